@@ -20,6 +20,7 @@ using namespace std;
 #include "includeFixes.h"
 #include "IntegratorVerlet.h"
 #include "IntegratorRelax.h"
+#include "IntegratorRESPA.h"
 #include "IntegratorGradientDescent.h"
 #include "FixLangevin.h"
 #include "boost_stls.h"
@@ -44,6 +45,7 @@ BOOST_PYTHON_MODULE(DASH) {
     export_Integrator();
     export_IntegratorVerlet();
     export_IntegratorRelax();
+    export_IntegratorRESPA();
     export_IntegratorGradientDescent();
     export_TypedItemHolder();
     export_Fix();
@@ -74,6 +76,9 @@ BOOST_PYTHON_MODULE(DASH) {
     export_Fix2d();
     export_FixLinearMomentum();
     export_FixRigid();
+    export_FixConstraint();
+    export_FixShake();
+    export_FixLINCS();
     export_FixTIP4PFlexible();
     export_FixE3B3();
     export_FixDeform();
@@ -88,6 +93,7 @@ BOOST_PYTHON_MODULE(DASH) {
     export_FixLJCHARMM();
     export_FixTICG();
     export_FixWCA();
+    export_FixPairTabulated();
     
     export_FixCharge();
     export_FixChargePairDSF();
@@ -0,0 +1,131 @@
+#pragma once
+#ifndef ACCUMULATOR_H
+#define ACCUMULATOR_H
+
+#include <cmath>
+#include "cutils_math.h"
+#include "Virial.h"
+
+//Types used to sum many float terms: per-atom sums over neighbors and bonded forcers,
+//and reductions over atoms in the data computers.  Per-pair math and the stored per-atom
+//arrays stay in float.  Build with -DMIXED_PRECISION=ON to accumulate in double.  Summing the
+//per-atom totals of all fixes is chosen at run time, see State::fixedPointForces and addAtomForce.
+#ifdef MIXED_PRECISION
+typedef double accum;
+#else
+typedef float accum;
+#endif
+
+//number of floats to reserve before an array of accumulators in a float shared memory buffer, so that the array is aligned
+inline __host__ __device__ int accumAlignedFloats(int nFloats) {
+    int width = sizeof(accum) / sizeof(float);
+    return ((nFloats + width - 1) / width) * width;
+}
+
+class Float3Accum {
+    public:
+        accum x;
+        accum y;
+        accum z;
+        __host__ __device__ Float3Accum() {};
+        __host__ __device__ Float3Accum(float3 v) : x(v.x), y(v.y), z(v.z) {};
+        inline __host__ __device__ void operator += (float3 v) {
+            x += v.x;
+            y += v.y;
+            z += v.z;
+        }
+        inline __host__ __device__ void operator += (const Float3Accum &other) {
+            x += other.x;
+            y += other.y;
+            z += other.z;
+        }
+        inline __host__ __device__ void operator -= (float3 v) {
+            x -= v.x;
+            y -= v.y;
+            z -= v.z;
+        }
+        inline __host__ __device__ float3 asFloat3() const {
+            return make_float3(x, y, z);
+        }
+};
+
+//as xx, yy, zz, xy, xz, yz, same as Virial
+class VirialAccum {
+    public:
+        accum vals[6];
+        accum &__host__ __device__ operator[] (int idx) {
+            return vals[idx];
+        }
+        __host__ __device__ VirialAccum() {};
+        __host__ __device__ VirialAccum(accum xx, accum yy, accum zz, accum xy, accum xz, accum yz) {
+            vals[0] = xx;
+            vals[1] = yy;
+            vals[2] = zz;
+            vals[3] = xy;
+            vals[4] = xz;
+            vals[5] = yz;
+        }
+        __host__ __device__ VirialAccum(const Virial &v) {
+            for (int i=0; i<6; i++) {
+                vals[i] = v.vals[i];
+            }
+        }
+        inline __host__ __device__ void operator += (const VirialAccum &other) {
+            for (int i=0; i<6; i++) {
+                vals[i] += other.vals[i];
+            }
+        }
+        inline __host__ __device__ void operator += (const Virial &other) {
+            for (int i=0; i<6; i++) {
+                vals[i] += other.vals[i];
+            }
+        }
+        inline __host__ __device__ void operator *=(float x) {
+            for (int i=0; i<6; i++) {
+                vals[i] *= x;
+            }
+        }
+        inline __host__ __device__ Virial asVirial() const {
+            return Virial(vals[0], vals[1], vals[2], vals[3], vals[4], vals[5]);
+        }
+};
+
+//Fixed point representation used for sums done with atomics when State::deterministic is set.
+//Integer addition is associative, so the result does not depend on the order threads add in.
+//2^32 leaves a range of +/- 2^31 with a resolution of 2^-32.
+#define FIXED_POINT_SCALE 4294967296.0
+
+inline __host__ __device__ long long toFixedPoint(double x) {
+    return llrint(x * FIXED_POINT_SCALE);
+}
+
+inline __host__ __device__ double fromFixedPoint(long long x) {
+    return x / FIXED_POINT_SCALE;
+}
+
+//Adds one thread's total for an atom to its force.  fsFixed holds x, y, z fixed point sums per atom when
+//State::fixedPointForces is set (see GPUData::fsFixed), otherwise the total is rounded into fs directly.
+//Only one thread may write a given atom in each kernel.
+inline __host__ __device__ void addAtomForce(float4 *fs, unsigned long long *fsFixed, int idx, const Float3Accum &f) {
+    if (fsFixed) {
+        fsFixed[3*idx] += (unsigned long long) toFixedPoint(f.x);
+        fsFixed[3*idx+1] += (unsigned long long) toFixedPoint(f.y);
+        fsFixed[3*idx+2] += (unsigned long long) toFixedPoint(f.z);
+    } else {
+        float3 sum = f.asFloat3();
+        float4 cur = fs[idx];
+        cur += sum;
+        fs[idx] = cur;
+    }
+}
+
+inline __host__ __device__ void computeVirial(VirialAccum &v, float3 force, float3 dr) {
+    v[0] += force.x * dr.x;
+    v[1] += force.y * dr.y;
+    v[2] += force.z * dr.z;
+    v[3] += force.x * dr.y;
+    v[4] += force.x * dr.z;
+    v[5] += force.y * dr.z;
+}
+
+#endif
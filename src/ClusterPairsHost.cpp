@@ -0,0 +1,110 @@
+#include "ClusterPairsHost.h"
+#include "helpers.h"
+
+void buildClusterPairListHost(const float4 *xs, const uint32_t *gridCellArrayIdxs, int3 ns, float3 os, float3 ds,
+                              const int *cellOrder, float3 periodic, float3 trace, float neighCutSqr,
+                              std::function<uint (int, int)> exclusionTag,
+                              std::vector<int> &clusterIdxs, std::vector<int> &cellClusterIdxs,
+                              std::vector<uint32_t> &clusterPairIdxs, std::vector<ClusterPair> &clusterPairs) {
+    int numGridCells = prod(ns);
+
+    //atoms are sorted by cell, so each cell is chopped into clusters of consecutive atoms
+    cellClusterIdxs.resize(numGridCells+1);
+    clusterIdxs.clear();
+    for (int cell=0; cell<numGridCells; cell++) {
+        cellClusterIdxs[cell] = clusterIdxs.size() / HOST_CLUSTER_SIZE;
+        for (uint32_t i=gridCellArrayIdxs[cell]; i<gridCellArrayIdxs[cell+1]; i+=HOST_CLUSTER_SIZE) {
+            for (int k=0; k<HOST_CLUSTER_SIZE; k++) {
+                clusterIdxs.push_back(i+k < gridCellArrayIdxs[cell+1] ? (int) (i+k) : -1);
+            }
+        }
+    }
+    int nClusters = clusterIdxs.size() / HOST_CLUSTER_SIZE;
+    cellClusterIdxs[numGridCells] = nClusters;
+
+    std::vector<float3> clusterLo(nClusters);
+    std::vector<float3> clusterHi(nClusters);
+    std::vector<int3> clusterCell(nClusters);
+#pragma omp parallel for schedule(static)
+    for (int c=0; c<nClusters; c++) {
+        float3 first = make_float3(xs[clusterIdxs[c*HOST_CLUSTER_SIZE]]);
+        float3 lo = first;
+        float3 hi = first;
+        for (int k=1; k<HOST_CLUSTER_SIZE; k++) {
+            int idx = clusterIdxs[c*HOST_CLUSTER_SIZE + k];
+            if (idx != -1) {
+                float3 pos = make_float3(xs[idx]);
+                lo = fminf(lo, pos);
+                hi = fmaxf(hi, pos);
+            }
+        }
+        clusterLo[c] = lo;
+        clusterHi[c] = hi;
+        clusterCell[c] = make_int3((first - os) / ds);
+    }
+
+    //bounding boxes closer than the cutoff make a pair.  Each pair is stored once, by the lower cluster, and
+    //compute_force_cluster_host applies the force to both.  A cluster paired with its own periodic image (small
+    //boxes) is met with shift and -shift, so only the image with the positive shift is kept
+    auto forEachClusterPair = [&] (int c, std::function<void (int, bool, float3)> f) {
+        forEachStencilCellHost(clusterCell[c], ns, cellOrder, periodic, trace, [&] (int sqrIdxOtherLin, bool ownCell, float3 shift) {
+            for (int other=cellClusterIdxs[sqrIdxOtherLin]; other<cellClusterIdxs[sqrIdxOtherLin+1]; other++) {
+                if (other < c) {
+                    continue;
+                }
+                if (other == c and not ownCell
+                    and not (shift.x > 0 or (shift.x == 0 and (shift.y > 0 or (shift.y == 0 and shift.z > 0))))) {
+                    continue;
+                }
+                float3 gap = fmaxf(make_float3(0, 0, 0),
+                                   fmaxf(clusterLo[other] + shift - clusterHi[c], clusterLo[c] - (clusterHi[other] + shift)));
+                if (dot(gap, gap) < neighCutSqr) {
+                    f(other, ownCell, shift);
+                }
+            }
+        });
+    };
+
+    clusterPairIdxs.resize(nClusters+1);
+#pragma omp parallel for schedule(static)
+    for (int c=0; c<nClusters; c++) {
+        int count = 0;
+        forEachClusterPair(c, [&] (int other, bool ownCell, float3 shift) { count++; });
+        clusterPairIdxs[c] = count;
+    }
+    clusterPairIdxs[nClusters] = 0;
+    cumulativeSum(clusterPairIdxs.data(), nClusters+1);
+    clusterPairs.resize(clusterPairIdxs.back());
+
+    bool useExclusions = (bool) exclusionTag;
+#pragma omp parallel for schedule(static)
+    for (int c=0; c<nClusters; c++) {
+        ClusterPair *pairs = clusterPairs.data() + clusterPairIdxs[c];
+        const int *myIdxs = clusterIdxs.data() + c*HOST_CLUSTER_SIZE;
+        forEachClusterPair(c, [&] (int other, bool ownCell, float3 shift) {
+            const int *otherIdxs = clusterIdxs.data() + other*HOST_CLUSTER_SIZE;
+            ClusterPair pair;
+            pair.otherCluster = other;
+            pair.shift = shift;
+            pair.mask = 0;
+            pair.exclusions = 0;
+            for (int i=0; i<HOST_CLUSTER_SIZE; i++) {
+                for (int j=0; j<HOST_CLUSTER_SIZE; j++) {
+                    int a = myIdxs[i];
+                    int b = otherIdxs[j];
+                    //within a cluster's own pair, each atom pair appears once
+                    if (a == -1 or b == -1 or (ownCell and other == c and b <= a)) {
+                        continue;
+                    }
+                    int bit = i*HOST_CLUSTER_SIZE + j;
+                    pair.mask |= (uint32_t) 1 << bit;
+                    if (useExclusions) {
+                        pair.exclusions |= (uint32_t) (exclusionTag(a, b) >> 30) << (2*bit);
+                    }
+                }
+            }
+            *pairs = pair;
+            pairs++;
+        });
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+#ifndef CLUSTER_PAIRS_HOST_H
+#define CLUSTER_PAIRS_HOST_H
+
+#include <cmath>
+#include <functional>
+#include <vector>
+
+#include "globalDefs.h"
+#include "cutils_math.h"
+
+/*! \brief Pair of atom clusters in the host cluster-pair list
+ *
+ * Bit i*HOST_CLUSTER_SIZE+j of mask is set if atom i of the owning cluster
+ * interacts with atom j of otherCluster.  exclusions holds the 1-2, 1-3,
+ * 1-4 tag of each atom pair in two bits at the same position times two.
+ */
+struct ClusterPair {
+    int otherCluster;
+    uint32_t mask;
+    uint32_t exclusions;
+    float3 shift; //!< periodic image offset added to otherCluster's positions
+};
+
+//calls f(otherCellLin, ownCell, shift) for each of the 27 cells around sqrIdx, same stencil as assignNeighbors
+template <class F>
+void forEachStencilCellHost(int3 sqrIdx, int3 ns, const int *cellOrder, float3 periodic, float3 trace, F f) {
+    int xIdx, yIdx, zIdx;
+    int xIdxLoop, yIdxLoop, zIdxLoop;
+    float3 offset = make_float3(0, 0, 0);
+    for (xIdx=sqrIdx.x-1; xIdx<=sqrIdx.x+1; xIdx++) {
+        offset.x = -floorf((float) xIdx / ns.x);
+        xIdxLoop = xIdx + ns.x * offset.x;
+        if (periodic.x || (!periodic.x && xIdxLoop == xIdx)) {
+
+            for (yIdx=sqrIdx.y-1; yIdx<=sqrIdx.y+1; yIdx++) {
+                offset.y = -floorf((float) yIdx / ns.y);
+                yIdxLoop = yIdx + ns.y * offset.y;
+                if (periodic.y || (!periodic.y && yIdxLoop == yIdx)) {
+
+                    for (zIdx=sqrIdx.z-1; zIdx<=sqrIdx.z+1; zIdx++) {
+                        offset.z = -floorf((float) zIdx / ns.z);
+                        zIdxLoop = zIdx + ns.z * offset.z;
+                        if (periodic.z || (!periodic.z && zIdxLoop == zIdx)) {
+                            bool ownCell = xIdx == sqrIdx.x and yIdx == sqrIdx.y and zIdx == sqrIdx.z;
+                            int3 sqrIdxOther = make_int3(xIdxLoop, yIdxLoop, zIdxLoop);
+                            f(CELLIDX(sqrIdxOther, ns, cellOrder), ownCell, (-offset) * trace);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/*! \brief Build the host cluster-pair list
+ *
+ * xs must be sorted by grid cell, with gridCellArrayIdxs holding the first
+ * atom of each cell.  Each cell's atoms are chopped into clusters of
+ * HOST_CLUSTER_SIZE consecutive atoms, and clusters whose bounding boxes are
+ * within the cutoff are paired.  Each pair is stored once, in the row of the
+ * lower cluster.  exclusionTag(a, b) gives the 1-2, 1-3, 1-4 tag (in the top
+ * two bits) of the atoms at idxs a and b; leave it empty if there are no
+ * exclusions.  See GridGPU::buildClusterPairsHost.
+ */
+void buildClusterPairListHost(const float4 *xs, const uint32_t *gridCellArrayIdxs, int3 ns, float3 os, float3 ds,
+                              const int *cellOrder, float3 periodic, float3 trace, float neighCutSqr,
+                              std::function<uint (int, int)> exclusionTag,
+                              std::vector<int> &clusterIdxs, std::vector<int> &cellClusterIdxs,
+                              std::vector<uint32_t> &clusterPairIdxs, std::vector<ClusterPair> &clusterPairs);
+
+#endif
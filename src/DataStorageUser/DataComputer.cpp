@@ -1,5 +1,6 @@
 #include "DataComputer.h"
 #include "State.h"
+#include <algorithm>
 namespace py = boost::python;
 using namespace MD_ENGINE;
 DataComputer::DataComputer(State *state_, std::string computeMode_, bool requiresVirials_) {
@@ -9,16 +10,20 @@ DataComputer::DataComputer(State *state_, std::string computeMode_, bool require
     lastGroupTag = 0;
 
     requiresPerAtomVirials = false; //though may be set to true by a derived class
+    canRunOnHost = false;
 };
 
 
 void DataComputer::prepareForRun() {
     if (computeMode=="scalar") {
-        gpuBufferReduce = GPUArrayGlobal<float>(2);
-        gpuBuffer = GPUArrayGlobal<float>(state->atoms.size());
+        //reductions write an accum (or a fixed point long long, see State::deterministic) and a count
+        int reduceSize = 2 * sizeof(double) / sizeof(float);
+        gpuBufferReduce = GPUArrayGlobal<float>(reduceSize);
+        gpuBuffer = GPUArrayGlobal<float>(std::max<int>(state->atoms.size(), reduceSize));
     } else if (computeMode=="tensor") {
-        gpuBufferReduce = GPUArrayGlobal<float>(2*6);
-        gpuBuffer = GPUArrayGlobal<float>(state->atoms.size() * 6);
+        int reduceSize = 2 * 6 * sizeof(double) / sizeof(float);
+        gpuBufferReduce = GPUArrayGlobal<float>(reduceSize);
+        gpuBuffer = GPUArrayGlobal<float>(std::max<int>(state->atoms.size() * 6, reduceSize));
     } else if (computeMode=="vector") {
         gpuBuffer = GPUArrayGlobal<float>(state->atoms.size());
         sorted = std::vector<double>(state->atoms.size());
@@ -41,6 +46,18 @@ void DataComputer::compute_GPU(bool transferToCPU, uint32_t groupTag) {
 
 
 
+void DataComputer::compute_host(uint32_t groupTag) {
+    if (computeMode=="scalar") {
+        computeScalar_host(groupTag);
+    } else if (computeMode=="tensor") {
+        computeTensor_host(groupTag);
+    } else if (computeMode=="vector") {
+        computeVector_host(groupTag);
+    }
+}
+
+
+
 void DataComputer::compute_CPU() {
     if (computeMode=="scalar") {
         computeScalar_CPU();
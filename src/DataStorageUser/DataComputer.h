@@ -36,6 +36,12 @@ namespace MD_ENGINE {
         virtual void computeVector_CPU() = 0;
         virtual void computeTensor_CPU() = 0;
 
+        //host backend versions of the _GPU functions.  They leave their results in the h_data of the same buffers,
+        //so the _CPU functions are shared.  Only computers with canRunOnHost set implement them
+        virtual void computeScalar_host(uint32_t groupTag) {}
+        virtual void computeVector_host(uint32_t groupTag) {}
+        virtual void computeTensor_host(uint32_t groupTag) {}
+
 
 
 
@@ -47,6 +53,7 @@ namespace MD_ENGINE {
 
         bool requiresVirials;
         bool requiresPerAtomVirials;
+        bool canRunOnHost; //!< True if the computer implements the _host functions; defaults to false
 
         GPUArrayGlobal<float> gpuBuffer; //will be cast as virial if necessary
         GPUArrayGlobal<float> gpuBufferReduce; //target for reductions, also maybe cast as virial
@@ -55,6 +62,7 @@ namespace MD_ENGINE {
         std::string computeMode;
         virtual void prepareForRun();
         void compute_GPU(bool transferToCPU, uint32_t groupTag);
+        void compute_host(uint32_t groupTag);
         void compute_CPU();
         void appendData(boost::python::list &);
         DataComputer(){};
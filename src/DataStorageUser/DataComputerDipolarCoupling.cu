@@ -67,7 +67,7 @@ void DataComputerDipolarCoupling::computeScalar_GPU(bool transferToHost, uint32_
     uint16_t *neighborCounts = grid.perAtomArray.d_data.data();
     float *neighborCoefs = state->specialNeighborCoefs;
     //hijacking energy group-group calculation to compute sum of 1/r^3, which we'll then multiple by some coefficient
-    evalWrap->energyGroupGroup(nAtoms, nPerRingPoly, gpd.xs(activeIdx), gpd.fs(activeIdx), gpuBuffer.getDevData(),neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(), state->devManager.prop.warpSize, rCutSqrArray.getDevData() /*giving junk data to the parameters*/, numTypes, state->boundsGPU, neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs(activeIdx), 0, groupTagA, groupTagB, state->nThreadPerBlock, state->nThreadPerAtom);
+    evalWrap->energyGroupGroup(nAtoms, nPerRingPoly, gpd.xs(activeIdx), gpd.fs(activeIdx), gpuBuffer.getDevData(),neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(), state->devManager.prop.warpSize, rCutSqrArray.getDevData() /*giving junk data to the parameters*/, numTypes, state->boundsGPU, neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs(activeIdx), 0, groupTagA, groupTagB, state->nThreadPerBlock, state->nThreadPerAtom, grid.compressedNeighborlist());
 
     coalesceInvR3<<<NBLOCK(nAtoms), PERBLOCK>>>(nAtoms, gpd.fs(activeIdx), gpuBuffer.getDevData(), (int *) gpuBufferReduce.getDevData(), coalescedInvR3.getDevData(), groupTagA);
     if (transferToHost) {
@@ -9,6 +9,7 @@ DataComputerEnergy::DataComputerEnergy(State *state_, py::list fixes_, std::stri
 
     groupTagB = state->groupTagFromHandle(groupHandleB);
     otherIsAll = groupHandleB == "all";
+    canRunOnHost = true;
     if (py::len(fixes_)) {
         int len = py::len(fixes_);
         for (int i=0; i<len; i++) {
@@ -42,11 +43,9 @@ void DataComputerEnergy::computeScalar_GPU(bool transferToCPU, uint32_t groupTag
         fix->setEvalWrapper();
     }
     if (groupTag == 1 or !otherIsAll) { //if other isn't all, then only group-group energies got computed so need to sum them all up anyway.  If other is all then every eng gets computed so need to accumulate only things in group
-         accumulate_gpu<float, float, SumSingle, N_DATA_PER_THREAD> <<<NBLOCK(nAtoms / (double) N_DATA_PER_THREAD), PERBLOCK, N_DATA_PER_THREAD*PERBLOCK*sizeof(float)>>>
-            (gpuBufferReduce.getDevData(), gpuBuffer.getDevData(), nAtoms, state->devManager.prop.warpSize, SumSingle());
+        accumulate((accum *) gpuBufferReduce.getDevData(), gpuBuffer.getDevData(), nAtoms, state->devManager.prop.warpSize, SumSingleAccum(), state->deterministic);
     } else {
-        accumulate_gpu_if<float, float, SumSingleIf, N_DATA_PER_THREAD> <<<NBLOCK(nAtoms / (double) N_DATA_PER_THREAD), PERBLOCK, N_DATA_PER_THREAD*PERBLOCK*sizeof(float)>>>
-            (gpuBufferReduce.getDevData(), gpuBuffer.getDevData(), nAtoms, state->devManager.prop.warpSize, SumSingleIf(gpd.fs.getDevData(), groupTag));
+        accumulateIf((accum *) gpuBufferReduce.getDevData(), gpuBuffer.getDevData(), nAtoms, state->devManager.prop.warpSize, SumSingleAccumIf(gpd.fs.getDevData(), groupTag), state->deterministic);
     }
     if (transferToCPU) {
         //does NOT sync
@@ -79,9 +78,37 @@ void DataComputerEnergy::computeVector_GPU(bool transferToCPU, uint32_t groupTag
 
 
 
+void DataComputerEnergy::computeEngsHost(uint32_t groupTag) {
+    mdAssert(otherIsAll, "Group-group energies are not supported by the host backend");
+    std::fill(gpuBuffer.h_data.begin(), gpuBuffer.h_data.end(), 0);
+    lastGroupTag = groupTag;
+    for (boost::shared_ptr<Fix> fix : fixes) {
+        fix->setEvalWrapperMode("self");
+        fix->setEvalWrapper();
+        fix->singlePointEngHost(gpuBuffer.h_data.data());
+        fix->setEvalWrapperMode("offload");
+        fix->setEvalWrapper();
+    }
+}
+
+void DataComputerEnergy::computeScalar_host(uint32_t groupTag) {
+    computeEngsHost(groupTag);
+    int nAtoms = state->atoms.size();
+    GPUData &gpd = state->gpd;
+    if (groupTag == 1) {
+        accumulateHost((accum *) gpuBufferReduce.h_data.data(), gpuBuffer.h_data.data(), nAtoms, SumSingleAccum(), state->deterministic);
+    } else {
+        accumulateIfHost((accum *) gpuBufferReduce.h_data.data(), gpuBuffer.h_data.data(), nAtoms, SumSingleAccumIf(gpd.fs.h_data.data(), groupTag), state->deterministic);
+    }
+}
+
+void DataComputerEnergy::computeVector_host(uint32_t groupTag) {
+    computeEngsHost(groupTag);
+}
+
 void DataComputerEnergy::computeScalar_CPU() {
     //int n;
-    double total = gpuBufferReduce.h_data[0];
+    double total = reductionResult<accum>(gpuBufferReduce.h_data.data(), state->deterministic);
     /*
     if (lastGroupTag == 1) {
         n = state->atoms.size();//* (int *) &tempGPUScalar.h_data[1];
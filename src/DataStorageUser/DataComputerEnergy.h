@@ -13,6 +13,11 @@ namespace MD_ENGINE {
             void computeVector_GPU(bool, uint32_t);
             void computeTensor_GPU(bool, uint32_t){};
 
+            void computeScalar_host(uint32_t);
+            void computeVector_host(uint32_t);
+            void computeTensor_host(uint32_t){};
+            void computeEngsHost(uint32_t); //per-atom energies into gpuBuffer's host data
+
             void computeScalar_CPU();
             void computeVector_CPU();
             void computeTensor_CPU(){};
@@ -7,6 +7,7 @@ using namespace MD_ENGINE;
 
 DataComputerPressure::DataComputerPressure(State *state_, std::string computeMode_) : DataComputer(state_, computeMode_, true), tempComputer(state_, computeMode_) {
     usingExternalTemperature = false;
+    canRunOnHost = true;
     if (computeMode == "vector") {
         requiresPerAtomVirials = true;
     }
@@ -23,15 +24,14 @@ void DataComputerPressure::computeScalar_GPU(bool transferToCPU, uint32_t groupT
     lastGroupTag = groupTag;
     int nAtoms = state->atoms.size();
     if (groupTag == 1) {
-         accumulate_gpu<float, Virial, SumVirialToScalar, N_DATA_PER_THREAD> <<<NBLOCK(nAtoms / (double) N_DATA_PER_THREAD), PERBLOCK, N_DATA_PER_THREAD*PERBLOCK*sizeof(float)>>>
-            (gpuBuffer.getDevData(), gpd.virials.getDevData(), nAtoms, state->devManager.prop.warpSize, SumVirialToScalar());
+        accumulate((accum *) gpuBuffer.getDevData(), gpd.virials.getDevData(), nAtoms, state->devManager.prop.warpSize, SumVirialToScalarAccum(), state->deterministic);
     } else {
-        accumulate_gpu_if<float, Virial, SumVirialToScalarIf, N_DATA_PER_THREAD> <<<NBLOCK(nAtoms / (double) N_DATA_PER_THREAD), PERBLOCK, N_DATA_PER_THREAD*PERBLOCK*sizeof(float)>>>
-            (gpuBuffer.getDevData(), 
-             gpd.virials.getDevData(), 
-             nAtoms, 
-             state->devManager.prop.warpSize, 
-             SumVirialToScalarIf(gpd.fs.getDevData(), groupTag));
+        accumulateIf((accum *) gpuBuffer.getDevData(), 
+                     gpd.virials.getDevData(), 
+                     nAtoms, 
+                     state->devManager.prop.warpSize, 
+                     SumVirialToScalarAccumIf(gpd.fs.getDevData(), groupTag),
+                     state->deterministic);
     }
     if (transferToCPU) {
         //does NOT sync
@@ -58,11 +58,9 @@ void DataComputerPressure::computeTensor_GPU(bool transferToCPU, uint32_t groupT
     int nAtoms = state->atoms.size();
     if (groupTag == 1) {
         
-        accumulate_gpu<Virial, Virial, SumVirial, N_DATA_PER_THREAD>  <<<NBLOCK(nAtoms / (double) N_DATA_PER_THREAD), PERBLOCK, N_DATA_PER_THREAD*PERBLOCK*sizeof(Virial)>>>
-            ((Virial *) gpuBuffer.getDevData(), gpd.virials.getDevData(), nAtoms, state->devManager.prop.warpSize, SumVirial());    
+        accumulate((VirialAccum *) gpuBuffer.getDevData(), gpd.virials.getDevData(), nAtoms, state->devManager.prop.warpSize, SumVirialAccum(), state->deterministic);    
     } else {
-        accumulate_gpu_if<Virial, Virial, SumVirialIf, N_DATA_PER_THREAD> <<<NBLOCK(nAtoms / (double) N_DATA_PER_THREAD), PERBLOCK, N_DATA_PER_THREAD*PERBLOCK*sizeof(Virial)>>>
-            ((Virial *) gpuBuffer.getDevData(), gpd.virials.getDevData(), nAtoms, state->devManager.prop.warpSize, SumVirialIf(gpd.fs.getDevData(), groupTag));
+        accumulateIf((VirialAccum *) gpuBuffer.getDevData(), gpd.virials.getDevData(), nAtoms, state->devManager.prop.warpSize, SumVirialAccumIf(gpd.fs.getDevData(), groupTag), state->deterministic);
     } 
     if (transferToCPU) {
         //does NOT sync
@@ -70,6 +68,30 @@ void DataComputerPressure::computeTensor_GPU(bool transferToCPU, uint32_t groupT
     }
 }
 
+void DataComputerPressure::computeScalar_host(uint32_t groupTag) {
+    mdAssert(groupTag == 1, "Trying to compute pressure for group other than 'all'");
+    if (!usingExternalTemperature) {
+        tempComputer.computeScalar_host(groupTag);
+    }
+    lastGroupTag = groupTag;
+    int nAtoms = state->atoms.size();
+    accumulateHost((accum *) gpuBuffer.h_data.data(), state->gpd.virials.h_data.data(), nAtoms, SumVirialToScalarAccum(), state->deterministic);
+}
+
+//per-atom virials are already on the host
+void DataComputerPressure::computeVector_host(uint32_t groupTag) {
+}
+
+void DataComputerPressure::computeTensor_host(uint32_t groupTag) {
+    mdAssert(groupTag == 1, "Trying to compute pressure for group other than 'all'");
+    if (!usingExternalTemperature) {
+        tempComputer.computeTensor_host(groupTag);
+    }
+    lastGroupTag = groupTag;
+    int nAtoms = state->atoms.size();
+    accumulateHost((VirialAccum *) gpuBuffer.h_data.data(), state->gpd.virials.h_data.data(), nAtoms, SumVirialAccum(), state->deterministic);
+}
+
 void DataComputerPressure::computeScalar_CPU() {
     //we are assuming that z component of virial is zero if sim is 2D
     float boltz = state->units.boltz;
@@ -82,7 +104,7 @@ void DataComputerPressure::computeScalar_CPU() {
         tempScalar_loc = tempComputer.tempScalar;
         ndf_loc = tempComputer.ndf;
     }
-    double sumVirial = gpuBuffer.h_data[0];
+    double sumVirial = reductionResult<accum>(gpuBuffer.h_data.data(), state->deterministic);
     double dim = state->is2d ? 2 : 3;
     double volume = state->boundsGPU.volume();
     pressureScalar = (tempScalar_loc * ndf_loc * boltz + sumVirial) / (dim * volume) * state->units.nktv_to_press;
@@ -104,7 +126,7 @@ void DataComputerPressure::computeTensor_CPU() {
         tempTensor_loc = tempComputer.tempTensor;
     }
     pressureTensor = Virial(0, 0, 0, 0, 0, 0);
-    Virial sumVirial = * (Virial *) gpuBuffer.h_data.data();
+    Virial sumVirial = reductionResult<VirialAccum>(gpuBuffer.h_data.data(), state->deterministic).asVirial();
     double volume = state->boundsGPU.volume();
     for (int i=0; i<6; i++) {
         pressureTensor[i] = (tempTensor_loc[i] + sumVirial[i]) / volume * state->units.nktv_to_press;
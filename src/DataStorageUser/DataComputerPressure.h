@@ -15,6 +15,10 @@ namespace MD_ENGINE {
             void computeVector_GPU(bool, uint32_t);
             void computeTensor_GPU(bool, uint32_t);
 
+            void computeScalar_host(uint32_t);
+            void computeVector_host(uint32_t);
+            void computeTensor_host(uint32_t);
+
             void computeScalar_CPU();
             void computeVector_CPU();
             void computeTensor_CPU();
@@ -7,7 +7,7 @@ namespace py = boost::python;
 using namespace MD_ENGINE;
 
 DataComputerTemperature::DataComputerTemperature(State *state_, std::string computeMode_) : DataComputer(state_, computeMode_, false) {
-
+    canRunOnHost = true;
 }
 
 
@@ -17,11 +17,9 @@ void DataComputerTemperature::computeScalar_GPU(bool transferToCPU, uint32_t gro
     lastGroupTag = groupTag;
     int nAtoms = state->atoms.size();
     if (groupTag == 1) {
-         accumulate_gpu<float, float4, SumVectorSqr3DOverW, N_DATA_PER_THREAD> <<<NBLOCK(nAtoms / (double) N_DATA_PER_THREAD), PERBLOCK, N_DATA_PER_THREAD*PERBLOCK*sizeof(float)>>>
-            (gpuBuffer.getDevData(), state->gpd.vs.getDevData(), nAtoms, state->devManager.prop.warpSize, SumVectorSqr3DOverW());
+        accumulate((accum *) gpuBuffer.getDevData(), state->gpd.vs.getDevData(), nAtoms, state->devManager.prop.warpSize, SumVectorSqr3DOverWAccum(), state->deterministic);
     } else {
-        accumulate_gpu_if<float, float4, SumVectorSqr3DOverWIf, N_DATA_PER_THREAD> <<<NBLOCK(nAtoms / (double) N_DATA_PER_THREAD), PERBLOCK, N_DATA_PER_THREAD*PERBLOCK*sizeof(float)>>>
-            (gpuBuffer.getDevData(), gpd.vs.getDevData(), nAtoms, state->devManager.prop.warpSize, SumVectorSqr3DOverWIf(gpd.fs.getDevData(), groupTag));
+        accumulateIf((accum *) gpuBuffer.getDevData(), gpd.vs.getDevData(), nAtoms, state->devManager.prop.warpSize, SumVectorSqr3DOverWAccumIf(gpd.fs.getDevData(), groupTag), state->deterministic);
     }
     if (transferToCPU) {
         //does NOT sync
@@ -69,11 +67,9 @@ void DataComputerTemperature::computeTensor_GPU(bool transferToCPU, uint32_t gro
     lastGroupTag = groupTag;
     int nAtoms = state->atoms.size();
     if (groupTag == 1) {
-        accumulate_gpu<Virial, float4, SumVectorToVirialOverW, N_DATA_PER_THREAD>  <<<NBLOCK(nAtoms / (double) N_DATA_PER_THREAD), PERBLOCK, N_DATA_PER_THREAD*PERBLOCK*sizeof(Virial)>>>
-            ((Virial *) gpuBuffer.getDevData(), gpd.vs.getDevData(), nAtoms, state->devManager.prop.warpSize, SumVectorToVirialOverW());    
+        accumulate((VirialAccum *) gpuBuffer.getDevData(), gpd.vs.getDevData(), nAtoms, state->devManager.prop.warpSize, SumVectorToVirialOverWAccum(), state->deterministic);    
     } else {
-        accumulate_gpu_if<Virial, float4, SumVectorToVirialOverWIf, N_DATA_PER_THREAD> <<<NBLOCK(nAtoms / (double) N_DATA_PER_THREAD), PERBLOCK, N_DATA_PER_THREAD*PERBLOCK*sizeof(Virial)>>>
-            ((Virial *) gpuBuffer.getDevData(), gpd.vs.getDevData(), nAtoms, state->devManager.prop.warpSize, SumVectorToVirialOverWIf(gpd.fs.getDevData(), groupTag));
+        accumulateIf((VirialAccum *) gpuBuffer.getDevData(), gpd.vs.getDevData(), nAtoms, state->devManager.prop.warpSize, SumVectorToVirialOverWAccumIf(gpd.fs.getDevData(), groupTag), state->deterministic);
     } 
     if (transferToCPU) {
         //does NOT sync
@@ -81,9 +77,43 @@ void DataComputerTemperature::computeTensor_GPU(bool transferToCPU, uint32_t gro
     }
 }
 
+void DataComputerTemperature::computeScalar_host(uint32_t groupTag) {
+    GPUData &gpd = state->gpd;
+    lastGroupTag = groupTag;
+    int nAtoms = state->atoms.size();
+    if (groupTag == 1) {
+        accumulateHost((accum *) gpuBuffer.h_data.data(), gpd.vs.h_data.data(), nAtoms, SumVectorSqr3DOverWAccum(), state->deterministic);
+    } else {
+        accumulateIfHost((accum *) gpuBuffer.h_data.data(), gpd.vs.h_data.data(), nAtoms, SumVectorSqr3DOverWAccumIf(gpd.fs.h_data.data(), groupTag), state->deterministic);
+    }
+}
+
+void DataComputerTemperature::computeVector_host(uint32_t groupTag) {
+    GPUData &gpd = state->gpd;
+    lastGroupTag = groupTag;
+    int nAtoms = state->atoms.size();
+    SumVectorSqr3DOverW instance;
+    float *kes = gpuBuffer.h_data.data();
+#pragma omp parallel for schedule(static)
+    for (int i=0; i<nAtoms; i++) {
+        kes[i] = instance.process(gpd.vs.h_data[i]);
+    }
+}
+
+void DataComputerTemperature::computeTensor_host(uint32_t groupTag) {
+    GPUData &gpd = state->gpd;
+    lastGroupTag = groupTag;
+    int nAtoms = state->atoms.size();
+    if (groupTag == 1) {
+        accumulateHost((VirialAccum *) gpuBuffer.h_data.data(), gpd.vs.h_data.data(), nAtoms, SumVectorToVirialOverWAccum(), state->deterministic);
+    } else {
+        accumulateIfHost((VirialAccum *) gpuBuffer.h_data.data(), gpd.vs.h_data.data(), nAtoms, SumVectorToVirialOverWAccumIf(gpd.fs.h_data.data(), groupTag), state->deterministic);
+    }
+}
+
 void DataComputerTemperature::computeScalar_CPU() {
     //int n;
-    double total = gpuBuffer.h_data[0];
+    double total = reductionResult<accum>(gpuBuffer.h_data.data(), state->deterministic);
     /*
     if (lastGroupTag == 1) {
         n = state->atoms.size();//\* (int *) &gpuBuffer.h_data[1];
@@ -124,7 +154,7 @@ void DataComputerTemperature::computeVector_CPU() {
 }
 
 void DataComputerTemperature::computeTensor_CPU() {
-    Virial total = *(Virial *) &gpuBuffer.h_data[0];
+    Virial total = reductionResult<VirialAccum>(gpuBuffer.h_data.data(), state->deterministic).asVirial();
     total *= (state->units.mvv_to_eng / state->units.boltz);
     /*
     int n;
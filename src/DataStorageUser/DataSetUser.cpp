@@ -20,7 +20,11 @@ void DataSetUser::prepareForRun() {
     
 }
 void DataSetUser::computeData() {
-    computer->compute_GPU(true, groupTag);
+    if (state->backend == BACKEND::HOST) {
+        computer->compute_host(groupTag);
+    } else {
+        computer->compute_GPU(true, groupTag);
+    }
     //if (dataMode == DATAMODE::SCALAR) {
     //    computer->computeScalar_GPU(true, groupTag);
     //} else if (dataMode == DATAMODE::VECTOR) {
@@ -1,14 +1,45 @@
 #include "DeviceManager.h"
 #include "boost_for_export.h"
+#include "GPUArrayDevice.h"
 
+#include <cstring>
 #include <iostream>
 using namespace std;
 using namespace boost::python;
+//the manager which selects the device before the first device allocation
+static DeviceManager *selectingManager = nullptr;
+
 DeviceManager::DeviceManager() {
-    cudaGetDeviceCount(&nDevices);
+    nDevices = 0;
+    currentDevice = -1;
+    initialized = false;
+    memset(&prop, 0, sizeof(prop));
+    prop.warpSize = 32;
+    selectingManager = this;
+    GPUArrayDevice::selectDevice = [this] () { init(); };
+}
+DeviceManager::~DeviceManager() {
+    if (selectingManager == this) {
+        selectingManager = nullptr;
+        GPUArrayDevice::selectDevice = nullptr;
+    }
+}
+void DeviceManager::init() {
+    if (initialized) {
+        return;
+    }
+    initialized = true;
+    if (cudaGetDeviceCount(&nDevices) != cudaSuccess) {
+        nDevices = 0;
+    }
     setDevice(nDevices-1);
 }
+int DeviceManager::getNDevices() {
+    init();
+    return nDevices;
+}
 bool DeviceManager::setDevice(int i, bool output) {
+    init();
     if (i >= 0 and i < nDevices) {
         //add error handling here
         cudaSetDevice(i);
@@ -25,11 +56,9 @@ bool DeviceManager::setDevice(int i, bool output) {
 void export_DeviceManager() {
     class_<DeviceManager, boost::noncopyable>("DeviceManager", no_init)
         
-        .def_readonly("nDevices", &DeviceManager::nDevices)
+        .add_property("nDevices", &DeviceManager::getNDevices)
         .def_readonly("currentDevice", &DeviceManager::currentDevice)
         .def("setDevice", &DeviceManager::setDevice, (boost::python::arg("i"), boost::python::arg("output")=true ))
         ;
 
 }
-
-
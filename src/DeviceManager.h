@@ -7,13 +7,25 @@
 #include <cuda_runtime_api.h>
 void export_DeviceManager();
 
+//! Selects the GPU
+/*!
+ * Devices are only queried when a GPU is first needed (a device allocation,
+ * a GPU run, or a call from Python), so runs on the host backend work on
+ * machines without a GPU.  Until then prop holds only a warp size of 32.
+ */
 class DeviceManager {
 public:
     int nDevices;
     DeviceManager();
+    ~DeviceManager();
     cudaDeviceProp prop;
+    //! Query the devices and select the last one, if not done already
+    void init();
     bool setDevice(int, bool output=false);
+    int getNDevices();
     int currentDevice;
+private:
+    bool initialized;
 };
 
 #endif
@@ -1,6 +1,6 @@
 #define SMALL 0.0001f
 template <class ANGLETYPE, class EVALUATOR, bool COMPUTEVIRIALS>
-__global__ void compute_force_angle(int nAtoms, float4 *xs, float4 *forces, int *idToIdxs, AngleGPU *angles, int *startstops, BoundsGPU bounds, ANGLETYPE *parameters_arg, int nParameters, Virial *__restrict__ virials, bool usingSharedMemForParams, EVALUATOR evaluator) {
+__global__ void compute_force_angle(int nAtoms, float4 *xs, float4 *forces, unsigned long long *forcesFixed, int *idToIdxs, AngleGPU *angles, int *startstops, BoundsGPU bounds, ANGLETYPE *parameters_arg, int nParameters, Virial *__restrict__ virials, bool usingSharedMemForParams, EVALUATOR evaluator) {
 
     int idx = GETIDX();
     extern __shared__ char all_shr[];
@@ -26,7 +26,7 @@ __global__ void compute_force_angle(int nAtoms, float4 *xs, float4 *forces, int
         int shr_idx = startIdx - idxBeginCopy;
         int n = endIdx - startIdx;
         if (n>0) {
-            Virial virialSum(0, 0, 0, 0, 0, 0);
+            VirialAccum virialSum(0, 0, 0, 0, 0, 0);
             int myIdxInAngle = angles_shr[shr_idx].type >> 29;
             int idSelf = angles_shr[shr_idx].ids[myIdxInAngle];
 
@@ -34,7 +34,7 @@ __global__ void compute_force_angle(int nAtoms, float4 *xs, float4 *forces, int
             float3 pos = make_float3(xs[idxSelf]);
             //printf("pos %f %f %f\n", 
             //float3 pos = make_float3(float4FromIndex(xs, idxSelf));
-            float3 forceSum = make_float3(0, 0, 0);
+            Float3Accum forceSum(make_float3(0, 0, 0));
             for (int i=0; i<n; i++) {
              //   printf("ANGLE! %d\n", i);
                 AngleGPU angle = angles_shr[shr_idx + i];
@@ -104,12 +104,11 @@ __global__ void compute_force_angle(int nAtoms, float4 *xs, float4 *forces, int
 
 
             }
-            float4 curForce = forces[idxSelf];
-            curForce += forceSum;
-            forces[idxSelf] = curForce;
+            addAtomForce(forces, forcesFixed, idxSelf, forceSum);
             if (COMPUTEVIRIALS) {
                 virialSum *= 1.0f / 3.0f;
-                virials[idx] += virialSum;
+                Virial tmp = virialSum.asVirial();
+                virials[idx] += tmp;
             }
         }
     }
@@ -153,7 +152,7 @@ __global__ void compute_energy_angle(int nAtoms, float4 *xs, float *perParticleE
             int idxSelf = idToIdxs[idSelf];
             float3 pos = make_float3(xs[idxSelf]);
             //float3 pos = make_float3(float4FromIndex(xs, idxSelf));
-            float engSum = 0;
+            accum engSum = 0;
             for (int i=0; i<n; i++) {
              //   printf("ANGLE! %d\n", i);
                 AngleGPU angle = angles_shr[shr_idx + i];
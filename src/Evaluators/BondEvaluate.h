@@ -1,6 +1,6 @@
 #define SMALL 0.0001f
 template <class BONDTYPE, class EVALUATOR, bool COMPUTEVIRIALS>
-__global__ void compute_force_bond(int nAtoms, float4 *xs, float4 *forces, int *idToIdxs, BondGPU *bonds, int *startstops, BONDTYPE *parameters_arg, int nParameters, BoundsGPU bounds, Virial *__restrict__ virials, bool usingSharedMemForParams, EVALUATOR T) {
+__global__ void compute_force_bond(int nAtoms, float4 *xs, float4 *forces, unsigned long long *forcesFixed, int *idToIdxs, BondGPU *bonds, int *startstops, BONDTYPE *parameters_arg, int nParameters, BoundsGPU bounds, Virial *__restrict__ virials, bool usingSharedMemForParams, EVALUATOR T) {
 
     int idx = GETIDX();
     extern __shared__ char all_shr[];
@@ -18,7 +18,7 @@ __global__ void compute_force_bond(int nAtoms, float4 *xs, float4 *forces, int *
     }
     __syncthreads();
     if (idx < nAtoms) {
-        Virial virialsSum = Virial(0, 0, 0, 0, 0, 0);
+        VirialAccum virialsSum = VirialAccum(0, 0, 0, 0, 0, 0);
   //      printf("going to compute %d\n", idx);
         int startIdx = startstops[idx]; 
         int endIdx = startstops[idx+1];
@@ -33,7 +33,7 @@ __global__ void compute_force_bond(int nAtoms, float4 *xs, float4 *forces, int *
 
 
             float3 pos = make_float3(xs[myIdx]);
-            float3 forceSum = make_float3(0, 0, 0);
+            Float3Accum forceSum(make_float3(0, 0, 0));
             for (int i=0; i<n; i++) {
                 BondGPU b = bonds_shr[shr_idx + i];
                 int type = b.type;
@@ -51,11 +51,12 @@ __global__ void compute_force_bond(int nAtoms, float4 *xs, float4 *forces, int *
                     computeVirial(virialsSum, force, bondVec);
                 }
             }
-            forces[myIdx] += forceSum;
+            addAtomForce(forces, forcesFixed, myIdx, forceSum);
 
             if (COMPUTEVIRIALS) {
                 virialsSum *= 0.5f;
-                virials[idx] += virialsSum;
+                Virial tmp = virialsSum.asVirial();
+                virials[idx] += tmp;
             }
         }
     }
@@ -95,7 +96,7 @@ __global__ void compute_energy_bond(int nAtoms, float4 *xs, float *perParticleEn
 
 
             float3 pos = make_float3(xs[myIdx]);
-            float energySum = 0;
+            accum energySum = 0;
             for (int i=0; i<n; i++) {
                 BondGPU b = bonds_shr[shr_idx + i];
                 int type = b.type;
@@ -116,3 +117,68 @@ __global__ void compute_energy_bond(int nAtoms, float4 *xs, float *perParticleEn
     }
 }
 
+
+//host version of compute_force_bond, used by the host backend.  Each slot in startstops belongs to one atom, so threads never write to the same atom
+template <class BONDTYPE, class EVALUATOR, bool COMPUTEVIRIALS>
+void compute_force_bond_host(int nAtoms, float4 *xs, float4 *forces, int *idToIdxs, BondGPU *bonds, int *startstops, BONDTYPE *parameters, BoundsGPU bounds, Virial *__restrict__ virials, EVALUATOR T) {
+#pragma omp parallel for schedule(static)
+    for (int idx=0; idx<nAtoms; idx++) {
+        Virial virialsSum = Virial(0, 0, 0, 0, 0, 0);
+        int startIdx = startstops[idx];
+        int endIdx = startstops[idx+1];
+        int n = endIdx - startIdx;
+        if (n>0) {
+            int myId = bonds[startIdx].myId;
+            int myIdx = idToIdxs[myId];
+            float3 pos = make_float3(xs[myIdx]);
+            float3 forceSum = make_float3(0, 0, 0);
+            for (int i=startIdx; i<endIdx; i++) {
+                BondGPU b = bonds[i];
+                BONDTYPE bondType = parameters[b.type];
+                int otherIdx = idToIdxs[b.otherId];
+
+                float3 posOther = make_float3(xs[otherIdx]);
+                float3 bondVec  = bounds.minImage(pos - posOther);
+                float rSqr = lengthSqr(bondVec);
+                float3 force = T.force(bondVec, rSqr, bondType);
+                forceSum += force;
+                if (COMPUTEVIRIALS) {
+                    computeVirial(virialsSum, force, bondVec);
+                }
+            }
+            forces[myIdx] += forceSum;
+
+            if (COMPUTEVIRIALS) {
+                virialsSum *= 0.5f;
+                virials[idx] += virialsSum;
+            }
+        }
+    }
+}
+
+template <class BONDTYPE, class EVALUATOR>
+void compute_energy_bond_host(int nAtoms, float4 *xs, float *perParticleEng, int *idToIdxs, BondGPU *bonds, int *startstops, BONDTYPE *parameters, BoundsGPU bounds, EVALUATOR T) {
+#pragma omp parallel for schedule(static)
+    for (int idx=0; idx<nAtoms; idx++) {
+        int startIdx = startstops[idx];
+        int endIdx = startstops[idx+1];
+        int n = endIdx - startIdx;
+        if (n>0) {
+            int myId = bonds[startIdx].myId;
+            int myIdx = idToIdxs[myId];
+            float3 pos = make_float3(xs[myIdx]);
+            accum energySum = 0;
+            for (int i=startIdx; i<endIdx; i++) {
+                BondGPU b = bonds[i];
+                BONDTYPE bondType = parameters[b.type];
+                int otherIdx = idToIdxs[b.otherId];
+
+                float3 posOther = make_float3(xs[otherIdx]);
+                float3 bondVec  = bounds.minImage(pos - posOther);
+                float rSqr = lengthSqr(bondVec);
+                energySum += T.energy(bondVec, rSqr, bondType);
+            }
+            perParticleEng[myIdx] += energySum;
+        }
+    }
+}
@@ -6,7 +6,7 @@
 
 class BondEvaluatorFENE{
 public:
-    inline __device__ float3 force(float3 bondVec, float rSqr, BondFENEType bondType) {
+    inline __host__ __device__ float3 force(float3 bondVec, float rSqr, BondFENEType bondType) {
         float k = bondType.k;
         float r0 = bondType.r0;
         float eps = bondType.eps;
@@ -29,7 +29,7 @@ public:
         float3 force = bondVec * fbond;
         return force;
     }
-    inline __device__ float energy(float3 bondVec, float rSqr, BondFENEType bondType) {
+    inline __host__ __device__ float energy(float3 bondVec, float rSqr, BondFENEType bondType) {
         float k = bondType.k;
         float r0 = bondType.r0;
         float eps = bondType.eps;
@@ -6,7 +6,7 @@
 
 class BondEvaluatorHarmonic {
 public:
-    inline __device__ float3 force(float3 bondVec, float rSqr, BondHarmonicType bondType) {
+    inline __host__ __device__ float3 force(float3 bondVec, float rSqr, BondHarmonicType bondType) {
         float r = sqrtf(rSqr);
         float dr = r - bondType.r0;
         float rk = bondType.k * dr;
@@ -16,7 +16,7 @@ public:
         } 
         return make_float3(0, 0, 0);
     }
-    inline __device__ float energy(float3 bondVec, float rSqr, BondHarmonicType bondType) {
+    inline __host__ __device__ float energy(float3 bondVec, float rSqr, BondHarmonicType bondType) {
         float r = sqrtf(rSqr);
         float dr = r - bondType.r0;
         //printf("%f\n", (bondType.k/2.0) * 0.066 / (3.5*3.5));
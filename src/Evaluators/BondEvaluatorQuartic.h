@@ -6,7 +6,7 @@
 
 class BondEvaluatorQuartic {
 public:
-    inline __device__ float3 force(float3 bondVec, float rSqr, BondQuarticType bondType) {
+    inline __host__ __device__ float3 force(float3 bondVec, float rSqr, BondQuarticType bondType) {
         float r = sqrtf(rSqr);
         if (r > 0) {
             float dr = r - bondType.r0;
@@ -18,7 +18,7 @@ public:
         } 
         return make_float3(0, 0, 0);
     }
-    inline __device__ float energy(float3 bondVec, float rSqr, BondQuarticType bondType) {
+    inline __host__ __device__ float energy(float3 bondVec, float rSqr, BondQuarticType bondType) {
         float r  = sqrtf(rSqr);
         float dr = r - bondType.r0;
         float dr2= dr*dr;
@@ -9,14 +9,14 @@ class ChargeEvaluatorDSF {
         float shift;
         float qqr_to_eng;
         float r_cut;
-        inline __device__ float3 force(float3 dr, float lenSqr, float qi, float qj, float multiplier) {
+        inline __host__ __device__ float3 force(float3 dr, float lenSqr, float qi, float qj, float multiplier) {
             float r2inv = 1.0f/lenSqr;
             float rinv = sqrtf(r2inv);
             float len = sqrtf(lenSqr);
             float forceScalar = qqr_to_eng * qi*qj*(erfcf((alpha*len))*r2inv+A*expf(-alpha*alpha*lenSqr)*rinv-shift)*rinv * multiplier;
             return dr * forceScalar;
         }
-        inline __device__ float energy(float lenSqr, float qi, float qj, float multiplier) {
+        inline __host__ __device__ float energy(float lenSqr, float qi, float qj, float multiplier) {
             float r2inv = 1.0f/lenSqr;
             float rinv = sqrtf(r2inv);
             float len = sqrtf(lenSqr);
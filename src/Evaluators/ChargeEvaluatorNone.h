@@ -6,13 +6,13 @@
 
 class ChargeEvaluatorNone {
     public:
-        inline __device__ float3 force(float3 dr, float lenSqr, float qi, float qj, float multiplier) {
+        inline __host__ __device__ float3 force(float3 dr, float lenSqr, float qi, float qj, float multiplier) {
             return make_float3(0, 0, 0);
         }
-        inline __device__ float energy(float lenSqr, float qi, float qj, float multiplier) {
+        inline __host__ __device__ float energy(float lenSqr, float qi, float qj, float multiplier) {
             return 0;
         }
-      /*  inline __device__ float energy(float params[3], float lenSqr, float multiplier) {
+      /*  inline __host__ __device__ float energy(float params[3], float lenSqr, float multiplier) {
             float epstimes24 = params[1];
             float sig6 = params[2];
             float r2inv = 1/lenSqr;
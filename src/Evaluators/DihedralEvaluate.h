@@ -1,5 +1,5 @@
 template <class DIHEDRALTYPE, class EVALUATOR, bool COMPUTEVIRIALS> //don't need DihedralGPU, are all DihedralGPU.  Worry about later 
-__global__ void compute_force_dihedral(int nDihedrals, float4 *xs, float4 *fs, int *idToIdxs, DihedralGPU *dihedrals, BoundsGPU bounds, DIHEDRALTYPE *parameters_arg, int nParameters, Virial *virials, bool usingSharedMemForParams, EVALUATOR evaluator) {
+__global__ void compute_force_dihedral(int nDihedrals, float4 *xs, float4 *fs, int *idToIdxs, DihedralGPU *dihedrals, BoundsGPU bounds, DIHEDRALTYPE *parameters_arg, int nParameters, Virial *virials, unsigned long long *fsFixed, unsigned long long *virialsFixed, bool usingSharedMemForParams, EVALUATOR evaluator) {
 
 
     int idx = GETIDX();
@@ -147,9 +147,15 @@ __global__ void compute_force_dihedral(int nDihedrals, float4 *xs, float4 *fs, i
         forces[2] = sFloat3 - forces[3];
         //printf("phi is %f\n", phi);
         for (int i=0; i<4; i++) {
-            atomicAdd(&(fs[idxs[i]].x), (forces[i].x));
-            atomicAdd(&(fs[idxs[i]].y), (forces[i].y));
-            atomicAdd(&(fs[idxs[i]].z), (forces[i].z));
+            if (fsFixed) {
+                atomicAddFixedPoint(fsFixed + 3*idxs[i], forces[i].x);
+                atomicAddFixedPoint(fsFixed + 3*idxs[i]+1, forces[i].y);
+                atomicAddFixedPoint(fsFixed + 3*idxs[i]+2, forces[i].z);
+            } else {
+                atomicAdd(&(fs[idxs[i]].x), (forces[i].x));
+                atomicAdd(&(fs[idxs[i]].y), (forces[i].y));
+                atomicAdd(&(fs[idxs[i]].z), (forces[i].z));
+            }
         //    printf("f %d is %f %f %f\n", i, forces[i].x, forces[i].y, forces[i].z);
         }
 
@@ -163,7 +169,11 @@ __global__ void compute_force_dihedral(int nDihedrals, float4 *xs, float4 *fs, i
             //just adding virials to one of them
             for (int i=0; i<6; i++) {
                 //printf("virial %d %f\n", i, sumVirials[i]);
-                atomicAdd(&(virials[idxs[0]][i]), sumVirials[i]);
+                if (virialsFixed) {
+                    atomicAddFixedPoint(virialsFixed + 6*idxs[0]+i, sumVirials[i]);
+                } else {
+                    atomicAdd(&(virials[idxs[0]][i]), sumVirials[i]);
+                }
             }
         }
     }
@@ -171,7 +181,7 @@ __global__ void compute_force_dihedral(int nDihedrals, float4 *xs, float4 *fs, i
 
 
 template <class DIHEDRALTYPE, class EVALUATOR>
-__global__ void compute_energy_dihedral(int nDihedrals, float4 *xs, float *perParticleEng, int *idToIdxs, DihedralGPU *dihedrals, BoundsGPU bounds, DIHEDRALTYPE *parameters_arg, int nParameters, bool usingSharedMemForParams, EVALUATOR evaluator) {
+__global__ void compute_energy_dihedral(int nDihedrals, float4 *xs, float *perParticleEng, unsigned long long *engsFixed, int *idToIdxs, DihedralGPU *dihedrals, BoundsGPU bounds, DIHEDRALTYPE *parameters_arg, int nParameters, bool usingSharedMemForParams, EVALUATOR evaluator) {
  
     int idx = GETIDX();
     extern __shared__ char all_shr[];
@@ -274,7 +284,11 @@ __global__ void compute_energy_dihedral(int nDihedrals, float4 *xs, float *perPa
         //printf("no force\n");
         float potential = evaluator.potential(dihedralType, phi) * 0.25f;
         for (int i=0; i<4; i++) {
-            atomicAdd(perParticleEng + idxs[i], potential);
+            if (engsFixed) {
+                atomicAddFixedPoint(engsFixed + idxs[i], potential);
+            } else {
+                atomicAdd(perParticleEng + idxs[i], potential);
+            }
         }
     }
 }
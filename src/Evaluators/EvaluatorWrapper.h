@@ -1,14 +1,19 @@
 #pragma once
 #include "PairEvaluateIso.h"
+#include "PairEvaluateIsoHost.h"
+#include "PairEvaluateClusterHost.h"
 #include <boost/shared_ptr.hpp>
 #include "FixChargeEwald.h"
 #include "FixChargePairDSF.h"
 #include "ChargeEvaluatorNone.h"
 class EvaluatorWrapper {
 public:
-    virtual void compute(int nAtoms, int nPerRingPoly, float4 *xs, float4 *fs, uint16_t *neighborCounts, uint *neighborlist, uint32_t *cumulSumMaxPerBlock, int warpSize, float *parameters, int numTypes,  BoundsGPU bounds, float onetwoStr, float onethreeStr, float onefourStr, Virial *virials, float *qs, float qCutoffSqr, int virialMode, int nThreadPerBlock, int nThreadPerAtom) {};
-    virtual void energy(int nAtoms, int nPerRingPoly, float4 *xs, float *perParticleEng, uint16_t *neighborCounts, uint *neighborlist, uint32_t *cumulSumMaxPerBlock, int warpSize, float *parameters, int numTypes, BoundsGPU bounds, float onetwoStr, float onethreeStr, float onefourStr, float *qs, float qCutoffSqr, int nThreadPerBlock, int nThreadPerAtom) {};
-    virtual void energyGroupGroup(int nAtoms, int nPerRingPoly, float4 *xs, float4 *fs, float *perParticleEng, uint16_t *neighborCounts, uint *neighborlist, uint32_t *cumulSumMaxPerBlock, int warpSize, float *parameters, int numTypes, BoundsGPU bounds, float onetwoStr, float onethreeStr, float onefourStr, float *qs, float qCutoffSqr, uint32_t tagA, uint32_t tagB, int nThreadPerBlock, int nThreadPerAtom) {};
+    virtual void compute(int nAtoms, int nPerRingPoly, float4 *xs, float4 *fs, unsigned long long *fsFixed, uint16_t *neighborCounts, uint *neighborlist, uint32_t *cumulSumMaxPerBlock, int warpSize, float *parameters, int numTypes,  BoundsGPU bounds, float onetwoStr, float onethreeStr, float onefourStr, Virial *virials, float *qs, float qCutoffSqr, int virialMode, int nThreadPerBlock, int nThreadPerAtom, NeighborlistCompressed compressed) {};
+    virtual void energy(int nAtoms, int nPerRingPoly, float4 *xs, float *perParticleEng, uint16_t *neighborCounts, uint *neighborlist, uint32_t *cumulSumMaxPerBlock, int warpSize, float *parameters, int numTypes, BoundsGPU bounds, float onetwoStr, float onethreeStr, float onefourStr, float *qs, float qCutoffSqr, int nThreadPerBlock, int nThreadPerAtom, NeighborlistCompressed compressed) {};
+    virtual void energyGroupGroup(int nAtoms, int nPerRingPoly, float4 *xs, float4 *fs, float *perParticleEng, uint16_t *neighborCounts, uint *neighborlist, uint32_t *cumulSumMaxPerBlock, int warpSize, float *parameters, int numTypes, BoundsGPU bounds, float onetwoStr, float onethreeStr, float onefourStr, float *qs, float qCutoffSqr, uint32_t tagA, uint32_t tagB, int nThreadPerBlock, int nThreadPerAtom, NeighborlistCompressed compressed) {};
+    //host backend versions.  Neighbors are read from the grid's host lists
+    virtual void computeHost(int nAtoms, GridGPU &grid, float4 *xs, float4 *fs, float *parameters, int numTypes, BoundsGPU bounds, float onetwoStr, float onethreeStr, float onefourStr, Virial *virials, float *qs, float qCutoff, int virialMode) {};
+    virtual void energyHost(int nAtoms, GridGPU &grid, float4 *xs, float *perParticleEng, float *parameters, int numTypes, BoundsGPU bounds, float onetwoStr, float onethreeStr, float onefourStr, float *qs, float qCutoff) {};
 };
 
 
@@ -22,40 +27,87 @@ public:
     }
     PAIR_EVAL pairEval;
     CHARGE_EVAL chargeEval;
-    virtual void compute(int nAtoms, int nPerRingPoly, float4 *xs, float4 *fs, uint16_t *neighborCounts, uint *neighborlist, uint32_t *cumulSumMaxPerBlock, int warpSize, float *parameters, int numTypes,  BoundsGPU bounds, float onetwoStr, float onethreeStr, float onefourStr, Virial *virials, float *qs, float qCutoff, int virialMode, int nThreadPerBlock, int nThreadPerAtom) {
+    virtual void compute(int nAtoms, int nPerRingPoly, float4 *xs, float4 *fs, unsigned long long *fsFixed, uint16_t *neighborCounts, uint *neighborlist, uint32_t *cumulSumMaxPerBlock, int warpSize, float *parameters, int numTypes,  BoundsGPU bounds, float onetwoStr, float onethreeStr, float onefourStr, Virial *virials, float *qs, float qCutoff, int virialMode, int nThreadPerBlock, int nThreadPerAtom, NeighborlistCompressed compressed) {
         if (COMP_PAIRS or COMP_CHARGES) {
             //printf("nAtons %d nTPB %d nTPA %d NBLOCK %d\n",  nAtoms, nThreadPerBlock, nThreadPerAtom, NBLOCKTEAM(nAtoms, nThreadPerBlock, nThreadPerAtom));
             if (virialMode==2 or virialMode == 1) {
                 if (nThreadPerAtom==1) {
-                    compute_force_iso<PAIR_EVAL, COMP_PAIRS, N_PARAM, true, CHARGE_EVAL, COMP_CHARGES, 0> <<<NBLOCKTEAM(nAtoms, nThreadPerBlock, nThreadPerAtom), nThreadPerBlock, N_PARAM*numTypes*numTypes*sizeof(float)>>>(nAtoms,nPerRingPoly, xs, fs, neighborCounts, neighborlist, cumulSumMaxPerBlock, warpSize, parameters, numTypes, bounds, onetwoStr, onethreeStr, onefourStr, virials, qs, qCutoff*qCutoff, nThreadPerAtom, pairEval, chargeEval);
+                    compute_force_iso<PAIR_EVAL, COMP_PAIRS, N_PARAM, true, CHARGE_EVAL, COMP_CHARGES, 0> <<<NBLOCKTEAM(nAtoms, nThreadPerBlock, nThreadPerAtom), nThreadPerBlock, N_PARAM*numTypes*numTypes*sizeof(float)>>>(nAtoms,nPerRingPoly, xs, fs, fsFixed, neighborCounts, neighborlist, cumulSumMaxPerBlock, warpSize, parameters, numTypes, bounds, onetwoStr, onethreeStr, onefourStr, virials, qs, qCutoff*qCutoff, nThreadPerAtom, pairEval, chargeEval, compressed);
                 } else {
-                    compute_force_iso<PAIR_EVAL, COMP_PAIRS, N_PARAM, true, CHARGE_EVAL, COMP_CHARGES, 1> <<<NBLOCKTEAM(nAtoms, nThreadPerBlock, nThreadPerAtom), nThreadPerBlock, N_PARAM*numTypes*numTypes*sizeof(float) + nThreadPerBlock*(sizeof(float3) + sizeof(Virial))>>>(nAtoms,nPerRingPoly, xs, fs, neighborCounts, neighborlist, cumulSumMaxPerBlock, warpSize, parameters, numTypes, bounds, onetwoStr, onethreeStr, onefourStr, virials, qs, qCutoff*qCutoff, nThreadPerAtom, pairEval, chargeEval);
+                    compute_force_iso<PAIR_EVAL, COMP_PAIRS, N_PARAM, true, CHARGE_EVAL, COMP_CHARGES, 1> <<<NBLOCKTEAM(nAtoms, nThreadPerBlock, nThreadPerAtom), nThreadPerBlock, accumAlignedFloats(N_PARAM*numTypes*numTypes)*sizeof(float) + nThreadPerBlock*(sizeof(Float3Accum) + sizeof(VirialAccum))>>>(nAtoms,nPerRingPoly, xs, fs, fsFixed, neighborCounts, neighborlist, cumulSumMaxPerBlock, warpSize, parameters, numTypes, bounds, onetwoStr, onethreeStr, onefourStr, virials, qs, qCutoff*qCutoff, nThreadPerAtom, pairEval, chargeEval, compressed);
                 }
             } else {
 
                 if (nThreadPerAtom==1) {
-                    compute_force_iso<PAIR_EVAL, COMP_PAIRS, N_PARAM, false, CHARGE_EVAL, COMP_CHARGES, 0> <<<NBLOCKTEAM(nAtoms, nThreadPerBlock, nThreadPerAtom), nThreadPerBlock, N_PARAM*numTypes*numTypes*sizeof(float)>>>(nAtoms,nPerRingPoly, xs, fs, neighborCounts, neighborlist, cumulSumMaxPerBlock, warpSize, parameters, numTypes, bounds, onetwoStr, onethreeStr, onefourStr, virials, qs, qCutoff*qCutoff, nThreadPerAtom, pairEval, chargeEval);
+                    compute_force_iso<PAIR_EVAL, COMP_PAIRS, N_PARAM, false, CHARGE_EVAL, COMP_CHARGES, 0> <<<NBLOCKTEAM(nAtoms, nThreadPerBlock, nThreadPerAtom), nThreadPerBlock, N_PARAM*numTypes*numTypes*sizeof(float)>>>(nAtoms,nPerRingPoly, xs, fs, fsFixed, neighborCounts, neighborlist, cumulSumMaxPerBlock, warpSize, parameters, numTypes, bounds, onetwoStr, onethreeStr, onefourStr, virials, qs, qCutoff*qCutoff, nThreadPerAtom, pairEval, chargeEval, compressed);
                 } else {
-                    compute_force_iso<PAIR_EVAL, COMP_PAIRS, N_PARAM, false, CHARGE_EVAL, COMP_CHARGES, 1> <<<NBLOCKTEAM(nAtoms, nThreadPerBlock, nThreadPerAtom), nThreadPerBlock, N_PARAM*numTypes*numTypes*sizeof(float) + nThreadPerBlock*sizeof(float3)>>>(nAtoms,nPerRingPoly, xs, fs, neighborCounts, neighborlist, cumulSumMaxPerBlock, warpSize, parameters, numTypes, bounds, onetwoStr, onethreeStr, onefourStr, virials, qs, qCutoff*qCutoff, nThreadPerAtom, pairEval, chargeEval);
+                    compute_force_iso<PAIR_EVAL, COMP_PAIRS, N_PARAM, false, CHARGE_EVAL, COMP_CHARGES, 1> <<<NBLOCKTEAM(nAtoms, nThreadPerBlock, nThreadPerAtom), nThreadPerBlock, accumAlignedFloats(N_PARAM*numTypes*numTypes)*sizeof(float) + nThreadPerBlock*sizeof(Float3Accum)>>>(nAtoms,nPerRingPoly, xs, fs, fsFixed, neighborCounts, neighborlist, cumulSumMaxPerBlock, warpSize, parameters, numTypes, bounds, onetwoStr, onethreeStr, onefourStr, virials, qs, qCutoff*qCutoff, nThreadPerAtom, pairEval, chargeEval, compressed);
                 }
             }
         }
     }
-    virtual void energy(int nAtoms, int nPerRingPoly, float4 *xs, float *perParticleEng, uint16_t *neighborCounts, uint *neighborlist, uint32_t *cumulSumMaxPerBlock, int warpSize, float *parameters, int numTypes, BoundsGPU bounds, float onetwoStr, float onethreeStr, float onefourStr, float *qs, float qCutoff, int nThreadPerBlock, int nThreadPerAtom) {
+    virtual void energy(int nAtoms, int nPerRingPoly, float4 *xs, float *perParticleEng, uint16_t *neighborCounts, uint *neighborlist, uint32_t *cumulSumMaxPerBlock, int warpSize, float *parameters, int numTypes, BoundsGPU bounds, float onetwoStr, float onethreeStr, float onefourStr, float *qs, float qCutoff, int nThreadPerBlock, int nThreadPerAtom, NeighborlistCompressed compressed) {
         if (nThreadPerAtom==1) {
-           compute_energy_iso<PAIR_EVAL, COMP_PAIRS, N_PARAM, CHARGE_EVAL, COMP_CHARGES, 0> <<<NBLOCKTEAM(nAtoms, nThreadPerBlock, nThreadPerAtom), nThreadPerBlock, N_PARAM*numTypes*numTypes*sizeof(float)>>> (nAtoms, nPerRingPoly, xs, perParticleEng, neighborCounts, neighborlist, cumulSumMaxPerBlock, warpSize, parameters, numTypes, bounds, onetwoStr, onethreeStr, onefourStr, qs, qCutoff*qCutoff, nThreadPerAtom, pairEval, chargeEval);
+           compute_energy_iso<PAIR_EVAL, COMP_PAIRS, N_PARAM, CHARGE_EVAL, COMP_CHARGES, 0> <<<NBLOCKTEAM(nAtoms, nThreadPerBlock, nThreadPerAtom), nThreadPerBlock, N_PARAM*numTypes*numTypes*sizeof(float)>>> (nAtoms, nPerRingPoly, xs, perParticleEng, neighborCounts, neighborlist, cumulSumMaxPerBlock, warpSize, parameters, numTypes, bounds, onetwoStr, onethreeStr, onefourStr, qs, qCutoff*qCutoff, nThreadPerAtom, pairEval, chargeEval, compressed);
         } else {
-           compute_energy_iso<PAIR_EVAL, COMP_PAIRS, N_PARAM, CHARGE_EVAL, COMP_CHARGES, 1> <<<NBLOCKTEAM(nAtoms, nThreadPerBlock, nThreadPerAtom), nThreadPerBlock, N_PARAM*numTypes*numTypes*sizeof(float) + sizeof(float) * nThreadPerBlock>>> (nAtoms, nPerRingPoly, xs, perParticleEng, neighborCounts, neighborlist, cumulSumMaxPerBlock, warpSize, parameters, numTypes, bounds, onetwoStr, onethreeStr, onefourStr, qs, qCutoff*qCutoff, nThreadPerAtom, pairEval, chargeEval);
+           compute_energy_iso<PAIR_EVAL, COMP_PAIRS, N_PARAM, CHARGE_EVAL, COMP_CHARGES, 1> <<<NBLOCKTEAM(nAtoms, nThreadPerBlock, nThreadPerAtom), nThreadPerBlock, accumAlignedFloats(N_PARAM*numTypes*numTypes)*sizeof(float) + sizeof(accum) * nThreadPerBlock>>> (nAtoms, nPerRingPoly, xs, perParticleEng, neighborCounts, neighborlist, cumulSumMaxPerBlock, warpSize, parameters, numTypes, bounds, onetwoStr, onethreeStr, onefourStr, qs, qCutoff*qCutoff, nThreadPerAtom, pairEval, chargeEval, compressed);
         }
     }
-    virtual void energyGroupGroup(int nAtoms, int nPerRingPoly, float4 *xs, float4 *fs, float *perParticleEng, uint16_t *neighborCounts, uint *neighborlist, uint32_t *cumulSumMaxPerBlock, int warpSize, float *parameters, int numTypes, BoundsGPU bounds, float onetwoStr, float onethreeStr, float onefourStr, float *qs, float qCutoff, uint32_t tagA, uint32_t tagB, int nThreadPerBlock, int nThreadPerAtom) {
+    virtual void energyGroupGroup(int nAtoms, int nPerRingPoly, float4 *xs, float4 *fs, float *perParticleEng, uint16_t *neighborCounts, uint *neighborlist, uint32_t *cumulSumMaxPerBlock, int warpSize, float *parameters, int numTypes, BoundsGPU bounds, float onetwoStr, float onethreeStr, float onefourStr, float *qs, float qCutoff, uint32_t tagA, uint32_t tagB, int nThreadPerBlock, int nThreadPerAtom, NeighborlistCompressed compressed) {
         if (nThreadPerAtom==1) {
-            compute_energy_iso_group_group<PAIR_EVAL, COMP_PAIRS, N_PARAM, CHARGE_EVAL, COMP_CHARGES, 0> <<<NBLOCKTEAM(nAtoms, nThreadPerBlock, nThreadPerAtom), nThreadPerBlock, N_PARAM*numTypes*numTypes*sizeof(float)>>> (nAtoms, nPerRingPoly, xs, fs, perParticleEng, neighborCounts, neighborlist, cumulSumMaxPerBlock, warpSize, parameters, numTypes, bounds, onetwoStr, onethreeStr, onefourStr, qs, qCutoff*qCutoff, tagA, tagB, nThreadPerAtom, pairEval, chargeEval);
+            compute_energy_iso_group_group<PAIR_EVAL, COMP_PAIRS, N_PARAM, CHARGE_EVAL, COMP_CHARGES, 0> <<<NBLOCKTEAM(nAtoms, nThreadPerBlock, nThreadPerAtom), nThreadPerBlock, N_PARAM*numTypes*numTypes*sizeof(float)>>> (nAtoms, nPerRingPoly, xs, fs, perParticleEng, neighborCounts, neighborlist, cumulSumMaxPerBlock, warpSize, parameters, numTypes, bounds, onetwoStr, onethreeStr, onefourStr, qs, qCutoff*qCutoff, tagA, tagB, nThreadPerAtom, pairEval, chargeEval, compressed);
         } else {
-            compute_energy_iso_group_group<PAIR_EVAL, COMP_PAIRS, N_PARAM, CHARGE_EVAL, COMP_CHARGES, 1> <<<NBLOCKTEAM(nAtoms, nThreadPerBlock, nThreadPerAtom), nThreadPerBlock, N_PARAM*numTypes*numTypes*sizeof(float) + sizeof(float) * nThreadPerBlock>>> (nAtoms, nPerRingPoly, xs, fs, perParticleEng, neighborCounts, neighborlist, cumulSumMaxPerBlock, warpSize, parameters, numTypes, bounds, onetwoStr, onethreeStr, onefourStr, qs, qCutoff*qCutoff, tagA, tagB, nThreadPerAtom, pairEval, chargeEval);
+            compute_energy_iso_group_group<PAIR_EVAL, COMP_PAIRS, N_PARAM, CHARGE_EVAL, COMP_CHARGES, 1> <<<NBLOCKTEAM(nAtoms, nThreadPerBlock, nThreadPerAtom), nThreadPerBlock, accumAlignedFloats(N_PARAM*numTypes*numTypes)*sizeof(float) + sizeof(accum) * nThreadPerBlock>>> (nAtoms, nPerRingPoly, xs, fs, perParticleEng, neighborCounts, neighborlist, cumulSumMaxPerBlock, warpSize, parameters, numTypes, bounds, onetwoStr, onethreeStr, onefourStr, qs, qCutoff*qCutoff, tagA, tagB, nThreadPerAtom, pairEval, chargeEval, compressed);
         }
 
     }
+    virtual void computeHost(int nAtoms, GridGPU &grid, float4 *xs, float4 *fs, float *parameters, int numTypes, BoundsGPU bounds, float onetwoStr, float onethreeStr, float onefourStr, Virial *virials, float *qs, float qCutoff, int virialMode) {
+        if (COMP_PAIRS or COMP_CHARGES) {
+            bool virials_ = virialMode==2 or virialMode == 1;
+            if (grid.clusterPairsHostValid) {
+                int nClusters = grid.clusterIdxsHost.size() / HOST_CLUSTER_SIZE;
+                if (virials_) {
+                    compute_force_cluster_host<PAIR_EVAL, COMP_PAIRS, N_PARAM, true, CHARGE_EVAL, COMP_CHARGES>(nAtoms, nClusters, grid.clusterIdxsHost.data(), grid.clusterPairIdxsHost.data(), grid.clusterPairsHost.data(), xs, fs, parameters, numTypes, onetwoStr, onethreeStr, onefourStr, virials, qs, qCutoff*qCutoff, grid.forceScratchHost, grid.virialScratchHost, pairEval, chargeEval);
+                } else {
+                    compute_force_cluster_host<PAIR_EVAL, COMP_PAIRS, N_PARAM, false, CHARGE_EVAL, COMP_CHARGES>(nAtoms, nClusters, grid.clusterIdxsHost.data(), grid.clusterPairIdxsHost.data(), grid.clusterPairsHost.data(), xs, fs, parameters, numTypes, onetwoStr, onethreeStr, onefourStr, virials, qs, qCutoff*qCutoff, grid.forceScratchHost, grid.virialScratchHost, pairEval, chargeEval);
+                }
+                return;
+            }
+            uint16_t *neighborCounts = grid.perAtomArray.h_data.data();
+            uint *neighborlist = grid.neighborlistHost.data();
+            uint32_t *neighborIdxs = grid.neighborIdxsHost.data();
+            if (grid.halfListHost) {
+                if (virials_) {
+                    compute_force_iso_half_host<PAIR_EVAL, COMP_PAIRS, N_PARAM, true, CHARGE_EVAL, COMP_CHARGES>(nAtoms, xs, fs, neighborCounts, neighborlist, neighborIdxs, parameters, numTypes, bounds, onetwoStr, onethreeStr, onefourStr, virials, qs, qCutoff*qCutoff, grid.forceScratchHost, grid.virialScratchHost, pairEval, chargeEval);
+                } else {
+                    compute_force_iso_half_host<PAIR_EVAL, COMP_PAIRS, N_PARAM, false, CHARGE_EVAL, COMP_CHARGES>(nAtoms, xs, fs, neighborCounts, neighborlist, neighborIdxs, parameters, numTypes, bounds, onetwoStr, onethreeStr, onefourStr, virials, qs, qCutoff*qCutoff, grid.forceScratchHost, grid.virialScratchHost, pairEval, chargeEval);
+                }
+                return;
+            }
+            if (virials_) {
+                compute_force_iso_host<PAIR_EVAL, COMP_PAIRS, N_PARAM, true, CHARGE_EVAL, COMP_CHARGES>(nAtoms, xs, fs, neighborCounts, neighborlist, neighborIdxs, parameters, numTypes, bounds, onetwoStr, onethreeStr, onefourStr, virials, qs, qCutoff*qCutoff, pairEval, chargeEval);
+            } else {
+                compute_force_iso_host<PAIR_EVAL, COMP_PAIRS, N_PARAM, false, CHARGE_EVAL, COMP_CHARGES>(nAtoms, xs, fs, neighborCounts, neighborlist, neighborIdxs, parameters, numTypes, bounds, onetwoStr, onethreeStr, onefourStr, virials, qs, qCutoff*qCutoff, pairEval, chargeEval);
+            }
+        }
+    }
+    virtual void energyHost(int nAtoms, GridGPU &grid, float4 *xs, float *perParticleEng, float *parameters, int numTypes, BoundsGPU bounds, float onetwoStr, float onethreeStr, float onefourStr, float *qs, float qCutoff) {
+        if (COMP_PAIRS or COMP_CHARGES) {
+            if (grid.clusterPairsHostValid) {
+                int nClusters = grid.clusterIdxsHost.size() / HOST_CLUSTER_SIZE;
+                compute_energy_cluster_host<PAIR_EVAL, COMP_PAIRS, N_PARAM, CHARGE_EVAL, COMP_CHARGES>(nAtoms, nClusters, grid.clusterIdxsHost.data(), grid.clusterPairIdxsHost.data(), grid.clusterPairsHost.data(), xs, perParticleEng, parameters, numTypes, onetwoStr, onethreeStr, onefourStr, qs, qCutoff*qCutoff, grid.engScratchHost, pairEval, chargeEval);
+                return;
+            }
+            uint16_t *neighborCounts = grid.perAtomArray.h_data.data();
+            uint *neighborlist = grid.neighborlistHost.data();
+            uint32_t *neighborIdxs = grid.neighborIdxsHost.data();
+            if (grid.halfListHost) {
+                compute_energy_iso_half_host<PAIR_EVAL, COMP_PAIRS, N_PARAM, CHARGE_EVAL, COMP_CHARGES>(nAtoms, xs, perParticleEng, neighborCounts, neighborlist, neighborIdxs, parameters, numTypes, bounds, onetwoStr, onethreeStr, onefourStr, qs, qCutoff*qCutoff, grid.engScratchHost, pairEval, chargeEval);
+            } else {
+                compute_energy_iso_host<PAIR_EVAL, COMP_PAIRS, N_PARAM, CHARGE_EVAL, COMP_CHARGES>(nAtoms, xs, perParticleEng, neighborCounts, neighborlist, neighborIdxs, parameters, numTypes, bounds, onetwoStr, onethreeStr, onefourStr, qs, qCutoff*qCutoff, pairEval, chargeEval);
+            }
+        }
+    }
 
 };
 
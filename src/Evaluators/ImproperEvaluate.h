@@ -1,5 +1,5 @@
 template <class IMPROPERTYPE, class EVALUATOR, bool COMPUTEVIRIALS> 
-__global__ void compute_force_improper(int nImpropers, float4 *xs, float4 *fs, int *idToIdxs, ImproperGPU *impropers, BoundsGPU bounds, IMPROPERTYPE *parameters_arg, int nParameters, Virial *virials, bool usingSharedMemForParams, EVALUATOR evaluator) {
+__global__ void compute_force_improper(int nImpropers, float4 *xs, float4 *fs, int *idToIdxs, ImproperGPU *impropers, BoundsGPU bounds, IMPROPERTYPE *parameters_arg, int nParameters, Virial *virials, unsigned long long *fsFixed, unsigned long long *virialsFixed, bool usingSharedMemForParams, EVALUATOR evaluator) {
 
     int idx = GETIDX();
     extern __shared__ char all_shr[];
@@ -106,9 +106,15 @@ __global__ void compute_force_improper(int nImpropers, float4 *xs, float4 *fs, i
         forces[3].z = a13Dir1.z + a23Dir2.z + a33Dir3.z;
         forces[2] = sFloat3 - forces[3];
         for (int i=0; i<4; i++) {
-            atomicAdd(&(fs[idxs[i]].x), (forces[i].x));
-            atomicAdd(&(fs[idxs[i]].y), (forces[i].y));
-            atomicAdd(&(fs[idxs[i]].z), (forces[i].z));
+            if (fsFixed) {
+                atomicAddFixedPoint(fsFixed + 3*idxs[i], forces[i].x);
+                atomicAddFixedPoint(fsFixed + 3*idxs[i]+1, forces[i].y);
+                atomicAddFixedPoint(fsFixed + 3*idxs[i]+2, forces[i].z);
+            } else {
+                atomicAdd(&(fs[idxs[i]].x), (forces[i].x));
+                atomicAdd(&(fs[idxs[i]].y), (forces[i].y));
+                atomicAdd(&(fs[idxs[i]].z), (forces[i].z));
+            }
             //printf("imp f %d is %f %f %f\n", i, forces[i].x, forces[i].y, forces[i].z);
         }
 
@@ -118,7 +124,11 @@ __global__ void compute_force_improper(int nImpropers, float4 *xs, float4 *fs, i
             computeVirial(sumVirials, forces[3], directors[1] + directors[2]);
             for (int i=0; i<6; i++) {
                 //printf("imp vir %d %f\n", i, sumVirials[i]);
-                atomicAdd(&(virials[idxs[0]][i]), sumVirials[i]);
+                if (virialsFixed) {
+                    atomicAddFixedPoint(virialsFixed + 6*idxs[0]+i, sumVirials[i]);
+                } else {
+                    atomicAdd(&(virials[idxs[0]][i]), sumVirials[i]);
+                }
             }
 
         } 
@@ -136,7 +146,7 @@ __global__ void compute_force_improper(int nImpropers, float4 *xs, float4 *fs, i
 
 
 template <class IMPROPERTYPE, class EVALUATOR> 
-__global__ void compute_energy_improper(int nImpropers, float4 *xs, float *perParticleEng, int *idToIdxs, ImproperGPU *impropers, BoundsGPU bounds, IMPROPERTYPE *parameters_arg, int nParameters, bool usingSharedMemForParams, EVALUATOR evaluator) {
+__global__ void compute_energy_improper(int nImpropers, float4 *xs, float *perParticleEng, unsigned long long *engsFixed, int *idToIdxs, ImproperGPU *impropers, BoundsGPU bounds, IMPROPERTYPE *parameters_arg, int nParameters, bool usingSharedMemForParams, EVALUATOR evaluator) {
 
     int idx = GETIDX();
     extern __shared__ char all_shr[];
@@ -206,7 +216,11 @@ __global__ void compute_energy_improper(int nImpropers, float4 *xs, float *perPa
         float theta = acosf(c);
         float potential = 0.25f * evaluator.potential(improperType, theta);
         for (int i=0; i<4; i++) {
-            atomicAdd(perParticleEng + idxs[i], potential);
+            if (engsFixed) {
+                atomicAddFixedPoint(engsFixed + idxs[i], potential);
+            } else {
+                atomicAdd(perParticleEng + idxs[i], potential);
+            }
         }
 
 
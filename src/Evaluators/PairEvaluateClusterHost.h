@@ -0,0 +1,347 @@
+#pragma once
+#include "BoundsGPU.h"
+#include "cutils_math.h"
+#include "Virial.h"
+#include "helpers.h"
+#include "SquareVector.h"
+#include "GridGPU.h"
+#include "PairEvaluateIsoHost.h"
+#include <vector>
+
+//cluster-vs-cluster version of compute_force_iso_host.  Each cluster of HOST_CLUSTER_SIZE atoms is gathered into
+//small structure-of-arrays buffers and the inner loop over the other cluster's atoms is vectorized with omp simd,
+//so the compiler evaluates HOST_CLUSTER_SIZE pairs at once using the same evaluators as the device kernels.
+//Pairs in the list may be outside the cutoff; they are masked by the usual rCut/qCutoff checks.  Each cluster pair
+//is stored once (see GridGPU::buildClusterPairsHost), so the reaction force is applied to the other cluster as in
+//compute_force_iso_half_host.  Clusters hold consecutive atoms and the other cluster is never lower, so each
+//thread only writes to atoms from its first cluster up, and its scratch slice is cleared lazily in that order.
+
+template <class PAIR_EVAL, bool COMP_PAIRS, int N_PARAM, bool COMP_VIRIALS, class CHARGE_EVAL, bool COMP_CHARGES>
+void compute_force_cluster_host
+        (int nAtoms,
+         int nClusters,
+         const int *__restrict__ clusterIdxs,
+         const uint32_t *__restrict__ clusterPairIdxs,
+         const ClusterPair *__restrict__ clusterPairs,
+         const float4 *__restrict__ xs,
+         float4 *__restrict__ fs,
+         const float *__restrict__ parameters,
+         int numTypes,
+         float onetwoStr,
+         float onethreeStr,
+         float onefourStr,
+         Virial *__restrict__ virials,
+         const float *qs,
+         float qCutoffSqr,
+         std::vector<float3> &forceScratch,
+         std::vector<Virial> &virialScratch,
+         PAIR_EVAL pairEval,
+         CHARGE_EVAL chargeEval)
+{
+    const int CS = HOST_CLUSTER_SIZE;
+    float multipliers[4] = {1, onetwoStr, onethreeStr, onefourStr};
+    int sqrSize = numTypes*numTypes;
+    int maxThreads = hostMaxThreads();
+    if (forceScratch.size() < (size_t) maxThreads*nAtoms) {
+        forceScratch.resize((size_t) maxThreads*nAtoms);
+    }
+    if (COMP_VIRIALS and virialScratch.size() < (size_t) maxThreads*nAtoms) {
+        virialScratch.resize((size_t) maxThreads*nAtoms);
+    }
+    //last atom of each cluster, padding is always at the end
+    auto lastIdx = [&] (int c) {
+        int idx = clusterIdxs[c*CS];
+        for (int k=1; k<CS; k++) {
+            if (clusterIdxs[c*CS + k] != -1) {
+                idx = clusterIdxs[c*CS + k];
+            }
+        }
+        return idx;
+    };
+    std::vector<int> writtenLo(maxThreads, 0);
+    std::vector<int> writtenHi(maxThreads, 0);
+    int nThreads = 1;
+#pragma omp parallel
+    {
+        int tid = hostThreadIdx();
+#pragma omp single
+        nThreads = hostNumThreads();
+        int cLo = (int64_t) nClusters*tid/nThreads;
+        int cHi = (int64_t) nClusters*(tid+1)/nThreads;
+        int idxLo = cLo < cHi ? clusterIdxs[cLo*CS] : 0;
+        float3 *myForces = forceScratch.data() + (size_t) tid*nAtoms;
+        Virial *myVirials = COMP_VIRIALS ? virialScratch.data() + (size_t) tid*nAtoms : nullptr;
+        int cleared = idxLo;
+        auto touch = [&] (int idx) {
+            for (; cleared<=idx; cleared++) {
+                myForces[cleared] = make_float3(0, 0, 0);
+                if (COMP_VIRIALS) {
+                    myVirials[cleared] = Virial(0, 0, 0, 0, 0, 0);
+                }
+            }
+        };
+        for (int c=cLo; c<cHi; c++) {
+            touch(lastIdx(c));
+            float xi[CS], yi[CS], zi[CS], qi[CS];
+            int ti[CS];
+            float fxi[CS], fyi[CS], fzi[CS];
+            Virial virialsSum[CS];
+            for (int i=0; i<CS; i++) {
+                int idx = clusterIdxs[c*CS + i];
+                float4 posWhole = xs[idx == -1 ? clusterIdxs[c*CS] : idx];
+                xi[i] = posWhole.x;
+                yi[i] = posWhole.y;
+                zi[i] = posWhole.z;
+                ti[i] = *(int *) &posWhole.w;
+                qi[i] = COMP_CHARGES ? qs[idx == -1 ? clusterIdxs[c*CS] : idx] : 0;
+                fxi[i] = 0;
+                fyi[i] = 0;
+                fzi[i] = 0;
+                virialsSum[i] = Virial(0, 0, 0, 0, 0, 0);
+            }
+            for (uint32_t p=clusterPairIdxs[c]; p<clusterPairIdxs[c+1]; p++) {
+                ClusterPair pair = clusterPairs[p];
+                float xj[CS], yj[CS], zj[CS], qj[CS];
+                int tj[CS];
+                float fxj[CS], fyj[CS], fzj[CS];
+                float vj0[CS], vj1[CS], vj2[CS], vj3[CS], vj4[CS], vj5[CS];
+                for (int j=0; j<CS; j++) {
+                    int idx = clusterIdxs[pair.otherCluster*CS + j];
+                    float4 posWhole = xs[idx == -1 ? clusterIdxs[pair.otherCluster*CS] : idx];
+                    xj[j] = posWhole.x + pair.shift.x;
+                    yj[j] = posWhole.y + pair.shift.y;
+                    zj[j] = posWhole.z + pair.shift.z;
+                    tj[j] = *(int *) &posWhole.w;
+                    qj[j] = COMP_CHARGES ? qs[idx == -1 ? clusterIdxs[pair.otherCluster*CS] : idx] : 0;
+                    fxj[j] = 0;
+                    fyj[j] = 0;
+                    fzj[j] = 0;
+                    vj0[j] = vj1[j] = vj2[j] = vj3[j] = vj4[j] = vj5[j] = 0;
+                }
+                for (int i=0; i<CS; i++) {
+                    float fx = 0;
+                    float fy = 0;
+                    float fz = 0;
+                    //virial components kept as scalars so they can be reduced across simd lanes, same order as computeVirial
+                    float v0 = 0, v1 = 0, v2 = 0, v3 = 0, v4 = 0, v5 = 0;
+#pragma omp simd reduction(+:fx,fy,fz,v0,v1,v2,v3,v4,v5)
+                    for (int j=0; j<CS; j++) {
+                        int bit = i*CS + j;
+                        bool valid = (pair.mask >> bit) & 1;
+                        float multiplier = multipliers[(pair.exclusions >> (2*bit)) & 3];
+                        float3 dr = make_float3(xi[i] - xj[j], yi[i] - yj[j], zi[i] - zj[j]);
+                        float lenSqr = lengthSqr(dr);
+                        float3 force = make_float3(0, 0, 0);
+                        if (COMP_PAIRS) {
+                            int sqrIdx = squareVectorIndex(numTypes, ti[i], tj[j]);
+                            float params_pair[N_PARAM];
+                            for (int pIdx=0; pIdx<N_PARAM; pIdx++) {
+                                params_pair[pIdx] = parameters[pIdx*sqrSize + sqrIdx];
+                            }
+                            if (valid and lenSqr < params_pair[0]) {
+                                force += pairEval.force(dr, params_pair, lenSqr, multiplier);
+                            }
+                        }
+                        if (COMP_CHARGES and valid and lenSqr < qCutoffSqr) {
+                            force += chargeEval.force(dr, lenSqr, qi[i], qj[j], multiplier);
+                        }
+                        fx += force.x;
+                        fy += force.y;
+                        fz += force.z;
+                        fxj[j] -= force.x;
+                        fyj[j] -= force.y;
+                        fzj[j] -= force.z;
+                        if (COMP_VIRIALS) {
+                            float w0 = force.x * dr.x;
+                            float w1 = force.y * dr.y;
+                            float w2 = force.z * dr.z;
+                            float w3 = force.x * dr.y;
+                            float w4 = force.x * dr.z;
+                            float w5 = force.y * dr.z;
+                            v0 += w0;
+                            v1 += w1;
+                            v2 += w2;
+                            v3 += w3;
+                            v4 += w4;
+                            v5 += w5;
+                            vj0[j] += w0;
+                            vj1[j] += w1;
+                            vj2[j] += w2;
+                            vj3[j] += w3;
+                            vj4[j] += w4;
+                            vj5[j] += w5;
+                        }
+                    }
+                    if (COMP_VIRIALS) {
+                        Virial pairVirials(v0, v1, v2, v3, v4, v5);
+                        virialsSum[i] += pairVirials;
+                    }
+                    fxi[i] += fx;
+                    fyi[i] += fy;
+                    fzi[i] += fz;
+                }
+                touch(lastIdx(pair.otherCluster));
+                for (int j=0; j<CS; j++) {
+                    int idx = clusterIdxs[pair.otherCluster*CS + j];
+                    if (idx != -1) {
+                        myForces[idx] += make_float3(fxj[j], fyj[j], fzj[j]);
+                        if (COMP_VIRIALS) {
+                            //each atom gets half of the pair virial, as with the full list
+                            Virial otherVirials(vj0[j], vj1[j], vj2[j], vj3[j], vj4[j], vj5[j]);
+                            otherVirials *= 0.5f;
+                            myVirials[idx] += otherVirials;
+                        }
+                    }
+                }
+            }
+            for (int i=0; i<CS; i++) {
+                int idx = clusterIdxs[c*CS + i];
+                if (idx != -1) {
+                    myForces[idx] += make_float3(fxi[i], fyi[i], fzi[i]);
+                    if (COMP_VIRIALS) {
+                        virialsSum[i] *= 0.5f;
+                        myVirials[idx] += virialsSum[i];
+                    }
+                }
+            }
+        }
+        writtenLo[tid] = idxLo;
+        writtenHi[tid] = cleared;
+#pragma omp barrier
+#pragma omp for schedule(static)
+        for (int idx=0; idx<nAtoms; idx++) {
+            float3 forceSum = make_float3(0, 0, 0);
+            for (int t=0; t<nThreads; t++) {
+                if (idx >= writtenLo[t] and idx < writtenHi[t]) {
+                    forceSum += forceScratch[(size_t) t*nAtoms + idx];
+                }
+            }
+            float4 forceCur = fs[idx];
+            forceCur += forceSum;
+            fs[idx] = forceCur;
+            if (COMP_VIRIALS) {
+                for (int t=0; t<nThreads; t++) {
+                    if (idx >= writtenLo[t] and idx < writtenHi[t]) {
+                        virials[idx] += virialScratch[(size_t) t*nAtoms + idx];
+                    }
+                }
+            }
+        }
+    }
+}
+
+//energies from the cluster-pair list.  Energy evaluators return half of the pair energy, so each atom of a pair gets
+//one copy.  Scratch slices are cleared and summed as in compute_force_cluster_host.  Only used for data recording, so
+//the pair loop is not vectorized
+template <class PAIR_EVAL, bool COMP_PAIRS, int N_PARAM, class CHARGE_EVAL, bool COMP_CHARGES>
+void compute_energy_cluster_host
+        (int nAtoms,
+         int nClusters,
+         const int *__restrict__ clusterIdxs,
+         const uint32_t *__restrict__ clusterPairIdxs,
+         const ClusterPair *__restrict__ clusterPairs,
+         const float4 *__restrict__ xs,
+         float *__restrict__ perParticleEng,
+         const float *__restrict__ parameters,
+         int numTypes,
+         float onetwoStr,
+         float onethreeStr,
+         float onefourStr,
+         const float *qs,
+         float qCutoffSqr,
+         std::vector<float> &engScratch,
+         PAIR_EVAL pairEval,
+         CHARGE_EVAL chargeEval)
+{
+    const int CS = HOST_CLUSTER_SIZE;
+    float multipliers[4] = {1, onetwoStr, onethreeStr, onefourStr};
+    int sqrSize = numTypes*numTypes;
+    int maxThreads = hostMaxThreads();
+    if (engScratch.size() < (size_t) maxThreads*nAtoms) {
+        engScratch.resize((size_t) maxThreads*nAtoms);
+    }
+    auto lastIdx = [&] (int c) {
+        int idx = clusterIdxs[c*CS];
+        for (int k=1; k<CS; k++) {
+            if (clusterIdxs[c*CS + k] != -1) {
+                idx = clusterIdxs[c*CS + k];
+            }
+        }
+        return idx;
+    };
+    std::vector<int> writtenLo(maxThreads, 0);
+    std::vector<int> writtenHi(maxThreads, 0);
+    int nThreads = 1;
+#pragma omp parallel
+    {
+        int tid = hostThreadIdx();
+#pragma omp single
+        nThreads = hostNumThreads();
+        int cLo = (int64_t) nClusters*tid/nThreads;
+        int cHi = (int64_t) nClusters*(tid+1)/nThreads;
+        int idxLo = cLo < cHi ? clusterIdxs[cLo*CS] : 0;
+        float *myEngs = engScratch.data() + (size_t) tid*nAtoms;
+        int cleared = idxLo;
+        auto touch = [&] (int idx) {
+            for (; cleared<=idx; cleared++) {
+                myEngs[cleared] = 0;
+            }
+        };
+        for (int c=cLo; c<cHi; c++) {
+            touch(lastIdx(c));
+            for (uint32_t p=clusterPairIdxs[c]; p<clusterPairIdxs[c+1]; p++) {
+                ClusterPair pair = clusterPairs[p];
+                touch(lastIdx(pair.otherCluster));
+                for (int i=0; i<CS; i++) {
+                    int idx = clusterIdxs[c*CS + i];
+                    if (idx == -1) {
+                        continue;
+                    }
+                    float4 posWhole = xs[idx];
+                    int type = *(int *) &posWhole.w;
+                    for (int j=0; j<CS; j++) {
+                        int bit = i*CS + j;
+                        int otherIdx = clusterIdxs[pair.otherCluster*CS + j];
+                        if (otherIdx == -1 or not ((pair.mask >> bit) & 1)) {
+                            continue;
+                        }
+                        float multiplier = multipliers[(pair.exclusions >> (2*bit)) & 3];
+                        float4 otherPosWhole = xs[otherIdx];
+                        int otherType = *(int *) &otherPosWhole.w;
+                        float3 dr = make_float3(posWhole) - (make_float3(otherPosWhole) + pair.shift);
+                        float lenSqr = lengthSqr(dr);
+                        float eng = 0;
+                        if (COMP_PAIRS) {
+                            int sqrIdx = squareVectorIndex(numTypes, type, otherType);
+                            float params_pair[N_PARAM];
+                            for (int pIdx=0; pIdx<N_PARAM; pIdx++) {
+                                params_pair[pIdx] = parameters[pIdx*sqrSize + sqrIdx];
+                            }
+                            if (lenSqr < params_pair[0]) {
+                                eng += pairEval.energy(params_pair, lenSqr, multiplier);
+                            }
+                        }
+                        if (COMP_CHARGES and lenSqr < qCutoffSqr) {
+                            eng += chargeEval.energy(lenSqr, qs[idx], qs[otherIdx], multiplier);
+                        }
+                        myEngs[idx] += eng;
+                        myEngs[otherIdx] += eng;
+                    }
+                }
+            }
+        }
+        writtenLo[tid] = idxLo;
+        writtenHi[tid] = cleared;
+#pragma omp barrier
+#pragma omp for schedule(static)
+        for (int idx=0; idx<nAtoms; idx++) {
+            float engSum = 0;
+            for (int t=0; t<nThreads; t++) {
+                if (idx >= writtenLo[t] and idx < writtenHi[t]) {
+                    engSum += engScratch[(size_t) t*nAtoms + idx];
+                }
+            }
+            perParticleEng[idx] += engSum;
+        }
+    }
+}
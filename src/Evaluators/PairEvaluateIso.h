@@ -2,8 +2,10 @@
 #include "BoundsGPU.h"
 #include "cutils_func.h"
 #include "Virial.h"
+#include "Accumulator.h"
 #include "helpers.h"
 #include "SquareVector.h"
+#include "NeighborlistCompressed.h"
 
 template <class PAIR_EVAL, bool COMP_PAIRS, int N_PARAM, bool COMP_VIRIALS, class CHARGE_EVAL, bool COMP_CHARGES, int MULTITHREADPERATOM>
 __global__ void compute_force_iso
@@ -11,6 +13,7 @@ __global__ void compute_force_iso
 	 int nPerRingPoly,
          const float4 *__restrict__ xs, 
          float4 *__restrict__ fs, 
+         unsigned long long *__restrict__ fsFixed, 
          const uint16_t *__restrict__ neighborCounts, 
          const uint *__restrict__ neighborlist, 
          const uint32_t * __restrict__ cumulSumMaxPerBlock, 
@@ -26,7 +29,8 @@ __global__ void compute_force_iso
          float qCutoffSqr, 
          int nThreadPerAtom,
          PAIR_EVAL pairEval, 
-         CHARGE_EVAL chargeEval) 
+         CHARGE_EVAL chargeEval,
+         NeighborlistCompressed compressed)
 {
 
 
@@ -36,11 +40,11 @@ __global__ void compute_force_iso
     extern __shared__ float paramsAll[];
     int sqrSize = numTypes*numTypes;
     float *params_shr[N_PARAM];
-    float3 *forces_shr;
-    Virial *virials_shr;
+    Float3Accum *forces_shr;
+    VirialAccum *virials_shr;
     if (MULTITHREADPERATOM) {
-        forces_shr = (float3 *) (paramsAll + sqrSize*N_PARAM);
-        virials_shr = (Virial *) (forces_shr + blockDim.x);
+        forces_shr = (Float3Accum *) (paramsAll + accumAlignedFloats(sqrSize*N_PARAM));
+        virials_shr = (VirialAccum *) (forces_shr + blockDim.x);
     }
     //then we take pointers into paramsAll.
     //
@@ -61,9 +65,9 @@ __global__ void compute_force_iso
     int idx = GETIDX();
     if (idx < nAtoms*nThreadPerAtom) {
 
-        Virial virialsSum;
+        VirialAccum virialsSum;
         if (COMP_VIRIALS) {
-            virialsSum = Virial(0, 0, 0, 0, 0, 0);
+            virialsSum = VirialAccum(0, 0, 0, 0, 0, 0);
         }
 	// information based on ring polymer and bead
     // okay so we can assign multiple atoms per ring poly.  This manifests as multiple threads per bead
@@ -96,7 +100,7 @@ __global__ void compute_force_iso
         int type = __float_as_int(posWhole.w);
         float3 pos = make_float3(posWhole);
 
-        float3 forceSum = make_float3(0, 0, 0);
+        Float3Accum forceSum(make_float3(0, 0, 0));
         int myIdxInTeam;
         if (MULTITHREADPERATOM) {
             myIdxInTeam = threadIdx.x % nThreadPerAtom;
@@ -106,16 +110,19 @@ __global__ void compute_force_iso
         //how many neighbors do I have?
         //int numNeigh = neighborCounts[idx];
         int numNeigh = neighborCounts[ringPolyIdx];
-        //printf("pfe thread %d atom %d\n", threadIdx.x, atomIdx);
-        for (int nthNeigh=myIdxInTeam; nthNeigh<numNeigh; nthNeigh+=nThreadPerAtom) {
-            int nlistIdx;
+        //each thread's neighbors are spaced warpSize apart in either list
+        int baseIdxCompressed = 0;
+        if (compressed.words) {
             if (MULTITHREADPERATOM) {
-                nlistIdx = baseIdx + myIdxInTeam + warpSize * (nthNeigh/nThreadPerAtom);
+                baseIdxCompressed = baseNeighlistIdxFromRPIndex(compressed.cumulSumMaxPerBlock, warpSize, ringPolyIdx, nThreadPerAtom) + myIdxInTeam;
             } else {
-                nlistIdx = baseIdx + warpSize * nthNeigh;
+                baseIdxCompressed = baseNeighlistIdxFromRPIndex(compressed.cumulSumMaxPerBlock, warpSize, ringPolyIdx);
             }
-            
-            uint otherIdxRaw = neighborlist[nlistIdx];
+        }
+        NeighborReader neighbors(neighborlist, compressed, baseIdx + myIdxInTeam, baseIdxCompressed, warpSize);
+        //printf("pfe thread %d atom %d\n", threadIdx.x, atomIdx);
+        for (int nthNeigh=myIdxInTeam; nthNeigh<numNeigh; nthNeigh+=nThreadPerAtom) {
+            uint otherIdxRaw = neighbors.next();
             //The leftmost two bits in the neighbor entry say if it is a 1-2, 1-3, or 1-4 neighbor, or none of these
             uint neighDist = otherIdxRaw >> 30;
             float multiplier = multipliers[neighDist];
@@ -175,28 +182,26 @@ __global__ void compute_force_iso
        // printf("force %f %f %f\n", forceSum.x, forceSum.y, forceSum.z);
         if (MULTITHREADPERATOM) {
             forces_shr[threadIdx.x] = forceSum;
-            reduceByN_NOSYNC<float3>(forces_shr, nThreadPerAtom);
+            reduceByN_NOSYNC<Float3Accum>(forces_shr, nThreadPerAtom);
             if (myIdxInTeam==0) {
-                float4 forceCur = fs[atomIdx]; 
-                forceCur += forces_shr[threadIdx.x];
-                fs[atomIdx] = forceCur;
+                addAtomForce(fs, fsFixed, atomIdx, forces_shr[threadIdx.x]);
             }
             if (COMP_VIRIALS) {
                 virials_shr[threadIdx.x] = virialsSum;
-                reduceByN_NOSYNC<Virial>(virials_shr, nThreadPerAtom);
+                reduceByN_NOSYNC<VirialAccum>(virials_shr, nThreadPerAtom);
                 if (myIdxInTeam==0) {
-                    Virial tmp = virials_shr[threadIdx.x] * 0.5;
+                    virials_shr[threadIdx.x] *= 0.5f;
+                    Virial tmp = virials_shr[threadIdx.x].asVirial();
                     virials[atomIdx] += tmp;
                 }
             }
 
         } else {
-            float4 forceCur = fs[atomIdx]; 
-            forceCur += forceSum;
-            fs[atomIdx] = forceCur;
+            addAtomForce(fs, fsFixed, atomIdx, forceSum);
             if (COMP_VIRIALS) {
                 virialsSum *= 0.5f;
-                virials[atomIdx] += virialsSum;
+                Virial tmp = virialsSum.asVirial();
+                virials[atomIdx] += tmp;
             }
         }
         
@@ -229,15 +234,16 @@ __global__ void compute_energy_iso
          float qCutoffSqr, 
          int nThreadPerAtom,
          PAIR_EVAL pairEval, 
-         CHARGE_EVAL chargeEval) 
+         CHARGE_EVAL chargeEval,
+         NeighborlistCompressed compressed) 
 {
     float multipliers[4] = {1, onetwoStr, onethreeStr, onefourStr};
     extern __shared__ float paramsAll[];
     int sqrSize = numTypes*numTypes;
     float *params_shr[N];
-    float *engs_shr;
+    accum *engs_shr;
     if (MULTITHREADPERATOM) {
-        engs_shr = paramsAll + N*sqrSize;
+        engs_shr = (accum *) (paramsAll + accumAlignedFloats(N*sqrSize));
     }
 
 
@@ -285,7 +291,7 @@ __global__ void compute_energy_iso
         int type = __float_as_int(posWhole.w);
         float3 pos = make_float3(posWhole);
 
-        float engSum = 0;
+        accum engSum = 0;
         int myIdxInTeam;
         if (MULTITHREADPERATOM) {
             myIdxInTeam = threadIdx.x % nThreadPerAtom;
@@ -293,15 +299,17 @@ __global__ void compute_energy_iso
             myIdxInTeam = 0;
         }
         int numNeigh = neighborCounts[ringPolyIdx];
-        for (int nthNeigh=myIdxInTeam; nthNeigh<numNeigh; nthNeigh+=nThreadPerAtom) {
-            int nlistIdx;
+        int baseIdxCompressed = 0;
+        if (compressed.words) {
             if (MULTITHREADPERATOM) {
-                nlistIdx = baseIdx + myIdxInTeam + warpSize * (nthNeigh/nThreadPerAtom);
+                baseIdxCompressed = baseNeighlistIdxFromRPIndex(compressed.cumulSumMaxPerBlock, warpSize, ringPolyIdx, nThreadPerAtom) + myIdxInTeam;
             } else {
-                nlistIdx = baseIdx + warpSize * nthNeigh;
+                baseIdxCompressed = baseNeighlistIdxFromRPIndex(compressed.cumulSumMaxPerBlock, warpSize, ringPolyIdx);
             }
-            
-            uint otherIdxRaw = neighborlist[nlistIdx];
+        }
+        NeighborReader neighbors(neighborlist, compressed, baseIdx + myIdxInTeam, baseIdxCompressed, warpSize);
+        for (int nthNeigh=myIdxInTeam; nthNeigh<numNeigh; nthNeigh+=nThreadPerAtom) {
+            uint otherIdxRaw = neighbors.next();
             //The leftmost two bits in the neighbor entry say if it is a 1-2, 1-3, or 1-4 neighbor, or none of these
             uint neighDist = otherIdxRaw >> 30;
             float multiplier = multipliers[neighDist];
@@ -343,7 +351,7 @@ __global__ void compute_energy_iso
         }   
         if (MULTITHREADPERATOM) {
             engs_shr[threadIdx.x] = engSum;
-            reduceByN_NOSYNC<float>(engs_shr, nThreadPerAtom);
+            reduceByN_NOSYNC<accum>(engs_shr, nThreadPerAtom);
             if (myIdxInTeam==0) {
                 perParticleEng[atomIdx] += engs_shr[threadIdx.x];
             }
@@ -385,15 +393,16 @@ __global__ void compute_energy_iso_group_group
          uint32_t tagB,
          int nThreadPerAtom,
          PAIR_EVAL pairEval, 
-         CHARGE_EVAL chargeEval) 
+         CHARGE_EVAL chargeEval,
+         NeighborlistCompressed compressed) 
 {
     float multipliers[4] = {1, onetwoStr, onethreeStr, onefourStr};
     extern __shared__ float paramsAll[];
     int sqrSize = numTypes*numTypes;
     float *params_shr[N];
-    float *engs_shr;
+    accum *engs_shr;
     if (MULTITHREADPERATOM) {
-        engs_shr = paramsAll + N*sqrSize;
+        engs_shr = (accum *) (paramsAll + accumAlignedFloats(N*sqrSize));
     }
 
 
@@ -445,7 +454,7 @@ __global__ void compute_energy_iso_group_group
         }
         float3 pos = make_float3(posWhole);
 
-        float engSum = 0;
+        accum engSum = 0;
         int myIdxInTeam;
         if (MULTITHREADPERATOM) {
             myIdxInTeam = threadIdx.x % nThreadPerAtom;
@@ -453,15 +462,17 @@ __global__ void compute_energy_iso_group_group
             myIdxInTeam = 0;
         }
         int numNeigh = neighborCounts[ringPolyIdx];
-        for (int nthNeigh=myIdxInTeam; nthNeigh<numNeigh; nthNeigh+=nThreadPerAtom) {
-            int nlistIdx;
+        int baseIdxCompressed = 0;
+        if (compressed.words) {
             if (MULTITHREADPERATOM) {
-                nlistIdx = baseIdx + myIdxInTeam + warpSize * (nthNeigh/nThreadPerAtom);
+                baseIdxCompressed = baseNeighlistIdxFromRPIndex(compressed.cumulSumMaxPerBlock, warpSize, ringPolyIdx, nThreadPerAtom) + myIdxInTeam;
             } else {
-                nlistIdx = baseIdx + warpSize * nthNeigh;
+                baseIdxCompressed = baseNeighlistIdxFromRPIndex(compressed.cumulSumMaxPerBlock, warpSize, ringPolyIdx);
             }
-
-            uint otherIdxRaw = neighborlist[nlistIdx];
+        }
+        NeighborReader neighbors(neighborlist, compressed, baseIdx + myIdxInTeam, baseIdxCompressed, warpSize);
+        for (int nthNeigh=myIdxInTeam; nthNeigh<numNeigh; nthNeigh+=nThreadPerAtom) {
+            uint otherIdxRaw = neighbors.next();
             //The leftmost two bits in the neighbor entry say if it is a 1-2, 1-3, or 1-4 neighbor, or none of these
             uint neighDist = otherIdxRaw >> 30;
             float multiplier = multipliers[neighDist];
@@ -510,7 +521,7 @@ __global__ void compute_energy_iso_group_group
 
         if (MULTITHREADPERATOM) {
             engs_shr[threadIdx.x] = engSum;
-            reduceByN_NOSYNC<float>(engs_shr, nThreadPerAtom);
+            reduceByN_NOSYNC<accum>(engs_shr, nThreadPerAtom);
             if (myIdxInTeam==0) {
                 perParticleEng[atomIdx] += engs_shr[threadIdx.x];
             }
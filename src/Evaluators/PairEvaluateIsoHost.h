@@ -0,0 +1,447 @@
+#pragma once
+#include "BoundsGPU.h"
+#include "cutils_math.h"
+#include "Virial.h"
+#include "helpers.h"
+#include "SquareVector.h"
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+//host analogues of the kernels in PairEvaluateIso.h, used when the state's backend is set to 'host'
+//
+//The host neighborlist is stored in compressed rows: atom i's neighbors are neighborlist[neighborIdxs[i]] up to neighborlist[neighborIdxs[i]+neighborCounts[i]].
+//Entries carry the 1-2, 1-3, 1-4 flags in the top two bits exactly like the device list does.
+//The list is full (each pair stored from both sides), so each thread only ever writes to the atom it owns and no atomics are needed.
+
+template <class PAIR_EVAL, bool COMP_PAIRS, int N_PARAM, bool COMP_VIRIALS, class CHARGE_EVAL, bool COMP_CHARGES>
+void compute_force_iso_host
+        (int nAtoms,
+         const float4 *__restrict__ xs,
+         float4 *__restrict__ fs,
+         const uint16_t *__restrict__ neighborCounts,
+         const uint *__restrict__ neighborlist,
+         const uint32_t *__restrict__ neighborIdxs,
+         const float *__restrict__ parameters,
+         int numTypes,
+         BoundsGPU bounds,
+         float onetwoStr,
+         float onethreeStr,
+         float onefourStr,
+         Virial *__restrict__ virials,
+         const float *qs,
+         float qCutoffSqr,
+         PAIR_EVAL pairEval,
+         CHARGE_EVAL chargeEval)
+{
+    float multipliers[4] = {1, onetwoStr, onethreeStr, onefourStr};
+    int sqrSize = numTypes*numTypes;
+#pragma omp parallel for schedule(static)
+    for (int idx=0; idx<nAtoms; idx++) {
+        Virial virialsSum = Virial(0, 0, 0, 0, 0, 0);
+        float qi;
+        if (COMP_CHARGES) {
+            qi = qs[idx];
+        }
+        float4 posWhole = xs[idx];
+        int type = *(int *) &posWhole.w;
+        float3 pos = make_float3(posWhole);
+        float3 forceSum = make_float3(0, 0, 0);
+
+        int baseIdx = neighborIdxs[idx];
+        int numNeigh = neighborCounts[idx];
+        for (int nthNeigh=0; nthNeigh<numNeigh; nthNeigh++) {
+            uint otherIdxRaw = neighborlist[baseIdx + nthNeigh];
+            uint neighDist = otherIdxRaw >> 30;
+            float multiplier = multipliers[neighDist];
+            uint otherIdx = otherIdxRaw & EXCL_MASK;
+
+            float4 otherPosWhole = xs[otherIdx];
+            int otherType = *(int *) &otherPosWhole.w;
+            float3 otherPos = make_float3(otherPosWhole);
+
+            int sqrIdx = squareVectorIndex(numTypes, type, otherType);
+            float3 dr  = bounds.minImage(pos - otherPos);
+            float lenSqr = lengthSqr(dr);
+            float params_pair[N_PARAM];
+            float rCutSqr;
+            if (COMP_PAIRS) {
+                for (int pIdx=0; pIdx<N_PARAM; pIdx++) {
+                    params_pair[pIdx] = parameters[pIdx*sqrSize + sqrIdx];
+                }
+                rCutSqr = params_pair[0];
+            }
+            float3 force = make_float3(0, 0, 0);
+            bool computedForce = false;
+            if (COMP_PAIRS && lenSqr < rCutSqr) {
+                force += pairEval.force(dr, params_pair, lenSqr, multiplier);
+                computedForce = true;
+            }
+            if (COMP_CHARGES && lenSqr < qCutoffSqr) {
+                float qj = qs[otherIdx];
+                force += chargeEval.force(dr, lenSqr, qi, qj, multiplier);
+                computedForce = true;
+            }
+            if (computedForce) {
+                forceSum += force;
+                if (COMP_VIRIALS) {
+                    computeVirial(virialsSum, force, dr);
+                }
+            }
+        }
+        float4 forceCur = fs[idx];
+        forceCur += forceSum;
+        fs[idx] = forceCur;
+        if (COMP_VIRIALS) {
+            virialsSum *= 0.5f;
+            virials[idx] += virialsSum;
+        }
+    }
+}
+
+template <class PAIR_EVAL, bool COMP_PAIRS, int N, class CHARGE_EVAL, bool COMP_CHARGES>
+void compute_energy_iso_host
+        (int nAtoms,
+         const float4 *__restrict__ xs,
+         float *__restrict__ perParticleEng,
+         const uint16_t *__restrict__ neighborCounts,
+         const uint *__restrict__ neighborlist,
+         const uint32_t *__restrict__ neighborIdxs,
+         const float *__restrict__ parameters,
+         int numTypes,
+         BoundsGPU bounds,
+         float onetwoStr,
+         float onethreeStr,
+         float onefourStr,
+         const float *qs,
+         float qCutoffSqr,
+         PAIR_EVAL pairEval,
+         CHARGE_EVAL chargeEval)
+{
+    float multipliers[4] = {1, onetwoStr, onethreeStr, onefourStr};
+    int sqrSize = numTypes*numTypes;
+#pragma omp parallel for schedule(static)
+    for (int idx=0; idx<nAtoms; idx++) {
+        float qi;
+        if (COMP_CHARGES) {
+            qi = qs[idx];
+        }
+        float4 posWhole = xs[idx];
+        int type = *(int *) &posWhole.w;
+        float3 pos = make_float3(posWhole);
+        float engSum = 0;
+
+        int baseIdx = neighborIdxs[idx];
+        int numNeigh = neighborCounts[idx];
+        for (int nthNeigh=0; nthNeigh<numNeigh; nthNeigh++) {
+            uint otherIdxRaw = neighborlist[baseIdx + nthNeigh];
+            uint neighDist = otherIdxRaw >> 30;
+            float multiplier = multipliers[neighDist];
+            uint otherIdx = otherIdxRaw & EXCL_MASK;
+
+            float4 otherPosWhole = xs[otherIdx];
+            int otherType = *(int *) &otherPosWhole.w;
+            float3 otherPos = make_float3(otherPosWhole);
+            float3 dr = bounds.minImage(pos - otherPos);
+            float lenSqr = lengthSqr(dr);
+            int sqrIdx = squareVectorIndex(numTypes, type, otherType);
+            float rCutSqr;
+            float params_pair[N];
+            if (COMP_PAIRS) {
+                for (int pIdx=0; pIdx<N; pIdx++) {
+                    params_pair[pIdx] = parameters[pIdx*sqrSize + sqrIdx];
+                }
+                rCutSqr = params_pair[0];
+            }
+            if (COMP_PAIRS && lenSqr < rCutSqr) {
+                engSum += pairEval.energy(params_pair, lenSqr, multiplier);
+            }
+            if (COMP_CHARGES && lenSqr < qCutoffSqr) {
+                float qj = qs[otherIdx];
+                engSum += chargeEval.energy(lenSqr, qi, qj, multiplier);
+            }
+        }
+        perParticleEng[idx] += engSum;
+    }
+}
+
+//Half-list versions.  Each pair is stored once (otherIdx > idx) and the force is applied to both atoms.
+//Every thread handles a contiguous range of atoms and accumulates into its own slice of the scratch buffers.  Since
+//neighbors have larger indices, a thread only writes from the start of its range up to its largest neighbor, so
+//only that part of its slice is cleared and summed.  Slices are summed in thread order, so there are no races and
+//the result does not depend on scheduling for a fixed thread count.
+//
+//Rows are sorted by neighbor index, and every pair term is added straight into the scratch slot of each atom, so an
+//atom's terms are summed in increasing neighbor index on both lists.  With one thread the half list therefore gives
+//the full list's forces, energies, and virials bit for bit.
+
+inline int hostThreadIdx() {
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+inline int hostMaxThreads() {
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+inline int hostNumThreads() {
+#ifdef _OPENMP
+    return omp_get_num_threads();
+#else
+    return 1;
+#endif
+}
+
+template <class PAIR_EVAL, bool COMP_PAIRS, int N_PARAM, bool COMP_VIRIALS, class CHARGE_EVAL, bool COMP_CHARGES>
+void compute_force_iso_half_host
+        (int nAtoms,
+         const float4 *__restrict__ xs,
+         float4 *__restrict__ fs,
+         const uint16_t *__restrict__ neighborCounts,
+         const uint *__restrict__ neighborlist,
+         const uint32_t *__restrict__ neighborIdxs,
+         const float *__restrict__ parameters,
+         int numTypes,
+         BoundsGPU bounds,
+         float onetwoStr,
+         float onethreeStr,
+         float onefourStr,
+         Virial *__restrict__ virials,
+         const float *qs,
+         float qCutoffSqr,
+         std::vector<float3> &forceScratch,
+         std::vector<Virial> &virialScratch,
+         PAIR_EVAL pairEval,
+         CHARGE_EVAL chargeEval)
+{
+    float multipliers[4] = {1, onetwoStr, onethreeStr, onefourStr};
+    int sqrSize = numTypes*numTypes;
+    int maxThreads = hostMaxThreads();
+    //slices are cleared as they are written, so old contents don't matter
+    if (forceScratch.size() < (size_t) maxThreads*nAtoms) {
+        forceScratch.resize((size_t) maxThreads*nAtoms);
+    }
+    if (COMP_VIRIALS and virialScratch.size() < (size_t) maxThreads*nAtoms) {
+        virialScratch.resize((size_t) maxThreads*nAtoms);
+    }
+    //first atom and one past the last atom written by each thread
+    std::vector<int> writtenLo(maxThreads, 0);
+    std::vector<int> writtenHi(maxThreads, 0);
+    int nThreads = 1;
+#pragma omp parallel
+    {
+        int tid = hostThreadIdx();
+#pragma omp single
+        nThreads = hostNumThreads();
+        int idxLo = (int64_t) nAtoms*tid/nThreads;
+        int idxHi = (int64_t) nAtoms*(tid+1)/nThreads;
+        float3 *myForces = forceScratch.data() + (size_t) tid*nAtoms;
+        Virial *myVirials = COMP_VIRIALS ? virialScratch.data() + (size_t) tid*nAtoms : nullptr;
+        int cleared = idxLo;
+        //clears the slice up to and including idx the first time it is reached
+        auto touch = [&] (int idx) {
+            for (; cleared<=idx; cleared++) {
+                myForces[cleared] = make_float3(0, 0, 0);
+                if (COMP_VIRIALS) {
+                    myVirials[cleared] = Virial(0, 0, 0, 0, 0, 0);
+                }
+            }
+        };
+        for (int idx=idxLo; idx<idxHi; idx++) {
+            touch(idx);
+            float qi;
+            if (COMP_CHARGES) {
+                qi = qs[idx];
+            }
+            float4 posWhole = xs[idx];
+            int type = *(int *) &posWhole.w;
+            float3 pos = make_float3(posWhole);
+
+            int baseIdx = neighborIdxs[idx];
+            int numNeigh = neighborCounts[idx];
+            for (int nthNeigh=0; nthNeigh<numNeigh; nthNeigh++) {
+                uint otherIdxRaw = neighborlist[baseIdx + nthNeigh];
+                uint neighDist = otherIdxRaw >> 30;
+                float multiplier = multipliers[neighDist];
+                uint otherIdx = otherIdxRaw & EXCL_MASK;
+
+                float4 otherPosWhole = xs[otherIdx];
+                int otherType = *(int *) &otherPosWhole.w;
+                float3 otherPos = make_float3(otherPosWhole);
+
+                int sqrIdx = squareVectorIndex(numTypes, type, otherType);
+                float3 dr  = bounds.minImage(pos - otherPos);
+                float lenSqr = lengthSqr(dr);
+                float params_pair[N_PARAM];
+                float rCutSqr;
+                if (COMP_PAIRS) {
+                    for (int pIdx=0; pIdx<N_PARAM; pIdx++) {
+                        params_pair[pIdx] = parameters[pIdx*sqrSize + sqrIdx];
+                    }
+                    rCutSqr = params_pair[0];
+                }
+                float3 force = make_float3(0, 0, 0);
+                bool computedForce = false;
+                if (COMP_PAIRS && lenSqr < rCutSqr) {
+                    force += pairEval.force(dr, params_pair, lenSqr, multiplier);
+                    computedForce = true;
+                }
+                if (COMP_CHARGES && lenSqr < qCutoffSqr) {
+                    float qj = qs[otherIdx];
+                    force += chargeEval.force(dr, lenSqr, qi, qj, multiplier);
+                    computedForce = true;
+                }
+                if (computedForce) {
+                    touch(otherIdx);
+                    myForces[idx] += force;
+                    myForces[otherIdx] -= force;
+                    if (COMP_VIRIALS) {
+                        //halved in the reduction, so each atom gets half of the pair virial as with the full list
+                        computeVirial(myVirials[idx], force, dr);
+                        computeVirial(myVirials[otherIdx], -force, -dr);
+                    }
+                }
+            }
+        }
+        writtenLo[tid] = idxLo;
+        writtenHi[tid] = cleared;
+#pragma omp barrier
+#pragma omp for schedule(static)
+        for (int idx=0; idx<nAtoms; idx++) {
+            float3 forceSum = make_float3(0, 0, 0);
+            for (int t=0; t<nThreads; t++) {
+                if (idx >= writtenLo[t] and idx < writtenHi[t]) {
+                    forceSum += forceScratch[(size_t) t*nAtoms + idx];
+                }
+            }
+            float4 forceCur = fs[idx];
+            forceCur += forceSum;
+            fs[idx] = forceCur;
+            if (COMP_VIRIALS) {
+                Virial virialsSum(0, 0, 0, 0, 0, 0);
+                for (int t=0; t<nThreads; t++) {
+                    if (idx >= writtenLo[t] and idx < writtenHi[t]) {
+                        virialsSum += virialScratch[(size_t) t*nAtoms + idx];
+                    }
+                }
+                virialsSum *= 0.5f;
+                virials[idx] += virialsSum;
+            }
+        }
+    }
+}
+
+//Energy evaluators return half of the pair energy, so on the half list each atom of a pair gets one copy
+template <class PAIR_EVAL, bool COMP_PAIRS, int N, class CHARGE_EVAL, bool COMP_CHARGES>
+void compute_energy_iso_half_host
+        (int nAtoms,
+         const float4 *__restrict__ xs,
+         float *__restrict__ perParticleEng,
+         const uint16_t *__restrict__ neighborCounts,
+         const uint *__restrict__ neighborlist,
+         const uint32_t *__restrict__ neighborIdxs,
+         const float *__restrict__ parameters,
+         int numTypes,
+         BoundsGPU bounds,
+         float onetwoStr,
+         float onethreeStr,
+         float onefourStr,
+         const float *qs,
+         float qCutoffSqr,
+         std::vector<float> &engScratch,
+         PAIR_EVAL pairEval,
+         CHARGE_EVAL chargeEval)
+{
+    float multipliers[4] = {1, onetwoStr, onethreeStr, onefourStr};
+    int sqrSize = numTypes*numTypes;
+    int maxThreads = hostMaxThreads();
+    if (engScratch.size() < (size_t) maxThreads*nAtoms) {
+        engScratch.resize((size_t) maxThreads*nAtoms);
+    }
+    std::vector<int> writtenLo(maxThreads, 0);
+    std::vector<int> writtenHi(maxThreads, 0);
+    int nThreads = 1;
+#pragma omp parallel
+    {
+        int tid = hostThreadIdx();
+#pragma omp single
+        nThreads = hostNumThreads();
+        int idxLo = (int64_t) nAtoms*tid/nThreads;
+        int idxHi = (int64_t) nAtoms*(tid+1)/nThreads;
+        float *myEngs = engScratch.data() + (size_t) tid*nAtoms;
+        int cleared = idxLo;
+        auto touch = [&] (int idx) {
+            for (; cleared<=idx; cleared++) {
+                myEngs[cleared] = 0;
+            }
+        };
+        for (int idx=idxLo; idx<idxHi; idx++) {
+            touch(idx);
+            float qi;
+            if (COMP_CHARGES) {
+                qi = qs[idx];
+            }
+            float4 posWhole = xs[idx];
+            int type = *(int *) &posWhole.w;
+            float3 pos = make_float3(posWhole);
+
+            int baseIdx = neighborIdxs[idx];
+            int numNeigh = neighborCounts[idx];
+            for (int nthNeigh=0; nthNeigh<numNeigh; nthNeigh++) {
+                uint otherIdxRaw = neighborlist[baseIdx + nthNeigh];
+                uint neighDist = otherIdxRaw >> 30;
+                float multiplier = multipliers[neighDist];
+                uint otherIdx = otherIdxRaw & EXCL_MASK;
+
+                float4 otherPosWhole = xs[otherIdx];
+                int otherType = *(int *) &otherPosWhole.w;
+                float3 otherPos = make_float3(otherPosWhole);
+                float3 dr = bounds.minImage(pos - otherPos);
+                float lenSqr = lengthSqr(dr);
+                int sqrIdx = squareVectorIndex(numTypes, type, otherType);
+                float rCutSqr;
+                float params_pair[N];
+                if (COMP_PAIRS) {
+                    for (int pIdx=0; pIdx<N; pIdx++) {
+                        params_pair[pIdx] = parameters[pIdx*sqrSize + sqrIdx];
+                    }
+                    rCutSqr = params_pair[0];
+                }
+                if (COMP_PAIRS && lenSqr < rCutSqr) {
+                    float eng = pairEval.energy(params_pair, lenSqr, multiplier);
+                    touch(otherIdx);
+                    myEngs[idx] += eng;
+                    myEngs[otherIdx] += eng;
+                }
+                if (COMP_CHARGES && lenSqr < qCutoffSqr) {
+                    float qj = qs[otherIdx];
+                    float eng = chargeEval.energy(lenSqr, qi, qj, multiplier);
+                    touch(otherIdx);
+                    myEngs[idx] += eng;
+                    myEngs[otherIdx] += eng;
+                }
+            }
+        }
+        writtenLo[tid] = idxLo;
+        writtenHi[tid] = cleared;
+#pragma omp barrier
+#pragma omp for schedule(static)
+        for (int idx=0; idx<nAtoms; idx++) {
+            float engSum = 0;
+            for (int t=0; t<nThreads; t++) {
+                if (idx >= writtenLo[t] and idx < writtenHi[t]) {
+                    engSum += engScratch[(size_t) t*nAtoms + idx];
+                }
+            }
+            perParticleEng[idx] += engSum;
+        }
+    }
+}
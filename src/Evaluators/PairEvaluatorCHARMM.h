@@ -4,7 +4,7 @@
 
 class EvaluatorCHARMM {
     public:
-        inline __device__ float3 force(float3 dr, float params[5], float lenSqr, float multiplier) {
+        inline __host__ __device__ float3 force(float3 dr, float params[5], float lenSqr, float multiplier) {
             if (multiplier) {
                 bool isNorm = multiplier != mult14;
                 float epstimes24 = isNorm ? params[1] : params[3];
@@ -18,7 +18,7 @@ class EvaluatorCHARMM {
             }
             return make_float3(0, 0, 0);
         }
-        inline __device__ float energy(float params[3], float lenSqr, float multiplier) {
+        inline __host__ __device__ float energy(float params[3], float lenSqr, float multiplier) {
             if (multiplier) {
                 bool isNorm = multiplier != mult14;
                 float eps = (isNorm ? params[1] : params[3]) / 24.0f;
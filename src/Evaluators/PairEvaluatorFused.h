@@ -0,0 +1,113 @@
+#pragma once
+#ifndef EVALUATOR_FUSED
+#define EVALUATOR_FUSED
+
+#include "cutils_math.h"
+#include "PairEvaluatorLJ.h"
+#include "PairEvaluatorLJFS.h"
+#include "PairEvaluatorWCA.h"
+#include "PairEvaluatorTICG.h"
+#include "PairEvaluatorCHARMM.h"
+#include "PairEvaluatorTabulated.h"
+
+#include <vector>
+
+//Evaluates the pair potentials of several pair fixes in one pass over the neighbor list.
+//params are the largest rCutSqr of the fused fixes, followed by one slot of FUSED_SLOT_PARAMS
+//per fix holding that fix's own parameters (rCutSqr first).  EvaluatorFusedSlots is templated
+//on the evaluator of each slot, so each slot's potential is inlined at a compile time offset
+//and the per-pair parameters stay in registers.  Kernels only exist for the combinations
+//listed in FixPair::pickFusedEvaluator; EvaluatorFused describes a candidate combination.
+#define MAX_FUSED_PAIR 3
+#define FUSED_SLOT_PARAMS 5
+#define FUSED_N_PARAM(nSlots) (1 + (nSlots) * FUSED_SLOT_PARAMS)
+
+//slots are laid out in increasing kind order
+enum PAIR_EVAL_KIND {PAIR_EVAL_LJ, PAIR_EVAL_LJFS, PAIR_EVAL_WCA, PAIR_EVAL_TICG, PAIR_EVAL_CHARMM, PAIR_EVAL_TABULATED};
+
+class EvaluatorFused {
+    public:
+        int nEvals;
+        int kinds[MAX_FUSED_PAIR];
+        //evaluators which carry state.  Only one fix of each of these kinds can be fused
+        EvaluatorCHARMM charmm;
+        EvaluatorTabulated tabulated;
+        EvaluatorFused() : nEvals(0), charmm(0) {};
+
+        //! Returns false if there is no room, or if a stateful kind is already used
+        bool add(int kind) {
+            if (nEvals == MAX_FUSED_PAIR) {
+                return false;
+            }
+            if (kind == PAIR_EVAL_CHARMM or kind == PAIR_EVAL_TABULATED) {
+                for (int i=0; i<nEvals; i++) {
+                    if (kinds[i] == kind) {
+                        return false;
+                    }
+                }
+            }
+            kinds[nEvals++] = kind;
+            return true;
+        }
+
+        //! Order of the added evaluators which puts their kinds in increasing order, stable for equal kinds
+        std::vector<int> slotOrder() const {
+            std::vector<int> order;
+            for (int kind=PAIR_EVAL_LJ; kind<=PAIR_EVAL_TABULATED; kind++) {
+                for (int i=0; i<nEvals; i++) {
+                    if (kinds[i] == kind) {
+                        order.push_back(i);
+                    }
+                }
+            }
+            return order;
+        }
+};
+
+//! The slots of a fused evaluator.  Each slot adds its evaluator's term if the pair is within that fix's cutoff
+template <class... EVALS>
+class FusedSlotList {
+    public:
+        inline __host__ __device__ void addForce(float3 &, float3, float *, float, float) {}
+        inline __host__ __device__ void addEnergy(float &, float *, float, float) {}
+};
+
+template <class EVAL, class... REST>
+class FusedSlotList<EVAL, REST...> {
+    public:
+        EVAL eval;
+        FusedSlotList<REST...> rest;
+        FusedSlotList(EVAL eval_, REST... rest_) : eval(eval_), rest(rest_...) {};
+        inline __host__ __device__ void addForce(float3 &forceSum, float3 dr, float *p, float lenSqr, float multiplier) {
+            if (lenSqr < p[0]) {
+                forceSum += eval.force(dr, p, lenSqr, multiplier);
+            }
+            rest.addForce(forceSum, dr, p + FUSED_SLOT_PARAMS, lenSqr, multiplier);
+        }
+        inline __host__ __device__ void addEnergy(float &eng, float *p, float lenSqr, float multiplier) {
+            if (lenSqr < p[0]) {
+                eng += eval.energy(p, lenSqr, multiplier);
+            }
+            rest.addEnergy(eng, p + FUSED_SLOT_PARAMS, lenSqr, multiplier);
+        }
+};
+
+//! Fused evaluator with one slot per evaluator type, as the pair kernels take it
+template <class... EVALS>
+class EvaluatorFusedSlots {
+    public:
+        FusedSlotList<EVALS...> slots;
+        EvaluatorFusedSlots(EVALS... evals) : slots(evals...) {};
+        inline __host__ __device__ float3 force(float3 dr, float params[FUSED_N_PARAM(sizeof...(EVALS))], float lenSqr, float multiplier) {
+            float3 forceSum = make_float3(0, 0, 0);
+            slots.addForce(forceSum, dr, params + 1, lenSqr, multiplier);
+            return forceSum;
+        }
+        inline __host__ __device__ float energy(float params[FUSED_N_PARAM(sizeof...(EVALS))], float lenSqr, float multiplier) {
+            float eng = 0;
+            slots.addEnergy(eng, params + 1, lenSqr, multiplier);
+            return eng;
+        }
+};
+
+#endif
@@ -6,7 +6,7 @@
 
 class EvaluatorLJ {
     public:
-        inline __device__ float3 force(float3 dr, float params[3], float lenSqr, float multiplier) {
+        inline __host__ __device__ float3 force(float3 dr, float params[3], float lenSqr, float multiplier) {
             if (multiplier) {
                 float epstimes24 = params[1];
                 float sig6 = params[2];
@@ -19,7 +19,7 @@ class EvaluatorLJ {
             }
             return make_float3(0, 0, 0);
         }
-        inline __device__ float energy(float params[3], float lenSqr, float multiplier) {
+        inline __host__ __device__ float energy(float params[3], float lenSqr, float multiplier) {
             if (multiplier) {
                 float eps = params[1] / 24.0f;
                 float sig6 = params[2];
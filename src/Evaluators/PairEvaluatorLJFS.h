@@ -10,7 +10,7 @@
 
 class EvaluatorLJFS {
     public:
-        inline __device__ float3 force(float3 dr, float params[4], float lenSqr, float multiplier) {
+        inline __host__ __device__ float3 force(float3 dr, float params[4], float lenSqr, float multiplier) {
             if (multiplier) {
                 float epstimes24 = params[1];
                 float sig6 = params[2];
@@ -24,7 +24,7 @@ class EvaluatorLJFS {
             }
             return make_float3(0, 0, 0);
         }
-        inline __device__ float energy(float params[4], float lenSqr, float multiplier) {
+        inline __host__ __device__ float energy(float params[4], float lenSqr, float multiplier) {
             if (multiplier) {
                 float epstimes24 = params[1];
                 float sig6 = params[2];
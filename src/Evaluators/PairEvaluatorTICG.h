@@ -6,7 +6,7 @@
 
 class EvaluatorTICG {
 public:
-    inline __device__ float3 force(float3 dr, float params[2], float lenSqr, float multiplier) {
+    inline __host__ __device__ float3 force(float3 dr, float params[2], float lenSqr, float multiplier) {
         if (multiplier) {
             float rCutSqr = params[0];
 
@@ -27,7 +27,7 @@ public:
         }
         return make_float3(0, 0, 0);
     }
-    inline __device__ float energy(float params[2], float lenSqr, float multiplier) {
+    inline __host__ __device__ float energy(float params[2], float lenSqr, float multiplier) {
         if (multiplier) {
             float rCutSqr = params[0];
 
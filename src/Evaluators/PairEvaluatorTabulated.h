@@ -0,0 +1,59 @@
+#pragma once
+#ifndef EVALUATOR_TABULATED
+#define EVALUATOR_TABULATED
+
+#include "cutils_math.h"
+
+//Tables hold, for each interval between evenly spaced knots, the coefficients of the cubic
+//E(t) = c.x + c.y t + c.z t^2 + c.w t^3 with t in [0, 1) across the interval, so each pair needs one float4 read.
+//The force is -dE/dr of the same cubic, so forces and energies are consistent.
+//params are rCutSqr, rMin, 1/dr, and the index of the type pair's first interval (-1 if the pair has no table)
+
+//Coefficients of the interval of length dr between knots with energies e0, e1 and forces f0, f1 (dE/dr = -F)
+inline float4 tabulatedInterval(double e0, double e1, double f0, double f1, double dr) {
+    double d0 = -f0 * dr;
+    double d1 = -f1 * dr;
+    return make_float4(e0, d0, 3*(e1-e0) - 2*d0 - d1, 2*(e0-e1) + d0 + d1);
+}
+
+class EvaluatorTabulated {
+    public:
+        float4 *table;
+        float4 *tableHost;
+        int nIntervals;
+        EvaluatorTabulated() : table(nullptr), tableHost(nullptr), nIntervals(0) {};
+        EvaluatorTabulated(float4 *table_, float4 *tableHost_, int nIntervals_) : table(table_), tableHost(tableHost_), nIntervals(nIntervals_) {};
+
+        inline __host__ __device__ float4 lookup(float params[4], float len, float &t) {
+#ifdef __CUDA_ARCH__
+            float4 *coefs = table;
+#else
+            float4 *coefs = tableHost;
+#endif
+            float x = fmaxf((len - params[1]) * params[2], 0.0f);
+            int interval = min((int) x, nIntervals-1);
+            t = x - interval;
+            return coefs[(int) params[3] + interval];
+        }
+        inline __host__ __device__ float3 force(float3 dr, float params[4], float lenSqr, float multiplier) {
+            if (multiplier and params[3] >= 0) {
+                float len = sqrtf(lenSqr);
+                float t;
+                float4 c = lookup(params, len, t);
+                float forceScalar = -(c.y + t * (2.0f * c.z + t * 3.0f * c.w)) * params[2];
+                return dr * (forceScalar * multiplier / len);
+            }
+            return make_float3(0, 0, 0);
+        }
+        inline __host__ __device__ float energy(float params[4], float lenSqr, float multiplier) {
+            if (multiplier and params[3] >= 0) {
+                float t;
+                float4 c = lookup(params, sqrtf(lenSqr), t);
+                return 0.5f * (c.x + t * (c.y + t * (c.z + t * c.w))) * multiplier; //0.5 b/c we need to half-count energy b/c pairs are redundant
+            }
+            return 0;
+        }
+
+};
+
+#endif
@@ -10,7 +10,7 @@
 
 class EvaluatorWCA {
 public:
-    inline __device__ float3 force(float3 dr, float params[3], float lenSqr, float multiplier) {
+    inline __host__ __device__ float3 force(float3 dr, float params[3], float lenSqr, float multiplier) {
         if (multiplier) {
             float epstimes24 = params[1];
             float sig6 = params[2];
@@ -24,7 +24,7 @@ public:
         }
         return make_float3(0, 0, 0);
     }
-    inline __device__ float energy(float params[3], float lenSqr, float multiplier) {
+    inline __host__ __device__ float energy(float params[3], float lenSqr, float multiplier) {
         if (multiplier) {
             float eps = params[1]/24.0;
             float sig6 = params[2];
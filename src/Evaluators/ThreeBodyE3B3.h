@@ -6,6 +6,7 @@
 #include "helpers.h"
 #include "SquareVector.h"
 #include "cutils_math.h"
+#include "NeighborlistCompressed.h"
 #include <boost/shared_ptr.hpp>
 
 template <class EVALUATOR, bool COMP_VIRIALS> 
@@ -23,7 +24,8 @@ __global__ void compute_E3B3
          float4 *__restrict__ fs, 
          BoundsGPU bounds, 
          Virial *__restrict__ virials,
-         EVALUATOR eval)
+         EVALUATOR eval,
+         NeighborlistCompressed compressed)
 {
 
     int idx = GETIDX();
@@ -33,6 +35,7 @@ __global__ void compute_E3B3
         // -- the purpose of this is to load the neighbors associated with this molecule ID
         int thisIdx = molIdToIdxs[waterMolecIds[idx]];
         int baseIdx = baseNeighlistIdxFromIndex(cumulSumMaxPerBlock, warpSize, thisIdx);
+        int baseIdxCompressed = compressed.words ? baseNeighlistIdxFromIndex(compressed.cumulSumMaxPerBlock, warpSize, thisIdx) : 0;
 
         // here we should extract the positions of the O, H atoms of this water molecule
         // first, get the atom indices - maybe this will be stored as an array of ints?
@@ -76,11 +79,11 @@ __global__ void compute_E3B3
         // number of neighbors this molecule has, with which it can form trimers
         int numNeighMolecules = neighborCounts[thisIdx];
         
+        NeighborReader jNeighbors(neighborlist, compressed, baseIdx, baseIdxCompressed, warpSize);
         for (int j = 0; j < (numNeighMolecules); j++) {
             // get idx of this molecule
             // -- then, the atomIDs that we need are somehow accessible via MoleculeID
-            int nlistIdx = baseIdx + warpSize * j;
-            uint jIdxRaw = neighborlist[nlistIdx];
+            uint jIdxRaw = jNeighbors.next();
             int moleculeId2 = waterMolecIds[jIdxRaw];
 
             // get the molecule id for this idx
@@ -149,12 +152,12 @@ __global__ void compute_E3B3
             // we only wish to compute $-/nabla E_{ijk}$ for all unique combos of trimers, so this should range 
             // from k = j+1, while still less than numNeighMolecules w.r.t. baseMolecule ('i');
             
+            // a copy of the reader goes on from molecule 'j'
+            NeighborReader kNeighbors = jNeighbors;
             for (int k = j+1; k < numNeighMolecules; k++) {
                 
-                // grab warp index corresponding to this 'k'
-                int klistMoleculeIdx = baseIdx + warpSize * k;
-                // convert this index to a molecule index within our molecule array
-                uint krawIdx = neighborlist[klistMoleculeIdx];
+                // convert the next entry to a molecule index within our molecule array
+                uint krawIdx = kNeighbors.next();
 
                 // we now have our k molecule
                 int moleculeId3 = waterMolecIds[krawIdx];
@@ -0,0 +1,328 @@
+#include "FFTHost.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+typedef std::complex<double> cplx;
+
+FFTHostPlan::FFTHostPlan(int n_) : n(n_), m(0) {
+    int rest = n;
+    while (rest % 4 == 0) {
+        radices.push_back(4);
+        rest /= 4;
+    }
+    const int small[4] = {2, 3, 5, 7};
+    for (int p : small) {
+        while (rest % p == 0) {
+            radices.push_back(p);
+            rest /= p;
+        }
+    }
+    if (rest > 1) {
+        //a prime factor above 7: chirp z-transform as a power of two circular convolution of length >= 2n-1
+        radices.clear();
+        m = 1;
+        while (m < 2*n - 1) {
+            m *= 2;
+        }
+        convolution = std::make_shared<FFTHostPlan>(m);
+        chirp.resize(n);
+        for (int k=0; k<n; k++) {
+            //k^2 mod 2n keeps the phase accurate for large k
+            long long kSqr = ((long long) k * k) % (2*n);
+            chirp[k] = std::polar(1.0, -M_PI * kSqr / n);
+        }
+        std::vector<cplx> convScratch(convolution->scratchSize());
+        for (int s=0; s<2; s++) {
+            std::vector<cplx> &kernel = s ? kernelInverse : kernelForward;
+            kernel.assign(m, 0);
+            for (int k=0; k<n; k++) {
+                //conjugate of the chirp for this sign, at +k and -k
+                cplx c = s ? chirp[k] : std::conj(chirp[k]);
+                kernel[k] = c;
+                if (k) {
+                    kernel[m-k] = c;
+                }
+            }
+            convolution->transform(kernel.data(), -1, convScratch.data());
+        }
+        return;
+    }
+    twiddles.resize(n);
+    for (int k=0; k<n; k++) {
+        twiddles[k] = std::polar(1.0, -2.0 * M_PI * k / n);
+    }
+}
+
+int FFTHostPlan::scratchSize() const {
+    if (m) {
+        return m + convolution->scratchSize();
+    }
+    return 2*n;
+}
+
+//mixed radix decimation in time.  Writes the transform of the N values at in, spaced by stride, to out.
+//scratch must hold N values.  Roots of unity of order N are every (n/N)th entry of the table
+void FFTHostPlan::radixPass(const cplx *in, int N, int stride, cplx *out, int sign, cplx *scratch, int level) const {
+    if (N == 1) {
+        out[0] = in[0];
+        return;
+    }
+    int p = radices[level];
+    int M = N / p;
+    //transform each of the p interleaved subsequences into consecutive blocks of scratch
+    for (int r=0; r<p; r++) {
+        radixPass(in + r*stride, M, stride*p, scratch + r*M, sign, out + r*M, level+1);
+    }
+    int twStride = n / N;
+    int pStride = n / p;
+    bool conj = sign > 0;
+    //combine: X[k + j*M] = sum_r w_N^(r*k) w_p^(r*j) Y_r[k]
+    for (int k=0; k<M; k++) {
+        cplx t[7];
+        t[0] = scratch[k];
+        for (int r=1; r<p; r++) {
+            cplx w = twiddles[r*k*twStride];
+            t[r] = scratch[r*M + k] * (conj ? std::conj(w) : w);
+        }
+        if (p == 2) {
+            out[k] = t[0] + t[1];
+            out[k + M] = t[0] - t[1];
+        } else if (p == 4) {
+            cplx a = t[0] + t[2];
+            cplx b = t[0] - t[2];
+            cplx c = t[1] + t[3];
+            //(t1 - t3) times w_4 = -i forward, +i inverse
+            cplx d = t[1] - t[3];
+            d = conj ? cplx(-d.imag(), d.real()) : cplx(d.imag(), -d.real());
+            out[k] = a + c;
+            out[k + M] = b + d;
+            out[k + 2*M] = a - c;
+            out[k + 3*M] = b - d;
+        } else {
+            for (int j=0; j<p; j++) {
+                cplx sum = t[0];
+                for (int r=1; r<p; r++) {
+                    cplx w = twiddles[((r*j) % p) * pStride];
+                    sum += t[r] * (conj ? std::conj(w) : w);
+                }
+                out[k + j*M] = sum;
+            }
+        }
+    }
+}
+
+//X_k = c_k sum_j (x_j c_j) conj(c_(k-j)), with c_k = exp(sign pi i k^2 / n)
+void FFTHostPlan::bluestein(cplx *line, int sign, cplx *scratch) const {
+    bool conj = sign > 0;
+    cplx *a = scratch;
+    for (int k=0; k<n; k++) {
+        a[k] = line[k] * (conj ? std::conj(chirp[k]) : chirp[k]);
+    }
+    for (int k=n; k<m; k++) {
+        a[k] = 0;
+    }
+    cplx *convScratch = scratch + m;
+    convolution->transform(a, -1, convScratch);
+    const std::vector<cplx> &kernel = conj ? kernelInverse : kernelForward;
+    for (int k=0; k<m; k++) {
+        a[k] *= kernel[k];
+    }
+    convolution->transform(a, 1, convScratch);
+    double norm = 1.0 / m;
+    for (int k=0; k<n; k++) {
+        line[k] = a[k] * (conj ? std::conj(chirp[k]) : chirp[k]) * norm;
+    }
+}
+
+void FFTHostPlan::transform(cplx *line, int sign, cplx *scratch) const {
+    if (m) {
+        bluestein(line, sign, scratch);
+        return;
+    }
+    cplx *out = scratch;
+    radixPass(line, n, 1, out, sign, scratch + n, 0);
+    for (int i=0; i<n; i++) {
+        line[i] = out[i];
+    }
+}
+
+FFTHost::FFTHost(int nx_, int ny_, int nz_, bool useFFTW) : nx(nx_), ny(ny_), nz(nz_), lineSize(0), scratchSize(0) {
+    nzComplex = nz/2 + 1;
+#ifdef HAVE_FFTW
+    if (useFFTW) {
+        //FFTW_ESTIMATE does not touch the arrays, so any buffer of the right size works for planning
+        std::vector<float> buffer(size());
+        fftwf_complex *bufferComplex = (fftwf_complex *) buffer.data();
+        fftwForward = std::shared_ptr<fftwf_plan_s>(
+                fftwf_plan_dft_r2c_3d(nx, ny, nz, buffer.data(), bufferComplex, FFTW_ESTIMATE | FFTW_UNALIGNED),
+                fftwf_destroy_plan);
+        fftwInverse = std::shared_ptr<fftwf_plan_s>(
+                fftwf_plan_dft_c2r_3d(nx, ny, nz, bufferComplex, buffer.data(), FFTW_ESTIMATE | FFTW_UNALIGNED),
+                fftwf_destroy_plan);
+        return;
+    }
+#endif
+    planX = FFTHostPlan(nx);
+    planY = FFTHostPlan(ny);
+    if (nz % 2 == 0) {
+        planZ = FFTHostPlan(nz/2);
+        zTwiddles.resize(nzComplex);
+        for (int k=0; k<nzComplex; k++) {
+            zTwiddles[k] = std::polar(1.0, -2.0 * M_PI * k / nz);
+        }
+    } else {
+        planZ = FFTHostPlan(nz);
+    }
+    lineSize = std::max(std::max(nx, ny), nz);
+    scratchSize = std::max(std::max(planX.scratchSize(), planY.scratchSize()), planZ.scratchSize());
+}
+
+bool FFTHost::usingFFTW() const {
+#ifdef HAVE_FFTW
+    return (bool) fftwForward;
+#else
+    return false;
+#endif
+}
+
+//Even nz: pack the row as z_j = x_2j + i x_2j+1, transform at length h = nz/2, then split
+//X_k = (Z_k + conj(Z_h-k))/2 + w^k (Z_k - conj(Z_h-k))/2i for k <= h
+void FFTHost::forwardZ(float *rowData, cplx *line, cplx *scratch) const {
+    if (nz % 2) {
+        for (int z=0; z<nz; z++) {
+            line[z] = cplx(rowData[z], 0);
+        }
+        planZ.transform(line, -1, scratch);
+        for (int z=0; z<nzComplex; z++) {
+            rowData[2*z] = line[z].real();
+            rowData[2*z+1] = line[z].imag();
+        }
+        return;
+    }
+    int h = nz/2;
+    for (int j=0; j<h; j++) {
+        line[j] = cplx(rowData[2*j], rowData[2*j+1]);
+    }
+    planZ.transform(line, -1, scratch);
+    //k and h-k share the even and odd parts up to conjugation, so finish them in pairs
+    for (int k=0; k<=h/2; k++) {
+        int kk = h - k;
+        cplx zk = line[k % h];
+        cplx zkk = line[kk % h];
+        cplx even = 0.5 * (zk + std::conj(zkk));
+        cplx odd = cplx(0, -0.5) * (zk - std::conj(zkk));
+        cplx xk = even + zTwiddles[k] * odd;
+        //the same two values seen from h-k
+        cplx evenKK = std::conj(even);
+        cplx oddKK = std::conj(odd);
+        cplx xkk = evenKK + zTwiddles[kk] * oddKK;
+        rowData[2*k] = xk.real();
+        rowData[2*k+1] = xk.imag();
+        rowData[2*kk] = xkk.real();
+        rowData[2*kk+1] = xkk.imag();
+    }
+}
+
+//Inverse of the packing above: E_k = X_k + conj(X_h-k), O_k = (X_k - conj(X_h-k)) w^-k, Z_k = E_k + i O_k.
+//The unnormalized length h inverse of Z is nz times the packed row
+void FFTHost::inverseZ(float *rowData, cplx *line, cplx *scratch) const {
+    if (nz % 2) {
+        for (int z=0; z<nzComplex; z++) {
+            line[z] = cplx(rowData[2*z], rowData[2*z+1]);
+        }
+        for (int z=nzComplex; z<nz; z++) {
+            line[z] = std::conj(line[nz-z]);
+        }
+        planZ.transform(line, 1, scratch);
+        for (int z=0; z<nz; z++) {
+            rowData[z] = line[z].real();
+        }
+        return;
+    }
+    int h = nz/2;
+    for (int k=0; k<h; k++) {
+        cplx xk(rowData[2*k], rowData[2*k+1]);
+        cplx xkk(rowData[2*(h-k)], -rowData[2*(h-k)+1]);
+        cplx even = xk + xkk;
+        cplx odd = (xk - xkk) * std::conj(zTwiddles[k]);
+        line[k] = even + cplx(-odd.imag(), odd.real());
+    }
+    planZ.transform(line, 1, scratch);
+    for (int j=0; j<h; j++) {
+        rowData[2*j] = line[j].real();
+        rowData[2*j+1] = line[j].imag();
+    }
+}
+
+//Transforms every line along x (or y) of the half complex grid.  Called inside a parallel region
+void FFTHost::transformColumns(float *data, const FFTHostPlan &plan, bool alongX, int sign,
+                               cplx *line, cplx *scratch) const {
+    int rowStride = 2*nzComplex;
+    int n = alongX ? nx : ny;
+    int nOther = alongX ? ny : nx;
+    int lineStride = alongX ? ny*rowStride : rowStride;
+    int otherStride = alongX ? rowStride : ny*rowStride;
+#pragma omp for
+    for (int oz=0; oz<nOther*nzComplex; oz++) {
+        float *start = data + (oz / nzComplex)*otherStride + 2*(oz % nzComplex);
+        for (int i=0; i<n; i++) {
+            float *v = start + i*lineStride;
+            line[i] = cplx(v[0], v[1]);
+        }
+        plan.transform(line, sign, scratch);
+        for (int i=0; i<n; i++) {
+            float *v = start + i*lineStride;
+            v[0] = line[i].real();
+            v[1] = line[i].imag();
+        }
+    }
+}
+
+void FFTHost::forward(float *data) const {
+#ifdef HAVE_FFTW
+    if (fftwForward) {
+        fftwf_execute_dft_r2c(fftwForward.get(), data, (fftwf_complex *) data);
+        return;
+    }
+#endif
+    int rowStride = 2*nzComplex;
+#pragma omp parallel
+    {
+        std::vector<cplx> line(lineSize);
+        std::vector<cplx> scratch(scratchSize);
+        //z: real rows to the kz <= nz/2 half, then y, then x on the half grid
+#pragma omp for
+        for (int row=0; row<nx*ny; row++) {
+            forwardZ(data + row*rowStride, line.data(), scratch.data());
+        }
+        transformColumns(data, planY, false, -1, line.data(), scratch.data());
+        transformColumns(data, planX, true, -1, line.data(), scratch.data());
+    }
+}
+
+void FFTHost::inverse(float *data) const {
+#ifdef HAVE_FFTW
+    if (fftwInverse) {
+        fftwf_execute_dft_c2r(fftwInverse.get(), (fftwf_complex *) data, data);
+        return;
+    }
+#endif
+    int rowStride = 2*nzComplex;
+#pragma omp parallel
+    {
+        std::vector<cplx> line(lineSize);
+        std::vector<cplx> scratch(scratchSize);
+        //x, then y on the half grid, then z back to real rows
+        transformColumns(data, planX, true, 1, line.data(), scratch.data());
+        transformColumns(data, planY, false, 1, line.data(), scratch.data());
+#pragma omp for
+        for (int row=0; row<nx*ny; row++) {
+            inverseZ(data + row*rowStride, line.data(), scratch.data());
+        }
+    }
+}
@@ -0,0 +1,114 @@
+#pragma once
+#ifndef FFTHOST_H
+#define FFTHOST_H
+
+#include <complex>
+#include <memory>
+#include <vector>
+
+#ifdef HAVE_FFTW
+#include <fftw3.h>
+#endif
+
+//! One dimensional complex FFT of a fixed length
+/*!
+ * Everything that depends only on the length is computed once here: the
+ * factorization, the table of roots of unity and, for lengths with a prime
+ * factor above 7, the chirp and its transform for Bluestein's algorithm.
+ * Lengths made of 2, 3, 4, 5 and 7 use mixed radix decimation in time;
+ * other lengths become a power of two convolution, so every length is
+ * O(n log n).
+ */
+class FFTHostPlan {
+public:
+    FFTHostPlan() : n(0), m(0) {}
+    FFTHostPlan(int n_);
+
+    //! Number of complex values transform needs in scratch
+    int scratchSize() const;
+
+    //! Transform n values in place.  sign is -1 for forward, +1 for inverse (unnormalized)
+    void transform(std::complex<double> *line, int sign, std::complex<double> *scratch) const;
+
+    int n;
+
+private:
+    std::vector<int> radices;
+    //! exp(-2 pi i k / n) for k < n.  Inverse transforms use the conjugate
+    std::vector<std::complex<double> > twiddles;
+
+    //! Bluestein: convolution length (0 if unused), its plan, the chirp exp(-pi i k^2 / n),
+    //! and the forward transform of the convolution kernel for each sign
+    int m;
+    std::shared_ptr<FFTHostPlan> convolution;
+    std::vector<std::complex<double> > chirp;
+    std::vector<std::complex<double> > kernelForward;
+    std::vector<std::complex<double> > kernelInverse;
+
+    void radixPass(const std::complex<double> *in, int N, int stride, std::complex<double> *out, int sign,
+                   std::complex<double> *scratch, int level) const;
+    void bluestein(std::complex<double> *line, int sign, std::complex<double> *scratch) const;
+};
+
+//! Three dimensional real-to-complex FFT on the host
+/*!
+ * Uses the same data layout as in-place cuFFT R2C and C2R plans, so mesh
+ * data can be moved between FixChargeEwald's device grids and the host and
+ * transformed either way with identical results.  The real grid is stored
+ * with x slowest and z fastest, with the z dimension padded to
+ * 2*(nz/2+1) floats.  After the forward transform the same memory holds the
+ * nx*ny*(nz/2+1) complex coefficients with kz <= nz/2, as interleaved
+ * (real, imaginary) pairs.  As with cuFFT, the inverse transform is not
+ * normalized.
+ *
+ * When the build finds FFTW (HAVE_FFTW), FFTW plans do the work.  Otherwise
+ * the built-in transforms are used: plans for each axis are made in the
+ * constructor, real z rows of even length go through a complex transform
+ * of half the length, and lines are transformed in parallel with OpenMP
+ * when it is available.
+ */
+class FFTHost {
+public:
+    FFTHost() : nx(0), ny(0), nz(0), nzComplex(0), lineSize(0), scratchSize(0) {}
+    //! useFFTW=false forces the built-in transforms even when FFTW is available
+    FFTHost(int nx_, int ny_, int nz_, bool useFFTW=true);
+
+    //! Number of floats in a padded grid
+    int size() const {
+        return nx*ny*2*nzComplex;
+    }
+
+    //! Real grid to half complex grid, in place
+    void forward(float *data) const;
+
+    //! Half complex grid to real grid, in place, without normalization
+    void inverse(float *data) const;
+
+    //! True if FFTW plans are used
+    bool usingFFTW() const;
+
+private:
+    int nx, ny, nz;
+    int nzComplex;
+
+    FFTHostPlan planX, planY;
+    //! Length nz/2 for even nz, used with the packing below; nz otherwise
+    FFTHostPlan planZ;
+    //! exp(-2 pi i k / nz) for k <= nz/2, to split the packed half length transform of a real row
+    std::vector<std::complex<double> > zTwiddles;
+    //! Complex values of per-thread line and scratch storage
+    int lineSize;
+    int scratchSize;
+
+    void forwardZ(float *rowData, std::complex<double> *line, std::complex<double> *scratch) const;
+    void inverseZ(float *rowData, std::complex<double> *line, std::complex<double> *scratch) const;
+    void transformColumns(float *data, const FFTHostPlan &plan, bool alongX, int sign,
+                          std::complex<double> *line, std::complex<double> *scratch) const;
+
+#ifdef HAVE_FFTW
+    std::shared_ptr<fftwf_plan_s> fftwForward;
+    std::shared_ptr<fftwf_plan_s> fftwInverse;
+#endif
+};
+
+#endif
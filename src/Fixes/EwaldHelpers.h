@@ -0,0 +1,151 @@
+#pragma once
+#ifndef EWALD_HELPERS_H
+#define EWALD_HELPERS_H
+
+#include "cutils_math.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+//Mesh functions of FixChargeEwald which are shared by the device kernels and the host backend
+
+//Charge assignment functions of Hockney and Eastwood, the cardinal B-splines of order ORDER.  For a
+//particle at u (in grid units), grid point floor(u + ORDER/2) - k gets weight w[k], k = 0..ORDER-1, where
+//frac is the fractional part of u + ORDER/2.  dw[k] is the derivative of w[k] with respect to u
+template <int ORDER>
+inline __host__ __device__ void assignmentWeights(float frac, float *w, float *dw) {
+    //w[k] = M_n(frac + k), built up from M_1 with M_n(x) = (x M_{n-1}(x) + (n-x) M_{n-1}(x-1)) / (n-1)
+    w[0] = 1.0f;
+    dw[0] = 0.0f;
+    for (int n=2; n<=ORDER; n++) {
+        for (int k=n-1; k>=0; k--) {
+            float a = k < n-1 ? w[k] : 0.0f;
+            float b = k > 0 ? w[k-1] : 0.0f;
+            if (n == ORDER) {
+                dw[k] = a - b;
+            }
+            w[k] = ((frac + k)*a + (n - frac - k)*b) / (n-1);
+        }
+    }
+}
+
+inline __host__ __device__ float sinc(float x){
+  if ((x<0.1)&&(x>-0.1)){
+    float x2=x*x;
+    return 1.0 - x2*0.16666666667f + x2*x2*0.008333333333333333f - x2*x2*x2*0.00019841269841269841f;    
+  }
+    else return sin(x)/x;
+}
+
+//k vector of half grid point id, indices above sz/2 being negative frequencies
+inline __host__ __device__ float3 kVector(int3 id, int3 sz, float3 trace) {
+    //         2*PI
+    float3 k= 6.28318530717958647693f*make_float3(id)/trace;
+    if (id.x>sz.x/2) k.x= 6.28318530717958647693f*(id.x-sz.x)/trace.x;
+    if (id.y>sz.y/2) k.y= 6.28318530717958647693f*(id.y-sz.y)/trace.y;
+    if (id.z>sz.z/2) k.z= 6.28318530717958647693f*(id.z-sz.z)/trace.z;
+    return k;
+}
+
+//Shared by Green_function_cu and the host backend.  Also returns the derivatives of G with respect to the log of each
+//box dimension at fixed sz and alpha in dG, so small box changes can be applied without redoing the aliasing sums.
+//W depends only on the grid indices, not on the box, since kpM*h/2 = PI*(n + m*sz)/sz
+inline __host__ __device__ float greenFunction(int3 id, int3 sz, float3 trace, float alpha,
+                                               int sum_limits, int intrpl_order, bool ad, float3 &dG) {
+    float3 h =trace/make_float3(sz);
+    float3 k=kVector(id, sz, trace);
+
+    //OK GF(k)  = 4Pi/K^2 [SumforM(W(K+M)^2  exp(-(K+M)^2/4alpha) dot(K,K+M)/(K+M^2))] / 
+    //                    [SumforM^2(W(K+M)^2)]
+    //analytical differentiation:
+    //     GF(k)  = 4Pi [SumforM(W(K+M)^2  exp(-(K+M)^2/4alpha))] /
+    //                  [SumforM(W(K+M)^2) SumforM((K+M)^2 W(K+M)^2)]
+       
+       
+    float sum1=0.0f;   
+    float sum2=0.0f;   
+    float sum3=0.0f;
+    float3 dsum1=make_float3(0, 0, 0);
+    float3 dsum3=make_float3(0, 0, 0);
+    float k2=lengthSqr(k);
+    float Fouralpha2inv=0.25/alpha/alpha;
+    dG=make_float3(0, 0, 0);
+    if (k2==0.0){
+        return 0.0f;
+    }
+    for (int ix=-sum_limits;ix<=sum_limits;ix++){//TODO different limits 
+      for (int iy=-sum_limits;iy<=sum_limits;iy++){
+        for (int iz=-sum_limits;iz<=sum_limits;iz++){
+            float3 kpM=k+6.28318530717958647693f*make_float3(ix,iy,iz)/h;
+            float kpMlen=lengthSqr(kpM);
+            float W=sinc(kpM.x*h.x*0.5)*sinc(kpM.y*h.y*0.5)*sinc(kpM.z*h.z*0.5);
+    //      W*=h;//not need- cancels out
+            float W2=pow(W,intrpl_order*2);
+            //d kpM_i / d ln L_j = -kpM_i delta_ij, and likewise for k
+            float3 kpM2=kpM*kpM;
+            //4*PI
+            float term=12.56637061435917295385*exp(-kpMlen*Fouralpha2inv)*W2;
+            if (ad) {
+                sum1+=term;
+                sum3+=kpMlen*W2;
+                dsum1+=kpM2*(2.0f*Fouralpha2inv*term);
+                dsum3-=kpM2*(2.0f*W2);
+            } else {
+                float dotRatio=dot(k,kpM)/kpMlen;
+                sum1+=term*dotRatio;
+                dsum1+=kpM2*((2.0f*Fouralpha2inv + 2.0f/kpMlen)*term*dotRatio) - k*kpM*(2.0f*term/kpMlen);
+            }
+            sum2+=W2;
+        }
+      }
+    }
+    if (ad) {
+        float G=sum1/(sum2*sum3);
+        dG=dsum1/(sum2*sum3) - dsum3*(G/sum3);
+        return G;
+    }
+    float G=sum1/(sum2*sum2)/k2;
+    dG=k*k*(2.0f*G/k2) + dsum1/(sum2*sum2*k2);
+    return G;
+}
+
+//first order update of the Green function for a box whose dimensions differ from the one it was computed for by
+//factors of exp(dLogL)
+inline __host__ __device__ float updatedGreenFunction(float4 expansion, float3 dLogL) {
+    return expansion.x + expansion.y*dLogL.x + expansion.z*dLogL.y + expansion.w*dLogL.z;
+}
+
+//smallest size >= n with no prime factors other than 2, 3, 5 and 7, which both cuFFT and FFTHost transform fastest
+inline int nextFFTSize(int n) {
+    for (int m=std::max(n, 1); ; m++) {
+        int rest = m;
+        for (int p : {2, 3, 5, 7}) {
+            while (rest % p == 0) {
+                rest /= p;
+            }
+        }
+        if (rest == 1) {
+            return m;
+        }
+    }
+}
+
+//(r_cut, interpolation_order) sets FixChargeEwald offers the Autotuner in error mode.  The user's come first, then
+//scaled cutoffs below rCutMax at the user's and a few other orders of at least minOrder, without repeats
+inline std::vector<std::pair<float, int> > ewaldTuneCandidates(float rCut, int order, float rCutMax, int minOrder) {
+    std::vector<std::pair<float, int> > candidates;
+    candidates.push_back(std::make_pair(rCut, order));
+    for (int o : {order, 3, 5, 7}) {
+        for (float scale : {0.85f, 1.0f, 1.2f}) {
+            std::pair<float, int> candidate(scale*rCut, o);
+            if (candidate.first < rCutMax and o >= minOrder
+                and std::find(candidates.begin(), candidates.end(), candidate) == candidates.end()) {
+                candidates.push_back(candidate);
+            }
+        }
+    }
+    return candidates;
+}
+
+#endif
@@ -1,5 +1,6 @@
 #include "Fix.h"
 
+#include <cmath>
 #include <iostream>
 
 #include "Atom.h"
@@ -20,6 +21,7 @@ Fix::Fix(boost::shared_ptr<State> state_, std::string handle_, std::string group
     updateGroupTag();
     requiresPostNVE_V = false;
     requiresForces = false;
+    canRunOnHost = false;
     requiresPerAtomVirials = false;
     prepared = false;
     canOffloadChargePairCalc = false;
@@ -27,6 +29,9 @@ Fix::Fix(boost::shared_ptr<State> state_, std::string handle_, std::string group
     
     hasOffloadedChargePairCalc = false;
     hasAcceptedChargePairCalc = false;
+    canFusePairCalc = false;
+    hasOffloadedPairCalc = false;
+    respaLevel = 0;
     setEvalWrapperMode("offload"); //offload by default
     nThreadPerAtom(state->nThreadPerAtom);
 
@@ -63,7 +68,23 @@ void Fix::resetChargePairFlags() {
 
     hasOffloadedChargePairCalc = false;
     hasAcceptedChargePairCalc = false;
+    hasOffloadedPairCalc = false;
+    resetPairFusion();
 }
+float Fix::getNeighborRCut() {
+    float rCut = 0;
+    for (float x : getRCuts()) {
+        rCut = fmax(rCut, x < 0 ? (float) state->rCut : x);
+    }
+    return rCut;
+}
+
+std::vector<float> Fix::getNeighborRCutSqrs() {
+    int numTypes = state->atomParams.numTypes;
+    float rCut = getNeighborRCut();
+    return std::vector<float>(numTypes*numTypes, rCut*rCut);
+}
+
 bool Fix::isEqual(Fix &f) {
     return f.handle == handle;
 }
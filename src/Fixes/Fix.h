@@ -91,6 +91,17 @@ public:
      */
     virtual bool postRun() { return true; }
 
+    //! Regroup bonded forcers by the current atom ordering
+    /*!
+     * \param idToIdx Current index of each atom id
+     *
+     * Bonded fixes group their forcers by atom index in prepareForRun(), so
+     * as atoms are re-sorted during a run the forcers of neighboring threads
+     * drift apart in memory.  Called every State::reorderForcersEvery
+     * neighbor list builds.
+     */
+    virtual void reorderForcers(std::vector<int> &idToIdx) {}
+
     //! Perform operations at the start of a simulation step
     /*!
      * \return False if a problem occured, else return true
@@ -133,6 +144,16 @@ public:
      */
     virtual void compute(int virialMode) {}
 
+    //! Apply fix on the host
+    /*!
+     * \param virialMode Compute virials for this Fix
+     *
+     * Called in place of compute() when the state's backend is 'host'.  Acts
+     * on the host copies of the atom data.  Only fixes with canRunOnHost set
+     * may be used with the host backend.
+     */
+    virtual void computeHost(int virialMode) {}
+
     //! Calculate single point energy of this Fix
     /*!
      * \param perParticleEng Pointer to where to store the per-particle energy
@@ -148,6 +169,14 @@ public:
     virtual void singlePointEng(float *perParticleEng) {}
     virtual void singlePointEngGroupGroup(float *perParticleEng, uint32_t groupTagA, uint32_t groupTagB) {}
 
+    //! Host backend version of singlePointEng
+    /*!
+     * \param perParticleEng Host array the per-particle energies are added to
+     *
+     * Implemented by the fixes with canRunOnHost set.
+     */
+    virtual void singlePointEngHost(float *perParticleEng) {}
+
     //! Accomodate for new type of Atoms added to the system
     /*!
      * \param handle String specifying the new type of Atoms
@@ -224,6 +253,43 @@ public:
         return std::vector<float>();
     }
 
+    //! Largest distance of the pairs this Fix evaluates from the neighbor list
+    /*!
+     * \return Largest of getRCuts(), with default cutoffs taken from
+     *         State::rCut, or 0 if the Fix has no cutoffs.
+     *
+     * The Fix's pair kernels iterate the shortest neighbor sub-list covering
+     * this distance, see GridGPU::setSubListRCuts.
+     */
+    virtual float getNeighborRCut();
+
+    //! Squared cutoff of each type pair, for State::multiCutoffNeighbors
+    /*!
+     * \return numTypes*numTypes squared cutoffs.  Defaults to
+     *         getNeighborRCut() for every pair.
+     */
+    virtual std::vector<float> getNeighborRCutSqrs();
+
+    //! Number of parameter sets the Autotuner may time for this Fix
+    /*!
+     * Fixes with settings that trade accuracy-neutral work between parts of
+     * the step (such as FixChargeEwald's real space cutoff and mesh) list
+     * them here.  The Autotuner times each with setTuneCandidate and keeps
+     * the fastest.  Set 0 must be the Fix's own settings.  Returns 0 if the
+     * Fix has nothing to tune.
+     */
+    virtual int nTuneCandidates() {
+        return 0;
+    }
+
+    //! Switch to parameter set idx, 0 <= idx < nTuneCandidates()
+    virtual void setTuneCandidate(int idx) {}
+
+    //! Index of the parameter set in use
+    virtual int tuneCandidate() {
+        return 0;
+    }
+
     
     //XXX A temporary fix so that the temperature computer, when consulting fixes for a removal of DOF,
     // does not end up with a bad value for NDF.  Currently implemented in the Andersen thermostat.
@@ -248,6 +314,11 @@ public:
     //There's a hitch though.  When I want to calculate per-fix energies, the charge fix needs to take back its evaluator so that short-range pair energies belong to that fix. 
     //The un-adulterated evaluator is origEvalWrapper, and that is used to calculate per-particle energies
     virtual void acceptChargePairCalc(Fix *){};
+    //Pair fixes can likewise hand their pair evaluators to another pair fix, so that all of them run in one
+    //pass over the neighbor list.  See handlePairFusion in State.cpp and EvaluatorFused.
+    //Returns false if the other fix's evaluator cannot be fused into this one
+    virtual bool acceptPairCalc(Fix *){return false;};
+    virtual void resetPairFusion(){};
 
     virtual void setEvalWrapper(){};
 
@@ -270,6 +341,7 @@ public:
     bool isThermostat; //!< True if is a thermostat. Used for barostats.
     bool requiresForces; //!< True if the fix requires forces on instantiation; defaults to false.
     bool requiresPostNVE_V;
+    bool canRunOnHost; //!< True if the fix implements computeHost; defaults to false.
 
     bool prepared; //!< True if the fix has been prepared; false otherwise.
     bool canOffloadChargePairCalc;
@@ -278,6 +350,9 @@ public:
     bool hasOffloadedChargePairCalc;
     bool hasAcceptedChargePairCalc;
     void resetChargePairFlags();
+    bool canFusePairCalc; //!< True if the fix's pair evaluator can run in another pair fix's kernel
+    bool hasOffloadedPairCalc; //!< True if another pair fix is evaluating this fix's pairs
+    int respaLevel; //!< Force level the fix is integrated at by IntegratorRESPA, 0 otherwise
 
     int orderPreference; //!< Fixes with a high order preference are calculated
                          //!< later.
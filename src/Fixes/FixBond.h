@@ -23,7 +23,8 @@ template <class SRC, class DEST, class BONDTYPEHOLDER>
 int copyBondsToGPU(std::vector<Atom> &atoms, 
                    std::vector<BondVariant> &src, std::vector<int> &idToIdx,
                    GPUArrayDeviceGlobal<DEST> *dest, GPUArrayDeviceGlobal<int> *destIdxs, 
-                   GPUArrayDeviceGlobal<BONDTYPEHOLDER> *parameters, int maxExistingType, std::unordered_map<int, BONDTYPEHOLDER> &bondTypes) {
+                   GPUArrayDeviceGlobal<BONDTYPEHOLDER> *parameters, int maxExistingType, std::unordered_map<int, BONDTYPEHOLDER> &bondTypes,
+                   std::vector<DEST> *destHost_out, std::vector<int> *destIdxsHost_out, std::vector<BONDTYPEHOLDER> *parametersHost_out) {
 
     std::vector<int> idxs(atoms.size()+1, 0);  // started out being used as counts
     std::vector<int> numAddedPerAtom(atoms.size(), 0);
@@ -57,6 +58,9 @@ int copyBondsToGPU(std::vector<Atom> &atoms,
     dest->set(destHost.data());
     *destIdxs = GPUArrayDeviceGlobal<int>(idxs.size());
     destIdxs->set(idxs.data());
+    //host copies for the host backend
+    *destHost_out = destHost;
+    *destIdxsHost_out = idxs;
 
     //getting max # bonds per block
     int maxPerBlock = 0;
@@ -75,6 +79,7 @@ int copyBondsToGPU(std::vector<Atom> &atoms,
     }
     *parameters = GPUArrayDeviceGlobal<BONDTYPEHOLDER>(types.size());
     parameters->set(types.data());
+    *parametersHost_out = types;
     return maxPerBlock;
 
 }
@@ -85,6 +90,10 @@ class FixBond : public Fix, public TypedItemHolder {
         GPUArrayDeviceGlobal<GPUMember> bondsGPU;
         GPUArrayDeviceGlobal<int> bondIdxs;
         GPUArrayDeviceGlobal<BONDTYPEHOLDER> parameters; 
+        //host copies of the above, used by the host backend
+        std::vector<GPUMember> bondsHost;
+        std::vector<int> bondIdxsHost;
+        std::vector<BONDTYPEHOLDER> parametersHost;
         std::vector<BondVariant> bonds;
         boost::python::list pyBonds;
         VariantPyListInterface<BondVariant, CPUMember> pyListInterface;
@@ -140,7 +149,8 @@ class FixBond : public Fix, public TypedItemHolder {
                 } 
             }
             maxBondsPerBlock = copyBondsToGPU<CPUMember, GPUMember, BONDTYPEHOLDER>(
-                    atoms, bonds, state->idToIdx, &bondsGPU, &bondIdxs, &parameters, maxExistingType, bondTypes);
+                    atoms, bonds, state->idToIdx, &bondsGPU, &bondIdxs, &parameters, maxExistingType, bondTypes,
+                    &bondsHost, &bondIdxsHost, &parametersHost);
            // maxbondsPerBlock = copyMultiAtomToGPU<CPUVariant, CPUBase, CPUMember, GPUMember, ForcerTypeHolder, N>(state->atoms.size(), forcers, state->idToIdx, &forcersGPU, &forcerIdxs, &forcerTypes, &parameters, maxExistingType);
             setSharedMemForParams();
             prepared = true;
@@ -151,6 +161,14 @@ class FixBond : public Fix, public TypedItemHolder {
 
         
         
+        virtual void reorderForcers(std::vector<int> &idToIdx) {
+            //only the grouping by atom changes, so the arrays are refilled in place
+            maxBondsPerBlock = regroupForcersByAtom(bondsHost, bondIdxsHost, idToIdx,
+                                                    [] (const GPUMember &b) { return b.myId; });
+            bondsGPU.set(bondsHost.data());
+            bondIdxs.set(bondIdxsHost.data());
+        }
+
         std::vector<int> getTypeIds() {
             std::vector<int> ids;
             for (auto it=bondTypes.begin(); it!=bondTypes.end(); it++) {
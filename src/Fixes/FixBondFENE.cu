@@ -12,6 +12,7 @@ const std::string bondFENEType = "BondFENE";
 FixBondFENE::FixBondFENE(SHARED(State) state_, string handle)
     : FixBond(state_, handle, string("None"), bondFENEType, true, 1) {
         readFromRestart();
+        canRunOnHost = true;
     }
 
 
@@ -40,13 +41,33 @@ void FixBondFENE::compute(int virialMode) {
     //cout << "Max bonds per block is " << maxBondsPerBlock << endl;
     if (bondsGPU.size()) {
         if (virialMode) {
-            compute_force_bond<BondFENEType, BondEvaluatorFENE, true> <<<NBLOCK(nAtoms), PERBLOCK, sizeof(BondGPU) * maxBondsPerBlock + sharedMemSizeForParams>>>(nAtoms, gpd.xs(activeIdx), gpd.fs(activeIdx), gpd.idToIdxs.d_data.data(), bondsGPU.data(), bondIdxs.data(), parameters.data(), parameters.size(), state->boundsGPU, gpd.virials.d_data.data(), usingSharedMemForParams, evaluator);
+            compute_force_bond<BondFENEType, BondEvaluatorFENE, true> <<<NBLOCK(nAtoms), PERBLOCK, sizeof(BondGPU) * maxBondsPerBlock + sharedMemSizeForParams>>>(nAtoms, gpd.xs(activeIdx), gpd.fs(activeIdx), gpd.fsFixed.data(), gpd.idToIdxs.d_data.data(), bondsGPU.data(), bondIdxs.data(), parameters.data(), parameters.size(), state->boundsGPU, gpd.virials.d_data.data(), usingSharedMemForParams, evaluator);
         } else {
-            compute_force_bond<BondFENEType, BondEvaluatorFENE, false> <<<NBLOCK(nAtoms), PERBLOCK, sizeof(BondGPU) * maxBondsPerBlock + sharedMemSizeForParams>>>(nAtoms, gpd.xs(activeIdx), gpd.fs(activeIdx), gpd.idToIdxs.d_data.data(), bondsGPU.data(), bondIdxs.data(), parameters.data(), parameters.size(), state->boundsGPU, gpd.virials.d_data.data(), usingSharedMemForParams, evaluator);
+            compute_force_bond<BondFENEType, BondEvaluatorFENE, false> <<<NBLOCK(nAtoms), PERBLOCK, sizeof(BondGPU) * maxBondsPerBlock + sharedMemSizeForParams>>>(nAtoms, gpd.xs(activeIdx), gpd.fs(activeIdx), gpd.fsFixed.data(), gpd.idToIdxs.d_data.data(), bondsGPU.data(), bondIdxs.data(), parameters.data(), parameters.size(), state->boundsGPU, gpd.virials.d_data.data(), usingSharedMemForParams, evaluator);
         }
     }
 }
 
+void FixBondFENE::computeHost(int virialMode) {
+    int nAtoms = state->atoms.size();
+    GPUData &gpd = state->gpd;
+    if (bondsHost.size()) {
+        if (virialMode) {
+            compute_force_bond_host<BondFENEType, BondEvaluatorFENE, true>(nAtoms, gpd.xs.h_data.data(), gpd.fs.h_data.data(), gpd.idToIdxs.h_data.data(), bondsHost.data(), bondIdxsHost.data(), parametersHost.data(), state->boundsGPU, gpd.virials.h_data.data(), evaluator);
+        } else {
+            compute_force_bond_host<BondFENEType, BondEvaluatorFENE, false>(nAtoms, gpd.xs.h_data.data(), gpd.fs.h_data.data(), gpd.idToIdxs.h_data.data(), bondsHost.data(), bondIdxsHost.data(), parametersHost.data(), state->boundsGPU, gpd.virials.h_data.data(), evaluator);
+        }
+    }
+}
+
+void FixBondFENE::singlePointEngHost(float *perParticleEng) {
+    int nAtoms = state->atoms.size();
+    GPUData &gpd = state->gpd;
+    if (bondsHost.size()) {
+        compute_energy_bond_host<BondFENEType, BondEvaluatorFENE>(nAtoms, gpd.xs.h_data.data(), perParticleEng, gpd.idToIdxs.h_data.data(), bondsHost.data(), bondIdxsHost.data(), parametersHost.data(), state->boundsGPU, evaluator);
+    }
+}
+
 void FixBondFENE::singlePointEng(float *perParticleEng) {
     int nAtoms = state->atoms.size();
     int activeIdx = state->gpd.activeIdx();
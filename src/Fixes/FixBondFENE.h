@@ -19,7 +19,9 @@ public:
     ~FixBondFENE(){};
 
     void compute(int);
+    void computeHost(int);
     void singlePointEng(float *);
+    void singlePointEngHost(float *);
     std::string restartChunk(std::string format);
     bool readFromRestart();
     BondEvaluatorFENE evaluator;
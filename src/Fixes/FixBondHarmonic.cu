@@ -12,6 +12,7 @@ const std::string bondHarmonicType = "BondHarmonic";
 FixBondHarmonic::FixBondHarmonic(SHARED(State) state_, string handle)
     : FixBond(state_, handle, string("None"), bondHarmonicType, true, 1) {
         readFromRestart();
+        canRunOnHost = true;
     }
 
 //template <class BONDTYPE, class EVALUATOR, bool COMPUTEVIRIALS>
@@ -41,13 +42,33 @@ void FixBondHarmonic::compute(int virialMode) {
     //cout << "Max bonds per block is " << maxBondsPerBlock << endl;
     if (bondsGPU.size()) {
         if (virialMode) {
-            compute_force_bond<BondHarmonicType, BondEvaluatorHarmonic, true> <<<NBLOCK(nAtoms), PERBLOCK, sizeof(BondGPU) * maxBondsPerBlock + sharedMemSizeForParams>>>(nAtoms, gpd.xs(activeIdx), gpd.fs(activeIdx), gpd.idToIdxs.d_data.data(), bondsGPU.data(), bondIdxs.data(), parameters.data(), parameters.size(), state->boundsGPU, gpd.virials.d_data.data(), usingSharedMemForParams, evaluator);
+            compute_force_bond<BondHarmonicType, BondEvaluatorHarmonic, true> <<<NBLOCK(nAtoms), PERBLOCK, sizeof(BondGPU) * maxBondsPerBlock + sharedMemSizeForParams>>>(nAtoms, gpd.xs(activeIdx), gpd.fs(activeIdx), gpd.fsFixed.data(), gpd.idToIdxs.d_data.data(), bondsGPU.data(), bondIdxs.data(), parameters.data(), parameters.size(), state->boundsGPU, gpd.virials.d_data.data(), usingSharedMemForParams, evaluator);
         } else {
-            compute_force_bond<BondHarmonicType, BondEvaluatorHarmonic, false> <<<NBLOCK(nAtoms), PERBLOCK, sizeof(BondGPU) * maxBondsPerBlock + sharedMemSizeForParams>>>(nAtoms, gpd.xs(activeIdx), gpd.fs(activeIdx), gpd.idToIdxs.d_data.data(), bondsGPU.data(), bondIdxs.data(), parameters.data(), parameters.size(), state->boundsGPU, gpd.virials.d_data.data(), usingSharedMemForParams, evaluator);
+            compute_force_bond<BondHarmonicType, BondEvaluatorHarmonic, false> <<<NBLOCK(nAtoms), PERBLOCK, sizeof(BondGPU) * maxBondsPerBlock + sharedMemSizeForParams>>>(nAtoms, gpd.xs(activeIdx), gpd.fs(activeIdx), gpd.fsFixed.data(), gpd.idToIdxs.d_data.data(), bondsGPU.data(), bondIdxs.data(), parameters.data(), parameters.size(), state->boundsGPU, gpd.virials.d_data.data(), usingSharedMemForParams, evaluator);
         }
     }
 }
 
+void FixBondHarmonic::computeHost(int virialMode) {
+    int nAtoms = state->atoms.size();
+    GPUData &gpd = state->gpd;
+    if (bondsHost.size()) {
+        if (virialMode) {
+            compute_force_bond_host<BondHarmonicType, BondEvaluatorHarmonic, true>(nAtoms, gpd.xs.h_data.data(), gpd.fs.h_data.data(), gpd.idToIdxs.h_data.data(), bondsHost.data(), bondIdxsHost.data(), parametersHost.data(), state->boundsGPU, gpd.virials.h_data.data(), evaluator);
+        } else {
+            compute_force_bond_host<BondHarmonicType, BondEvaluatorHarmonic, false>(nAtoms, gpd.xs.h_data.data(), gpd.fs.h_data.data(), gpd.idToIdxs.h_data.data(), bondsHost.data(), bondIdxsHost.data(), parametersHost.data(), state->boundsGPU, gpd.virials.h_data.data(), evaluator);
+        }
+    }
+}
+
+void FixBondHarmonic::singlePointEngHost(float *perParticleEng) {
+    int nAtoms = state->atoms.size();
+    GPUData &gpd = state->gpd;
+    if (bondsHost.size()) {
+        compute_energy_bond_host<BondHarmonicType, BondEvaluatorHarmonic>(nAtoms, gpd.xs.h_data.data(), perParticleEng, gpd.idToIdxs.h_data.data(), bondsHost.data(), bondIdxsHost.data(), parametersHost.data(), state->boundsGPU, evaluator);
+    }
+}
+
 void FixBondHarmonic::singlePointEng(float *perParticleEng) {
     int nAtoms = state->atoms.size();
     int activeIdx = state->gpd.activeIdx();
@@ -19,7 +19,9 @@ public:
     ~FixBondHarmonic(){};
 
     void compute(int);
+    void computeHost(int);
     void singlePointEng(float *);
+    void singlePointEngHost(float *);
     std::string restartChunk(std::string format);
     bool readFromRestart();
     BondEvaluatorHarmonic evaluator;
@@ -8,8 +8,11 @@
 #include <cufft.h>
 #include "globalDefs.h"
 #include <fstream>
+#include <algorithm>
 #include "Virial.h"
 #include "helpers.h"
+#include "EwaldHelpers.h"
+#include "Logging.h"
 
 #include "PairEvaluatorNone.h"
 #include "EvaluatorWrapper.h"
@@ -18,6 +21,27 @@ using namespace std;
 namespace py = boost::python;
 const std::string chargeEwaldType = "ChargeEwald";
 
+//The charge density is real, so the mesh is transformed real-to-complex in place, in cuFFT's padded layout:
+//real grid points are laid out with the z dimension padded to 2*(sz.z/2+1), and only the kz <= sz.z/2 half
+//of k-space is stored, the rest following from Hermitian symmetry
+inline __host__ __device__ int realGridIdx(int3 p, int3 sz) {
+    return (p.x*sz.y + p.y)*2*(sz.z/2 + 1) + p.z;
+}
+
+inline __host__ __device__ int kGridIdx(int3 id, int3 sz) {
+    return (id.x*sz.y + id.y)*(sz.z/2 + 1) + id.z;
+}
+
+inline __host__ __device__ int3 kGridId(int kIdx, int3 sz) {
+    int nzComplex = sz.z/2 + 1;
+    return make_int3(kIdx/(sz.y*nzComplex), (kIdx/nzComplex)%sz.y, kIdx%nzComplex);
+}
+
+//k-points with 0 < kz < sz.z/2 stand for themselves and their conjugate in sums over all of k-space
+inline __host__ __device__ float kGridWeight(int3 id, int3 sz) {
+    return (id.z == 0 or 2*id.z == sz.z) ? 1.0f : 2.0f;
+}
+
 // #define THREADS_PER_BLOCK_
 
 // MW: Note that this function is a verbatim copy of that which appears in GridGPU.cu
@@ -67,43 +91,40 @@ __global__ void computeCentroid(float4 *centroids, float4 *xs, int nAtoms, int n
      }
  
  }
-//different implementation for different interpolation orders
-//TODO template
-//order 1 nearest point
-__global__ void map_charge_to_grid_order_1_cu(int nRingPoly, int nPerRingPoly, float4 *xs,  float *qs,  BoundsGPU bounds,
-                                      int3 sz,float *grid/*convert to float for cufffComplex*/,float  Qunit) {
-
-    int idx = GETIDX();
-    if (idx < nRingPoly) {
-        float4 posWhole = xs[idx];
-        float3 pos = make_float3(posWhole)-bounds.lo;
-
-        float qi = Qunit*qs[idx * nPerRingPoly];
-        
-        //find nearest grid point
-        float3 h=bounds.trace()/make_float3(sz);
-        int3 nearest_grid_point=make_int3((pos+0.5*h)/h);
-        //or
-        int3 p=nearest_grid_point;
-        if (p.x>0) p.x-=int(p.x/sz.x)*sz.x;
-        if (p.y>0) p.y-=int(p.y/sz.y)*sz.y;
-        if (p.z>0) p.z-=int(p.z/sz.z)*sz.z;
-        if (p.x<0) p.x-=int((p.x+1)/sz.x-1)*sz.x;
-        if (p.y<0) p.y-=int((p.y+1)/sz.y-1)*sz.y;
-        if (p.z<0) p.z-=int((p.z+1)/sz.z-1)*sz.z;
-        atomicAdd(&grid[p.x*sz.y*sz.z*2+p.y*sz.z*2+p.z*2], 1.0*qi);
-    }
+inline __host__ __device__ int3 wrapGridPoint(int3 p, int3 sz) {
+    if (p.x>0) p.x-=int(p.x/sz.x)*sz.x;
+    if (p.y>0) p.y-=int(p.y/sz.y)*sz.y;
+    if (p.z>0) p.z-=int(p.z/sz.z)*sz.z;
+    if (p.x<0) p.x-=int((p.x+1)/sz.x-1)*sz.x;
+    if (p.y<0) p.y-=int((p.y+1)/sz.y-1)*sz.y;
+    if (p.z<0) p.z-=int((p.z+1)/sz.z-1)*sz.z;
+    return p;
 }
 
-inline __host__ __device__ float W_p_3(int i,float x){
-    if (i==-1) return 0.125-0.5*x+0.5*x*x;
-    if (i== 0) return 0.75-x*x;
-    /*if (i== 1)*/ return 0.125+0.5*x+0.5*x*x;
+//assignment weights of a particle in each dimension, and the grid point with index 0 in each
+template <int ORDER>
+inline __host__ __device__ int3 assignmentStencil(float3 pos, float3 h, float *wx, float *wy, float *wz,
+                                         float *dwx, float *dwy, float *dwz) {
+    float3 u = pos/h + 0.5f*ORDER;
+    int3 base = make_int3(floorf(u));
+    float3 frac = u - make_float3(base);
+    assignmentWeights<ORDER>(frac.x, wx, dwx);
+    assignmentWeights<ORDER>(frac.y, wy, dwy);
+    assignmentWeights<ORDER>(frac.z, wz, dwz);
+    return base;
 }
 
+//self force of analytical differentiation on a unit charge at pos (measured from lo), see FixChargeEwald::calcSelfForceSums
+inline __host__ __device__ float3 adSelfForce(EwaldSelfForce sf, float3 pos, float3 h) {
+    float3 phase = 6.28318530717958647693f*pos/h;
+    return make_float3(sf.c1.x*sinf(phase.x) + sf.c2.x*sinf(2.0f*phase.x),
+                       sf.c1.y*sinf(phase.y) + sf.c2.y*sinf(2.0f*phase.y),
+                       sf.c1.z*sinf(phase.z) + sf.c2.z*sinf(2.0f*phase.z));
+}
 
-__global__ void map_charge_to_grid_order_3_cu(int nRingPoly, int nPerRingPoly, float4 *xs,  float *qs,  BoundsGPU bounds,
-                                      int3 sz,float *grid/*convert to float for cufffComplex*/,float  Qunit) {
+template <int ORDER>
+__global__ void map_charge_to_grid_cu(int nRingPoly, int nPerRingPoly, float4 *xs,  float *qs,  BoundsGPU bounds,
+                                      int3 sz,float *grid,float  Qunit, unsigned long long *gridFixed) {
 
     int idx = GETIDX();
     if (idx < nRingPoly) {
@@ -112,121 +133,94 @@ __global__ void map_charge_to_grid_order_3_cu(int nRingPoly, int nPerRingPoly, f
 
         float qi = Qunit*qs[idx * nPerRingPoly];
         
-        //find nearest grid point
         float3 h=bounds.trace()/make_float3(sz);
-        int3 nearest_grid_point=make_int3((pos+0.5*h)/h);
-        
-        //distance from nearest_grid_point /h
-        float3 d=pos/h-make_float3(nearest_grid_point);
+        float wx[ORDER], wy[ORDER], wz[ORDER];
+        float dwx[ORDER], dwy[ORDER], dwz[ORDER];
+        int3 base = assignmentStencil<ORDER>(pos, h, wx, wy, wz, dwx, dwy, dwz);
         
-        int3 p=nearest_grid_point;
-        for (int ix=-1;ix<=1;ix++){
-          p.x=nearest_grid_point.x+ix;
-          float charge_yz_w=qi*W_p_3(ix,d.x);
-          for (int iy=-1;iy<=1;iy++){
-            p.y=nearest_grid_point.y+iy;
-            float charge_z_w=charge_yz_w*W_p_3(iy,d.y);
-            for (int iz=-1;iz<=1;iz++){
-                p.z=nearest_grid_point.z+iz;
-                float charge_w=charge_z_w*W_p_3(iz,d.z);
-                if (p.x>0) p.x-=int(p.x/sz.x)*sz.x;
-                if (p.y>0) p.y-=int(p.y/sz.y)*sz.y;
-                if (p.z>0) p.z-=int(p.z/sz.z)*sz.z;
-                if (p.x<0) p.x-=int((p.x+1)/sz.x-1)*sz.x;
-                if (p.y<0) p.y-=int((p.y+1)/sz.y-1)*sz.y;
-                if (p.z<0) p.z-=int((p.z+1)/sz.z-1)*sz.z;
-                if ((p.x<0) or (p.x>sz.x-1)) printf("grid point miss x  %d, %d, %d, %f \n", idx,p.x,nearest_grid_point.x,pos.x);
-                if ((p.y<0) or (p.y>sz.y-1)) printf("grid point miss y  %d, %d, %d, %f \n", idx,p.y,nearest_grid_point.y,pos.y);
-                if ((p.z<0) or (p.z>sz.z-1)) printf("grid point miss z  %d, %d, %d, %f \n", idx,p.z,nearest_grid_point.z,pos.z);
-                
-                atomicAdd(&grid[p.x*sz.y*sz.z*2+p.y*sz.z*2+p.z*2], charge_w);
-                
+        for (int ix=0;ix<ORDER;ix++){
+          float charge_yz_w=qi*wx[ix];
+          for (int iy=0;iy<ORDER;iy++){
+            float charge_z_w=charge_yz_w*wy[iy];
+            for (int iz=0;iz<ORDER;iz++){
+                float charge_w=charge_z_w*wz[iz];
+                int3 p=wrapGridPoint(make_int3(base.x-ix, base.y-iy, base.z-iz), sz);
+                if (gridFixed) {
+                    atomicAddFixedPoint(gridFixed + p.x*sz.y*sz.z+p.y*sz.z+p.z, charge_w);
+                } else {
+                    atomicAdd(&grid[realGridIdx(p, sz)], charge_w);
+                }
             }
           }
         }
     }
 }
 
+void map_charge_to_grid(int order, int nRingPoly, int nPerRingPoly, float4 *xs, float *qs, BoundsGPU bounds,
+                        int3 sz, float *grid, float Qunit, unsigned long long *gridFixed) {
+    switch (order) {
+        case 1: map_charge_to_grid_cu<1><<<NBLOCK(nRingPoly), PERBLOCK>>>(nRingPoly, nPerRingPoly, xs, qs, bounds, sz, grid, Qunit, gridFixed); break;
+        case 2: map_charge_to_grid_cu<2><<<NBLOCK(nRingPoly), PERBLOCK>>>(nRingPoly, nPerRingPoly, xs, qs, bounds, sz, grid, Qunit, gridFixed); break;
+        case 3: map_charge_to_grid_cu<3><<<NBLOCK(nRingPoly), PERBLOCK>>>(nRingPoly, nPerRingPoly, xs, qs, bounds, sz, grid, Qunit, gridFixed); break;
+        case 4: map_charge_to_grid_cu<4><<<NBLOCK(nRingPoly), PERBLOCK>>>(nRingPoly, nPerRingPoly, xs, qs, bounds, sz, grid, Qunit, gridFixed); break;
+        case 5: map_charge_to_grid_cu<5><<<NBLOCK(nRingPoly), PERBLOCK>>>(nRingPoly, nPerRingPoly, xs, qs, bounds, sz, grid, Qunit, gridFixed); break;
+        case 6: map_charge_to_grid_cu<6><<<NBLOCK(nRingPoly), PERBLOCK>>>(nRingPoly, nPerRingPoly, xs, qs, bounds, sz, grid, Qunit, gridFixed); break;
+        case 7: map_charge_to_grid_cu<7><<<NBLOCK(nRingPoly), PERBLOCK>>>(nRingPoly, nPerRingPoly, xs, qs, bounds, sz, grid, Qunit, gridFixed); break;
+    }
+}
 
+//launched over the k-space half grid, which zeroes the padded real grid sharing its memory
 __global__ void map_charge_set_to_zero_cu(int3 sz,cufftComplex *grid) {
       int3 id = make_int3( blockIdx.x*blockDim.x + threadIdx.x,
                           blockIdx.y*blockDim.y + threadIdx.y,
                           blockIdx.z*blockDim.z + threadIdx.z);
 
-      if ((id.x<sz.x)&&(id.y<sz.y)&&(id.z<sz.z))                  
-         grid[id.x*sz.y*sz.z+id.y*sz.z+id.z]=make_cuComplex (0.0f, 0.0f);    
+      if ((id.x<sz.x)&&(id.y<sz.y)&&(id.z<sz.z/2+1))
+         grid[kGridIdx(id, sz)]=make_cuComplex (0.0f, 0.0f);
 }
 
-__device__ float sinc(float x){
-  if ((x<0.1)&&(x>-0.1)){
-    float x2=x*x;
-    return 1.0 - x2*0.16666666667f + x2*x2*0.008333333333333333f - x2*x2*x2*0.00019841269841269841f;    
-  }
-    else return sin(x)/x;
+//deterministic mode: charges were spread in fixed point on an unpadded grid, copy them to the padded real grid
+__global__ void map_charge_from_fixed_point_cu(int3 sz, float *grid, unsigned long long *gridFixed) {
+    int idx = GETIDX();
+    if (idx < sz.x*sz.y*sz.z) {
+        grid[(idx/sz.z)*2*(sz.z/2+1) + idx%sz.z] = fromFixedPoint(gridFixed[idx]);
+        gridFixed[idx] = 0;
+    }
 }
 
-__global__ void Green_function_cu(BoundsGPU bounds, int3 sz,float *Green_function,float alpha,
+__global__ void Green_function_cu(BoundsGPU bounds, int3 sz,float *Green_function,float4 *Green_expansion,float alpha,
                                   //now some parameter for Gf calc
-                                  int sum_limits, int intrpl_order) {
+                                  int sum_limits, int intrpl_order, bool ad) {
       int3 id = make_int3( blockIdx.x*blockDim.x + threadIdx.x,
                           blockIdx.y*blockDim.y + threadIdx.y,
                           blockIdx.z*blockDim.z + threadIdx.z);
 
-      if ((id.x<sz.x)&&(id.y<sz.y)&&(id.z<sz.z)){
-          float3 h =bounds.trace()/make_float3(sz);
-          
-          //         2*PI
-          float3 k= 6.28318530717958647693f*make_float3(id)/bounds.trace();
-          if (id.x>sz.x/2) k.x= 6.28318530717958647693f*(id.x-sz.x)/bounds.trace().x;
-          if (id.y>sz.y/2) k.y= 6.28318530717958647693f*(id.y-sz.y)/bounds.trace().y;
-          if (id.z>sz.z/2) k.z= 6.28318530717958647693f*(id.z-sz.z)/bounds.trace().z;
-          
-
-          //OK GF(k)  = 4Pi/K^2 [SumforM(W(K+M)^2  exp(-(K+M)^2/4alpha) dot(K,K+M)/(K+M^2))] / 
-          //                    [SumforM^2(W(K+M)^2)]
-             
-             
-          float sum1=0.0f;   
-          float sum2=0.0f;   
-          float k2=lengthSqr(k);
-          float Fouralpha2inv=0.25/alpha/alpha;
-          if (k2!=0.0){
-              for (int ix=-sum_limits;ix<=sum_limits;ix++){//TODO different limits 
-                for (int iy=-sum_limits;iy<=sum_limits;iy++){
-                  for (int iz=-sum_limits;iz<=sum_limits;iz++){
-                      float3 kpM=k+6.28318530717958647693f*make_float3(ix,iy,iz)/h;
-//                             kpM.x+=6.28318530717958647693f/h.x*ix;//TODO rewrite
-//                             kpM.y+=6.28318530717958647693f/h.y*iy;
-//                             kpM.z+=6.28318530717958647693f/h.z*iz;
-                            float kpMlen=lengthSqr(kpM);
-                            float W=sinc(kpM.x*h.x*0.5)*sinc(kpM.y*h.y*0.5)*sinc(kpM.z*h.z*0.5);
-//                             for(int p=1;p<intrpl_order;p++)
-//                                   W*=W;
-    //                          W*=h;//not need- cancels out
-//                             float W2=W*W;
-                             float W2=pow(W,intrpl_order*2);
-                            //4*PI
-                            sum1+=12.56637061435917295385*exp(-kpMlen*Fouralpha2inv)*dot(k,kpM)/kpMlen*W2;
-                            sum2+=W2;
-                  }
-                }
-              }
-              Green_function[id.x*sz.y*sz.z+id.y*sz.z+id.z]=sum1/(sum2*sum2)/k2;
-          }else{
-              Green_function[id.x*sz.y*sz.z+id.y*sz.z+id.z]=0.0f;
-          }
+      if ((id.x<sz.x)&&(id.y<sz.y)&&(id.z<sz.z/2+1)){
+          int kIdx = kGridIdx(id, sz);
+          float3 dG;
+          float G=greenFunction(id, sz, bounds.trace(), alpha, sum_limits, intrpl_order, ad, dG);
+          Green_function[kIdx]=G;
+          Green_expansion[kIdx]=make_float4(G, dG.x, dG.y, dG.z);
       }
              
 }
 
+__global__ void Green_function_update_cu(int nKPoints, float *Green_function, float4 *Green_expansion, float3 dLogL) {
+    int idx = GETIDX();
+    if (idx < nKPoints) {
+        Green_function[idx] = updatedGreenFunction(Green_expansion[idx], dLogL);
+    }
+}
+
 __global__ void potential_cu(int3 sz,float *Green_function,
                                     cufftComplex *FFT_qs, cufftComplex *FFT_phi){
       int3 id = make_int3( blockIdx.x*blockDim.x + threadIdx.x,
                           blockIdx.y*blockDim.y + threadIdx.y,
                           blockIdx.z*blockDim.z + threadIdx.z);
 
-      if ((id.x<sz.x)&&(id.y<sz.y)&&(id.z<sz.z)){
-        FFT_phi[id.x*sz.y*sz.z+id.y*sz.z+id.z]=FFT_qs[id.x*sz.y*sz.z+id.y*sz.z+id.z]*Green_function[id.x*sz.y*sz.z+id.y*sz.z+id.z];
+      if ((id.x<sz.x)&&(id.y<sz.y)&&(id.z<sz.z/2+1)){
+        int kIdx = kGridIdx(id, sz);
+        FFT_phi[kIdx]=FFT_qs[kIdx]*Green_function[kIdx];
 //TODO after Inverse FFT divide by volume
       }
 }
@@ -237,17 +231,15 @@ __global__ void E_field_cu(BoundsGPU bounds, int3 sz,float *Green_function, cuff
                           blockIdx.y*blockDim.y + threadIdx.y,
                           blockIdx.z*blockDim.z + threadIdx.z);
 
-      if ((id.x<sz.x)&&(id.y<sz.y)&&(id.z<sz.z)){
+      if ((id.x<sz.x)&&(id.y<sz.y)&&(id.z<sz.z/2+1)){
           //K vector
-          float3 k= 6.28318530717958647693f*make_float3(id)/bounds.trace();
-          if (id.x>sz.x/2) k.x= 6.28318530717958647693f*(id.x-sz.x)/bounds.trace().x;
-          if (id.y>sz.y/2) k.y= 6.28318530717958647693f*(id.y-sz.y)/bounds.trace().y;
-          if (id.z>sz.z/2) k.z= 6.28318530717958647693f*(id.z-sz.z)/bounds.trace().z;        
+          float3 k=kVector(id, sz, bounds.trace());
           
           //ik*q(k)*Gf(k)
           cufftComplex Ex,Ey,Ez;
-          float GF=Green_function[id.x*sz.y*sz.z+id.y*sz.z+id.z];
-          cufftComplex q=FFT_qs[id.x*sz.y*sz.z+id.y*sz.z+id.z];
+          int kIdx = kGridIdx(id, sz);
+          float GF=Green_function[kIdx];
+          cufftComplex q=FFT_qs[kIdx];
 
           Ex.y= k.x*q.x*GF;
           Ex.x=-k.x*q.y*GF;
@@ -256,107 +248,64 @@ __global__ void E_field_cu(BoundsGPU bounds, int3 sz,float *Green_function, cuff
           Ez.y= k.z*q.x*GF;
           Ez.x=-k.z*q.y*GF;
           
-          FFT_Ex[id.x*sz.y*sz.z+id.y*sz.z+id.z]=Ex;
-          FFT_Ey[id.x*sz.y*sz.z+id.y*sz.z+id.z]=Ey;
-          FFT_Ez[id.x*sz.y*sz.z+id.y*sz.z+id.z]=Ez;
+          FFT_Ex[kIdx]=Ex;
+          FFT_Ey[kIdx]=Ey;
+          FFT_Ez[kIdx]=Ez;
           //TODO after Inverse FFT divide by -volume
       }
 }
 
 
-__global__ void Ewald_long_range_forces_order_1_cu(int nRingPoly, int nPerRingPoly, float4 *xs, float4 *fs, 
-                                                   float *qs, BoundsGPU bounds,
-                                                   int3 sz, cufftComplex *FFT_Ex,
-                                                    cufftComplex *FFT_Ey,cufftComplex *FFT_Ez,float  Qunit,
-                                                   bool storeForces, uint *ids, float4 *storedForces) {
+//ik differentiation: interpolate the field from the mesh.  Analytical differentiation (AD):
+//E = -grad sum_p phi(r_p) W(r - r_p), with phi the mesh potential passed in Ex_grid
+template <int ORDER, bool AD>
+__global__ void Ewald_long_range_forces_cu(int nRingPoly, int nPerRingPoly, float4 *xs, float4 *fs, 
+                                           float *qs, BoundsGPU bounds,
+                                           int3 sz, float *Ex_grid,
+                                           float *Ey_grid, float *Ez_grid, float  Qunit, EwaldSelfForce selfForce,
+                                           bool storeForces, uint *ids, float4 *storedForces) {
     int idx = GETIDX();
     if (idx < nRingPoly) {
         float4 posWhole= xs[idx];
         float3 pos     = make_float3(posWhole)-bounds.lo;
         int    baseIdx = idx*nPerRingPoly;
         float  qi      = qs[baseIdx];
-        
-        //find nearest grid point
-        float3 h=bounds.trace()/make_float3(sz);
-        int3 nearest_grid_point=make_int3((pos+0.5*h)/h);
-
-        int3 p=nearest_grid_point;        
-        if (p.x>0) p.x-=int(p.x/sz.x)*sz.x;
-        if (p.y>0) p.y-=int(p.y/sz.y)*sz.y;
-        if (p.z>0) p.z-=int(p.z/sz.z)*sz.z;
-        if (p.x<0) p.x-=int((p.x+1)/sz.x-1)*sz.x;
-        if (p.y<0) p.y-=int((p.y+1)/sz.y-1)*sz.y;
-        if (p.z<0) p.z-=int((p.z+1)/sz.z-1)*sz.z;
-        
-        //get E field
-        float3 E;
-        float volume=bounds.trace().x*bounds.trace().y*bounds.trace().z;
-        E.x= -FFT_Ex[p.x*sz.y*sz.z+p.y*sz.z+p.z].x/volume;
-        E.y= -FFT_Ey[p.x*sz.y*sz.z+p.y*sz.z+p.z].x/volume;
-        E.z= -FFT_Ez[p.x*sz.y*sz.z+p.y*sz.z+p.z].x/volume;
-        
-        // Apply force on centroid to all time slices for given atom
-        float3 force= Qunit*qi*E;
-        for (int i = 0; i< nPerRingPoly; i++) {
-            fs[baseIdx + i] += force; 
-        }
 
-        if (storeForces) {
-            for (int i = 0; i < nPerRingPoly; i++) {
-                storedForces[ids[baseIdx+i]] = make_float4(force.x, force.y, force.z, 0);
-            }
-        }
-    }
-}
-
-
-__global__ void Ewald_long_range_forces_order_3_cu(int nRingPoly, int nPerRingPoly, float4 *xs, float4 *fs, 
-                                                   float *qs, BoundsGPU bounds,
-                                                   int3 sz, cufftComplex *FFT_Ex,
-                                                    cufftComplex *FFT_Ey,cufftComplex *FFT_Ez,float  Qunit,
-                                                   bool storeForces, uint *ids, float4 *storedForces) {
-    int idx = GETIDX();
-    if (idx < nRingPoly) {
-        float4 posWhole= xs[idx];
-        float3 pos     = make_float3(posWhole)-bounds.lo;
-        int    baseIdx = idx*nPerRingPoly;
-        float  qi      = qs[baseIdx];
-
-        //find nearest grid point
         float3 h=bounds.trace()/make_float3(sz);
-        int3 nearest_grid_point=make_int3((pos+0.5*h)/h);
-        
-        //distance from nearest_grid_point /h
-        float3 d=pos/h-make_float3(nearest_grid_point);
+        float wx[ORDER], wy[ORDER], wz[ORDER];
+        float dwx[ORDER], dwy[ORDER], dwz[ORDER];
+        int3 base = assignmentStencil<ORDER>(pos, h, wx, wy, wz, dwx, dwy, dwz);
 
         float3 E=make_float3(0,0,0);
         float volume=bounds.trace().x*bounds.trace().y*bounds.trace().z;
 
-        int3 p=nearest_grid_point;
-        for (int ix=-1;ix<=1;ix++){
-          p.x=nearest_grid_point.x+ix;
-          for (int iy=-1;iy<=1;iy++){
-            p.y=nearest_grid_point.y+iy;
-            for (int iz=-1;iz<=1;iz++){
-                p.z=nearest_grid_point.z+iz;
-                if (p.x>0) p.x-=int(p.x/sz.x)*sz.x;
-                if (p.y>0) p.y-=int(p.y/sz.y)*sz.y;
-                if (p.z>0) p.z-=int(p.z/sz.z)*sz.z;
-                if (p.x<0) p.x-=int((p.x+1)/sz.x-1)*sz.x;
-                if (p.y<0) p.y-=int((p.y+1)/sz.y-1)*sz.y;
-                if (p.z<0) p.z-=int((p.z+1)/sz.z-1)*sz.z;
-                float3 Ep;
-                float W_xyz=W_p_3(ix,d.x)*W_p_3(iy,d.y)*W_p_3(iz,d.z);
-                
-                Ep.x= -FFT_Ex[p.x*sz.y*sz.z+p.y*sz.z+p.z].x/volume;
-                Ep.y= -FFT_Ey[p.x*sz.y*sz.z+p.y*sz.z+p.z].x/volume;
-                Ep.z= -FFT_Ez[p.x*sz.y*sz.z+p.y*sz.z+p.z].x/volume;
-                E+=W_xyz*Ep;
+        for (int ix=0;ix<ORDER;ix++){
+          for (int iy=0;iy<ORDER;iy++){
+            for (int iz=0;iz<ORDER;iz++){
+                int3 p=wrapGridPoint(make_int3(base.x-ix, base.y-iy, base.z-iz), sz);
+                int gridIdx = realGridIdx(p, sz);
+                if (AD) {
+                    float phi=Ex_grid[gridIdx]/volume;
+                    E-=phi*make_float3(dwx[ix]*wy[iy]*wz[iz]/h.x,
+                                       wx[ix]*dwy[iy]*wz[iz]/h.y,
+                                       wx[ix]*wy[iy]*dwz[iz]/h.z);
+                } else {
+                    float3 Ep;
+                    float W_xyz=wx[ix]*wy[iy]*wz[iz];
+                    
+                    Ep.x= -Ex_grid[gridIdx]/volume;
+                    Ep.y= -Ey_grid[gridIdx]/volume;
+                    Ep.z= -Ez_grid[gridIdx]/volume;
+                    E+=W_xyz*Ep;
+                }
             }
           }
         }
                
         float3 force= Qunit*qi*E;
+        if (AD) {
+            force-=Qunit*Qunit*qi*qi*adSelfForce(selfForce, pos, h);
+        }
         // Apply force on centroid to all time slices for given atom
         for (int i = 0; i < nPerRingPoly; i++) {
             fs[baseIdx + i] += force;
@@ -370,78 +319,274 @@ __global__ void Ewald_long_range_forces_order_3_cu(int nRingPoly, int nPerRingPo
     }
 }
 
+template <bool AD>
+void Ewald_long_range_forces(int order, int nRingPoly, int nPerRingPoly, float4 *xs, float4 *fs, float *qs, BoundsGPU bounds,
+                             int3 sz, float *Ex_grid, float *Ey_grid, float *Ez_grid, float Qunit, EwaldSelfForce selfForce,
+                             bool storeForces, uint *ids, float4 *storedForces) {
+    switch (order) {
+        case 1: Ewald_long_range_forces_cu<1, AD><<<NBLOCK(nRingPoly), PERBLOCK>>>(nRingPoly, nPerRingPoly, xs, fs, qs, bounds, sz, Ex_grid, Ey_grid, Ez_grid, Qunit, selfForce, storeForces, ids, storedForces); break;
+        case 2: Ewald_long_range_forces_cu<2, AD><<<NBLOCK(nRingPoly), PERBLOCK>>>(nRingPoly, nPerRingPoly, xs, fs, qs, bounds, sz, Ex_grid, Ey_grid, Ez_grid, Qunit, selfForce, storeForces, ids, storedForces); break;
+        case 3: Ewald_long_range_forces_cu<3, AD><<<NBLOCK(nRingPoly), PERBLOCK>>>(nRingPoly, nPerRingPoly, xs, fs, qs, bounds, sz, Ex_grid, Ey_grid, Ez_grid, Qunit, selfForce, storeForces, ids, storedForces); break;
+        case 4: Ewald_long_range_forces_cu<4, AD><<<NBLOCK(nRingPoly), PERBLOCK>>>(nRingPoly, nPerRingPoly, xs, fs, qs, bounds, sz, Ex_grid, Ey_grid, Ez_grid, Qunit, selfForce, storeForces, ids, storedForces); break;
+        case 5: Ewald_long_range_forces_cu<5, AD><<<NBLOCK(nRingPoly), PERBLOCK>>>(nRingPoly, nPerRingPoly, xs, fs, qs, bounds, sz, Ex_grid, Ey_grid, Ez_grid, Qunit, selfForce, storeForces, ids, storedForces); break;
+        case 6: Ewald_long_range_forces_cu<6, AD><<<NBLOCK(nRingPoly), PERBLOCK>>>(nRingPoly, nPerRingPoly, xs, fs, qs, bounds, sz, Ex_grid, Ey_grid, Ez_grid, Qunit, selfForce, storeForces, ids, storedForces); break;
+        case 7: Ewald_long_range_forces_cu<7, AD><<<NBLOCK(nRingPoly), PERBLOCK>>>(nRingPoly, nPerRingPoly, xs, fs, qs, bounds, sz, Ex_grid, Ey_grid, Ez_grid, Qunit, selfForce, storeForces, ids, storedForces); break;
+    }
+}
+
+
+//Host backend charge spreading.  Atoms are bucketed by the first x plane of their stencil, and the planes are
+//split into one contiguous chunk per thread.  Each thread spreads its atoms onto a private slab holding its chunk
+//and the ORDER-1 planes below it, then the slabs are summed into the mesh plane by plane in chunk order.  There
+//are no races, the slabs cost only ORDER-1 planes per thread beyond the mesh itself, and the result does not
+//depend on scheduling for a fixed thread count
+template <int ORDER>
+void spread_charges_host(int nAtoms, float4 *xs, float *qs, BoundsGPU bounds, int3 sz, float *grid, float Qunit,
+                         std::vector<int> &atomPlanes, std::vector<int> &planeStarts, std::vector<int> &planeAtoms,
+                         std::vector<float> &scratch) {
+    float3 h=bounds.trace()/make_float3(sz);
+    int planeSize = sz.y*sz.z;
+    atomPlanes.resize(nAtoms);
+#pragma omp parallel for schedule(static)
+    for (int i=0; i<nAtoms; i++) {
+        float3 pos = make_float3(xs[i])-bounds.lo;
+        int baseX = floorf(pos.x/h.x + 0.5f*ORDER); //as in assignmentStencil
+        atomPlanes[i] = wrapGridPoint(make_int3(baseX, 0, 0), sz).x;
+    }
+    //stable counting sort by plane, so each slab is filled in atom order
+    planeStarts.assign(sz.x+1, 0);
+    for (int i=0; i<nAtoms; i++) {
+        planeStarts[atomPlanes[i]]++;
+    }
+    int start = 0;
+    for (int x=0; x<=sz.x; x++) {
+        int count = planeStarts[x];
+        planeStarts[x] = start;
+        start += count;
+    }
+    planeAtoms.resize(nAtoms);
+    for (int i=0; i<nAtoms; i++) {
+        planeAtoms[planeStarts[atomPlanes[i]]++] = i;
+    }
+    for (int x=sz.x; x>0; x--) {
+        planeStarts[x] = planeStarts[x-1];
+    }
+    planeStarts[0] = 0;
+
+    int nChunks = std::min(hostMaxThreads(), sz.x);
+    scratch.resize(planeSize*(sz.x + nChunks*(ORDER-1)));
+#pragma omp parallel for schedule(static)
+    for (int c=0; c<nChunks; c++) {
+        int x0 = c*sz.x/nChunks;
+        int x1 = (c+1)*sz.x/nChunks;
+        float *slab = scratch.data() + planeSize*(x0 + c*(ORDER-1));
+        std::fill(slab, slab + planeSize*(x1 - x0 + ORDER-1), 0.0f);
+        for (int a=planeStarts[x0]; a<planeStarts[x1]; a++) {
+            int i = planeAtoms[a];
+            float3 pos = make_float3(xs[i])-bounds.lo;
+            float qi = Qunit*qs[i];
+            float wx[ORDER], wy[ORDER], wz[ORDER];
+            float dwx[ORDER], dwy[ORDER], dwz[ORDER];
+            int3 base = assignmentStencil<ORDER>(pos, h, wx, wy, wz, dwx, dwy, dwz);
+            int py[ORDER], pz[ORDER];
+            for (int k=0; k<ORDER; k++) {
+                int3 p = wrapGridPoint(make_int3(0, base.y-k, base.z-k), sz);
+                py[k] = p.y;
+                pz[k] = p.z;
+            }
+            //slab plane ORDER-1 is the chunk's first plane
+            int slabX = atomPlanes[i] - x0 + ORDER-1;
+            for (int ix=0; ix<ORDER; ix++) {
+                for (int iy=0; iy<ORDER; iy++) {
+                    float *row = slab + ((slabX-ix)*sz.y + py[iy])*sz.z;
+                    float charge_z_w = qi*wx[ix]*wy[iy];
+                    for (int iz=0; iz<ORDER; iz++) {
+                        row[pz[iz]] += charge_z_w*wz[iz];
+                    }
+                }
+            }
+        }
+    }
+#pragma omp parallel for schedule(static)
+    for (int x=0; x<sz.x; x++) {
+        float *plane = grid + realGridIdx(make_int3(x, 0, 0), sz);
+        std::fill(plane, plane + sz.y*2*(sz.z/2+1), 0.0f);
+        for (int c=0; c<nChunks; c++) {
+            int x0 = c*sz.x/nChunks;
+            int x1 = (c+1)*sz.x/nChunks;
+            int nSlabPlanes = x1 - x0 + ORDER-1;
+            float *slab = scratch.data() + planeSize*(x0 + c*(ORDER-1));
+            //a slab wider than the grid covers some planes more than once
+            for (int slabX=((x - x0 + ORDER-1)%sz.x + sz.x)%sz.x; slabX<nSlabPlanes; slabX+=sz.x) {
+                for (int y=0; y<sz.y; y++) {
+                    float *dest = plane + y*2*(sz.z/2+1);
+                    float *src = slab + (slabX*sz.y + y)*sz.z;
+#pragma omp simd
+                    for (int z=0; z<sz.z; z++) {
+                        dest[z] += src[z];
+                    }
+                }
+            }
+        }
+    }
+}
+
+//host version of Ewald_long_range_forces_cu.  Rows of the stencil are contiguous in z except where they wrap,
+//so z indices are looked up once per atom and the innermost loop is vectorized
+template <int ORDER, bool AD>
+void gather_forces_host(int nAtoms, float4 *xs, float4 *fs, float *qs, BoundsGPU bounds, int3 sz,
+                        float *Ex_grid, float *Ey_grid, float *Ez_grid, float Qunit, EwaldSelfForce selfForce,
+                        bool storeForces, uint *ids, float4 *storedForces) {
+    float3 h=bounds.trace()/make_float3(sz);
+    float volume=bounds.volume();
+#pragma omp parallel for schedule(static)
+    for (int idx=0; idx<nAtoms; idx++) {
+        float3 pos = make_float3(xs[idx])-bounds.lo;
+        float qi = qs[idx];
+        float wx[ORDER], wy[ORDER], wz[ORDER];
+        float dwx[ORDER], dwy[ORDER], dwz[ORDER];
+        int3 base = assignmentStencil<ORDER>(pos, h, wx, wy, wz, dwx, dwy, dwz);
+        int px[ORDER], py[ORDER], pz[ORDER];
+        for (int k=0; k<ORDER; k++) {
+            int3 p = wrapGridPoint(make_int3(base.x-k, base.y-k, base.z-k), sz);
+            px[k] = p.x;
+            py[k] = p.y;
+            pz[k] = p.z;
+        }
+        float Ex = 0, Ey = 0, Ez = 0;
+        for (int ix=0; ix<ORDER; ix++) {
+            for (int iy=0; iy<ORDER; iy++) {
+                int rowIdx = realGridIdx(make_int3(px[ix], py[iy], 0), sz);
+                if (AD) {
+                    float w_xy = wx[ix]*wy[iy];
+                    float dw_x = dwx[ix]*wy[iy];
+                    float dw_y = wx[ix]*dwy[iy];
+#pragma omp simd reduction(+:Ex,Ey,Ez)
+                    for (int iz=0; iz<ORDER; iz++) {
+                        float phi = Ex_grid[rowIdx + pz[iz]];
+                        Ex += phi*dw_x*wz[iz];
+                        Ey += phi*dw_y*wz[iz];
+                        Ez += phi*w_xy*dwz[iz];
+                    }
+                } else {
+                    float w_xy = wx[ix]*wy[iy];
+#pragma omp simd reduction(+:Ex,Ey,Ez)
+                    for (int iz=0; iz<ORDER; iz++) {
+                        int gridIdx = rowIdx + pz[iz];
+                        float W_xyz = w_xy*wz[iz];
+                        Ex += W_xyz*Ex_grid[gridIdx];
+                        Ey += W_xyz*Ey_grid[gridIdx];
+                        Ez += W_xyz*Ez_grid[gridIdx];
+                    }
+                }
+            }
+        }
+        float3 E;
+        if (AD) {
+            E = make_float3(-Ex/(h.x*volume), -Ey/(h.y*volume), -Ez/(h.z*volume));
+        } else {
+            E = make_float3(-Ex/volume, -Ey/volume, -Ez/volume);
+        }
+        float3 force = Qunit*qi*E;
+        if (AD) {
+            force -= Qunit*Qunit*qi*qi*adSelfForce(selfForce, pos, h);
+        }
+        fs[idx] += force;
+        if (storeForces) {
+            storedForces[ids[idx]] = make_float4(force.x, force.y, force.z, 0);
+        }
+    }
+}
+
+template <bool AD>
+void Ewald_long_range_forces_host(int order, int nAtoms, float4 *xs, float4 *fs, float *qs, BoundsGPU bounds, int3 sz,
+                        float *Ex_grid, float *Ey_grid, float *Ez_grid, float Qunit, EwaldSelfForce selfForce,
+                        bool storeForces, uint *ids, float4 *storedForces) {
+    switch (order) {
+        case 1: gather_forces_host<1, AD>(nAtoms, xs, fs, qs, bounds, sz, Ex_grid, Ey_grid, Ez_grid, Qunit, selfForce, storeForces, ids, storedForces); break;
+        case 2: gather_forces_host<2, AD>(nAtoms, xs, fs, qs, bounds, sz, Ex_grid, Ey_grid, Ez_grid, Qunit, selfForce, storeForces, ids, storedForces); break;
+        case 3: gather_forces_host<3, AD>(nAtoms, xs, fs, qs, bounds, sz, Ex_grid, Ey_grid, Ez_grid, Qunit, selfForce, storeForces, ids, storedForces); break;
+        case 4: gather_forces_host<4, AD>(nAtoms, xs, fs, qs, bounds, sz, Ex_grid, Ey_grid, Ez_grid, Qunit, selfForce, storeForces, ids, storedForces); break;
+        case 5: gather_forces_host<5, AD>(nAtoms, xs, fs, qs, bounds, sz, Ex_grid, Ey_grid, Ez_grid, Qunit, selfForce, storeForces, ids, storedForces); break;
+        case 6: gather_forces_host<6, AD>(nAtoms, xs, fs, qs, bounds, sz, Ex_grid, Ey_grid, Ez_grid, Qunit, selfForce, storeForces, ids, storedForces); break;
+        case 7: gather_forces_host<7, AD>(nAtoms, xs, fs, qs, bounds, sz, Ex_grid, Ey_grid, Ez_grid, Qunit, selfForce, storeForces, ids, storedForces); break;
+    }
+}
+
 
 __global__ void Energy_cu(int3 sz,float *Green_function,
-                                    cufftComplex *FFT_qs, cufftComplex *E_grid){
+                                    cufftComplex *FFT_qs, float *E_grid){
       int3 id = make_int3( blockIdx.x*blockDim.x + threadIdx.x,
                           blockIdx.y*blockDim.y + threadIdx.y,
                           blockIdx.z*blockDim.z + threadIdx.z);
 
-      if ((id.x<sz.x)&&(id.y<sz.y)&&(id.z<sz.z)){
-        cufftComplex qi=FFT_qs[id.x*sz.y*sz.z+id.y*sz.z+id.z];
-        E_grid[id.x*sz.y*sz.z+id.y*sz.z+id.z]
-            =make_cuComplex((qi.x*qi.x+qi.y*qi.y)*Green_function[id.x*sz.y*sz.z+id.y*sz.z+id.z],0.0);
+      if ((id.x<sz.x)&&(id.y<sz.y)&&(id.z<sz.z/2+1)){
+        int kIdx = kGridIdx(id, sz);
+        cufftComplex qi=FFT_qs[kIdx];
+        E_grid[kIdx]=kGridWeight(id, sz)*(qi.x*qi.x+qi.y*qi.y)*Green_function[kIdx];
 //TODO after Inverse FFT divide by volume
       }
 }
 
 
-__global__ void virials_cu(BoundsGPU bounds,int3 sz,Virial *dest,float alpha, float *Green_function,cufftComplex *FFT_qs,int warpSize){
+//virial of the field energy E of k-point k, from its derivative with respect to the box dimensions
+inline __host__ __device__ Virial fieldVirial(float3 k, float E, float alpha) {
+    float klen=lengthSqr(k);
+    if (klen==0.0) {
+        return Virial(0, 0, 0, 0, 0, 0);
+    }
+    float differential=-2.0*(1.0/klen+0.25/(alpha*alpha));
+    return Virial((1.0+differential*k.x*k.x)*E, //xx
+                  (1.0+differential*k.y*k.y)*E, //yy
+                  (1.0+differential*k.z*k.z)*E, //zz
+                  (differential*k.x*k.y)*E, //xy
+                  (differential*k.x*k.z)*E, //xz
+                  (differential*k.y*k.z)*E); //yz
+}
+
+__global__ void virials_cu(BoundsGPU bounds,int3 sz,Virial *dest,float alpha, float *Green_function,cufftComplex *FFT_qs,int warpSize, unsigned long long *destFixed){
       int3 id = make_int3( blockIdx.x*blockDim.x + threadIdx.x,
                           blockIdx.y*blockDim.y + threadIdx.y,
                           blockIdx.z*blockDim.z + threadIdx.z);
 
-      if ((id.x<sz.x)&&(id.y<sz.y)&&(id.z<sz.z)){
-          float3 k= 6.28318530717958647693f*make_float3(id)/bounds.trace();
-          if (id.x>sz.x/2) k.x= 6.28318530717958647693f*(id.x-sz.x)/bounds.trace().x;
-          if (id.y>sz.y/2) k.y= 6.28318530717958647693f*(id.y-sz.y)/bounds.trace().y;
-          if (id.z>sz.z/2) k.z= 6.28318530717958647693f*(id.z-sz.z)/bounds.trace().z;        
-          float klen=lengthSqr(k);
-          cufftComplex qi=FFT_qs[id.x*sz.y*sz.z+id.y*sz.z+id.z];
-          float E=(qi.x*qi.x+qi.y*qi.y)*Green_function[id.x*sz.y*sz.z+id.y*sz.z+id.z];
-          
-          float differential=-2.0*(1.0/klen+0.25/(alpha*alpha));
-          if (klen==0.0) {differential=0.0;E=0.0;}
-          
-          Virial virialstmp = Virial(0, 0, 0, 0, 0, 0);   
-          virialstmp[0]=(1.0+differential*k.x*k.x)*E; //xx
-          virialstmp[1]=(1.0+differential*k.y*k.y)*E; //yy
-          virialstmp[2]=(1.0+differential*k.z*k.z)*E; //zz
-          virialstmp[3]=(differential*k.x*k.y)*E; //xy
-          virialstmp[4]=(differential*k.x*k.z)*E; //xz
-          virialstmp[5]=(differential*k.y*k.z)*E; //yz
-
-//           virials[id.x*sz.y*sz.z+id.y*sz.z+id.z]=virialstmp;
-//           __syncthreads();
-          extern __shared__ Virial tmpV[]; 
-//           const int copyBaseIdx = blockDim.x*blockIdx.x * N_DATA_PER_THREAD + threadIdx.x;
-//           const int copyIncrement = blockDim.x;
-          tmpV[threadIdx.x*blockDim.y*blockDim.z+threadIdx.y*blockDim.z+threadIdx.z]=virialstmp;
-          int curLookahead=1;
-          int numLookaheadSteps = log2f(blockDim.x*blockDim.y*blockDim.z-1);
-          const int sumBaseIdx = threadIdx.x*blockDim.y*blockDim.z+threadIdx.y*blockDim.z+threadIdx.z;
+      //threads past the edge of the half grid contribute zero, so the whole block takes part in the reduction
+      Virial virialstmp = Virial(0, 0, 0, 0, 0, 0);
+      if ((id.x<sz.x)&&(id.y<sz.y)&&(id.z<sz.z/2+1)){
+          float3 k=kVector(id, sz, bounds.trace());
+          int kIdx = kGridIdx(id, sz);
+          cufftComplex qi=FFT_qs[kIdx];
+          float E=kGridWeight(id, sz)*(qi.x*qi.x+qi.y*qi.y)*Green_function[kIdx];
+          virialstmp=fieldVirial(k, E, alpha);
+      }
+
+      extern __shared__ Virial tmpV[]; 
+      tmpV[threadIdx.x*blockDim.y*blockDim.z+threadIdx.y*blockDim.z+threadIdx.z]=virialstmp;
+      int curLookahead=1;
+      int numLookaheadSteps = log2f(blockDim.x*blockDim.y*blockDim.z-1);
+      const int sumBaseIdx = threadIdx.x*blockDim.y*blockDim.z+threadIdx.y*blockDim.z+threadIdx.z;
+      __syncthreads();
+      for (int i=0; i<=numLookaheadSteps; i++) {
+          if (! (sumBaseIdx % (curLookahead*2))) {
+              tmpV[sumBaseIdx] += tmpV[sumBaseIdx + curLookahead];
+          }
+          curLookahead *= 2;
           __syncthreads();
-          for (int i=0; i<=numLookaheadSteps; i++) {
-              if (! (sumBaseIdx % (curLookahead*2))) {
-                  tmpV[sumBaseIdx] += tmpV[sumBaseIdx + curLookahead];
-              }
-              curLookahead *= 2;
-//               if (curLookahead >= (warpSize)) {//Doesn't work in 3D case 
-                  __syncthreads();
-//               }
-          } 
+      } 
 
-          if (sumBaseIdx  == 0) {
-            
+      if (sumBaseIdx  == 0) {
+          if (destFixed) {
+              for (int i=0; i<6; i++) {
+                  atomicAddFixedPoint(destFixed + i, tmpV[0][i]);
+              }
+          } else {
               atomicAdd(&(dest[0].vals[0]), tmpV[0][0]);
               atomicAdd(&(dest[0].vals[1]), tmpV[0][1]);
               atomicAdd(&(dest[0].vals[2]), tmpV[0][2]);
               atomicAdd(&(dest[0].vals[3]), tmpV[0][3]);
               atomicAdd(&(dest[0].vals[4]), tmpV[0][4]);
               atomicAdd(&(dest[0].vals[5]), tmpV[0][5]);
-          }          
-      }
-      
+          }
+      }          
 }
 
 
@@ -602,6 +747,11 @@ __global__ void applyStoredForces(int  nAtoms,
         fs[idx] = cur;
     }
 }
+__global__ void virialFromFixedPoint(Virial *fieldVirial, unsigned long long *fieldVirialFixed) {
+    fieldVirial[0][threadIdx.x] = fromFixedPoint(fieldVirialFixed[threadIdx.x]);
+    fieldVirialFixed[threadIdx.x] = 0;
+}
+
 __global__ void mapVirialToSingleAtom(Virial *atomVirials, Virial *fieldVirial, float volume) {
     //just mapping to one atom for now.  If we're looking at per-atom properties, should change to mapping to all atoms evenly
     atomVirials[0][threadIdx.x] += 0.5 * fieldVirial[0][threadIdx.x] / volume;
@@ -616,19 +766,29 @@ __global__ void mapEngToParticles(int nAtoms, float eng, float *engs) {
 }
 
 FixChargeEwald::FixChargeEwald(SHARED(State) state_, string handle_, string groupHandle_): FixCharge(state_, handle_, groupHandle_, chargeEwaldType, true){
-    cufftCreate(&plan);
+    //the cuFFT plans are made with the device grids in allocateGrids, so the host backend never creates them
     canOffloadChargePairCalc = true;
+    canRunOnHost = true;
     modeIsError = false;
     sz = make_int3(32, 32, 32);
+    szHost = make_int3(0, 0, 0);
     malloced = false;
+    differentiation = EWALD_DIFF::IK;
+    differentiationAllocated = EWALD_DIFF::IK;
+    differentiationLastOptimize = EWALD_DIFF::IK;
+    selfForce.c1 = make_float3(0, 0, 0);
+    selfForce.c2 = make_float3(0, 0, 0);
+    backendLastOptimize = -1;
+    tuneCandidateIdx = 0;
     longRangeInterval = 1;
     setEvalWrapper();
 }
 
 
 FixChargeEwald::~FixChargeEwald(){
-    cufftDestroy(plan);
     if (malloced) {
+        cufftDestroy(plan);
+        cufftDestroy(planInverse);
         cudaFree(FFT_Qs);
         cudaFree(FFT_Ex);
         cudaFree(FFT_Ey);
@@ -637,6 +797,10 @@ FixChargeEwald::~FixChargeEwald(){
 }
 
 
+//Largest change in the log of a box dimension, relative to the box the Green function was computed for, that is applied
+//to it to first order.  The relative error in the Green function is then below about 5e-5
+const float maxIncrementalBoxChange = 0.005;
+
 //Root mean square force error estimation
 const double amp_table[][7] = {
         {2.0/3.0,           0,                 0,                    0,                        0,                         0,                                0},
@@ -649,7 +813,69 @@ const double amp_table[][7] = {
 }; 
 
 
+//Analytical differentiation has no closed form error estimate; the rms force error is evaluated from the optimal
+//influence function by summing over the mesh and the first aliases, see Ballenegger, Cerda and Holm, JCTC 8, 936 (2012)
+double FixChargeEwald :: DeltaF_k_AD(double t_alpha){
+    int nAtoms = state->atoms.size();
+    const int nAlias = 2;
+    const int nM = 2*nAlias+1;
+    //the summands factorize over dimensions, so wave vectors, gaussians and assignment weights are tabulated per dimension
+    int dims[3] = {sz.x, sz.y, sz.z};
+    double lens[3] = {L.x, L.y, L.z};
+    std::vector<double> qs[3], us[3], ws[3];
+    for (int d=0; d<3; d++) {
+        double spacing = lens[d]/dims[d];
+        qs[d].resize(dims[d]*nM);
+        us[d].resize(dims[d]*nM);
+        ws[d].resize(dims[d]*nM);
+        for (int i=0; i<dims[d]; i++) {
+            int n = i > dims[d]/2 ? i-dims[d] : i;
+            for (int m=-nAlias; m<=nAlias; m++) {
+                double q = 2*M_PI*(n/lens[d] + m/spacing);
+                double arg = 0.5*q*spacing;
+                int idx = i*nM + m+nAlias;
+                qs[d][idx] = q;
+                us[d][idx] = exp(-0.25*q*q/(t_alpha*t_alpha));
+                ws[d][idx] = pow(arg == 0 ? 1.0 : sin(arg)/arg, 2*interpolation_order);
+            }
+        }
+    }
+    double qopt = 0;
+#pragma omp parallel for collapse(2) reduction(+:qopt) schedule(static)
+    for (int ix=0; ix<sz.x; ix++) {
+        for (int iy=0; iy<sz.y; iy++) {
+            for (int iz=0; iz<sz.z; iz++) {
+                if (ix == 0 and iy == 0 and iz == 0) {
+                    continue;
+                }
+                double sum1 = 0, sum2 = 0, sum3 = 0, sum4 = 0;
+                for (int mx=0; mx<nM; mx++) {
+                    int a = ix*nM + mx;
+                    for (int my=0; my<nM; my++) {
+                        int b = iy*nM + my;
+                        for (int mz=0; mz<nM; mz++) {
+                            int c = iz*nM + mz;
+                            double q2 = qs[0][a]*qs[0][a] + qs[1][b]*qs[1][b] + qs[2][c]*qs[2][c];
+                            double u1 = us[0][a]*us[1][b]*us[2][c];
+                            double u2 = ws[0][a]*ws[1][b]*ws[2][c];
+                            sum1 += u1*u1/q2*16*M_PI*M_PI;
+                            sum2 += u1*u2*4*M_PI;
+                            sum3 += u2;
+                            sum4 += q2*u2;
+                        }
+                    }
+                }
+                qopt += sum1 - sum2*sum2/(sum3*sum4);
+            }
+        }
+    }
+    return sqrt(qopt/nAtoms)*total_Q2/(L.x*L.y*L.z);
+}
+
 double FixChargeEwald :: DeltaF_k(double t_alpha){
+    if (differentiation == EWALD_DIFF::AD) {
+        return DeltaF_k_AD(t_alpha);
+    }
     int nAtoms = state->atoms.size(); 
    double sumx=0.0,sumy=0.0,sumz=0.0;
    for( int m=0;m<interpolation_order;m++){
@@ -671,33 +897,45 @@ double  FixChargeEwald :: DeltaF_real(double t_alpha){
  
 void FixChargeEwald::setTotalQ2() {
     int nAtoms = state->atoms.size();    
-    GPUArrayGlobal<float>tmp(1);
-    tmp.memsetByVal(0.0);
     float conversion = state->units.qqr_to_eng;
+    if (state->backend == BACKEND::HOST) {
+        double sumQ = 0;
+        double sumQ2 = 0;
+        float *qs = state->gpd.qs.h_data.data();
+        for (int i=0; i<nAtoms; i++) {
+            sumQ += qs[i];
+            sumQ2 += qs[i]*qs[i];
+        }
+        total_Q2=conversion*sumQ2/state->nPerRingPoly;
+        total_Q=sqrt(conversion)*sumQ/state->nPerRingPoly;
+        cout<<"total_Q "<<total_Q<<'\n';
+        cout<<"total_Q2 "<<total_Q2<<'\n';
+        return;
+    }
+    GPUArrayGlobal<float>tmp(2); //room for a fixed point sum
+    tmp.memsetByVal(0.0);
 
 
-    accumulate_gpu<float,float, SumSqr, N_DATA_PER_THREAD> <<<NBLOCK(nAtoms/(double)N_DATA_PER_THREAD),PERBLOCK,N_DATA_PER_THREAD*sizeof(float)*PERBLOCK>>>
-        (
-         tmp.getDevData(),
-         state->gpd.qs(state->gpd.activeIdx()),
-         nAtoms,
-         state->devManager.prop.warpSize,
-         SumSqr());
+    accumulate(tmp.getDevData(),
+               state->gpd.qs(state->gpd.activeIdx()),
+               nAtoms,
+               state->devManager.prop.warpSize,
+               SumSqr(),
+               state->deterministic);
     tmp.dataToHost();   
-    total_Q2=conversion*tmp.h_data[0]/state->nPerRingPoly;
+    total_Q2=conversion*reductionResult<float>(tmp.h_data.data(), state->deterministic)/state->nPerRingPoly;
 
     tmp.memsetByVal(0.0);
 
-    accumulate_gpu<float,float, SumSingle, N_DATA_PER_THREAD> <<<NBLOCK(nAtoms/(double)N_DATA_PER_THREAD),PERBLOCK,N_DATA_PER_THREAD*sizeof(float)*PERBLOCK>>>
-        (
-         tmp.getDevData(),
-         state->gpd.qs(state->gpd.activeIdx()),
-         nAtoms,
-         state->devManager.prop.warpSize,
-         SumSingle());
+    accumulate(tmp.getDevData(),
+               state->gpd.qs(state->gpd.activeIdx()),
+               nAtoms,
+               state->devManager.prop.warpSize,
+               SumSingle(),
+               state->deterministic);
 
     tmp.dataToHost();   
-    total_Q=sqrt(conversion)*tmp.h_data[0]/state->nPerRingPoly;   
+    total_Q=sqrt(conversion)*reductionResult<float>(tmp.h_data.data(), state->deterministic)/state->nPerRingPoly;   
     
     cout<<"total_Q "<<total_Q<<'\n';
     cout<<"total_Q2 "<<total_Q2<<'\n';
@@ -755,51 +993,72 @@ double FixChargeEwald::find_optimal_parameters(bool printError){
 
 void FixChargeEwald::setParameters(int szx_,int szy_,int szz_,float rcut_,int interpolation_order_)
 {
-    //for now support for only 2^N sizes
     //TODO generalize for non cubic boxes
     if (rcut_==-1) {
         rcut_ = state->rCut;
     }
-    if ((szx_!=32)&&(szx_!=64)&&(szx_!=128)&&(szx_!=256)&&(szx_!=512)&&(szx_!=1024)){
-        cout << szx_ << " is not supported, sorry. Only 2^N grid size works for charge Ewald\n";
-        exit(2);
-    }
-    if ((szy_!=32)&&(szy_!=64)&&(szy_!=128)&&(szy_!=256)&&(szy_!=512)&&(szy_!=1024)){
-        cout << szy_ << " is not supported, sorry. Only 2^N grid size works for charge Ewald\n";
-        exit(2);
-    }
-    if ((szz_!=32)&&(szz_!=64)&&(szz_!=128)&&(szz_!=256)&&(szz_!=512)&&(szz_!=1024)){
-        cout << szz_ << " is not supported, sorry. Only 2^N grid size works for charge Ewald\n";
-        exit(2);
-    }
+    mdAssert(nextFFTSize(szx_) == szx_ and nextFFTSize(szy_) == szy_ and nextFFTSize(szz_) == szz_,
+             "Ewald grid sizes must have no prime factors other than 2, 3, 5, and 7");
+    mdAssert(interpolation_order_ >= 1 and interpolation_order_ <= 7, "Ewald interpolation_order must be between 1 and 7");
     sz=make_int3(szx_,szy_,szz_);
     r_cut=rcut_;
-    cudaMalloc((void**)&FFT_Qs, sizeof(cufftComplex)*sz.x*sz.y*sz.z);
-
-    cufftPlan3d(&plan, sz.x,sz.y, sz.z, CUFFT_C2C);
-
-    
-    cudaMalloc((void**)&FFT_Ex, sizeof(cufftComplex)*sz.x*sz.y*sz.z);
-    cudaMalloc((void**)&FFT_Ey, sizeof(cufftComplex)*sz.x*sz.y*sz.z);
-    cudaMalloc((void**)&FFT_Ez, sizeof(cufftComplex)*sz.x*sz.y*sz.z);
-    
-    Green_function=GPUArrayGlobal<float>(sz.x*sz.y*sz.z);
-    CUT_CHECK_ERROR("setParameters execution failed");
+    allocateGrids();
+    if (state->backend != BACKEND::HOST) {
+        CUT_CHECK_ERROR("setParameters execution failed");
+    }
     
 
     interpolation_order=interpolation_order_;
 
-    malloced = true;
+}
 
+void FixChargeEwald::allocateGrids() {
+    if (malloced) {
+        cufftDestroy(plan);
+        cufftDestroy(planInverse);
+        cudaFree(FFT_Qs);
+        cudaFree(FFT_Ex);
+        cudaFree(FFT_Ey);
+        cudaFree(FFT_Ez);
+        malloced = false;
+    }
+    Green_function=GPUArrayGlobal<float>(nKPoints());
+    Green_expansion=GPUArrayGlobal<float4>(nKPoints());
+    differentiationAllocated = differentiation;
+    if (state->backend == BACKEND::HOST) {
+        //the host backend keeps its mesh in host memory, see prepareHostGrids
+        return;
+    }
+    cudaMalloc((void**)&FFT_Qs, sizeof(cufftComplex)*nKPoints());
+
+    cufftPlan3d(&plan, sz.x,sz.y, sz.z, CUFFT_R2C);
+    cufftPlan3d(&planInverse, sz.x,sz.y, sz.z, CUFFT_C2R);
+
+    cudaMalloc((void**)&FFT_Ex, sizeof(cufftComplex)*nKPoints());
+    //analytical differentiation only needs one grid for the potential
+    if (differentiation == EWALD_DIFF::IK) {
+        cudaMalloc((void**)&FFT_Ey, sizeof(cufftComplex)*nKPoints());
+        cudaMalloc((void**)&FFT_Ez, sizeof(cufftComplex)*nKPoints());
+    } else {
+        FFT_Ey = nullptr;
+        FFT_Ez = nullptr;
+    }
+
+    malloced = true;
 }
 
 
-void FixChargeEwald::setGridToErrorTolerance(bool printMsg) {
+//Refines the coarsest dimension to the next FFT-friendly size until the error is met.  Starts from the current grid
+//unless fromSmallest is set, so bounds changes during a run never shrink the grid
+void FixChargeEwald::setGridToErrorTolerance(bool printMsg, bool fromSmallest) {
     int3 szOld = sz;
+    if (fromSmallest) {
+        sz = make_int3(8, 8, 8);
+    }
     int nTries = 0;
     double error = find_optimal_parameters(false);
     Vector trace = state->bounds.rectComponents;
-    while (nTries < 100 and (error > errorTolerance or error!=error or error < 0)) { //<0 tests for -inf
+    while (nTries < 1000 and (error > errorTolerance or error!=error or error < 0)) { //<0 tests for -inf
         Vector sVec = Vector(make_float3(sz));
         Vector ratio = sVec / trace;
         double minRatio = ratio[0];
@@ -810,36 +1069,17 @@ void FixChargeEwald::setGridToErrorTolerance(bool printMsg) {
                 minIdx = i;
             }
         }
-        sVec[minIdx] *= 2;
-        //sz *= 2;//make_int3(sVec.asFloat3());
+        sVec[minIdx] = nextFFTSize((int) sVec[minIdx] + 1);
         sz = make_int3(sVec.asFloat3());
         error = find_optimal_parameters(false);
         nTries++;
     }
-    //DOESN'T REDUCE GRID SIZE EVER
     if (printMsg) {
         printf("Using ewald grid of %d %d %d with error %f\n", sz.x, sz.y, sz.z, error);
     }
 
-    if (!malloced or szOld != sz) {
-        if (malloced) {
-            cufftDestroy(plan);
-            cudaFree(FFT_Qs);
-            cudaFree(FFT_Ex);
-            cudaFree(FFT_Ey);
-            cudaFree(FFT_Ez);
-        }
-        cudaMalloc((void**)&FFT_Qs, sizeof(cufftComplex)*sz.x*sz.y*sz.z);
-
-        cufftPlan3d(&plan, sz.x,sz.y, sz.z, CUFFT_C2C);
-
-
-        cudaMalloc((void**)&FFT_Ex, sizeof(cufftComplex)*sz.x*sz.y*sz.z);
-        cudaMalloc((void**)&FFT_Ey, sizeof(cufftComplex)*sz.x*sz.y*sz.z);
-        cudaMalloc((void**)&FFT_Ez, sizeof(cufftComplex)*sz.x*sz.y*sz.z);
-
-        Green_function=GPUArrayGlobal<float>(sz.x*sz.y*sz.z);
-        malloced = true;
+    if (szOld != sz or Green_function.size() != nKPoints()) {
+        allocateGrids();
     }
 
 
@@ -848,8 +1088,11 @@ void FixChargeEwald::setError(double targetError, float rcut_, int interpolation
     if (rcut_==-1) {
         rcut_ = state->rCut;
     }
+    mdAssert(interpolation_order_ >= 1 and interpolation_order_ <= 7, "Ewald interpolation_order must be between 1 and 7");
     r_cut=rcut_;
     interpolation_order=interpolation_order_;
+    r_cutError = r_cut;
+    interpolation_orderError = interpolation_order;
     errorTolerance = targetError;
     modeIsError = true;
 
@@ -859,11 +1102,32 @@ void FixChargeEwald::calc_Green_function(){
 
     
     dim3 dimBlock(8,8,8);
-    dim3 dimGrid((sz.x + dimBlock.x - 1) / dimBlock.x,(sz.y + dimBlock.y - 1) / dimBlock.y,(sz.z + dimBlock.z - 1) / dimBlock.z);    
+    dim3 dimGrid((sz.x + dimBlock.x - 1) / dimBlock.x,(sz.y + dimBlock.y - 1) / dimBlock.y,(sz.z/2+1 + dimBlock.z - 1) / dimBlock.z);    
     int sum_limits=int(alpha*pow(h.x*h.y*h.z,1.0/3.0)/3.14159*(sqrt(-log(10E-7))))+1;
-    Green_function_cu<<<dimGrid, dimBlock>>>(state->boundsGPU, sz,Green_function.getDevData(),alpha,
-                                             sum_limits,interpolation_order);//TODO parameters unknown
+    if (state->backend == BACKEND::HOST) {
+        float3 trace = state->boundsGPU.trace();
+        bool ad = differentiation == EWALD_DIFF::AD;
+        float *G = Green_function.h_data.data();
+        float4 *expansion = Green_expansion.h_data.data();
+        int nK = nKPoints();
+#pragma omp parallel for schedule(static)
+        for (int kIdx=0; kIdx<nK; kIdx++) {
+            float3 dG;
+            G[kIdx] = greenFunction(kGridId(kIdx, sz), sz, trace, alpha, sum_limits, interpolation_order, ad, dG);
+            expansion[kIdx] = make_float4(G[kIdx], dG.x, dG.y, dG.z);
+        }
+        if (ad) {
+            calcSelfForceSums(expansion);
+        }
+        return;
+    }
+    Green_function_cu<<<dimGrid, dimBlock>>>(state->boundsGPU, sz,Green_function.getDevData(),Green_expansion.getDevData(),alpha,
+                                             sum_limits,interpolation_order,differentiation == EWALD_DIFF::AD);//TODO parameters unknown
     CUT_CHECK_ERROR("Green_function_cu kernel execution failed");
+    if (differentiation == EWALD_DIFF::AD) {
+        Green_expansion.dataToHost();
+        calcSelfForceSums(Green_expansion.h_data.data());
+    }
     
         //test area
 //     Green_function.dataToHost();
@@ -888,14 +1152,13 @@ void FixChargeEwald::calc_potential(cufftComplex *phi_buf){
     float volume=b.volume();
     
     dim3 dimBlock(8,8,8);
-    dim3 dimGrid((sz.x + dimBlock.x - 1) / dimBlock.x,(sz.y + dimBlock.y - 1) / dimBlock.y,(sz.z + dimBlock.z - 1) / dimBlock.z);    
+    dim3 dimGrid((sz.x + dimBlock.x - 1) / dimBlock.x,(sz.y + dimBlock.y - 1) / dimBlock.y,(sz.z/2+1 + dimBlock.z - 1) / dimBlock.z);    
     potential_cu<<<dimGrid, dimBlock>>>(sz,Green_function.getDevData(), FFT_Qs,phi_buf);
     CUT_CHECK_ERROR("potential_cu kernel execution failed");    
 
 
-    cufftExecC2C(plan, phi_buf, phi_buf,  CUFFT_INVERSE);
-    cudaDeviceSynchronize();
-    CUT_CHECK_ERROR("cufftExecC2C execution failed");
+    cufftExecC2R(planInverse, phi_buf, (cufftReal *)phi_buf);
+    CUT_CHECK_ERROR("cufftExecC2R execution failed");
 
 //     //test area
 //     float *buf=new float[sz.x*sz.y*sz.z*2];
@@ -915,15 +1178,45 @@ void FixChargeEwald::calc_potential(cufftComplex *phi_buf){
 //     delete []buf;
 }
 
+unsigned long long *FixChargeEwald::fixedPointGrid() {
+    if (not state->deterministic) {
+        return nullptr;
+    }
+    int nGrid = sz.x*sz.y*sz.z;
+    if (chargeGridFixed.size() != nGrid) {
+        chargeGridFixed = GPUArrayDeviceGlobal<unsigned long long>(nGrid);
+        chargeGridFixed.memset(0);
+    }
+    return chargeGridFixed.data();
+}
+
 bool FixChargeEwald::prepareForRun() {
+    mdAssert(differentiation == EWALD_DIFF::IK or interpolation_order >= 2, "Analytical differentiation needs interpolation_order of at least 2");
     virialField = GPUArrayDeviceGlobal<Virial>(1);
+    if (state->deterministic) {
+        virialFieldFixed = GPUArrayDeviceGlobal<unsigned long long>(6);
+        virialFieldFixed.memset(0);
+    }
     setTotalQ2();
 
-    //TODO these values for comparison are uninitialized - we should see about this
+    //with autoTune, offer the Autotuner other cutoffs and orders meeting the same error.  The user's come first
+    tuneCandidates.clear();
+    tuneCandidateIdx = 0;
+    if (modeIsError and state->autoTune) {
+        float3 trace = state->boundsGPU.trace();
+        float rCutMax = 0.5f*fminf(trace.x, trace.y);
+        if (not state->is2d) {
+            rCutMax = fminf(rCutMax, 0.5f*trace.z);
+        }
+        int minOrder = differentiation == EWALD_DIFF::AD ? 2 : 1;
+        tuneCandidates = ewaldTuneCandidates(r_cut, interpolation_order, rCutMax, minOrder);
+    }
 
-    handleBoundsChangeInternal(true);
+    handleBoundsChangeInternal(true, true);
     turnInit = state->turn;
-    if (longRangeInterval != 1) {
+    if (state->backend == BACKEND::HOST) {
+        hostStoredForces = std::vector<float4>(longRangeInterval != 1 ? state->maxIdExisting+1 : 0);
+    } else if (longRangeInterval != 1) {
         storedForces = GPUArrayDeviceGlobal<float4>(state->maxIdExisting+1);
     } else {
         storedForces = GPUArrayDeviceGlobal<float4>(1);
@@ -954,18 +1247,154 @@ void FixChargeEwald::handleBoundsChange() {
     handleBoundsChangeInternal(false);
 }
 
-void FixChargeEwald::handleBoundsChangeInternal(bool printError) {
+//force recomputes the parameters even if nothing they depend on changed, and in error mode searches grids from the smallest
+void FixChargeEwald::handleBoundsChangeInternal(bool printError, bool force) {
 
-    if ((state->boundsGPU != boundsLastOptimize)||(total_Q2!=total_Q2LastOptimize)) {
+    //device grids are missing if they were last set up for the host backend, and have the wrong number
+    //of field grids if the differentiation changed
+    bool reallocated = false;
+    if (state->backend != BACKEND::HOST and (not malloced or differentiation != differentiationAllocated)) {
+        allocateGrids();
+        reallocated = true;
+    }
+    //the Green function lives on the device or the host depending on the backend it was computed for
+    bool recompute = (total_Q2!=total_Q2LastOptimize)||(differentiation!=differentiationLastOptimize)
+                     ||(state->backend!=backendLastOptimize)||reallocated||force;
+    if (not recompute and state->boundsGPU != boundsLastUpdate) {
+        //Barostats change the box every few turns.  Small changes are applied to the Green function to first order,
+        //keeping alpha and the grid, rather than redoing the aliasing sums at every k-point
+        float3 trace = state->boundsGPU.trace();
+        float3 traceLastOptimize = boundsLastOptimize.trace();
+        float3 dLogL = make_float3(logf(trace.x/traceLastOptimize.x),
+                                   logf(trace.y/traceLastOptimize.y),
+                                   logf(trace.z/traceLastOptimize.z));
+        if (fmaxf(fabsf(dLogL.x), fmaxf(fabsf(dLogL.y), fabsf(dLogL.z))) < maxIncrementalBoxChange) {
+            updateGreenFunction(dLogL);
+        } else {
+            recompute = true;
+        }
+    }
+    if (recompute) {
         if (modeIsError) {
-            setGridToErrorTolerance(printError);
+            setGridToErrorTolerance(printError, force);
         } else {
             find_optimal_parameters(printError);
         }
         calc_Green_function();
         boundsLastOptimize = state->boundsGPU;
         total_Q2LastOptimize=total_Q2;
+        differentiationLastOptimize=differentiation;
+        backendLastOptimize=state->backend;
     }
+    boundsLastUpdate = state->boundsGPU;
+}
+
+//Analytical differentiation does not conserve momentum: the gradient of the assignment function leaves each charge
+//with a force from its own mesh potential.  For B-splines its mean over the charges' mesh positions is the first two
+//harmonics per dimension, c_s sin(2 PI s x/h), and is subtracted in the force gather.  See Ballenegger, Cerda and
+//Holm, JCTC 7, 3920 (2011), or LAMMPS's PPPM self force coefficients.  c_s = 2 PI s/h B_s with
+//  B_{x,s} = 1/V sum_k G(k) [sum_m W_x(m) W_x(m+s)] [sum_m W_y(m)^2] [sum_m W_z(m)^2],
+//W_d(m) = sinc(PI(n_d/sz_d + m))^order, the sum over m running over the aliases kept by DeltaF_k_AD
+void FixChargeEwald::calcSelfForceSums(const float4 *expansion) {
+    const int nAlias = 2;
+    const int nM = 2*nAlias+1;
+    //W_d(m) for m up to nAlias+2, so both harmonics have their partner
+    const int nW = nM + 2;
+    int dims[3] = {sz.x, sz.y, sz.z};
+    std::vector<float> ws[3];
+    for (int d=0; d<3; d++) {
+        ws[d].resize(dims[d]*nW);
+        for (int i=0; i<dims[d]; i++) {
+            int n = i > dims[d]/2 ? i-dims[d] : i;
+            for (int m=0; m<nW; m++) {
+                ws[d][i*nW + m] = pow(sinc(M_PI*(n/(double)dims[d] + m-nAlias)), interpolation_order);
+            }
+        }
+    }
+    //per dimension and grid index: sum_m W(m)^2, sum_m W(m)W(m+1), sum_m W(m)W(m+2)
+    std::vector<float3> pairSums[3];
+    for (int d=0; d<3; d++) {
+        pairSums[d].resize(dims[d]);
+        for (int i=0; i<dims[d]; i++) {
+            const float *w = ws[d].data() + i*nW;
+            float3 sums = make_float3(0, 0, 0);
+            for (int m=0; m<nM; m++) {
+                sums.x += w[m]*w[m];
+                sums.y += w[m]*w[m+1];
+                sums.z += w[m]*w[m+2];
+            }
+            pairSums[d][i] = sums;
+        }
+    }
+    double sums[2][3][4] = {};
+    int nK = nKPoints();
+    for (int kIdx=0; kIdx<nK; kIdx++) {
+        int3 id = kGridId(kIdx, sz);
+        float4 g = expansion[kIdx];
+        if (g.x == 0) {
+            continue;
+        }
+        float weight = kGridWeight(id, sz);
+        float3 px = pairSums[0][id.x];
+        float3 py = pairSums[1][id.y];
+        float3 pz = pairSums[2][id.z];
+        double p[2][3] = {{px.y*py.x*pz.x, px.x*py.y*pz.x, px.x*py.x*pz.y},
+                          {px.z*py.x*pz.x, px.x*py.z*pz.x, px.x*py.x*pz.z}};
+        for (int harm=0; harm<2; harm++) {
+            for (int d=0; d<3; d++) {
+                double wp = weight*p[harm][d];
+                sums[harm][d][0] += wp*g.x;
+                sums[harm][d][1] += wp*g.y;
+                sums[harm][d][2] += wp*g.z;
+                sums[harm][d][3] += wp*g.w;
+            }
+        }
+    }
+    double volume = state->boundsGPU.volume();
+    for (int harm=0; harm<2; harm++) {
+        for (int d=0; d<3; d++) {
+            double B = sums[harm][d][0]/volume;
+            //1/V contributes -B to each log derivative
+            selfForceSums[harm][d] = make_float4(B,
+                                                 sums[harm][d][1]/volume - B,
+                                                 sums[harm][d][2]/volume - B,
+                                                 sums[harm][d][3]/volume - B);
+        }
+    }
+    setSelfForce(make_float3(0, 0, 0));
+}
+
+void FixChargeEwald::setSelfForce(float3 dLogL) {
+    float3 h = state->boundsGPU.trace()/make_float3(sz);
+    float hs[3] = {h.x, h.y, h.z};
+    float c[2][3];
+    for (int harm=0; harm<2; harm++) {
+        for (int d=0; d<3; d++) {
+            float4 sum = selfForceSums[harm][d];
+            float B = sum.x + sum.y*dLogL.x + sum.z*dLogL.y + sum.w*dLogL.z;
+            c[harm][d] = 2*M_PI*(harm+1)/hs[d]*B;
+        }
+    }
+    selfForce.c1 = make_float3(c[0][0], c[0][1], c[0][2]);
+    selfForce.c2 = make_float3(c[1][0], c[1][1], c[1][2]);
+}
+
+void FixChargeEwald::updateGreenFunction(float3 dLogL) {
+    int nK = nKPoints();
+    if (differentiation == EWALD_DIFF::AD) {
+        setSelfForce(dLogL);
+    }
+    if (state->backend == BACKEND::HOST) {
+        float *G = Green_function.h_data.data();
+        float4 *expansion = Green_expansion.h_data.data();
+#pragma omp parallel for schedule(static)
+        for (int kIdx=0; kIdx<nK; kIdx++) {
+            G[kIdx] = updatedGreenFunction(expansion[kIdx], dLogL);
+        }
+        return;
+    }
+    Green_function_update_cu<<<NBLOCK(nK), PERBLOCK>>>(nK, Green_function.getDevData(), Green_expansion.getDevData(), dLogL);
+    CUT_CHECK_ERROR("Green_function_update_cu kernel execution failed");
 }
 
 void FixChargeEwald::compute(int virialMode) {
@@ -978,7 +1407,7 @@ void FixChargeEwald::compute(int virialMode) {
     GPUData &gpd     = state->gpd;
     GridGPU &grid    = state->gridGPU;
     int activeIdx    = gpd.activeIdx();
-    uint16_t *neighborCounts = grid.perAtomArray.d_data.data();
+    uint16_t *neighborCounts = grid.neighborCounts(getNeighborRCut());
     
  
     float Qconversion = sqrt(state->units.qqr_to_eng);
@@ -986,7 +1415,7 @@ void FixChargeEwald::compute(int virialMode) {
     //first update grid from atoms positions
     //set qs to 0
     dim3 dimBlock(8,8,8);
-    dim3 dimGrid((sz.x + dimBlock.x - 1) / dimBlock.x,(sz.y + dimBlock.y - 1) / dimBlock.y,(sz.z + dimBlock.z - 1) / dimBlock.z);    
+    dim3 dimGrid((sz.x + dimBlock.x - 1) / dimBlock.x,(sz.y + dimBlock.y - 1) / dimBlock.y,(sz.z/2+1 + dimBlock.z - 1) / dimBlock.z);    
     if (not ((state->turn - turnInit) % longRangeInterval)) {
         map_charge_set_to_zero_cu<<<dimGrid, dimBlock>>>(sz,FFT_Qs);
         //  CUT_CHECK_ERROR("map_charge_set_to_zero_cu kernel execution failed");
@@ -1003,31 +1432,23 @@ void FixChargeEwald::compute(int virialMode) {
         } else {
             centroids = gpd.xs(activeIdx);
         }
-        switch (interpolation_order){
-            case 1:{map_charge_to_grid_order_1_cu
-                       <<<NBLOCK(nRingPoly), PERBLOCK>>>( nRingPoly, nPerRingPoly, 
-                               centroids,                                                      
-                               gpd.qs(activeIdx),
-                               state->boundsGPU,
-                               sz,
-                               (float *)FFT_Qs,
-                               Qconversion);
-                       break;}
-            case 3:{map_charge_to_grid_order_3_cu
-                       <<<NBLOCK(nRingPoly), PERBLOCK>>>(nRingPoly, nPerRingPoly,
-                               centroids,
-                               gpd.qs(activeIdx),
-                               state->boundsGPU,
-                               sz,
-                               (float *)FFT_Qs,
-                               Qconversion);
-                       break;}
-        }    
+        unsigned long long *gridFixed = fixedPointGrid();
+        map_charge_to_grid(interpolation_order, nRingPoly, nPerRingPoly,
+                           centroids,
+                           gpd.qs(activeIdx),
+                           state->boundsGPU,
+                           sz,
+                           (float *)FFT_Qs,
+                           Qconversion,
+                           gridFixed);
+        if (gridFixed) {
+            map_charge_from_fixed_point_cu<<<NBLOCK(sz.x*sz.y*sz.z), PERBLOCK>>>(sz, (float *)FFT_Qs, gridFixed);
+        }
         // CUT_CHECK_ERROR("map_charge_to_grid_cu kernel execution failed");
 
-        cufftExecC2C(plan, FFT_Qs, FFT_Qs, CUFFT_FORWARD);
+        cufftExecR2C(plan, (cufftReal *)FFT_Qs, FFT_Qs);
         // cudaDeviceSynchronize();
-        //  CUT_CHECK_ERROR("cufftExecC2C Qs execution failed");
+        //  CUT_CHECK_ERROR("cufftExecR2C Qs execution failed");
 
 
         //     //test area
@@ -1046,19 +1467,21 @@ void FixChargeEwald::compute(int virialMode) {
         //             }
 
 
-        //next potential calculation: just going to use Ex to store it for now
-        //       calc_potential(FFT_Ex);
-
-        //calc E field
-        E_field_cu<<<dimGrid, dimBlock>>>(state->boundsGPU,sz,Green_function.getDevData(), FFT_Qs,FFT_Ex,FFT_Ey,FFT_Ez);
-        CUT_CHECK_ERROR("E_field_cu kernel execution failed");    
+        if (differentiation == EWALD_DIFF::AD) {
+            //potential only, using Ex to store it.  The field is taken from the gradient of the assignment function
+            calc_potential(FFT_Ex);
+        } else {
+            //calc E field
+            E_field_cu<<<dimGrid, dimBlock>>>(state->boundsGPU,sz,Green_function.getDevData(), FFT_Qs,FFT_Ex,FFT_Ey,FFT_Ez);
+            CUT_CHECK_ERROR("E_field_cu kernel execution failed");    
 
 
-        cufftExecC2C(plan, FFT_Ex, FFT_Ex,  CUFFT_INVERSE);
-        cufftExecC2C(plan, FFT_Ey, FFT_Ey,  CUFFT_INVERSE);
-        cufftExecC2C(plan, FFT_Ez, FFT_Ez,  CUFFT_INVERSE);
-        //  cudaDeviceSynchronize();
-        // CUT_CHECK_ERROR("cufftExecC2C  E_field execution failed");
+            cufftExecC2R(planInverse, FFT_Ex, (cufftReal *)FFT_Ex);
+            cufftExecC2R(planInverse, FFT_Ey, (cufftReal *)FFT_Ey);
+            cufftExecC2R(planInverse, FFT_Ez, (cufftReal *)FFT_Ez);
+            //  cudaDeviceSynchronize();
+            // CUT_CHECK_ERROR("cufftExecC2R  E_field execution failed");
+        }
 
 
         /*//test area
@@ -1112,28 +1535,26 @@ void FixChargeEwald::compute(int virialMode) {
         // Performing an "effective" ring polymer contraction means that we should evaluate the forces
         // for the centroids
         bool storeForces = longRangeInterval != 1;
-        switch (interpolation_order){
-            case 1:{Ewald_long_range_forces_order_1_cu<<<NBLOCK(nRingPoly), PERBLOCK>>>( nRingPoly, nPerRingPoly,
-                           centroids,                                                      
+        if (differentiation == EWALD_DIFF::AD) {
+            Ewald_long_range_forces<true>(interpolation_order, nRingPoly, nPerRingPoly,
+                           centroids,
                            gpd.fs(activeIdx),
                            gpd.qs(activeIdx),
                            state->boundsGPU,
                            sz,
-                           FFT_Ex,FFT_Ey,FFT_Ez,Qconversion,
+                           (float *)FFT_Ex,nullptr,nullptr,Qconversion,selfForce,
                            storeForces, gpd.ids(activeIdx), storedForces.data()
                            );
-                       break;}
-            case 3:{Ewald_long_range_forces_order_3_cu<<<NBLOCK(nRingPoly), PERBLOCK>>>( nRingPoly, nPerRingPoly,
-                           centroids,                                                      
+        } else {
+            Ewald_long_range_forces<false>(interpolation_order, nRingPoly, nPerRingPoly,
+                           centroids,
                            gpd.fs(activeIdx),
                            gpd.qs(activeIdx),
                            state->boundsGPU,
                            sz,
-                           FFT_Ex,FFT_Ey,FFT_Ez,Qconversion,
+                           (float *)FFT_Ex,(float *)FFT_Ey,(float *)FFT_Ez,Qconversion,selfForce,
                            storeForces, gpd.ids(activeIdx), storedForces.data()
                            );
-
-                       break;}
         }
     } else {
         applyStoredForces<<<NBLOCK(nAtoms), PERBLOCK>>>( nAtoms,
@@ -1147,8 +1568,12 @@ void FixChargeEwald::compute(int virialMode) {
         BoundsGPU &b=state->boundsGPU;
         float volume=b.volume();          
         virialField.memset(0); 
-        virials_cu<<<dimGrid, dimBlock,sizeof(Virial)*dimBlock.x*dimBlock.y*dimBlock.z>>>(state->boundsGPU,sz,virialField.data(),alpha,Green_function.getDevData(), FFT_Qs, warpSize); 
+        unsigned long long *virialFieldFixed_d = state->deterministic ? virialFieldFixed.data() : nullptr;
+        virials_cu<<<dimGrid, dimBlock,sizeof(Virial)*dimBlock.x*dimBlock.y*dimBlock.z>>>(state->boundsGPU,sz,virialField.data(),alpha,Green_function.getDevData(), FFT_Qs, warpSize, virialFieldFixed_d); 
         CUT_CHECK_ERROR("virials_cu kernel execution failed");    
+        if (virialFieldFixed_d) {
+            virialFromFixedPoint<<<1, 6>>>(virialField.data(), virialFieldFixed_d);
+        }
 
 
 
@@ -1156,11 +1581,11 @@ void FixChargeEwald::compute(int virialMode) {
     }
 
     float *neighborCoefs = state->specialNeighborCoefs;
-    evalWrap->compute(nAtoms,nPerRingPoly,gpd.xs(activeIdx), gpd.fs(activeIdx),
+    evalWrap->compute(nAtoms,nPerRingPoly,gpd.xs(activeIdx), gpd.fs(activeIdx), gpd.fsFixed.data(),
                   neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(),
                   state->devManager.prop.warpSize, nullptr, 0, state->boundsGPU, //PASSING NULLPTR TO GPU MAY CAUSE ISSUES
     //ALTERNATIVELy, COULD JUST GIVE THE PARMS SOME OTHER RANDOM POINTER, AS LONG AS IT'S VALID
-                  neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.virials.d_data.data(), gpd.qs(activeIdx), r_cut, virialMode, nThreadPerBlock(), nThreadPerAtom());
+                  neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.virials.d_data.data(), gpd.qs(activeIdx), r_cut, virialMode, nThreadPerBlock(), nThreadPerAtom(), grid.compressedNeighborlist());
 
 
     CUT_CHECK_ERROR("Ewald_short_range_forces_cu  execution failed");
@@ -1168,10 +1593,176 @@ void FixChargeEwald::compute(int virialMode) {
 }
 
 
+void FixChargeEwald::prepareHostGrids() {
+    if (szHost != sz) {
+        fftHost = FFTHost(sz.x, sz.y, sz.z);
+        szHost = sz;
+    }
+    hostQs.resize(fftHost.size());
+    int nFields = differentiation == EWALD_DIFF::AD ? 1 : 3;
+    for (int i=0; i<3; i++) {
+        if (i < nFields) {
+            hostFields[i].resize(fftHost.size());
+        } else {
+            std::vector<float>().swap(hostFields[i]);
+        }
+    }
+}
+
+void FixChargeEwald::spreadChargesHost(float4 *xs, float *qs, int nAtoms, float Qunit) {
+    BoundsGPU bounds = state->boundsGPU;
+    float *grid = hostQs.data();
+    switch (interpolation_order) {
+        case 1: spread_charges_host<1>(nAtoms, xs, qs, bounds, sz, grid, Qunit, hostAtomPlanes, hostPlaneStarts, hostPlaneAtoms, hostSpreadScratch); break;
+        case 2: spread_charges_host<2>(nAtoms, xs, qs, bounds, sz, grid, Qunit, hostAtomPlanes, hostPlaneStarts, hostPlaneAtoms, hostSpreadScratch); break;
+        case 3: spread_charges_host<3>(nAtoms, xs, qs, bounds, sz, grid, Qunit, hostAtomPlanes, hostPlaneStarts, hostPlaneAtoms, hostSpreadScratch); break;
+        case 4: spread_charges_host<4>(nAtoms, xs, qs, bounds, sz, grid, Qunit, hostAtomPlanes, hostPlaneStarts, hostPlaneAtoms, hostSpreadScratch); break;
+        case 5: spread_charges_host<5>(nAtoms, xs, qs, bounds, sz, grid, Qunit, hostAtomPlanes, hostPlaneStarts, hostPlaneAtoms, hostSpreadScratch); break;
+        case 6: spread_charges_host<6>(nAtoms, xs, qs, bounds, sz, grid, Qunit, hostAtomPlanes, hostPlaneStarts, hostPlaneAtoms, hostSpreadScratch); break;
+        case 7: spread_charges_host<7>(nAtoms, xs, qs, bounds, sz, grid, Qunit, hostAtomPlanes, hostPlaneStarts, hostPlaneAtoms, hostSpreadScratch); break;
+    }
+}
+
+//Same steps as compute, on the host copies of the atom data.  Ring polymers are rejected by the host backend,
+//so there are no centroids to handle
+void FixChargeEwald::computeHost(int virialMode) {
+    int nAtoms    = state->atoms.size();
+    GPUData &gpd  = state->gpd;
+    GridGPU &grid = state->gridGPU;
+    float4 *xs = gpd.xs.h_data.data();
+    float4 *fs = gpd.fs.h_data.data();
+    float *qs = gpd.qs.h_data.data();
+    uint *ids = gpd.ids.h_data.data();
+    BoundsGPU bounds = state->boundsGPU;
+    float3 trace = bounds.trace();
+    float *G = Green_function.h_data.data();
+    int nK = nKPoints();
+
+    float Qconversion = sqrt(state->units.qqr_to_eng);
+
+    prepareHostGrids();
+    //complex values of the half grids, as interleaved (real, imaginary) floats
+    float *Q = hostQs.data();
+    if (not ((state->turn - turnInit) % longRangeInterval)) {
+        spreadChargesHost(xs, qs, nAtoms, Qconversion);
+        fftHost.forward(Q);
+
+        if (differentiation == EWALD_DIFF::AD) {
+            float *phi = hostFields[0].data();
+#pragma omp parallel for schedule(static)
+            for (int kIdx=0; kIdx<nK; kIdx++) {
+                phi[2*kIdx]   = Q[2*kIdx]*G[kIdx];
+                phi[2*kIdx+1] = Q[2*kIdx+1]*G[kIdx];
+            }
+            fftHost.inverse(phi);
+        } else {
+            float *Ex = hostFields[0].data();
+            float *Ey = hostFields[1].data();
+            float *Ez = hostFields[2].data();
+            //ik*q(k)*Gf(k), as in E_field_cu
+#pragma omp parallel for schedule(static)
+            for (int kIdx=0; kIdx<nK; kIdx++) {
+                float3 k = kVector(kGridId(kIdx, sz), sz, trace);
+                float qRe = Q[2*kIdx]*G[kIdx];
+                float qIm = Q[2*kIdx+1]*G[kIdx];
+                Ex[2*kIdx] = -k.x*qIm;
+                Ex[2*kIdx+1] = k.x*qRe;
+                Ey[2*kIdx] = -k.y*qIm;
+                Ey[2*kIdx+1] = k.y*qRe;
+                Ez[2*kIdx] = -k.z*qIm;
+                Ez[2*kIdx+1] = k.z*qRe;
+            }
+            fftHost.inverse(Ex);
+            fftHost.inverse(Ey);
+            fftHost.inverse(Ez);
+        }
+
+        bool storeForces = longRangeInterval != 1;
+        if (differentiation == EWALD_DIFF::AD) {
+            Ewald_long_range_forces_host<true>(interpolation_order, nAtoms, xs, fs, qs, bounds, sz,
+                                               hostFields[0].data(), nullptr, nullptr, Qconversion, selfForce,
+                                               storeForces, ids, hostStoredForces.data());
+        } else {
+            Ewald_long_range_forces_host<false>(interpolation_order, nAtoms, xs, fs, qs, bounds, sz,
+                                                hostFields[0].data(), hostFields[1].data(), hostFields[2].data(), Qconversion, selfForce,
+                                                storeForces, ids, hostStoredForces.data());
+        }
+    } else {
+#pragma omp parallel for schedule(static)
+        for (int i=0; i<nAtoms; i++) {
+            float3 stored = make_float3(hostStoredForces[ids[i]]);
+            fs[i] += stored;
+        }
+    }
+    if (virialMode) {
+        double v0 = 0, v1 = 0, v2 = 0, v3 = 0, v4 = 0, v5 = 0;
+#pragma omp parallel for schedule(static) reduction(+:v0,v1,v2,v3,v4,v5)
+        for (int kIdx=0; kIdx<nK; kIdx++) {
+            int3 id = kGridId(kIdx, sz);
+            float E = kGridWeight(id, sz)*(Q[2*kIdx]*Q[2*kIdx] + Q[2*kIdx+1]*Q[2*kIdx+1])*G[kIdx];
+            Virial v = fieldVirial(kVector(id, sz, trace), E, alpha);
+            v0 += v[0];
+            v1 += v[1];
+            v2 += v[2];
+            v3 += v[3];
+            v4 += v[4];
+            v5 += v[5];
+        }
+        //mapped to a single atom, as with mapVirialToSingleAtom
+        Virial field(v0, v1, v2, v3, v4, v5);
+        field *= 0.5f / bounds.volume();
+        gpd.virials.h_data[0] += field;
+    }
+
+    float *neighborCoefs = state->specialNeighborCoefs;
+    evalWrap->computeHost(nAtoms, grid, xs, fs,
+                          nullptr, 0, bounds,
+                          neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.virials.h_data.data(), qs, r_cut, virialMode);
+}
+
+//same energies as singlePointEng, from the host grids
+void FixChargeEwald::singlePointEngHost(float *perParticleEng) {
+    if (state->boundsGPU != boundsLastUpdate) {
+        handleBoundsChange();
+    }
+    int nAtoms = state->atoms.size();
+    GPUData &gpd = state->gpd;
+    GridGPU &grid = state->gridGPU;
+    float4 *xs = gpd.xs.h_data.data();
+    float *qs = gpd.qs.h_data.data();
+    BoundsGPU bounds = state->boundsGPU;
+    float *G = Green_function.h_data.data();
+    int nK = nKPoints();
+    float Qconversion = sqrt(state->units.qqr_to_eng);
+
+    prepareHostGrids();
+    float *Q = hostQs.data();
+    spreadChargesHost(xs, qs, nAtoms, Qconversion);
+    fftHost.forward(Q);
+
+    double fieldEng = 0;
+#pragma omp parallel for schedule(static) reduction(+:fieldEng)
+    for (int kIdx=0; kIdx<nK; kIdx++) {
+        int3 id = kGridId(kIdx, sz);
+        fieldEng += kGridWeight(id, sz)*(Q[2*kIdx]*Q[2*kIdx] + Q[2*kIdx+1]*Q[2*kIdx+1])*G[kIdx];
+    }
+    float field_energy_per_particle = 0.5*fieldEng/bounds.volume()/nAtoms;
+    field_energy_per_particle -= alpha/sqrt(M_PI)*total_Q2/nAtoms;
+#pragma omp parallel for schedule(static)
+    for (int i=0; i<nAtoms; i++) {
+        perParticleEng[i] += field_energy_per_particle;
+    }
+
+    float *neighborCoefs = state->specialNeighborCoefs;
+    evalWrap->energyHost(nAtoms, grid, xs, perParticleEng,
+                         nullptr, 0, bounds,
+                         neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], qs, r_cut);
+}
+
 void FixChargeEwald::singlePointEng(float * perParticleEng) {
     CUT_CHECK_ERROR("before FixChargeEwald kernel execution failed");
 
-    if (state->boundsGPU != boundsLastOptimize) {
+    if (state->boundsGPU != boundsLastUpdate) {
         handleBoundsChange();
     }
 //     cout<<"FixChargeEwald::compute..\n";
@@ -1181,7 +1772,7 @@ void FixChargeEwald::singlePointEng(float * perParticleEng) {
     GPUData &gpd = state->gpd;
     GridGPU &grid = state->gridGPU;
     int activeIdx = gpd.activeIdx();
-    uint16_t *neighborCounts = grid.perAtomArray.d_data.data();
+    uint16_t *neighborCounts = grid.neighborCounts(getNeighborRCut());
     
     
      
@@ -1192,7 +1783,7 @@ void FixChargeEwald::singlePointEng(float * perParticleEng) {
     //set qs to 0
     float field_energy_per_particle = 0;
     dim3 dimBlock(8,8,8);
-    dim3 dimGrid((sz.x + dimBlock.x - 1) / dimBlock.x,(sz.y + dimBlock.y - 1) / dimBlock.y,(sz.z + dimBlock.z - 1) / dimBlock.z);    
+    dim3 dimGrid((sz.x + dimBlock.x - 1) / dimBlock.x,(sz.y + dimBlock.y - 1) / dimBlock.y,(sz.z/2+1 + dimBlock.z - 1) / dimBlock.z);    
     map_charge_set_to_zero_cu<<<dimGrid, dimBlock>>>(sz,FFT_Qs);
     CUT_CHECK_ERROR("map_charge_set_to_zero_cu kernel execution failed");
     //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -1210,29 +1801,21 @@ void FixChargeEwald::singlePointEng(float * perParticleEng) {
         centroids = gpd.xs(activeIdx);
     }
 
-      switch (interpolation_order){
-      case 1:{map_charge_to_grid_order_1_cu
-              <<<NBLOCK(nRingPoly), PERBLOCK>>>(nRingPoly, nPerRingPoly,
-                                              centroids,
-                                              gpd.qs(activeIdx),
-                                              state->boundsGPU,
-                                              sz,
-                                              (float *)FFT_Qs,Qconversion);
-              break;}
-      case 3:{map_charge_to_grid_order_3_cu
-              <<<NBLOCK(nRingPoly), PERBLOCK>>>(nRingPoly, nPerRingPoly, 
-                                              centroids,
-                                              gpd.qs(activeIdx),
-                                              state->boundsGPU,
-                                              sz,
-                                              (float *)FFT_Qs,Qconversion);
-              break;}
-    }    
+    unsigned long long *gridFixed = fixedPointGrid();
+    map_charge_to_grid(interpolation_order, nRingPoly, nPerRingPoly,
+                       centroids,
+                       gpd.qs(activeIdx),
+                       state->boundsGPU,
+                       sz,
+                       (float *)FFT_Qs,Qconversion,gridFixed);
+    if (gridFixed) {
+        map_charge_from_fixed_point_cu<<<NBLOCK(sz.x*sz.y*sz.z), PERBLOCK>>>(sz, (float *)FFT_Qs, gridFixed);
+    }
     CUT_CHECK_ERROR("map_charge_to_grid_cu kernel execution failed");
 
-    cufftExecC2C(plan, FFT_Qs, FFT_Qs, CUFFT_FORWARD);
+    cufftExecR2C(plan, (cufftReal *)FFT_Qs, FFT_Qs);
     cudaDeviceSynchronize();
-    CUT_CHECK_ERROR("cufftExecC2C Qs execution failed");
+    CUT_CHECK_ERROR("cufftExecR2C Qs execution failed");
 
     
 
@@ -1240,20 +1823,18 @@ void FixChargeEwald::singlePointEng(float * perParticleEng) {
     BoundsGPU &b=state->boundsGPU;
     float volume=b.volume();
     
-    Energy_cu<<<dimGrid, dimBlock>>>(sz,Green_function.getDevData(), FFT_Qs,FFT_Ex);//use Ex as buffer
+    Energy_cu<<<dimGrid, dimBlock>>>(sz,Green_function.getDevData(), FFT_Qs,(float *)FFT_Ex);//use Ex as buffer
     CUT_CHECK_ERROR("Energy_cu kernel execution failed");    
   
-    GPUArrayGlobal<float>field_E(1);
+    GPUArrayGlobal<float>field_E(2); //room for a fixed point sum
     field_E.memsetByVal(0.0);
     int warpSize = state->devManager.prop.warpSize;
-    accumulate_gpu<float,float, SumSingle, N_DATA_PER_THREAD> <<<NBLOCK(2*sz.x*sz.y*sz.z/(double)N_DATA_PER_THREAD),PERBLOCK,N_DATA_PER_THREAD*sizeof(float)*PERBLOCK>>>
-        (
-         field_E.getDevData(),
-         (float *)FFT_Ex,
-         2*sz.x*sz.y*sz.z,
-         warpSize,
-         SumSingle()
-         );   
+    accumulate(field_E.getDevData(),
+               (float *)FFT_Ex,
+               nKPoints(),
+               warpSize,
+               SumSingle(),
+               state->deterministic);
 /*
     sumSingle<float,float, N_DATA_PER_THREAD> <<<NBLOCK(2*sz.x*sz.y*sz.z/(double)N_DATA_PER_THREAD),PERBLOCK,N_DATA_PER_THREAD*sizeof(float)*PERBLOCK>>>(
                                             field_E.getDevData(),
@@ -1264,7 +1845,7 @@ void FixChargeEwald::singlePointEng(float * perParticleEng) {
     field_E.dataToHost();
 
     //field_energy_per_particle=0.5*field_E.h_data[0]/volume/nAtoms;
-    field_energy_per_particle=0.5*field_E.h_data[0]/volume/nRingPoly;
+    field_energy_per_particle=0.5*reductionResult<float>(field_E.h_data.data(), state->deterministic)/volume/nRingPoly;
 //         cout<<"field_E "<<field_E.h_data[0]<<'\n';
 
     field_energy_per_particle-=alpha/sqrt(M_PI)*total_Q2/nRingPoly;
@@ -1273,7 +1854,7 @@ void FixChargeEwald::singlePointEng(float * perParticleEng) {
 //pair energies
     mapEngToParticles<<<NBLOCK(nAtoms), PERBLOCK>>>(nAtoms, field_energy_per_particle, perParticleEng);
     float *neighborCoefs = state->specialNeighborCoefs;
-    evalWrap->energy(nAtoms,nPerRingPoly, gpd.xs(activeIdx), perParticleEng, neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(), state->devManager.prop.warpSize, nullptr, 0, state->boundsGPU, neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs(activeIdx), r_cut, nThreadPerBlock(), nThreadPerAtom());
+    evalWrap->energy(nAtoms,nPerRingPoly, gpd.xs(activeIdx), perParticleEng, neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(), state->devManager.prop.warpSize, nullptr, 0, state->boundsGPU, neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs(activeIdx), r_cut, nThreadPerBlock(), nThreadPerAtom(), grid.compressedNeighborlist());
 
 
     CUT_CHECK_ERROR("Ewald_short_range_forces_cu  execution failed");
@@ -1281,6 +1862,50 @@ void FixChargeEwald::singlePointEng(float * perParticleEng) {
 }
 
 
+void FixChargeEwald::setTuneCandidate(int idx) {
+    tuneCandidateIdx = idx;
+    r_cut = tuneCandidates[idx].first;
+    interpolation_order = tuneCandidates[idx].second;
+    handleBoundsChangeInternal(false, true);
+    mdMessage("Ewald r_cut %f, interpolation_order %d, grid %d %d %d, alpha %f\n",
+              r_cut, interpolation_order, sz.x, sz.y, sz.z, alpha);
+    //don't reuse long range forces from the old settings
+    turnInit = state->turn;
+    setEvalWrapper();
+    for (Fix *f : state->fixes) {
+        if (f->hasAcceptedChargePairCalc) {
+            //picks up the new r_cut and alpha
+            f->acceptChargePairCalc(this);
+            f->setEvalWrapper();
+        }
+    }
+    state->gridGPU.setRCut(state->getMaxRCut());
+    state->updateNeighborSubLists();
+    state->updateNeighborTypeRCuts();
+    state->gridGPU.periodicBoundaryConditions(-1, true);
+}
+
+bool FixChargeEwald::postRun() {
+    //tuning applies to one run, so the next starts from the settings given to setError
+    if (modeIsError) {
+        r_cut = r_cutError;
+        interpolation_order = interpolation_orderError;
+    }
+    tuneCandidates.clear();
+    tuneCandidateIdx = 0;
+    return true;
+}
+
+void FixChargeEwald::setDifferentiation(std::string mode) {
+    if (mode == "ik") {
+        differentiation = EWALD_DIFF::IK;
+    } else if (mode == "ad") {
+        differentiation = EWALD_DIFF::AD;
+    } else {
+        mdAssert(false, "Ewald differentiation must be 'ik' or 'ad'");
+    }
+}
+
 int FixChargeEwald::setLongRangeInterval(int interval) {
     if (interval) {
         longRangeInterval = interval;
@@ -1314,6 +1939,7 @@ void export_FixChargeEwald() {
         .def("setError", &FixChargeEwald::setError, (py::arg("error"), py::arg("rCut")=-1, py::arg("interpolation_order")=3)
             )
         .def("setLongRangeInterval", &FixChargeEwald::setLongRangeInterval, (py::arg("interval")=0))
+        .def("setDifferentiation", &FixChargeEwald::setDifferentiation, (py::arg("mode")))
         ;
 }
 
@@ -7,12 +7,23 @@
 #include "Virial.h"
 #include "BoundsGPU.h"
 #include "ChargeEvaluatorEwald.h"
+#include "FFTHost.h"
+#include <vector>
 
 class State;
 
 void export_FixChargeEwald();
 extern const std::string chargeEwaldType;
 
+//! How the mesh field is differentiated: ik (three inverse FFTs of the field) or analytically (one inverse FFT of the potential)
+enum EWALD_DIFF {IK, AD};
+
+//! Coefficients of the self force analytical differentiation leaves on each charge, see FixChargeEwald::calcSelfForceSums
+struct EwaldSelfForce {
+    float3 c1; //!< First harmonic in the mesh spacing, per dimension
+    float3 c2; //!< Second harmonic
+};
+
 /*! \class FixChargeEwald
  * \brief Short and Long range Coulomb interaction
  * Short range interactions are computed pairwise manner
@@ -23,14 +34,31 @@ extern const std::string chargeEwaldType;
 class FixChargeEwald : public FixCharge {
 
 private:
-    cufftHandle plan;
+    cufftHandle plan;         // real-to-complex, forward
+    cufftHandle planInverse;  // complex-to-real, inverse
+    //k-space half grids of sz.x*sz.y*(sz.z/2+1) points, transformed in place, so each also
+    //holds a real grid with the z dimension padded to 2*(sz.z/2+1)
     cufftComplex *FFT_Qs;  // change to GPU arrays?
     cufftComplex *FFT_Ex, *FFT_Ey, *FFT_Ez;
     
-    GPUArrayGlobal<float> Green_function;  // Green function in k space
+    GPUArrayGlobal<float> Green_function;  // Green function in k space, on the half grid
+    //Green function and its derivatives with respect to the log of each box dimension, for the box it was last computed for
+    GPUArrayGlobal<float4> Green_expansion;
+    void updateGreenFunction(float3 dLogL); //!< Apply a small box change to the Green function to first order
+
+    //analytical differentiation self force: the sums behind EwaldSelfForce for each harmonic and dimension, and their
+    //derivatives with respect to the log of each box dimension, for the box of Green_expansion
+    float4 selfForceSums[2][3];
+    EwaldSelfForce selfForce;
+    void calcSelfForceSums(const float4 *expansion);
+    void setSelfForce(float3 dLogL); //!< selfForce for the current box, which differs from the last full computation by dLogL
 
 
     int3 sz;
+    int nKPoints() {
+        return sz.x*sz.y*(sz.z/2+1);
+    }
+    void allocateGrids(); //!< (Re)allocate the mesh and FFT plans for the current sz
 
     float alpha;
     float r_cut;
@@ -43,22 +71,49 @@ private:
     void calc_Green_function();
     void calc_potential(cufftComplex *phi_buf);
 
-    int interpolation_order;
+    int interpolation_order; //!< Number of mesh points per dimension each charge is assigned to, 1 to 7
 //! RMS variables
     double DeltaF_k(double t_alpha);
+    double DeltaF_k_AD(double t_alpha);
     double DeltaF_real(double t_alpha);
     float3 h;
     float3 L;
     GPUArrayDeviceGlobal<Virial> virialField;
+    //fixed point charge grid and virial sums for State::deterministic
+    GPUArrayDeviceGlobal<unsigned long long> chargeGridFixed;
+    GPUArrayDeviceGlobal<unsigned long long> virialFieldFixed;
+    unsigned long long *fixedPointGrid(); //!< nullptr unless State::deterministic
     GPUArrayDeviceGlobal<float4> storedForces;
-    BoundsGPU boundsLastOptimize;
+    BoundsGPU boundsLastOptimize; //!< Bounds the Green function was last computed in full for
+    BoundsGPU boundsLastUpdate; //!< Bounds the Green function was last updated for
     float total_Q2LastOptimize;    
-    void handleBoundsChangeInternal(bool);
-    void setGridToErrorTolerance(bool);
+    void handleBoundsChangeInternal(bool, bool force=false);
+    void setGridToErrorTolerance(bool, bool fromSmallest=false);
     bool modeIsError;
     double errorTolerance;
+    float r_cutError; //!< r_cut given to setError, restored after runs that tuned it
+    int interpolation_orderError;
+    std::vector<std::pair<float, int> > tuneCandidates; //!< (r_cut, interpolation_order) sets offered to the Autotuner
+    int tuneCandidateIdx;
         
+    //host backend: the same mesh in host memory, transformed with FFTHost
+    FFTHost fftHost;
+    int3 szHost; //!< Grid size fftHost and the host grids were set up for
+    std::vector<float> hostQs; //!< Charge grid, then its transform
+    std::vector<float> hostFields[3]; //!< Ex, Ey, Ez, or the potential in the first for analytical differentiation
+    std::vector<float> hostSpreadScratch; //!< Per-thread slabs charges are spread onto
+    std::vector<int> hostAtomPlanes; //!< First x plane of each atom's stencil
+    std::vector<int> hostPlaneStarts; //!< Atoms sorted by stencil x plane, in compressed rows
+    std::vector<int> hostPlaneAtoms;
+    std::vector<float4> hostStoredForces;
+    void prepareHostGrids();
+    void spreadChargesHost(float4 *xs, float *qs, int nAtoms, float Qunit);
+
     bool malloced;
+    int differentiation; //!< One of EWALD_DIFF
+    int differentiationAllocated; //!< Differentiation the grids were allocated for
+    int differentiationLastOptimize;
+    int backendLastOptimize; //!< Backend the Green function was last computed for
 
 
 public:
@@ -78,13 +133,28 @@ public:
 
     //! Compute forces
     void compute(int);
+    //! Compute forces on the host backend
+    void computeHost(int);
     int setLongRangeInterval(int interval);
+    //! 'ik' (default) or 'ad'.  'ad' takes forces from the gradient of the assignment function, needing one inverse FFT and one mesh grid rather than three
+    void setDifferentiation(std::string mode);
 
     //! Compute single point energy
     void singlePointEng(float *);
+    void singlePointEngHost(float *);
     //void singlePointEngGroupGroup(float *, uint32_t, uint32_t);
 
     bool prepareForRun();
+    bool postRun();
+
+    //! In error mode with State::autoTune, other cutoffs and orders, each with the coarsest mesh reaching the error
+    int nTuneCandidates() {
+        return tuneCandidates.size();
+    }
+    void setTuneCandidate(int idx);
+    int tuneCandidate() {
+        return tuneCandidateIdx;
+    }
     
     //! Return list of cutoff values.
     std::vector<float> getRCuts() {
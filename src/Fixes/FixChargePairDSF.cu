@@ -33,6 +33,7 @@ const std::string chargePairDSFType = "ChargePairDSF";
 FixChargePairDSF::FixChargePairDSF(SHARED(State) state_, string handle_, string groupHandle_) : FixCharge(state_, handle_, groupHandle_, chargePairDSFType, true) {
    setParameters(0.25,9.0);
    canOffloadChargePairCalc = true;
+   canRunOnHost = true;
    setEvalWrapper();
 };
 
@@ -63,15 +64,34 @@ void FixChargePairDSF::compute(int virialMode) {
     GPUData &gpd = state->gpd;
     GridGPU &grid = state->gridGPU;
     int activeIdx = gpd.activeIdx();
-    uint16_t *neighborCounts = grid.perAtomArray.d_data.data();
+    uint16_t *neighborCounts = grid.neighborCounts(getNeighborRCut());
     float *neighborCoefs = state->specialNeighborCoefs;
-    evalWrap->compute(nAtoms,nPerRingPoly, gpd.xs(activeIdx), gpd.fs(activeIdx),
+    evalWrap->compute(nAtoms,nPerRingPoly, gpd.xs(activeIdx), gpd.fs(activeIdx), gpd.fsFixed.data(),
                   neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(),
                   state->devManager.prop.warpSize, nullptr, 0, state->boundsGPU,
-                  neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.virials.d_data.data(), gpd.qs(activeIdx), r_cut, virialMode, nThreadPerBlock(), nThreadPerAtom());
+                  neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.virials.d_data.data(), gpd.qs(activeIdx), r_cut, virialMode, nThreadPerBlock(), nThreadPerAtom(), grid.compressedNeighborlist());
 
 
 
+}
+void FixChargePairDSF::computeHost(int virialMode) {
+    int nAtoms = state->atoms.size();
+    GPUData &gpd = state->gpd;
+    GridGPU &grid = state->gridGPU;
+    float *neighborCoefs = state->specialNeighborCoefs;
+    evalWrap->computeHost(nAtoms, grid, gpd.xs.h_data.data(), gpd.fs.h_data.data(),
+                          nullptr, 0, state->boundsGPU,
+                          neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.virials.h_data.data(), gpd.qs.h_data.data(), r_cut, virialMode);
+}
+
+void FixChargePairDSF::singlePointEngHost(float *perParticleEng) {
+    int nAtoms = state->atoms.size();
+    GPUData &gpd = state->gpd;
+    GridGPU &grid = state->gridGPU;
+    float *neighborCoefs = state->specialNeighborCoefs;
+    evalWrap->energyHost(nAtoms, grid, gpd.xs.h_data.data(), perParticleEng,
+                         nullptr, 0, state->boundsGPU,
+                         neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs.h_data.data(), r_cut);
 }
 
 void FixChargePairDSF::singlePointEng(float * perParticleEng) {
@@ -80,12 +100,12 @@ void FixChargePairDSF::singlePointEng(float * perParticleEng) {
     GPUData &gpd = state->gpd;
     GridGPU &grid = state->gridGPU;
     int activeIdx = gpd.activeIdx();
-    uint16_t *neighborCounts = grid.perAtomArray.d_data.data();
+    uint16_t *neighborCounts = grid.neighborCounts(getNeighborRCut());
     float *neighborCoefs = state->specialNeighborCoefs;
     evalWrap->energy(nAtoms,nPerRingPoly, gpd.xs(activeIdx), perParticleEng,
                   neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(),
                   state->devManager.prop.warpSize, nullptr, 0, state->boundsGPU,
-                  neighborCoefs[0], neighborCoefs[1], neighborCoefs[2],  gpd.qs(activeIdx), r_cut, nThreadPerBlock(), nThreadPerAtom());
+                  neighborCoefs[0], neighborCoefs[1], neighborCoefs[2],  gpd.qs(activeIdx), r_cut, nThreadPerBlock(), nThreadPerAtom(), grid.compressedNeighborlist());
 
 }
 
@@ -95,12 +115,12 @@ void FixChargePairDSF::singlePointEngGroupGroup(float * perParticleEng, uint32_t
     GPUData &gpd = state->gpd;
     GridGPU &grid = state->gridGPU;
     int activeIdx = gpd.activeIdx();
-    uint16_t *neighborCounts = grid.perAtomArray.d_data.data();
+    uint16_t *neighborCounts = grid.neighborCounts(getNeighborRCut());
     float *neighborCoefs = state->specialNeighborCoefs;
     evalWrap->energyGroupGroup(nAtoms,nPerRingPoly, gpd.xs(activeIdx), gpd.fs(activeIdx), perParticleEng,
                   neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(),
                   state->devManager.prop.warpSize, nullptr, 0, state->boundsGPU,
-                  neighborCoefs[0], neighborCoefs[1], neighborCoefs[2],  gpd.qs(activeIdx), r_cut, tagA, tagB, nThreadPerBlock(), nThreadPerAtom());
+                  neighborCoefs[0], neighborCoefs[1], neighborCoefs[2],  gpd.qs(activeIdx), r_cut, tagA, tagB, nThreadPerBlock(), nThreadPerAtom(), grid.compressedNeighborlist());
 
 }
 
@@ -29,7 +29,9 @@ public:
     bool prepareForRun();
     void setParameters(float alpha_, float r_cut_);
     void compute(int);
+    void computeHost(int);
     void singlePointEng(float *);
+    void singlePointEngHost(float *);
     void singlePointEngGroupGroup(float *, uint32_t, uint32_t);
     ChargeEvaluatorDSF generateEvaluator();
     void setEvalWrapper();
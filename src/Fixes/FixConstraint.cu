@@ -0,0 +1,106 @@
+#include "FixConstraint.h"
+
+#include "State.h"
+#include "FixBondHarmonic.h"
+#include "boost_for_export.h"
+#include "cutils_math.h"
+#include "Logging.h"
+#include "globalDefs.h"
+namespace py = boost::python;
+
+FixConstraint::FixConstraint(boost::shared_ptr<State> state_, std::string handle_, std::string type_) : Fix(state_, handle_, "all", type_, false, false, false, 1) {
+}
+
+__global__ void saveConstraintVectors(int nConstraints, int2 *ids, int *idToIdxs, float4 *xs, float4 *refs, BoundsGPU bounds) {
+    int idx = GETIDX();
+    if (idx < nConstraints) {
+        int2 constraint = ids[idx];
+        float3 r = bounds.minImage(make_float3(xs[idToIdxs[constraint.x]]) - make_float3(xs[idToIdxs[constraint.y]]));
+        refs[idx] = make_float4(r.x, r.y, r.z, 0.0f);
+    }
+}
+
+void FixConstraint::createConstraint(int idA, int idB, double length) {
+    mdAssert(idA != idB, "Cannot constrain atom %d to itself", idA);
+    mdAssert(length > 0, "Constraint length between atoms %d and %d must be positive", idA, idB);
+    constraintIds.push_back(make_int2(idA, idB));
+    constraintLengths.push_back(length);
+    Bond bond;
+    bond.ids = { {idA, idB} };
+    bonds.push_back(bond);
+}
+
+void FixConstraint::constrainBonds(boost::shared_ptr<FixBondHarmonic> bondFix, double massCutoff) {
+    //these atoms are already excluded by the bond fix, so they are not added to bonds
+    int nAdded = 0;
+    for (BondVariant &bondVar : bondFix->bonds) {
+        BondHarmonic &bond = boost::get<BondHarmonic>(bondVar);
+        if (massCutoff > 0) {
+            double massA = state->idToAtom(bond.ids[0]).mass;
+            double massB = state->idToAtom(bond.ids[1]).mass;
+            if (massA >= massCutoff and massB >= massCutoff) {
+                continue;
+            }
+        }
+        double r0 = bond.r0;
+        auto it = bondFix->bondTypes.find(bond.type);
+        if (bond.type != -1 and it != bondFix->bondTypes.end()) {
+            r0 = it->second.r0;
+        }
+        mdAssert(r0 > 0, "Bond between atoms %d and %d has no equilibrium length to constrain to", bond.ids[0], bond.ids[1]);
+        constraintIds.push_back(make_int2(bond.ids[0], bond.ids[1]));
+        constraintLengths.push_back(r0);
+        nAdded++;
+    }
+    mdMessage("Fix%s %s constrained %d bonds of fix %s\n", type.c_str(), handle.c_str(), nAdded, bondFix->handle.c_str());
+}
+
+void FixConstraint::setConstraintsGPU(std::vector<int> &order) {
+    int nConstraints = order.size();
+    std::vector<int2> idsSorted(nConstraints);
+    std::vector<float> lengthsSorted(nConstraints);
+    for (int i=0; i<nConstraints; i++) {
+        int2 c = constraintIds[order[i]];
+        mdAssert(state->idToIdx[c.x] != -1 and state->idToIdx[c.y] != -1, "Constrained atoms %d and %d must exist", c.x, c.y);
+        idsSorted[i] = c;
+        lengthsSorted[i] = constraintLengths[order[i]];
+    }
+    idsGPU = GPUArrayDeviceGlobal<int2>(nConstraints);
+    idsGPU.set(idsSorted.data());
+    lengthsGPU = GPUArrayDeviceGlobal<float>(nConstraints);
+    lengthsGPU.set(lengthsSorted.data());
+    refs = GPUArrayDeviceGlobal<float4>(nConstraints);
+}
+
+int FixConstraint::removeNDF() {
+    return constraintIds.size();
+}
+
+bool FixConstraint::stepInit() {
+    int nConstraints = idsGPU.size();
+    if (nConstraints) {
+        GPUData &gpd = state->gpd;
+        int activeIdx = gpd.activeIdx();
+        saveConstraintVectors<<<NBLOCK(nConstraints), PERBLOCK>>>(nConstraints, idsGPU.data(), gpd.idToIdxs.d_data.data(),
+                                                                   gpd.xs(activeIdx), refs.data(), state->boundsGPU);
+    }
+    return true;
+}
+
+void export_FixConstraint()
+{
+    py::class_<FixConstraint,
+    boost::noncopyable,
+    py::bases<Fix> > (
+            "FixConstraint", py::no_init  )
+        .def("createConstraint", &FixConstraint::createConstraint,
+             (py::arg("idA"),
+              py::arg("idB"),
+              py::arg("length"))
+            )
+        .def("constrainBonds", &FixConstraint::constrainBonds,
+             (py::arg("bondFix"),
+              py::arg("massCutoff")=-1)
+            )
+        ;
+}
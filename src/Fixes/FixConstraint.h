@@ -0,0 +1,76 @@
+#pragma once
+#ifndef FIXCONSTRAINT_H
+#define FIXCONSTRAINT_H
+
+#undef _XOPEN_SOURCE
+#undef _POSIX_C_SOURCE
+#include "Python.h"
+#include "Fix.h"
+#include "Bond.h"
+#undef _XOPEN_SOURCE
+#undef _POSIX_C_SOURCE
+#include <boost/python.hpp>
+#include "GPUArrayDeviceGlobal.h"
+#include "globalDefs.h"
+
+class FixBondHarmonic;
+
+void export_FixConstraint();
+
+//! Inverse mass of an atom from its velocity.  Atoms with infinite mass are not moved by constraints
+inline __host__ __device__ float invMassOf(float4 vel) {
+    return vel.w > INVMASSBOOL ? 0.0f : vel.w;
+}
+
+//! Base class for fixes holding pairs of atoms at fixed distances
+/*!
+ * Stores the constraints given from python, saves the bond vectors at the
+ * start of each step (stepInit) for the solvers to constrain along, and
+ * removes one degree of freedom per constraint.  Solvers constrain positions
+ * in postNVE_X and velocities in stepFinal.
+ */
+class FixConstraint : public Fix {
+    protected:
+        std::vector<int2> constraintIds; //!< Atom ids of each constraint, as given
+        std::vector<float> constraintLengths; //!< Length of each constraint, as given
+        std::vector<BondVariant> bonds; //!< Constraints as bonds, so they are excluded like bonds
+
+        GPUArrayDeviceGlobal<int2> idsGPU; //!< Atom ids of each constraint, in the solver's order
+        GPUArrayDeviceGlobal<float> lengthsGPU;
+        GPUArrayDeviceGlobal<float4> refs; //!< Bond vectors at the start of the step.  w is free for the solver
+
+        //! Send constraints to the device in the given order
+        void setConstraintsGPU(std::vector<int> &order);
+
+    public:
+        FixConstraint(boost::shared_ptr<State> state_, std::string handle_, std::string type_);
+
+        //! Constrain two atoms to a distance
+        /*!
+         * \param idA Id of the first atom
+         * \param idB Id of the second atom
+         * \param length Constrained distance
+         */
+        void createConstraint(int idA, int idB, double length);
+
+        //! Constrain bonds of a harmonic bond fix to their equilibrium length
+        /*!
+         * \param bondFix Fix holding the bonds
+         * \param massCutoff Only bonds with an atom lighter than this are
+         *                   constrained, such as bonds to hydrogen.  If
+         *                   negative, all bonds are constrained
+         */
+        void constrainBonds(boost::shared_ptr<FixBondHarmonic> bondFix, double massCutoff);
+
+        //! Save the bond vectors of the constrained, start of step positions
+        bool stepInit();
+
+        //! Removes one degree of freedom per constraint
+        int removeNDF();
+
+        std::vector<BondVariant> *getBonds() {
+            return &bonds;
+        }
+};
+
+#endif
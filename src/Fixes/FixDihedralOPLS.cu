@@ -22,9 +22,12 @@ void FixDihedralOPLS::compute(int virialMode) {
     GPUData &gpd = state->gpd;
     if (forcersGPU.size()) {
         if (virialMode) {
-            compute_force_dihedral<DihedralOPLSType, DihedralEvaluatorOPLS, true><<<NBLOCK(forcersGPU.size()), PERBLOCK, sharedMemSizeForParams >>>(forcersGPU.size(), gpd.xs(activeIdx), gpd.fs(activeIdx), gpd.idToIdxs.d_data.data(), forcersGPU.data(), state->boundsGPU, parameters.data(), parameters.size(), gpd.virials.d_data.data(), usingSharedMemForParams, evaluator);
+            compute_force_dihedral<DihedralOPLSType, DihedralEvaluatorOPLS, true><<<NBLOCK(forcersGPU.size()), PERBLOCK, sharedMemSizeForParams >>>(forcersGPU.size(), gpd.xs(activeIdx), gpd.fs(activeIdx), gpd.idToIdxs.d_data.data(), forcersGPU.data(), state->boundsGPU, parameters.data(), parameters.size(), gpd.virials.d_data.data(), fsFixed(), virialsFixed(), usingSharedMemForParams, evaluator);
         } else {
-            compute_force_dihedral<DihedralOPLSType, DihedralEvaluatorOPLS, false><<<NBLOCK(forcersGPU.size()), PERBLOCK, sharedMemSizeForParams >>>(forcersGPU.size(), gpd.xs(activeIdx), gpd.fs(activeIdx), gpd.idToIdxs.d_data.data(), forcersGPU.data(), state->boundsGPU, parameters.data(), parameters.size(), gpd.virials.d_data.data(), usingSharedMemForParams, evaluator);
+            compute_force_dihedral<DihedralOPLSType, DihedralEvaluatorOPLS, false><<<NBLOCK(forcersGPU.size()), PERBLOCK, sharedMemSizeForParams >>>(forcersGPU.size(), gpd.xs(activeIdx), gpd.fs(activeIdx), gpd.idToIdxs.d_data.data(), forcersGPU.data(), state->boundsGPU, parameters.data(), parameters.size(), gpd.virials.d_data.data(), fsFixed(), virialsFixed(), usingSharedMemForParams, evaluator);
+        }
+        if (fixedPointScratch.size()) {
+            addFixedPointForces<<<NBLOCK(nAtoms), PERBLOCK>>>(nAtoms, gpd.fs(activeIdx), virialMode ? gpd.virials.d_data.data() : nullptr, fixedPointScratch.data(), virialsFixed());
         }
     }
 
@@ -36,7 +39,10 @@ void FixDihedralOPLS::singlePointEng(float *perParticleEng) {
 
     GPUData &gpd = state->gpd;
     if (forcersGPU.size()) {
-        compute_energy_dihedral<<<NBLOCK(forcersGPU.size()), PERBLOCK, sharedMemSizeForParams>>>(forcersGPU.size(), gpd.xs(activeIdx), perParticleEng, gpd.idToIdxs.d_data.data(), forcersGPU.data(), state->boundsGPU, parameters.data(), parameters.size(), usingSharedMemForParams, evaluator);
+        compute_energy_dihedral<<<NBLOCK(forcersGPU.size()), PERBLOCK, sharedMemSizeForParams>>>(forcersGPU.size(), gpd.xs(activeIdx), perParticleEng, engsFixed(), gpd.idToIdxs.d_data.data(), forcersGPU.data(), state->boundsGPU, parameters.data(), parameters.size(), usingSharedMemForParams, evaluator);
+        if (engsFixed()) {
+            addFixedPointEngs<<<NBLOCK(nAtoms), PERBLOCK>>>(nAtoms, perParticleEng, engsFixed());
+        }
     }
 
 }
@@ -72,7 +72,8 @@ __global__ void printNlist_E3B3(int* molIdToIdxs,
                                 float4* xs,
                                 float4* fs, 
                                 BoundsGPU bounds,
-                                int nMolecules) {
+                                int nMolecules,
+                                NeighborlistCompressed compressed) {
     int idx = GETIDX();
     
     if (idx < nMolecules) {
@@ -86,6 +87,7 @@ __global__ void printNlist_E3B3(int* molIdToIdxs,
         printf("this Idx %d this id %d idx %d", thisIdx, waterMolecIds[idx], idx);
         //int baseIdx = baseNeighlistIdx(cumulSumMaxPerBlock, warpSize);
         int baseIdx = baseNeighlistIdxFromIndex(cumulSumMaxPerBlock, warpSize, thisIdx);
+        int baseIdxCompressed = compressed.words ? baseNeighlistIdxFromIndex(compressed.cumulSumMaxPerBlock, warpSize, thisIdx) : 0;
         int numNeighMolecules = neighborCounts[thisIdx];
         //int numNeighMolecules = neighborCounts[idx];
 
@@ -114,9 +116,9 @@ __global__ void printNlist_E3B3(int* molIdToIdxs,
         int numNeigh = neighborCounts[thisIdx];
 
         int counter = 0;
+        NeighborReader neighbors(neighborlist, compressed, baseIdx, baseIdxCompressed, warpSize);
         for (int i = 0; i < numNeigh; i++) {
-            int nlistIdx = baseIdx + warpSize*i;
-            uint otherIdxRaw = neighborlist[nlistIdx];
+            uint otherIdxRaw = neighbors.next();
 
             int moleculeIds = waterMolecIds[otherIdxRaw];
 
@@ -272,7 +274,8 @@ void FixE3B3::compute(int VirialMode) {
             gpdGlobal.fs(globalActiveIdx),
             state->boundsGPU, 
             gpdGlobal.virials.d_data.data(),
-            evaluator);
+            evaluator,
+            gridGPULocal.compressedNeighborlist());
     } else {
         compute_E3B3<EvaluatorE3B3, false> <<<NBLOCK(nMolecules), PERBLOCK>>> (
             nMolecules, 
@@ -288,7 +291,8 @@ void FixE3B3::compute(int VirialMode) {
             gpdGlobal.fs(globalActiveIdx),
             state->boundsGPU, 
             gpdGlobal.virials.d_data.data(),
-            evaluator);
+            evaluator,
+            gridGPULocal.compressedNeighborlist());
     };
 }
 
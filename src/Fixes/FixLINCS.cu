@@ -0,0 +1,292 @@
+#include "FixLINCS.h"
+
+#include <map>
+#include <numeric>
+
+#include "State.h"
+#include "boost_for_export.h"
+#include "cutils_math.h"
+#include "cutils_func.h"
+#include "helpers.h"
+#include "Logging.h"
+#include "globalDefs.h"
+namespace py = boost::python;
+const std::string LINCSType = "LINCS";
+
+enum LINCS_RHS {LINCS_RHS_POSITIONS, LINCS_RHS_ROTATION, LINCS_RHS_VELOCITIES};
+
+FixLINCS::FixLINCS(boost::shared_ptr<State> state_, std::string handle_, int order_, int nIterations_) : FixConstraint(state_, handle_, LINCSType), order(order_), nIterations(nIterations_) {
+    nAtomsConstrained = 0;
+}
+
+__global__ void lincsDirections(int nConstraints, int2 *ids, int *idToIdxs, float4 *xs, float4 *refs, float4 *dirs, BoundsGPU bounds, bool useRefs) {
+    int idx = GETIDX();
+    if (idx < nConstraints) {
+        float3 r;
+        if (useRefs) {
+            r = make_float3(refs[idx]);
+        } else {
+            int2 constraint = ids[idx];
+            r = bounds.minImage(make_float3(xs[idToIdxs[constraint.x]]) - make_float3(xs[idToIdxs[constraint.y]]));
+        }
+        r *= rsqrtf(lengthSqr(r));
+        dirs[idx] = make_float4(r.x, r.y, r.z, 0.0f);
+    }
+}
+
+__global__ void lincsMatrix(int nConstraints, int *couplingIdxs, int *couplings, float *couplingCoefs, float4 *dirs, float *matrix) {
+    int idx = GETIDX();
+    if (idx < nConstraints) {
+        float3 dir = make_float3(dirs[idx]);
+        for (int i=couplingIdxs[idx]; i<couplingIdxs[idx+1]; i++) {
+            matrix[i] = couplingCoefs[i] * dot(dir, make_float3(dirs[couplings[i]]));
+        }
+    }
+}
+
+template <int MODE>
+__global__ void lincsRhs(int nConstraints, int2 *ids, int *idToIdxs, float4 *xs, float4 *vs, float4 *dirs, float *lengths,
+                         float *invSqrtMassSums, float *rhs, float *sol, BoundsGPU bounds) {
+    int idx = GETIDX();
+    if (idx < nConstraints) {
+        int2 constraint = ids[idx];
+        int idxA = idToIdxs[constraint.x];
+        int idxB = idToIdxs[constraint.y];
+        float3 dir = make_float3(dirs[idx]);
+        float res;
+        if (MODE == LINCS_RHS_VELOCITIES) {
+            res = dot(dir, make_float3(vs[idxA]) - make_float3(vs[idxB]));
+        } else {
+            float3 r = bounds.minImage(make_float3(xs[idxA]) - make_float3(xs[idxB]));
+            float length = lengths[idx];
+            if (MODE == LINCS_RHS_POSITIONS) {
+                res = dot(dir, r) - length;
+            } else {
+                //length the bond would have along dir if it had rotated without stretching
+                float p = sqrtf(fmaxf(2.0f * length * length - lengthSqr(r), 0.0f));
+                res = length - p;
+            }
+        }
+        res *= invSqrtMassSums[idx];
+        rhs[idx] = res;
+        sol[idx] = res;
+    }
+}
+
+__global__ void lincsExpand(int nConstraints, int *couplingIdxs, int *couplings, float *matrix, float *rhsIn, float *rhsOut, float *sol) {
+    int idx = GETIDX();
+    if (idx < nConstraints) {
+        float sum = 0;
+        for (int i=couplingIdxs[idx]; i<couplingIdxs[idx+1]; i++) {
+            sum += matrix[i] * rhsIn[couplings[i]];
+        }
+        rhsOut[idx] = sum;
+        sol[idx] += sum;
+    }
+}
+
+//one thread per constrained atom, gathering the corrections of its constraints
+template <bool POSITIONS>
+__global__ void lincsUpdate(int nAtomsConstrained, int *atomIds, int *atomConstraintIdxs, int2 *atomConstraints,
+                            int *idToIdxs, float4 *xs, float4 *vs, Virial *virials, float4 *dirs, float4 *refs,
+                            float *invSqrtMassSums, float *sol, float invDt, float virialScale) {
+    int idx = GETIDX();
+    if (idx < nAtomsConstrained) {
+        int atomIdx = idToIdxs[atomIds[idx]];
+        float4 vel = vs[atomIdx];
+        float invMass = invMassOf(vel);
+        float3 delta = make_float3(0, 0, 0);
+        Virial virial(0, 0, 0, 0, 0, 0);
+        for (int i=atomConstraintIdxs[idx]; i<atomConstraintIdxs[idx+1]; i++) {
+            int2 c = atomConstraints[i];
+            float3 d = make_float3(dirs[c.x]) * (-c.y * invSqrtMassSums[c.x] * sol[c.x]);
+            delta += d;
+            if (POSITIONS and virialScale != 0) {
+                computeVirial(virial, d * virialScale, make_float3(refs[c.x]) * (float) c.y);
+            }
+        }
+        delta *= invMass;
+        if (POSITIONS) {
+            float4 pos = xs[atomIdx];
+            pos += delta;
+            xs[atomIdx] = pos;
+            float3 dv = delta * invDt;
+            vel += dv;
+            if (virialScale != 0) {
+                virial *= 0.5f;
+                virials[atomIdx] += virial;
+            }
+        } else {
+            vel += delta;
+        }
+        vs[atomIdx] = vel;
+    }
+}
+
+bool FixLINCS::prepareForRun() {
+    mdAssert(order >= 0 and nIterations >= 0, "FixLINCS order and nIterations must not be negative");
+    int nConstraints = constraintIds.size();
+    std::vector<int> order_(nConstraints);
+    std::iota(order_.begin(), order_.end(), 0);
+    setConstraintsGPU(order_);
+
+    //constraints of each atom, as (constraint, sign)
+    std::map<int, std::vector<int2> > constraintsOfAtom;
+    for (int i=0; i<nConstraints; i++) {
+        constraintsOfAtom[constraintIds[i].x].push_back(make_int2(i, 1));
+        constraintsOfAtom[constraintIds[i].y].push_back(make_int2(i, -1));
+    }
+    //inverse masses as the kernels see them in vs.w, so atoms of infinite mass count as immovable here too
+    GPUData &gpd = state->gpd;
+    auto invMassOfId = [&] (int id) {
+        return (double) invMassOf(gpd.vs.h_data[gpd.idToIdxsOnCopy[id]]);
+    };
+    std::vector<float> invSqrtMassSumsHost(nConstraints);
+    for (int i=0; i<nConstraints; i++) {
+        double invMassSum = invMassOfId(constraintIds[i].x) + invMassOfId(constraintIds[i].y);
+        invSqrtMassSumsHost[i] = invMassSum > 0 ? 1.0 / sqrt(invMassSum) : 0;
+    }
+
+    //coupling coefficients, -S_i S_j sign_i sign_j / m for constraints i and j sharing an atom
+    std::vector<std::vector<std::pair<int, float> > > couplingsOf(nConstraints);
+    std::vector<int> atomIdsHost;
+    std::vector<int> atomConstraintIdxsHost(1, 0);
+    std::vector<int2> atomConstraintsHost;
+    for (auto &it : constraintsOfAtom) {
+        double invMass = invMassOfId(it.first);
+        std::vector<int2> &cs = it.second;
+        for (int2 a : cs) {
+            for (int2 b : cs) {
+                if (a.x != b.x) {
+                    float coef = -invSqrtMassSumsHost[a.x] * invSqrtMassSumsHost[b.x] * a.y * b.y * invMass;
+                    couplingsOf[a.x].push_back(std::make_pair(b.x, coef));
+                }
+            }
+        }
+        atomIdsHost.push_back(it.first);
+        atomConstraintsHost.insert(atomConstraintsHost.end(), cs.begin(), cs.end());
+        atomConstraintIdxsHost.push_back(atomConstraintsHost.size());
+    }
+    std::vector<int> couplingIdxsHost(1, 0);
+    std::vector<int> couplingsHost;
+    std::vector<float> couplingCoefsHost;
+    for (int i=0; i<nConstraints; i++) {
+        for (auto &c : couplingsOf[i]) {
+            couplingsHost.push_back(c.first);
+            couplingCoefsHost.push_back(c.second);
+        }
+        couplingIdxsHost.push_back(couplingsHost.size());
+    }
+    nAtomsConstrained = atomIdsHost.size();
+
+    invSqrtMassSums = GPUArrayDeviceGlobal<float>(nConstraints);
+    invSqrtMassSums.set(invSqrtMassSumsHost.data());
+    couplingIdxs = GPUArrayDeviceGlobal<int>(nConstraints+1);
+    couplingIdxs.set(couplingIdxsHost.data());
+    couplings = GPUArrayDeviceGlobal<int>(couplingsHost.size());
+    couplings.set(couplingsHost.data());
+    couplingCoefs = GPUArrayDeviceGlobal<float>(couplingCoefsHost.size());
+    couplingCoefs.set(couplingCoefsHost.data());
+    matrix = GPUArrayDeviceGlobal<float>(couplingsHost.size());
+    dirs = GPUArrayDeviceGlobal<float4>(nConstraints);
+    rhs[0] = GPUArrayDeviceGlobal<float>(nConstraints);
+    rhs[1] = GPUArrayDeviceGlobal<float>(nConstraints);
+    sol = GPUArrayDeviceGlobal<float>(nConstraints);
+    atomIds = GPUArrayDeviceGlobal<int>(nAtomsConstrained);
+    atomIds.set(atomIdsHost.data());
+    atomConstraintIdxs = GPUArrayDeviceGlobal<int>(nAtomsConstrained+1);
+    atomConstraintIdxs.set(atomConstraintIdxsHost.data());
+    atomConstraints = GPUArrayDeviceGlobal<int2>(atomConstraintsHost.size());
+    atomConstraints.set(atomConstraintsHost.data());
+
+    //bring the starting configuration onto the constraints without changing velocities, then remove velocities along them
+    if (nConstraints) {
+        stepInit();
+        constrainPositions(0, false);
+        constrainVelocities();
+    }
+    prepared = true;
+    return prepared;
+}
+
+void FixLINCS::solve() {
+    int nConstraints = idsGPU.size();
+    for (int i=0; i<order; i++) {
+        lincsExpand<<<NBLOCK(nConstraints), PERBLOCK>>>(nConstraints, couplingIdxs.data(), couplings.data(), matrix.data(),
+                                                        rhs[i%2].data(), rhs[(i+1)%2].data(), sol.data());
+    }
+}
+
+void FixLINCS::constrainPositions(float invDt, bool computeVirials) {
+    GPUData &gpd = state->gpd;
+    int activeIdx = gpd.activeIdx();
+    int nConstraints = idsGPU.size();
+    float dt = state->dt;
+    //the constraint force moving an atom by delta over the step is 2*m*delta/dt^2
+    float virialScale = computeVirials ? 2.0f / (dt * dt * state->units.ftm_to_v) : 0.0f;
+
+    lincsDirections<<<NBLOCK(nConstraints), PERBLOCK>>>(nConstraints, idsGPU.data(), gpd.idToIdxs.d_data.data(), gpd.xs(activeIdx),
+                                                        refs.data(), dirs.data(), state->boundsGPU, true);
+    lincsMatrix<<<NBLOCK(nConstraints), PERBLOCK>>>(nConstraints, couplingIdxs.data(), couplings.data(), couplingCoefs.data(),
+                                                    dirs.data(), matrix.data());
+    for (int i=0; i<nIterations+1; i++) {
+        if (i == 0) {
+            lincsRhs<LINCS_RHS_POSITIONS><<<NBLOCK(nConstraints), PERBLOCK>>>(nConstraints, idsGPU.data(), gpd.idToIdxs.d_data.data(),
+                    gpd.xs(activeIdx), gpd.vs(activeIdx), dirs.data(), lengthsGPU.data(), invSqrtMassSums.data(),
+                    rhs[0].data(), sol.data(), state->boundsGPU);
+        } else {
+            lincsRhs<LINCS_RHS_ROTATION><<<NBLOCK(nConstraints), PERBLOCK>>>(nConstraints, idsGPU.data(), gpd.idToIdxs.d_data.data(),
+                    gpd.xs(activeIdx), gpd.vs(activeIdx), dirs.data(), lengthsGPU.data(), invSqrtMassSums.data(),
+                    rhs[0].data(), sol.data(), state->boundsGPU);
+        }
+        solve();
+        lincsUpdate<true><<<NBLOCK(nAtomsConstrained), PERBLOCK>>>(nAtomsConstrained, atomIds.data(), atomConstraintIdxs.data(),
+                atomConstraints.data(), gpd.idToIdxs.d_data.data(), gpd.xs(activeIdx), gpd.vs(activeIdx),
+                gpd.virials.d_data.data(), dirs.data(), refs.data(), invSqrtMassSums.data(), sol.data(), invDt, virialScale);
+    }
+}
+
+void FixLINCS::constrainVelocities() {
+    GPUData &gpd = state->gpd;
+    int activeIdx = gpd.activeIdx();
+    int nConstraints = idsGPU.size();
+    lincsDirections<<<NBLOCK(nConstraints), PERBLOCK>>>(nConstraints, idsGPU.data(), gpd.idToIdxs.d_data.data(), gpd.xs(activeIdx),
+                                                        refs.data(), dirs.data(), state->boundsGPU, false);
+    lincsMatrix<<<NBLOCK(nConstraints), PERBLOCK>>>(nConstraints, couplingIdxs.data(), couplings.data(), couplingCoefs.data(),
+                                                    dirs.data(), matrix.data());
+    lincsRhs<LINCS_RHS_VELOCITIES><<<NBLOCK(nConstraints), PERBLOCK>>>(nConstraints, idsGPU.data(), gpd.idToIdxs.d_data.data(),
+            gpd.xs(activeIdx), gpd.vs(activeIdx), dirs.data(), lengthsGPU.data(), invSqrtMassSums.data(),
+            rhs[0].data(), sol.data(), state->boundsGPU);
+    solve();
+    lincsUpdate<false><<<NBLOCK(nAtomsConstrained), PERBLOCK>>>(nAtomsConstrained, atomIds.data(), atomConstraintIdxs.data(),
+            atomConstraints.data(), gpd.idToIdxs.d_data.data(), gpd.xs(activeIdx), gpd.vs(activeIdx),
+            gpd.virials.d_data.data(), dirs.data(), refs.data(), invSqrtMassSums.data(), sol.data(), 0, 0);
+}
+
+bool FixLINCS::postNVE_X() {
+    if (idsGPU.size()) {
+        int virialMode = state->dataManager.getVirialModeForTurn(state->turn);
+        constrainPositions(1.0f / state->dt, virialMode == 1 or virialMode == 2);
+    }
+    return true;
+}
+
+bool FixLINCS::stepFinal() {
+    if (idsGPU.size()) {
+        constrainVelocities();
+    }
+    return true;
+}
+
+void export_FixLINCS()
+{
+    py::class_<FixLINCS, boost::shared_ptr<FixLINCS>, py::bases<FixConstraint> >
+        (
+         "FixLINCS",
+         py::init<boost::shared_ptr<State>, std::string, py::optional<int, int> >
+            (py::args("state", "handle", "order", "nIterations"))
+        )
+        .def_readwrite("order", &FixLINCS::order)
+        .def_readwrite("nIterations", &FixLINCS::nIterations)
+        ;
+}
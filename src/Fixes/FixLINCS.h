@@ -0,0 +1,63 @@
+#pragma once
+#ifndef FIXLINCS_H
+#define FIXLINCS_H
+
+#include "FixConstraint.h"
+
+void export_FixLINCS();
+
+//! Fix constraining bond lengths with the parallel linear constraint solver
+/*!
+ * Implements P-LINCS (Hess, J. Chem. Theory Comput. 4, 116 (2008)).  The
+ * constraint equations are inverted with a truncated series expansion of the
+ * coupling matrix between constraints sharing atoms, followed by nIterations
+ * corrections for the rotation of the bonds.  Every constraint and every
+ * constrained atom is handled by its own thread, and the cost per step is
+ * fixed by order and nIterations, so long coupled chains such as polymer
+ * backbones cost no more per constraint than isolated bonds.  Positions are
+ * constrained after the position update (postNVE_X) and velocities at the
+ * end of the step (stepFinal).
+ */
+class FixLINCS : public FixConstraint {
+    private:
+        GPUArrayDeviceGlobal<float> invSqrtMassSums; //!< 1/sqrt(1/m_a + 1/m_b) for each constraint
+        GPUArrayDeviceGlobal<int> couplingIdxs; //!< Index of the first coupling of each constraint, nConstraints+1 entries
+        GPUArrayDeviceGlobal<int> couplings; //!< Constraints sharing an atom with each constraint
+        GPUArrayDeviceGlobal<float> couplingCoefs; //!< Mass factors of the couplings
+        GPUArrayDeviceGlobal<float> matrix; //!< Coupling matrix elements for the current bond directions
+        GPUArrayDeviceGlobal<float4> dirs; //!< Unit vector of each constraint
+        GPUArrayDeviceGlobal<float> rhs[2];
+        GPUArrayDeviceGlobal<float> sol;
+        int nAtomsConstrained;
+        GPUArrayDeviceGlobal<int> atomIds; //!< Ids of the constrained atoms
+        GPUArrayDeviceGlobal<int> atomConstraintIdxs; //!< Index of the first constraint of each constrained atom, nAtomsConstrained+1 entries
+        GPUArrayDeviceGlobal<int2> atomConstraints; //!< Constraint index and sign (+1 for the first atom, -1 for the second) for each atom
+
+        //! Invert the constraint equations for the current right hand side, leaving the result in sol
+        void solve();
+
+        //! Constrain positions along the start of step bond vectors
+        void constrainPositions(float invDt, bool computeVirials);
+
+        //! Remove velocity components along the current bond vectors
+        void constrainVelocities();
+
+    public:
+        //! Constructor
+        /*!
+         * \param state Pointer to the simulation state
+         * \param handle "Name" of the Fix
+         * \param order Number of terms of the matrix expansion
+         * \param nIterations Number of corrections for bond rotation
+         */
+        FixLINCS(boost::shared_ptr<State> state_, std::string handle_, int order=4, int nIterations=1);
+
+        bool prepareForRun();
+        bool postNVE_X();
+        bool stepFinal();
+
+        int order; //!< Number of terms of the matrix expansion
+        int nIterations; //!< Number of corrections for bond rotation
+};
+
+#endif
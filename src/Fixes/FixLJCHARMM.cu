@@ -7,6 +7,7 @@
 #include "cutils_func.h"
 #include "ReadConfig.h"
 #include "EvaluatorWrapper.h"
+#include "PairEvaluatorFused.h"
 #include "PairEvaluatorCHARMM.h"
 #include "EvaluatorWrapper.h"
 //#include "ChargeEvaluatorEwald.h"
@@ -29,6 +30,7 @@ FixLJCHARMM::FixLJCHARMM(boost::shared_ptr<State> state_, string handle_, string
     paramOrder = {rCutHandle, epsHandle, sigHandle, eps14Handle, sig14Handle};
     readFromRestart();
     canAcceptChargePairCalc = true;
+    canRunOnHost = true;
     setEvalWrapper();
 }
 
@@ -42,14 +44,35 @@ void FixLJCHARMM::compute(int virialMode) {
     GPUData &gpd = state->gpd;
     GridGPU &grid = state->gridGPU;
     int activeIdx = gpd.activeIdx();
-    uint16_t *neighborCounts = grid.perAtomArray.d_data.data();
+    uint16_t *neighborCounts = grid.neighborCounts(getNeighborRCut());
     auto neighborCoefs = state->specialNeighborCoefs;
-    evalWrap->compute(nAtoms,nPerRingPoly, gpd.xs(activeIdx), gpd.fs(activeIdx),
+    evalWrap->compute(nAtoms,nPerRingPoly, gpd.xs(activeIdx), gpd.fs(activeIdx), gpd.fsFixed.data(),
                       neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(),
-                      state->devManager.prop.warpSize, paramsCoalesced.data(), numTypes, state->boundsGPU,
-                      neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.virials.d_data.data(), gpd.qs(activeIdx), chargeRCut, virialMode, nThreadPerBlock(), nThreadPerAtom());
+                      state->devManager.prop.warpSize, evalParams(), numTypes, state->boundsGPU,
+                      neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.virials.d_data.data(), gpd.qs(activeIdx), chargeRCut, virialMode, nThreadPerBlock(), nThreadPerAtom(), grid.compressedNeighborlist());
 
 }
+void FixLJCHARMM::computeHost(int virialMode) {
+    int nAtoms = state->atoms.size();
+    int numTypes = state->atomParams.numTypes;
+    GPUData &gpd = state->gpd;
+    GridGPU &grid = state->gridGPU;
+    float *neighborCoefs = state->specialNeighborCoefs;
+    evalWrap->computeHost(nAtoms, grid, gpd.xs.h_data.data(), gpd.fs.h_data.data(),
+                          evalParamsHost(), numTypes, state->boundsGPU,
+                          neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.virials.h_data.data(), gpd.qs.h_data.data(), chargeRCut, virialMode);
+}
+
+void FixLJCHARMM::singlePointEngHost(float *perParticleEng) {
+    int nAtoms = state->atoms.size();
+    int numTypes = state->atomParams.numTypes;
+    GPUData &gpd = state->gpd;
+    GridGPU &grid = state->gridGPU;
+    float *neighborCoefs = state->specialNeighborCoefs;
+    evalWrap->energyHost(nAtoms, grid, gpd.xs.h_data.data(), perParticleEng,
+                         evalParamsHost(), numTypes, state->boundsGPU,
+                         neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs.h_data.data(), chargeRCut);
+}
 
 void FixLJCHARMM::singlePointEng(float *perParticleEng) {
     int nAtoms = state->atoms.size();
@@ -59,10 +82,10 @@ void FixLJCHARMM::singlePointEng(float *perParticleEng) {
     GridGPU &grid = state->gridGPU;
     int activeIdx = gpd.activeIdx();
     auto neighborCoefs = state->specialNeighborCoefs;
-    uint16_t *neighborCounts = grid.perAtomArray.d_data.data();
+    uint16_t *neighborCounts = grid.neighborCounts(getNeighborRCut());
     //float neighborCoefs[4] = {1, 1, 1, 0}; //see comment above
     //evalWrap->energy(nAtoms,nPerRingPoly, gpd.xs(activeIdx), perParticleEng, neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(), state->devManager.prop.warpSize, paramsCoalesced.data(), numTypes, state->boundsGPU, neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs(activeIdx), chargeRCut);
-    evalWrap->energy(nAtoms,nPerRingPoly, gpd.xs(activeIdx), perParticleEng, neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(), state->devManager.prop.warpSize, paramsCoalesced.data(), numTypes, state->boundsGPU, neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs(activeIdx), chargeRCut, nThreadPerBlock(), nThreadPerAtom());
+    evalWrap->energy(nAtoms,nPerRingPoly, gpd.xs(activeIdx), perParticleEng, neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(), state->devManager.prop.warpSize, evalParams(), numTypes, state->boundsGPU, neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs(activeIdx), chargeRCut, nThreadPerBlock(), nThreadPerAtom(), grid.compressedNeighborlist());
 }
 
 
@@ -74,13 +97,21 @@ void FixLJCHARMM::singlePointEngGroupGroup(float *perParticleEng, uint32_t tagA,
     GridGPU &grid = state->gridGPU;
     int activeIdx = gpd.activeIdx();
     auto neighborCoefs = state->specialNeighborCoefs;
-    uint16_t *neighborCounts = grid.perAtomArray.d_data.data();
+    uint16_t *neighborCounts = grid.neighborCounts(getNeighborRCut());
     //float neighborCoefs[4] = {1, 1, 1, 0}; //see comment above
     //evalWrap->energy(nAtoms,nPerRingPoly, gpd.xs(activeIdx), perParticleEng, neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(), state->devManager.prop.warpSize, paramsCoalesced.data(), numTypes, state->boundsGPU, neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs(activeIdx), chargeRCut);
-    evalWrap->energyGroupGroup(nAtoms,nPerRingPoly, gpd.xs(activeIdx), gpd.fs(activeIdx), perParticleEng, neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(), state->devManager.prop.warpSize, paramsCoalesced.data(), numTypes, state->boundsGPU, neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs(activeIdx), chargeRCut, tagA, tagB, nThreadPerBlock(), nThreadPerAtom());
+    evalWrap->energyGroupGroup(nAtoms,nPerRingPoly, gpd.xs(activeIdx), gpd.fs(activeIdx), perParticleEng, neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(), state->devManager.prop.warpSize, evalParams(), numTypes, state->boundsGPU, neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs(activeIdx), chargeRCut, tagA, tagB, nThreadPerBlock(), nThreadPerAtom(), grid.compressedNeighborlist());
+}
+
+bool FixLJCHARMM::addToFused(EvaluatorFused &fused) {
+    fused.charmm = EvaluatorCHARMM(state->specialNeighborCoefs[2]);
+    return fused.add(PAIR_EVAL_CHARMM);
 }
 
 void FixLJCHARMM::setEvalWrapper() {
+    if (setFusedEvalWrapper()) {
+        return;
+    }
     if (evalWrapperMode == "offload") {
         EvaluatorCHARMM eval(state->specialNeighborCoefs[2]);
         evalWrap = pickEvaluator<EvaluatorCHARMM, 5, true>(eval, chargeCalcFix);
@@ -37,9 +37,11 @@ class FixLJCHARMM : public FixPair {
 
         //! Compute forces
         void compute(int);
+        void computeHost(int);
 
         //! Compute single point energy
         void singlePointEng(float *);
+        void singlePointEngHost(float *);
         void singlePointEngGroupGroup(float *, uint32_t, uint32_t);
 
         //! Prepare Fix
@@ -77,6 +79,7 @@ class FixLJCHARMM : public FixPair {
         std::vector<float> getRCuts();
     public:
         void setEvalWrapper();
+        bool addToFused(EvaluatorFused &fused);
         const std::string epsHandle; //!< Handle for parameter epsilon
         const std::string sigHandle; //!< Handle for parameter sigma
         const std::string eps14Handle; //!< Handle for parameter epsilon for 1-4 interactions
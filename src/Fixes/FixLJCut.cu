@@ -8,6 +8,7 @@
 #include "ReadConfig.h"
 #include "PairEvaluatorLJ.h"
 #include "EvaluatorWrapper.h"
+#include "PairEvaluatorFused.h"
 //#include "ChargeEvaluatorEwald.h"
 using namespace std;
 namespace py = boost::python;
@@ -26,6 +27,7 @@ FixLJCut::FixLJCut(boost::shared_ptr<State> state_, string handle_, string mixin
     paramOrder = {rCutHandle, epsHandle, sigHandle};
     readFromRestart();
     canAcceptChargePairCalc = true;
+    canRunOnHost = true;
     setEvalWrapper();
 }
 
@@ -36,14 +38,35 @@ void FixLJCut::compute(int virialMode) {
     GPUData &gpd = state->gpd;
     GridGPU &grid = state->gridGPU;
     int activeIdx = gpd.activeIdx();
-    uint16_t *neighborCounts = grid.perAtomArray.d_data.data();
+    uint16_t *neighborCounts = grid.neighborCounts(getNeighborRCut());
     float *neighborCoefs = state->specialNeighborCoefs;
-    evalWrap->compute(nAtoms, nPerRingPoly, gpd.xs(activeIdx), gpd.fs(activeIdx),
+    evalWrap->compute(nAtoms, nPerRingPoly, gpd.xs(activeIdx), gpd.fs(activeIdx), gpd.fsFixed.data(),
                       neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(),
-                      state->devManager.prop.warpSize, paramsCoalesced.data(), numTypes, state->boundsGPU,
-                      neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.virials.d_data.data(), gpd.qs(activeIdx), chargeRCut, virialMode, nThreadPerBlock(), nThreadPerAtom());
+                      state->devManager.prop.warpSize, evalParams(), numTypes, state->boundsGPU,
+                      neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.virials.d_data.data(), gpd.qs(activeIdx), chargeRCut, virialMode, nThreadPerBlock(), nThreadPerAtom(), grid.compressedNeighborlist());
 
 }
+void FixLJCut::computeHost(int virialMode) {
+    int nAtoms = state->atoms.size();
+    int numTypes = state->atomParams.numTypes;
+    GPUData &gpd = state->gpd;
+    GridGPU &grid = state->gridGPU;
+    float *neighborCoefs = state->specialNeighborCoefs;
+    evalWrap->computeHost(nAtoms, grid, gpd.xs.h_data.data(), gpd.fs.h_data.data(),
+                          evalParamsHost(), numTypes, state->boundsGPU,
+                          neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.virials.h_data.data(), gpd.qs.h_data.data(), chargeRCut, virialMode);
+}
+
+void FixLJCut::singlePointEngHost(float *perParticleEng) {
+    int nAtoms = state->atoms.size();
+    int numTypes = state->atomParams.numTypes;
+    GPUData &gpd = state->gpd;
+    GridGPU &grid = state->gridGPU;
+    float *neighborCoefs = state->specialNeighborCoefs;
+    evalWrap->energyHost(nAtoms, grid, gpd.xs.h_data.data(), perParticleEng,
+                         evalParamsHost(), numTypes, state->boundsGPU,
+                         neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs.h_data.data(), chargeRCut);
+}
 
 void FixLJCut::singlePointEng(float *perParticleEng) {
     int nAtoms = state->atoms.size();
@@ -52,9 +75,9 @@ void FixLJCut::singlePointEng(float *perParticleEng) {
     GPUData &gpd = state->gpd;
     GridGPU &grid = state->gridGPU;
     int activeIdx = gpd.activeIdx();
-    uint16_t *neighborCounts = grid.perAtomArray.d_data.data();
+    uint16_t *neighborCounts = grid.neighborCounts(getNeighborRCut());
     float *neighborCoefs = state->specialNeighborCoefs;
-    evalWrap->energy(nAtoms, nPerRingPoly, gpd.xs(activeIdx), perParticleEng, neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(), state->devManager.prop.warpSize, paramsCoalesced.data(), numTypes, state->boundsGPU, neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs(activeIdx), chargeRCut, nThreadPerBlock(), nThreadPerAtom());
+    evalWrap->energy(nAtoms, nPerRingPoly, gpd.xs(activeIdx), perParticleEng, neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(), state->devManager.prop.warpSize, evalParams(), numTypes, state->boundsGPU, neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs(activeIdx), chargeRCut, nThreadPerBlock(), nThreadPerAtom(), grid.compressedNeighborlist());
 }
 
 void FixLJCut::singlePointEngGroupGroup(float *perParticleEng, uint32_t tagA, uint32_t tagB) {
@@ -64,12 +87,19 @@ void FixLJCut::singlePointEngGroupGroup(float *perParticleEng, uint32_t tagA, ui
     GPUData &gpd = state->gpd;
     GridGPU &grid = state->gridGPU;
     int activeIdx = gpd.activeIdx();
-    uint16_t *neighborCounts = grid.perAtomArray.d_data.data();
+    uint16_t *neighborCounts = grid.neighborCounts(getNeighborRCut());
     float *neighborCoefs = state->specialNeighborCoefs;
-    evalWrap->energyGroupGroup(nAtoms, nPerRingPoly, gpd.xs(activeIdx), gpd.fs(activeIdx), perParticleEng, neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(), state->devManager.prop.warpSize, paramsCoalesced.data(), numTypes, state->boundsGPU, neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs(activeIdx), chargeRCut, tagA, tagB, nThreadPerBlock(), nThreadPerAtom());
+    evalWrap->energyGroupGroup(nAtoms, nPerRingPoly, gpd.xs(activeIdx), gpd.fs(activeIdx), perParticleEng, neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(), state->devManager.prop.warpSize, evalParams(), numTypes, state->boundsGPU, neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs(activeIdx), chargeRCut, tagA, tagB, nThreadPerBlock(), nThreadPerAtom(), grid.compressedNeighborlist());
+}
+
+bool FixLJCut::addToFused(EvaluatorFused &fused) {
+    return fused.add(PAIR_EVAL_LJ);
 }
 
 void FixLJCut::setEvalWrapper() {
+    if (setFusedEvalWrapper()) {
+        return;
+    }
     if (evalWrapperMode == "offload") {
         EvaluatorLJ eval;
         evalWrap = pickEvaluator<EvaluatorLJ, 3, true>(eval, chargeCalcFix);
@@ -39,9 +39,11 @@ class FixLJCut : public FixPair {
 
         //! Compute forces
         void compute(int);
+        void computeHost(int);
 
         //! Compute single point energy
         void singlePointEng(float *);
+        void singlePointEngHost(float *);
         void singlePointEngGroupGroup(float *, uint32_t, uint32_t);
 
         //! Prepare Fix
@@ -79,6 +81,7 @@ class FixLJCut : public FixPair {
         std::vector<float> getRCuts();
     public:
         void setEvalWrapper();
+        bool addToFused(EvaluatorFused &fused);
 
         const std::string epsHandle; //!< Handle for parameter epsilon
         const std::string sigHandle; //!< Handle for parameter sigma
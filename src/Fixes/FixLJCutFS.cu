@@ -7,6 +7,7 @@
 #include "State.h"
 #include "cutils_func.h"
 #include "EvaluatorWrapper.h"
+#include "PairEvaluatorFused.h"
 
 const std::string LJCutType = "LJCutFS";
 namespace py = boost::python;
@@ -21,6 +22,7 @@ FixLJCutFS::FixLJCutFS(SHARED(State) state_, std::string handle_, std::string mi
     paramOrder = {rCutHandle, epsHandle, sigHandle, "FCutHandle"};
 
     canAcceptChargePairCalc = true;
+    canRunOnHost = true;
     setEvalWrapper();
 }
 void FixLJCutFS::compute(int virialMode) {
@@ -30,15 +32,36 @@ void FixLJCutFS::compute(int virialMode) {
     GPUData &gpd = state->gpd;
     GridGPU &grid = state->gridGPU;
     int activeIdx = gpd.activeIdx();
-    uint16_t *neighborCounts = grid.perAtomArray.d_data.data();
+    uint16_t *neighborCounts = grid.neighborCounts(getNeighborRCut());
     float *neighborCoefs = state->specialNeighborCoefs;
-    evalWrap->compute(nAtoms,nPerRingPoly, gpd.xs(activeIdx), gpd.fs(activeIdx),
+    evalWrap->compute(nAtoms,nPerRingPoly, gpd.xs(activeIdx), gpd.fs(activeIdx), gpd.fsFixed.data(),
                       neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(),
-                      state->devManager.prop.warpSize, paramsCoalesced.data(), numTypes, state->boundsGPU,
-                      neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.virials.d_data.data(), gpd.qs(activeIdx), chargeRCut, virialMode, nThreadPerBlock(), nThreadPerAtom());
+                      state->devManager.prop.warpSize, evalParams(), numTypes, state->boundsGPU,
+                      neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.virials.d_data.data(), gpd.qs(activeIdx), chargeRCut, virialMode, nThreadPerBlock(), nThreadPerAtom(), grid.compressedNeighborlist());
 
 
 
+}
+void FixLJCutFS::computeHost(int virialMode) {
+    int nAtoms = state->atoms.size();
+    int numTypes = state->atomParams.numTypes;
+    GPUData &gpd = state->gpd;
+    GridGPU &grid = state->gridGPU;
+    float *neighborCoefs = state->specialNeighborCoefs;
+    evalWrap->computeHost(nAtoms, grid, gpd.xs.h_data.data(), gpd.fs.h_data.data(),
+                          evalParamsHost(), numTypes, state->boundsGPU,
+                          neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.virials.h_data.data(), gpd.qs.h_data.data(), chargeRCut, virialMode);
+}
+
+void FixLJCutFS::singlePointEngHost(float *perParticleEng) {
+    int nAtoms = state->atoms.size();
+    int numTypes = state->atomParams.numTypes;
+    GPUData &gpd = state->gpd;
+    GridGPU &grid = state->gridGPU;
+    float *neighborCoefs = state->specialNeighborCoefs;
+    evalWrap->energyHost(nAtoms, grid, gpd.xs.h_data.data(), perParticleEng,
+                         evalParamsHost(), numTypes, state->boundsGPU,
+                         neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs.h_data.data(), chargeRCut);
 }
 
 void FixLJCutFS::singlePointEng(float *perParticleEng) {
@@ -48,10 +71,10 @@ void FixLJCutFS::singlePointEng(float *perParticleEng) {
     GPUData &gpd = state->gpd;
     GridGPU &grid = state->gridGPU;
     int activeIdx = gpd.activeIdx();
-    uint16_t *neighborCounts = grid.perAtomArray.d_data.data();
+    uint16_t *neighborCounts = grid.neighborCounts(getNeighborRCut());
     float *neighborCoefs = state->specialNeighborCoefs;
 
-    evalWrap->energy(nAtoms,nPerRingPoly, gpd.xs(activeIdx), perParticleEng, neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(), state->devManager.prop.warpSize, paramsCoalesced.data(), numTypes, state->boundsGPU, neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs(activeIdx), chargeRCut, nThreadPerBlock(), nThreadPerAtom());
+    evalWrap->energy(nAtoms,nPerRingPoly, gpd.xs(activeIdx), perParticleEng, neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(), state->devManager.prop.warpSize, evalParams(), numTypes, state->boundsGPU, neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs(activeIdx), chargeRCut, nThreadPerBlock(), nThreadPerAtom(), grid.compressedNeighborlist());
 
 
 }
@@ -63,10 +86,10 @@ void FixLJCutFS::singlePointEngGroupGroup(float *perParticleEng, uint32_t tagA,
     GPUData &gpd = state->gpd;
     GridGPU &grid = state->gridGPU;
     int activeIdx = gpd.activeIdx();
-    uint16_t *neighborCounts = grid.perAtomArray.d_data.data();
+    uint16_t *neighborCounts = grid.neighborCounts(getNeighborRCut());
     float *neighborCoefs = state->specialNeighborCoefs;
 
-    evalWrap->energyGroupGroup(nAtoms,nPerRingPoly, gpd.xs(activeIdx), gpd.fs(activeIdx), perParticleEng, neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(), state->devManager.prop.warpSize, paramsCoalesced.data(), numTypes, state->boundsGPU, neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs(activeIdx), chargeRCut, tagA, tagB, nThreadPerBlock(), nThreadPerAtom());
+    evalWrap->energyGroupGroup(nAtoms,nPerRingPoly, gpd.xs(activeIdx), gpd.fs(activeIdx), perParticleEng, neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(), state->devManager.prop.warpSize, evalParams(), numTypes, state->boundsGPU, neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs(activeIdx), chargeRCut, tagA, tagB, nThreadPerBlock(), nThreadPerAtom(), grid.compressedNeighborlist());
 
 }
 
@@ -128,7 +151,14 @@ bool FixLJCutFS::prepareForRun() {
     return prepared;
 }
 
+bool FixLJCutFS::addToFused(EvaluatorFused &fused) {
+    return fused.add(PAIR_EVAL_LJFS);
+}
+
 void FixLJCutFS::setEvalWrapper() {
+    if (setFusedEvalWrapper()) {
+        return;
+    }
     if (evalWrapperMode == "orig") {
         EvaluatorLJFS eval;
         evalWrap = pickEvaluator<EvaluatorLJFS, 3, true>(eval, chargeCalcFix);
@@ -23,9 +23,11 @@ class FixLJCutFS : public FixPair {
 
         //! Compute forces
         void compute(int);
+        void computeHost(int);
 
         //! Compute single point energy
         void singlePointEng(float *);
+        void singlePointEngHost(float *);
         void singlePointEngGroupGroup(float *, uint32_t, uint32_t);
 
         //! Prepare Fix
@@ -72,6 +74,7 @@ class FixLJCutFS : public FixPair {
         std::vector<float> FCuts; //!< vector storing force at cutoff distance
 
         void setEvalWrapper();
+        bool addToFused(EvaluatorFused &fused);
 };
 
 #endif
@@ -8,18 +8,19 @@ namespace py = boost::python;
 
 
 
-__global__ void compute_cu(int nAtoms, float4 *vs, float4 *fs, curandState_t *randStates, float dt, float T, float gamma, float boltz, float mvv_to_e, float ftm_to_v, bool useMass) {
+//random numbers are keyed on (seed, atom id, turn) rather than carried in per-thread states,
+//so the noise an atom sees does not depend on where it sits in the sorted arrays
+__global__ void compute_cu(int nAtoms, float4 *vs, float4 *fs, uint *ids, int seed, int64_t turn, float dt, float T, float gamma, float boltz, float mvv_to_e, float ftm_to_v, bool useMass) {
 
     int idx = GETIDX();
     if (idx < nAtoms) {
 
-        curandState_t *randState = randStates + idx;
-        curandState_t localState=*randState;
+        curandStatePhilox4_32_10_t localState;
+        curand_init(seed, ids[idx], turn*8, &localState);
         float3 Wiener;
         Wiener.x=curand_uniform(&localState)-0.5f;
         Wiener.y=curand_uniform(&localState)-0.5f;
         Wiener.z=curand_uniform(&localState)-0.5f;
-        *randState=localState;
         float4 vel_whole = vs[idx];
         float3 vel = make_float3(vel_whole);
 
@@ -64,18 +65,9 @@ FixLangevin::FixLangevin(boost::shared_ptr<State> state_, std::string handle_, s
     setDefaults();
 }
 
-void __global__ initRandStates(int nAtoms, curandState_t *states, int seed,int turn) {
-    int idx = GETIDX();
-    curand_init(seed, idx, turn, states + idx);
-
-}
-
-
 bool FixLangevin::prepareForRun() {
     turnBeginRun = state->runInit;
     turnFinishRun = state->runInit + state->runningFor;
-    randStates = GPUArrayDeviceGlobal<curandState_t>(state->atoms.size());
-    initRandStates<<<NBLOCK(state->atoms.size()), PERBLOCK>>>(state->atoms.size(), randStates.data(), seed,state->turn);
     prepared = true;
     return prepared;
 }
@@ -96,7 +88,7 @@ void FixLangevin::setParams(double seed_, double gamma_) {
 void FixLangevin::compute(int virialMode) {
     computeCurrentVal(state->turn);
     double temp = getCurrentVal();
-    compute_cu<<<NBLOCK(state->atoms.size()), PERBLOCK>>>(state->atoms.size(), state->gpd.vs.getDevData(), state->gpd.fs.getDevData(), randStates.data(), state->dt, temp, gamma, state->units.boltz, state->units.mvv_to_eng, state->units.ftm_to_v, true);
+    compute_cu<<<NBLOCK(state->atoms.size()), PERBLOCK>>>(state->atoms.size(), state->gpd.vs.getDevData(), state->gpd.fs.getDevData(), state->gpd.ids.getDevData(), seed, state->turn, state->dt, temp, gamma, state->units.boltz, state->units.mvv_to_eng, state->units.ftm_to_v, true);
     
 }
 
@@ -25,7 +25,6 @@ private:
     int seed;
     float gamma;
     void setDefaults();
-    GPUArrayDeviceGlobal<curandState_t> randStates;
 public:
 
     FixLangevin(boost::shared_ptr<State> state_, std::string handle_, std::string groupHandle_, double temp_);
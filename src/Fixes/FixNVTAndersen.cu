@@ -52,27 +52,20 @@ void FixNVTAndersen::assignLocalTempComputer() {
 }
 
 
-void __global__ initRand(int nAtoms, curandState_t *states, int seed,int turn) {
-    int idx = GETIDX();
-    curand_init(seed, idx, turn, states + idx);
-
-}
-
 bool FixNVTAndersen::prepareForRun() {
     turnBeginRun = state->runInit;
     turnFinishRun = state->runInit + state->runningFor;
     tempComputer.prepareForRun();
-    randStates = GPUArrayDeviceGlobal<curandState_t>(state->atoms.size());
-    initRand<<<NBLOCK(state->atoms.size()), PERBLOCK>>>(state->atoms.size(), randStates.data(), seed,state->turn);
     prepared = true;
     return prepared;
 }
 
-void __global__ resample_no_tags_cu(int nAtoms, float4 *vs, curandState_t *randStates, float tempSet, float nudt, float boltz, float mvv_to_e) {
+//random numbers are keyed on (seed, atom id, turn), see FixLangevin
+void __global__ resample_no_tags_cu(int nAtoms, float4 *vs, uint *ids, int seed, int64_t turn, float tempSet, float nudt, float boltz, float mvv_to_e) {
     int idx = GETIDX();
     if (tempSet > 0 and idx < nAtoms) {
-        curandState_t *randState = randStates + idx;
-        curandState_t localState=*randState;
+        curandStatePhilox4_32_10_t localState;
+        curand_init(seed, ids[idx], turn*8, &localState);
         if ( curand_uniform(&localState) <= nudt ) {
             // resample from Boltzmann distribution
             float4 vnew    = vs[idx];
@@ -87,16 +80,15 @@ void __global__ resample_no_tags_cu(int nAtoms, float4 *vs, curandState_t *randS
                 vnew.z = sigma*sz;
             vs[idx]= vnew;
         }
-        *randState=localState;
     }
 }
 
-void __global__ resample_cu(int nAtoms, uint groupTag, float4 *vs, float4 *fs, curandState_t *randStates, float tempSet, float nudt, float boltz, float mvv_to_e) {
+void __global__ resample_cu(int nAtoms, uint groupTag, float4 *vs, float4 *fs, uint *ids, int seed, int64_t turn, float tempSet, float nudt, float boltz, float mvv_to_e) {
 
     int idx = GETIDX();
     if (tempSet > 0 and idx < nAtoms) {
-        curandState_t *randState = randStates + idx;
-        curandState_t localState=*randState;
+        curandStatePhilox4_32_10_t localState;
+        curand_init(seed, ids[idx], turn*8, &localState);
         uint groupTagAtom = ((uint *) (fs+idx))[3];
         if (groupTag & groupTagAtom) {
             if ( curand_uniform(&localState) <= nudt ) {
@@ -113,7 +105,6 @@ void __global__ resample_cu(int nAtoms, uint groupTag, float4 *vs, float4 *fs, c
                 vnew.z = sigma*sz;
                 vs[idx]= vnew;
             }
-            *randState=localState;
         }
     }
 }
@@ -129,11 +120,11 @@ void FixNVTAndersen::compute(int virialMode) {
     int activeIdx = gpd.activeIdx();
 
     if (groupTag == 1) {
-        resample_no_tags_cu<<<NBLOCK(nAtoms), PERBLOCK>>>(nAtoms, gpd.vs(activeIdx), randStates.data(), 
+        resample_no_tags_cu<<<NBLOCK(nAtoms), PERBLOCK>>>(nAtoms, gpd.vs(activeIdx), gpd.ids(activeIdx), seed, turn, 
                 temp, nudt,state->units.boltz,state->units.mvv_to_eng);
 
     } else {
-        resample_cu<<<NBLOCK(nAtoms), PERBLOCK>>>(nAtoms, groupTag, gpd.vs(activeIdx),gpd.fs(activeIdx), randStates.data(), 
+        resample_cu<<<NBLOCK(nAtoms), PERBLOCK>>>(nAtoms, groupTag, gpd.vs(activeIdx),gpd.fs(activeIdx), gpd.ids(activeIdx), seed, turn, 
                 temp, nudt,state->units.boltz,state->units.mvv_to_eng);
     }
 }
@@ -29,7 +29,6 @@ private:
     int   seed;
     float nudt;
     void setDefaults();
-    GPUArrayDeviceGlobal<curandState_t> randStates;
     BoundsGPU boundsGPU;
 
     MD_ENGINE::DataComputerTemperature tempComputer;
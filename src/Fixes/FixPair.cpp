@@ -93,6 +93,63 @@ void FixPair::acceptChargePairCalc(Fix *chargeFix) {
     //setEvalWrapper(); done in integrator after prepareForRun is done
 
 }
+float FixPair::getNeighborRCut() {
+    //once parameters are processed the cutoffs are known per type pair, including those filled by the fix
+    //itself (e.g. FixWCA's 2^(1/6) sigma), which getRCuts reports as defaults
+    if (paramsProcessed()) {
+        float rCutSqr = 0;
+        for (float x : getNeighborRCutSqrs()) {
+            rCutSqr = fmax(rCutSqr, x);
+        }
+        return sqrt(rCutSqr);
+    }
+    float rCut = Fix::getNeighborRCut();
+    for (FixPair *f : fusedFixes) {
+        rCut = fmax(rCut, f->Fix::getNeighborRCut());
+    }
+    if (hasAcceptedChargePairCalc) {
+        rCut = fmax(rCut, chargeRCut);
+    }
+    return rCut;
+}
+
+bool FixPair::paramsProcessed() {
+    int numTypes = state->atomParams.numTypes;
+    if (paramsCoalescedHost.size() < numTypes*numTypes) {
+        return false;
+    }
+    for (FixPair *f : fusedFixes) {
+        if (f->paramsCoalescedHost.size() < numTypes*numTypes) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<float> FixPair::getNeighborRCutSqrs() {
+    if (not paramsProcessed()) {
+        return Fix::getNeighborRCutSqrs();
+    }
+    int numTypes = state->atomParams.numTypes;
+    std::vector<float> res(numTypes*numTypes, 0);
+    std::vector<FixPair *> evaluated = fusedFixes;
+    if (not evaluated.size()) {
+        evaluated.push_back(this);
+    }
+    //rCut squared is always the first parameter block
+    for (FixPair *f : evaluated) {
+        for (int i=0; i<res.size(); i++) {
+            res[i] = fmax(res[i], f->paramsCoalescedHost[i]);
+        }
+    }
+    if (hasAcceptedChargePairCalc) {
+        for (int i=0; i<res.size(); i++) {
+            res[i] = fmax(res[i], chargeRCut*chargeRCut);
+        }
+    }
+    return res;
+}
+
 void FixPair::ensureParamSize(std::vector<float> &array)
 {
     int desiredSize = state->atomParams.numTypes;
@@ -123,10 +180,12 @@ void FixPair::sendAllToDevice() {
 
     }
     paramsCoalesced = GPUArrayDeviceGlobal<float>(totalSize);
+    paramsCoalescedHost.resize(totalSize);
     int runningSize = 0;
     for (std::string handle : paramOrder) {
         std::vector<float> &vals = paramMapProcessed[handle];
         paramsCoalesced.set(vals.data(), runningSize, vals.size());
+        std::copy(vals.begin(), vals.end(), paramsCoalescedHost.begin() + runningSize);
         runningSize += vals.size();
     }
 }
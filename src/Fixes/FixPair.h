@@ -16,6 +16,7 @@
 void export_FixPair();
 
 class State;
+class EvaluatorFused;
 extern const std::string ARITHMETICTYPE;
 extern const std::string GEOMETRICTYPE;
 class FixPair : public Fix {
@@ -34,6 +35,7 @@ public:
         : Fix(state_, handle_, groupHandle_, type_, forceSingle_, false, requiresCharges_, applyEvery_, -1), chargeCalcFix(nullptr)
         {
 			setMixingRules(mixingRules_);
+            canFusePairCalc = true;
             // Empty constructor
         };
 
@@ -129,6 +131,9 @@ protected:
     //! Parameters to be sent to the GPU
     GPUArrayDeviceGlobal<float> paramsCoalesced;
 
+    //! Host copy of paramsCoalesced, used by the host backend
+    std::vector<float> paramsCoalescedHost;
+
     //! Order in which the parameters are processed
     std::vector<std::string> paramOrder;
 
@@ -144,6 +149,40 @@ protected:
     BoundsGPU boundsLast;
     void acceptChargePairCalc(Fix *);
     float chargeRCut;
+
+    //! Covers the fused fixes and the accepted charge pair calculation as well
+    float getNeighborRCut();
+    //! Per type pair rCut of this fix and the fused fixes, and the charge cutoff if accepted
+    std::vector<float> getNeighborRCutSqrs();
+    //! Whether paramsCoalescedHost of this fix and the fused fixes hold the processed parameters for the current types
+    bool paramsProcessed();
+
+    //! Pair fixes evaluated in this fix's kernel, this one included, in parameter slot order.  Empty if not fusing
+    std::vector<FixPair *> fusedFixes;
+
+    //! Parameters of the fused fixes, laid out as EvaluatorFused expects
+    GPUArrayDeviceGlobal<float> paramsFused;
+    std::vector<float> paramsFusedHost;
+
+    //! Add this fix's evaluator to a fused evaluator
+    /*!
+     * \returns False if this fix's evaluator cannot be fused
+     *
+     * Fixes whose evaluator is listed in PAIR_EVAL_KIND override this.
+     */
+    virtual bool addToFused(EvaluatorFused &fused) { return false; }
+
+    //! Set evalWrap if this fix's pairs are fused
+    /*!
+     * \returns True if evalWrap was set: to nothing if another fix evaluates
+     *          this fix's pairs, or to the fused evaluator if this fix
+     *          evaluates other fixes' pairs.  Only acts in offload mode.
+     */
+    bool setFusedEvalWrapper();
+
+    //! Parameters to pass to evalWrap, the fused ones if evalWrap is fused
+    float *evalParams();
+    float *evalParamsHost();
 public:
     //! Set a specific parameter for specific particle types
     /*!
@@ -186,4 +225,8 @@ public:
     void handleBoundsChange();
 
 	void setMixingRules(std::string);
+
+    //! Take over evaluation of another pair fix's pairs, see State::handlePairFusion
+    bool acceptPairCalc(Fix *);
+    void resetPairFusion();
 };
@@ -0,0 +1,158 @@
+#include "FixPair.h"
+#include "State.h"
+#include "PairEvaluatorFused.h"
+#include "EvaluatorWrapper.h"
+#include "Autotuner.h"
+
+#include <algorithm>
+
+//FixPair methods for evaluating several pair fixes in one pass over the neighbor list.
+//These live in a .cu file because setting the fused evaluator instantiates the pair kernels
+
+template <class... EVALS>
+static bool setFused(boost::shared_ptr<EvaluatorWrapper> *evalWrap, Fix *chargeFix, EVALS... evals) {
+    if (evalWrap != nullptr) {
+        *evalWrap = pickEvaluator<EvaluatorFusedSlots<EVALS...>, FUSED_N_PARAM(sizeof...(EVALS)), true>(
+                EvaluatorFusedSlots<EVALS...>(evals...), chargeFix);
+    }
+    return true;
+}
+
+//Every combination below instantiates the full set of pair kernels, so only common ones are listed.  fused
+//must be in slot order (EvaluatorFused::slotOrder).  Returns false if there is no kernel for the combination.
+//With evalWrap null, only checks
+static bool pickFusedEvaluator(const EvaluatorFused &fused, Fix *chargeFix, boost::shared_ptr<EvaluatorWrapper> *evalWrap) {
+    const int *k = fused.kinds;
+    if (fused.nEvals == 2) {
+        if (k[0] == PAIR_EVAL_LJ and k[1] == PAIR_EVAL_LJ) {
+            return setFused(evalWrap, chargeFix, EvaluatorLJ(), EvaluatorLJ());
+        } else if (k[0] == PAIR_EVAL_LJ and k[1] == PAIR_EVAL_LJFS) {
+            return setFused(evalWrap, chargeFix, EvaluatorLJ(), EvaluatorLJFS());
+        } else if (k[0] == PAIR_EVAL_LJ and k[1] == PAIR_EVAL_WCA) {
+            return setFused(evalWrap, chargeFix, EvaluatorLJ(), EvaluatorWCA());
+        } else if (k[0] == PAIR_EVAL_LJ and k[1] == PAIR_EVAL_TICG) {
+            return setFused(evalWrap, chargeFix, EvaluatorLJ(), EvaluatorTICG());
+        } else if (k[0] == PAIR_EVAL_LJ and k[1] == PAIR_EVAL_TABULATED) {
+            return setFused(evalWrap, chargeFix, EvaluatorLJ(), fused.tabulated);
+        } else if (k[0] == PAIR_EVAL_WCA and k[1] == PAIR_EVAL_WCA) {
+            return setFused(evalWrap, chargeFix, EvaluatorWCA(), EvaluatorWCA());
+        } else if (k[0] == PAIR_EVAL_WCA and k[1] == PAIR_EVAL_TICG) {
+            return setFused(evalWrap, chargeFix, EvaluatorWCA(), EvaluatorTICG());
+        } else if (k[0] == PAIR_EVAL_WCA and k[1] == PAIR_EVAL_TABULATED) {
+            return setFused(evalWrap, chargeFix, EvaluatorWCA(), fused.tabulated);
+        }
+    } else if (fused.nEvals == 3) {
+        if (k[0] == PAIR_EVAL_LJ and k[1] == PAIR_EVAL_LJ and k[2] == PAIR_EVAL_LJ) {
+            return setFused(evalWrap, chargeFix, EvaluatorLJ(), EvaluatorLJ(), EvaluatorLJ());
+        } else if (k[0] == PAIR_EVAL_LJ and k[1] == PAIR_EVAL_LJ and k[2] == PAIR_EVAL_WCA) {
+            return setFused(evalWrap, chargeFix, EvaluatorLJ(), EvaluatorLJ(), EvaluatorWCA());
+        } else if (k[0] == PAIR_EVAL_LJ and k[1] == PAIR_EVAL_WCA and k[2] == PAIR_EVAL_TICG) {
+            return setFused(evalWrap, chargeFix, EvaluatorLJ(), EvaluatorWCA(), EvaluatorTICG());
+        }
+    }
+    return false;
+}
+
+bool FixPair::acceptPairCalc(Fix *other) {
+    FixPair *otherPair = dynamic_cast<FixPair *>(other);
+    if (otherPair == nullptr) {
+        return false;
+    }
+    std::vector<FixPair *> candidates = fusedFixes;
+    if (not candidates.size()) {
+        candidates.push_back(this);
+    }
+    candidates.push_back(otherPair);
+    EvaluatorFused fused;
+    for (FixPair *f : candidates) {
+        if (f->paramOrder.size() > FUSED_SLOT_PARAMS or not f->addToFused(fused)) {
+            return false;
+        }
+    }
+    //parameter slots follow the kind order the fused kernels are instantiated in
+    std::vector<FixPair *> unordered = candidates;
+    std::vector<int> order = fused.slotOrder();
+    fused = EvaluatorFused();
+    for (int i=0; i<order.size(); i++) {
+        candidates[i] = unordered[order[i]];
+        candidates[i]->addToFused(fused);
+    }
+    if (not pickFusedEvaluator(fused, nullptr, nullptr)) {
+        std::cout << "No fused pair kernel for fixes";
+        for (FixPair *f : candidates) {
+            std::cout << " " << f->handle;
+        }
+        std::cout << ".  Evaluating " << other->handle << " on its own." << std::endl;
+        return false;
+    }
+    int numTypes = state->atomParams.numTypes;
+    int nSqr = numTypes*numTypes;
+    int nParam = FUSED_N_PARAM(candidates.size());
+    if (state->backend != BACKEND::HOST) {
+        //the pair kernels stage all parameters in shared memory, next to per-thread accumulators when
+        //several threads share an atom.  Leave the fixes unfused if the largest launch would not fit
+        int nThreadPerBlock = state->nThreadPerBlock;
+        if (state->autoTune and nThreadPerBlock < Autotuner::maxThreadPerBlock) {
+            nThreadPerBlock = Autotuner::maxThreadPerBlock;
+        }
+        size_t sharedMem = accumAlignedFloats(nParam*nSqr)*sizeof(float)
+                           + nThreadPerBlock*(sizeof(Float3Accum) + sizeof(VirialAccum));
+        if (sharedMem > state->devManager.prop.sharedMemPerBlock) {
+            return false;
+        }
+    }
+    fusedFixes = candidates;
+
+    //largest rCutSqr first, then each fix's parameters in its own slot
+    paramsFusedHost = std::vector<float>(nParam*nSqr, 0);
+    for (int i=0; i<fusedFixes.size(); i++) {
+        std::vector<float> &src = fusedFixes[i]->paramsCoalescedHost;
+        std::copy(src.begin(), src.end(), paramsFusedHost.begin() + (1 + i*FUSED_SLOT_PARAMS)*nSqr);
+        for (int j=0; j<nSqr; j++) {
+            paramsFusedHost[j] = std::fmax(paramsFusedHost[j], src[j]);
+        }
+    }
+    paramsFused = GPUArrayDeviceGlobal<float>(paramsFusedHost.size());
+    paramsFused.set(paramsFusedHost.data(), 0, paramsFusedHost.size());
+    return true;
+}
+
+void FixPair::resetPairFusion() {
+    fusedFixes = std::vector<FixPair *>();
+    paramsFused = GPUArrayDeviceGlobal<float>();
+    paramsFusedHost = std::vector<float>();
+}
+
+bool FixPair::setFusedEvalWrapper() {
+    if (evalWrapperMode != "offload") {
+        return false;
+    }
+    if (hasOffloadedPairCalc) {
+        evalWrap = pickEvaluator<EvaluatorNone, 1, false>(EvaluatorNone(), nullptr);
+        return true;
+    }
+    if (fusedFixes.size()) {
+        EvaluatorFused fused;
+        for (FixPair *f : fusedFixes) {
+            f->addToFused(fused);
+        }
+        bool picked = pickFusedEvaluator(fused, chargeCalcFix, &evalWrap);
+        mdAssert(picked, "Fused pair fixes have no fused kernel");
+        return true;
+    }
+    return false;
+}
+
+float *FixPair::evalParams() {
+    if (evalWrapperMode == "offload" and fusedFixes.size()) {
+        return paramsFused.data();
+    }
+    return paramsCoalesced.data();
+}
+
+float *FixPair::evalParamsHost() {
+    if (evalWrapperMode == "offload" and fusedFixes.size()) {
+        return paramsFusedHost.data();
+    }
+    return paramsCoalescedHost.data();
+}
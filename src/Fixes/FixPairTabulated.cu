@@ -0,0 +1,299 @@
+#include "FixPairTabulated.h"
+
+#include "BoundsGPU.h"
+#include "GridGPU.h"
+#include "list_macro.h"
+#include "State.h"
+#include "cutils_func.h"
+#include "EvaluatorWrapper.h"
+#include "PairEvaluatorFused.h"
+#include "Logging.h"
+
+#include <algorithm>
+using namespace std;
+namespace py = boost::python;
+const string PairTabulatedType = "PairTabulated";
+
+namespace {
+std::vector<double> listToVector(py::list vals, std::string name) {
+    std::vector<double> res;
+    int n = py::len(vals);
+    for (int i=0; i<n; i++) {
+        py::extract<double> val(vals[i]);
+        mdAssert(val.check(), "FixPairTabulated: %s must be a list of numbers", name.c_str());
+        res.push_back(val);
+    }
+    return res;
+}
+}
+
+
+FixPairTabulated::FixPairTabulated(boost::shared_ptr<State> state_, string handle_, int nPoints_)
+    : FixPair(state_, handle_, "all", PairTabulatedType, true, false, 1, GEOMETRICTYPE),
+    rCutHandle("rCut"), rMinHandle("rMin"), invDrHandle("invDr"), offsetHandle("offset"), nPoints(nPoints_)
+{
+    mdAssert(nPoints >= 2, "FixPairTabulated needs at least two points per table");
+    initializeParameters(rCutHandle, rCuts);
+    initializeParameters(rMinHandle, rMins);
+    initializeParameters(invDrHandle, invDrs);
+    initializeParameters(offsetHandle, offsets);
+    paramOrder = {rCutHandle, rMinHandle, invDrHandle, offsetHandle};
+    readFromRestart();
+    canAcceptChargePairCalc = true;
+    canRunOnHost = true;
+    setEvalWrapper();
+}
+
+void FixPairTabulated::compute(int virialMode) {
+    int nAtoms       = state->atoms.size();
+    int nPerRingPoly = state->nPerRingPoly;
+    int numTypes = state->atomParams.numTypes;
+    GPUData &gpd = state->gpd;
+    GridGPU &grid = state->gridGPU;
+    int activeIdx = gpd.activeIdx();
+    uint16_t *neighborCounts = grid.neighborCounts(getNeighborRCut());
+    float *neighborCoefs = state->specialNeighborCoefs;
+    evalWrap->compute(nAtoms, nPerRingPoly, gpd.xs(activeIdx), gpd.fs(activeIdx), gpd.fsFixed.data(),
+                      neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(),
+                      state->devManager.prop.warpSize, evalParams(), numTypes, state->boundsGPU,
+                      neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.virials.d_data.data(), gpd.qs(activeIdx), chargeRCut, virialMode, nThreadPerBlock(), nThreadPerAtom(), grid.compressedNeighborlist());
+
+}
+void FixPairTabulated::computeHost(int virialMode) {
+    int nAtoms = state->atoms.size();
+    int numTypes = state->atomParams.numTypes;
+    GPUData &gpd = state->gpd;
+    GridGPU &grid = state->gridGPU;
+    float *neighborCoefs = state->specialNeighborCoefs;
+    evalWrap->computeHost(nAtoms, grid, gpd.xs.h_data.data(), gpd.fs.h_data.data(),
+                          evalParamsHost(), numTypes, state->boundsGPU,
+                          neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.virials.h_data.data(), gpd.qs.h_data.data(), chargeRCut, virialMode);
+}
+
+void FixPairTabulated::singlePointEngHost(float *perParticleEng) {
+    int nAtoms = state->atoms.size();
+    int numTypes = state->atomParams.numTypes;
+    GPUData &gpd = state->gpd;
+    GridGPU &grid = state->gridGPU;
+    float *neighborCoefs = state->specialNeighborCoefs;
+    evalWrap->energyHost(nAtoms, grid, gpd.xs.h_data.data(), perParticleEng,
+                         evalParamsHost(), numTypes, state->boundsGPU,
+                         neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs.h_data.data(), chargeRCut);
+}
+
+void FixPairTabulated::singlePointEng(float *perParticleEng) {
+    int nAtoms = state->atoms.size();
+    int nPerRingPoly = state->nPerRingPoly;
+    int numTypes = state->atomParams.numTypes;
+    GPUData &gpd = state->gpd;
+    GridGPU &grid = state->gridGPU;
+    int activeIdx = gpd.activeIdx();
+    uint16_t *neighborCounts = grid.neighborCounts(getNeighborRCut());
+    float *neighborCoefs = state->specialNeighborCoefs;
+    evalWrap->energy(nAtoms, nPerRingPoly, gpd.xs(activeIdx), perParticleEng, neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(), state->devManager.prop.warpSize, evalParams(), numTypes, state->boundsGPU, neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs(activeIdx), chargeRCut, nThreadPerBlock(), nThreadPerAtom(), grid.compressedNeighborlist());
+}
+
+void FixPairTabulated::singlePointEngGroupGroup(float *perParticleEng, uint32_t tagA, uint32_t tagB) {
+    int nAtoms = state->atoms.size();
+    int nPerRingPoly = state->nPerRingPoly;
+    int numTypes = state->atomParams.numTypes;
+    GPUData &gpd = state->gpd;
+    GridGPU &grid = state->gridGPU;
+    int activeIdx = gpd.activeIdx();
+    uint16_t *neighborCounts = grid.neighborCounts(getNeighborRCut());
+    float *neighborCoefs = state->specialNeighborCoefs;
+    evalWrap->energyGroupGroup(nAtoms, nPerRingPoly, gpd.xs(activeIdx), gpd.fs(activeIdx), perParticleEng, neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(), state->devManager.prop.warpSize, evalParams(), numTypes, state->boundsGPU, neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs(activeIdx), chargeRCut, tagA, tagB, nThreadPerBlock(), nThreadPerAtom(), grid.compressedNeighborlist());
+}
+
+bool FixPairTabulated::addToFused(EvaluatorFused &fused) {
+    fused.tabulated = EvaluatorTabulated(tables.d_data.data(), tables.h_data.data(), nPoints-1);
+    return fused.add(PAIR_EVAL_TABULATED);
+}
+
+void FixPairTabulated::setEvalWrapper() {
+    if (setFusedEvalWrapper()) {
+        return;
+    }
+    EvaluatorTabulated eval(tables.d_data.data(), tables.h_data.data(), nPoints-1);
+    if (evalWrapperMode == "offload") {
+        evalWrap = pickEvaluator<EvaluatorTabulated, 4, true>(eval, chargeCalcFix);
+    } else if (evalWrapperMode == "self") {
+        evalWrap = pickEvaluator<EvaluatorTabulated, 4, true>(eval, nullptr);
+    }
+}
+
+void FixPairTabulated::setSource(string handleA, string handleB, TableSource src) {
+    mdAssert(state->atomParams.typeFromHandle(handleA) != -1 and state->atomParams.typeFromHandle(handleB) != -1,
+             "FixPairTabulated: invalid atom types %s, %s", handleA.c_str(), handleB.c_str());
+    mdAssert(src.rMin >= 0 and src.rCut > src.rMin, "FixPairTabulated: table must span 0 <= rMin < rCut");
+    sources[make_pair(std::min(handleA, handleB), std::max(handleA, handleB))] = src;
+    setParameter(rCutHandle, handleA, handleB, src.rCut);
+}
+
+void FixPairTabulated::setTable(string handleA, string handleB, py::list rs, py::list engs, py::list forces) {
+    TableSource src;
+    src.rs = listToVector(rs, "r");
+    src.engs = listToVector(engs, "E");
+    src.forces = listToVector(forces, "F");
+    mdAssert(src.rs.size() >= 2, "FixPairTabulated: tables need at least two points");
+    mdAssert(src.rs.size() == src.engs.size() and src.rs.size() == src.forces.size(),
+             "FixPairTabulated: r, E, and F must have the same length");
+    for (size_t i=1; i<src.rs.size(); i++) {
+        mdAssert(src.rs[i] > src.rs[i-1], "FixPairTabulated: r must be increasing");
+    }
+    src.rMin = src.rs.front();
+    src.rCut = src.rs.back();
+    setSource(handleA, handleB, src);
+}
+
+void FixPairTabulated::setFunction(string handleA, string handleB, py::object func, double rMin, double rCut) {
+    mdAssert(PyCallable_Check(func.ptr()), "FixPairTabulated: function must be callable");
+    TableSource src;
+    src.func = func;
+    src.rMin = rMin;
+    src.rCut = rCut;
+    setSource(handleA, handleB, src);
+}
+
+//energies and forces at nPoints evenly spaced knots.  Given points are interpolated with
+//a cubic Hermite spline through their energies and forces
+void FixPairTabulated::sample(TableSource &src, vector<double> &engs, vector<double> &forces) {
+    engs.resize(nPoints);
+    forces.resize(nPoints);
+    double dr = (src.rCut - src.rMin) / (nPoints - 1);
+    for (int k=0; k<nPoints; k++) {
+        double r = src.rMin + k*dr;
+        if (src.rs.size() == 0) {
+            py::object res = src.func(r);
+            py::extract<double> eng(res[0]);
+            py::extract<double> force(res[1]);
+            mdAssert(eng.check() and force.check(), "FixPairTabulated: function must return (E, F)");
+            engs[k] = eng;
+            forces[k] = force;
+            continue;
+        }
+        int i = upper_bound(src.rs.begin(), src.rs.end(), r) - src.rs.begin() - 1;
+        i = max(0, min(i, (int) src.rs.size() - 2));
+        double h = src.rs[i+1] - src.rs[i];
+        double s = (r - src.rs[i]) / h;
+        //dE/dr = -F
+        double e0 = src.engs[i];
+        double e1 = src.engs[i+1];
+        double d0 = -src.forces[i] * h;
+        double d1 = -src.forces[i+1] * h;
+        double s2 = s*s;
+        double s3 = s2*s;
+        engs[k] = (1 - 3*s2 + 2*s3) * e0 + (s - 2*s2 + s3) * d0 + (3*s2 - 2*s3) * e1 + (s3 - s2) * d1;
+        double dEds = (6*s2 - 6*s) * e0 + (1 - 4*s + 3*s2) * d0 + (6*s - 6*s2) * e1 + (3*s2 - 2*s) * d1;
+        forces[k] = -dEds / h;
+    }
+}
+
+bool FixPairTabulated::prepareForRun() {
+    int numTypes = state->atomParams.numTypes;
+    vector<string> &handles = state->atomParams.handles;
+    //one table per unordered type pair, both orderings point to it
+    vector<int> tableIdxs(numTypes*numTypes, -1);
+    vector<TableSource *> tableSources;
+    for (int i=0; i<numTypes; i++) {
+        for (int j=i; j<numTypes; j++) {
+            auto it = sources.find(make_pair(std::min(handles[i], handles[j]), std::max(handles[i], handles[j])));
+            if (it != sources.end()) {
+                tableIdxs[i*numTypes + j] = tableSources.size();
+                tableIdxs[j*numTypes + i] = tableSources.size();
+                tableSources.push_back(&it->second);
+            }
+        }
+    }
+    if (not tableSources.size()) {
+        mdWarning("FixPairTabulated %s has no tables\n", handle.c_str());
+    }
+
+    int nIntervals = nPoints - 1;
+    tables = GPUArrayGlobal<float4>(max(1, (int) tableSources.size() * nIntervals));
+    vector<double> engs, forces;
+    for (size_t t=0; t<tableSources.size(); t++) {
+        TableSource &src = *tableSources[t];
+        sample(src, engs, forces);
+        double dr = (src.rCut - src.rMin) / nIntervals;
+        for (int k=0; k<nIntervals; k++) {
+            tables.h_data[t*nIntervals + k] = tabulatedInterval(engs[k], engs[k+1], forces[k], forces[k+1], dr);
+        }
+    }
+    tables.dataToDevice();
+
+    std::function<float (int, int)> rCutSqr = [&] (int i, int j) {
+        float rCut = squareVectorItem<float>(rCuts.data(), numTypes, i, j);
+        return tableIdxs[i*numTypes + j] == -1 or rCut == DEFAULT_FILL ? 0.0f : rCut*rCut;
+    };
+    std::function<float (int, int)> rMin = [&] (int i, int j) {
+        int t = tableIdxs[i*numTypes + j];
+        return t == -1 ? 0.0f : (float) tableSources[t]->rMin;
+    };
+    std::function<float (int, int)> invDr = [&] (int i, int j) {
+        int t = tableIdxs[i*numTypes + j];
+        return t == -1 ? 0.0f : (float) (nIntervals / (tableSources[t]->rCut - tableSources[t]->rMin));
+    };
+    std::function<float (int, int)> offset = [&] (int i, int j) {
+        int t = tableIdxs[i*numTypes + j];
+        return t == -1 ? -1.0f : (float) (t * nIntervals);
+    };
+    prepareParameters(rCutHandle, rCutSqr);
+    prepareParameters(rMinHandle, rMin);
+    prepareParameters(invDrHandle, invDr);
+    prepareParameters(offsetHandle, offset);
+
+    sendAllToDevice();
+    setEvalWrapper();
+    prepared = true;
+    return prepared;
+}
+
+string FixPairTabulated::restartChunk(string format) {
+    stringstream ss;
+    ss << restartChunkPairParams(format);
+    return ss.str();
+}
+
+
+bool FixPairTabulated::postRun() {
+
+    return true;
+}
+
+void FixPairTabulated::addSpecies(string handle) {
+    initializeParameters(rCutHandle, rCuts);
+    initializeParameters(rMinHandle, rMins);
+    initializeParameters(invDrHandle, invDrs);
+    initializeParameters(offsetHandle, offsets);
+
+}
+
+vector<float> FixPairTabulated::getRCuts() {
+    vector<float> res;
+    vector<float> &src = *(paramMap[rCutHandle]);
+    for (float x : src) {
+        if (x == DEFAULT_FILL) {
+            res.push_back(-1);
+        } else {
+            res.push_back(x);
+        }
+    }
+
+    return res;
+}
+
+void export_FixPairTabulated() {
+    py::class_<FixPairTabulated, boost::shared_ptr<FixPairTabulated>, py::bases<FixPair>, boost::noncopyable > (
+        "FixPairTabulated",
+        py::init<boost::shared_ptr<State>, string, py::optional<int> > (py::args("state", "handle", "nPoints"))
+    )
+    .def("setTable", &FixPairTabulated::setTable,
+         (py::arg("handleA"), py::arg("handleB"), py::arg("r"), py::arg("E"), py::arg("F"))
+        )
+    .def("setFunction", &FixPairTabulated::setFunction,
+         (py::arg("handleA"), py::arg("handleB"), py::arg("func"), py::arg("rMin"), py::arg("rCut"))
+        )
+      ;
+
+}
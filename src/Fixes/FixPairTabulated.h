@@ -0,0 +1,101 @@
+#pragma once
+#ifndef FIXPAIRTABULATED_H
+#define FIXPAIRTABULATED_H
+
+#include <map>
+#include <utility>
+
+#include "FixPair.h"
+#include "PairEvaluatorTabulated.h"
+#include "xml_func.h"
+
+//! Make FixPairTabulated available to the pair base class in boost
+void export_FixPairTabulated();
+
+//! Fix for pair interactions given as tables
+/*!
+ * Energies and forces for each pair of types are given either as tables of
+ * r, E(r), F(r), or as a python function returning (E, F) for a given r which
+ * is sampled once in prepareForRun.  Either way, each table is resampled to
+ * nPoints evenly spaced knots from rMin to rCut, and a cubic Hermite spline
+ * through the knots' energies and forces is evaluated per pair.  Beyond rCut
+ * the interaction is zero, and below rMin the force and energy at rMin are used.
+ * Type pairs without a table do not interact through this fix.
+ */
+extern const std::string PairTabulatedType;
+class FixPairTabulated : public FixPair {
+    public:
+        //! Constructor
+        /*!
+         * \param nPoints Number of knots each table is resampled to
+         */
+        FixPairTabulated(SHARED(State), std::string handle, int nPoints=1000);
+
+        //! Compute forces
+        void compute(int);
+        void computeHost(int);
+
+        //! Compute single point energy
+        void singlePointEng(float *);
+        void singlePointEngHost(float *);
+        void singlePointEngGroupGroup(float *, uint32_t, uint32_t);
+
+        //! Sample the tables and send them to the device
+        bool prepareForRun();
+
+        //! Run after simulation
+        bool postRun();
+
+        //! Create restart string
+        /*!
+         * Only the cutoffs are written.  Tables must be given again after restarting.
+         */
+        std::string restartChunk(std::string format);
+
+        //! Add new type of atoms
+        void addSpecies(std::string handle);
+
+        //! Return list of cutoff values
+        std::vector<float> getRCuts();
+
+        //! Set the table for a pair of types from lists of r, E(r), F(r)
+        /*!
+         * r must be increasing.  The last r is the cutoff.
+         */
+        void setTable(std::string handleA, std::string handleB, boost::python::list rs, boost::python::list engs, boost::python::list forces);
+
+        //! Set the table for a pair of types from a python function f(r) returning (E, F)
+        void setFunction(std::string handleA, std::string handleB, boost::python::object func, double rMin, double rCut);
+
+    public:
+        void setEvalWrapper();
+        bool addToFused(EvaluatorFused &fused);
+
+        const std::string rCutHandle; //!< Handle for parameter rCut
+        const std::string rMinHandle; //!< Handle for the first knot of each table
+        const std::string invDrHandle; //!< Handle for the inverse knot spacing of each table
+        const std::string offsetHandle; //!< Handle for the index of each table's first interval
+        std::vector<float> rCuts; //!< vector storing cutoff distance values
+        std::vector<float> rMins;
+        std::vector<float> invDrs;
+        std::vector<float> offsets;
+        int nPoints; //!< Number of knots per table
+
+    private:
+        //! Table as given by the user, either as points or as a function
+        struct TableSource {
+            std::vector<double> rs;
+            std::vector<double> engs;
+            std::vector<double> forces;
+            boost::python::object func;
+            double rMin;
+            double rCut;
+        };
+        std::map<std::pair<std::string, std::string>, TableSource> sources;
+        GPUArrayGlobal<float4> tables; //!< Spline coefficients, nPoints-1 intervals per tabulated type pair
+
+        void setSource(std::string handleA, std::string handleB, TableSource src);
+        void sample(TableSource &src, std::vector<double> &engs, std::vector<double> &forces);
+};
+
+#endif
@@ -33,10 +33,28 @@ class FixPotentialMultiAtom : public Fix, public TypedItemHolder {
         GPUArrayDeviceGlobal<GPUMember> forcersGPU;
         GPUArrayDeviceGlobal<int> forcerIdxs;
         GPUArrayDeviceGlobal<ForcerTypeHolder> parameters;
+        //host copies of forcersGPU and forcerIdxs, regrouped by reorderForcers.  forcerIdxsHost is empty if not grouped by atom
+        std::vector<GPUMember> forcersHost;
+        std::vector<int> forcerIdxsHost;
         VariantPyListInterface<CPUVariant, CPUMember> pyListInterface;
         int sharedMemSizeForParams;
         bool usingSharedMemForParams;
         int maxForcersPerBlock;
+        //! Fixed point sums of this fix's forces and virials (or energies) when State::deterministic is set, see addFixedPointForces
+        GPUArrayDeviceGlobal<unsigned long long> fixedPointScratch;
+        //! Forces go to the sums shared by all fixes when State::fixedPointForces is set, which the integrator adds to fs
+        unsigned long long *fsFixed() {
+            if (state->gpd.fsFixed.size()) {
+                return state->gpd.fsFixed.data();
+            }
+            return fixedPointScratch.size() ? fixedPointScratch.data() : nullptr;
+        }
+        unsigned long long *virialsFixed() {
+            return fixedPointScratch.size() ? fixedPointScratch.data() + 3*state->atoms.size() : nullptr;
+        }
+        unsigned long long *engsFixed() {
+            return fixedPointScratch.size() ? fixedPointScratch.data() : nullptr;
+        }
         virtual bool prepareForRun() {
             int maxExistingType = -1;
             std::unordered_map<ForcerTypeHolder, int> reverseMap;
@@ -68,13 +86,31 @@ class FixPotentialMultiAtom : public Fix, public TypedItemHolder {
                     }
                 } 
             }
-            maxForcersPerBlock = copyMultiAtomToGPU<CPUVariant, CPUBase, CPUMember, GPUMember, ForcerTypeHolder, N>(state->atoms.size(), forcers, state->idToIdx, &forcersGPU, &forcerIdxs, &forcerTypes, &parameters, maxExistingType);
+            maxForcersPerBlock = copyMultiAtomToGPU<CPUVariant, CPUBase, CPUMember, GPUMember, ForcerTypeHolder, N>(state->atoms.size(), forcers, state->idToIdx, &forcersGPU, &forcerIdxs, &forcerTypes, &parameters, maxExistingType, &forcersHost, &forcerIdxsHost);
 
 
             setSharedMemForParams(); 
+            if (state->deterministic) {
+                fixedPointScratch = GPUArrayDeviceGlobal<unsigned long long>(9*state->atoms.size());
+                fixedPointScratch.memset(0);
+            } else {
+                fixedPointScratch = GPUArrayDeviceGlobal<unsigned long long>();
+            }
             prepared = true;
             return prepared;
         } 
+        virtual void reorderForcers(std::vector<int> &idToIdx) {
+            //forcers of more than three atoms are not grouped by atom
+            if (forcerIdxsHost.empty()) {
+                return;
+            }
+            //only the grouping by atom changes, so the arrays are refilled in place.  The top bits of type say
+            //which of its atoms an entry is for
+            maxForcersPerBlock = regroupForcersByAtom(forcersHost, forcerIdxsHost, idToIdx,
+                                                      [] (const GPUMember &f) { return f.ids[f.type >> 29]; });
+            forcersGPU.set(forcersHost.data());
+            forcerIdxs.set(forcerIdxsHost.data());
+        }
         void setForcerType(int n, CPUMember &forcer) {
             if (n < 0) {
                 std::cout << "Tried to set bonded potential for invalid type " << n << std::endl;
@@ -0,0 +1,245 @@
+#include "FixShake.h"
+
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <unordered_map>
+
+#include "State.h"
+#include "boost_for_export.h"
+#include "cutils_math.h"
+#include "cutils_func.h"
+#include "helpers.h"
+#include "Logging.h"
+#include "globalDefs.h"
+namespace py = boost::python;
+const std::string shakeType = "Shake";
+
+FixShake::FixShake(boost::shared_ptr<State> state_, std::string handle_) : FixConstraint(state_, handle_, shakeType) {
+    tolerance = 1e-5;
+    maxIterations = 100;
+    nClusters = 0;
+}
+
+//one thread per cluster.  Constraints are corrected one at a time until all are within tolerance
+__global__ void shakePositions(int nClusters, int *clusterIdxs, int2 *ids, float *lengths, float4 *refs,
+                               int *idToIdxs, float4 *xs, float4 *vs, Virial *virials, BoundsGPU bounds,
+                               float invDt, float virialScale, float tolerance, int maxIterations, int *nFailed) {
+    int idx = GETIDX();
+    if (idx < nClusters) {
+        int start = clusterIdxs[idx];
+        int end = clusterIdxs[idx+1];
+        bool converged = false;
+        for (int iter=0; iter<maxIterations and not converged; iter++) {
+            converged = true;
+            for (int i=start; i<end; i++) {
+                int2 constraint = ids[i];
+                int idxA = idToIdxs[constraint.x];
+                int idxB = idToIdxs[constraint.y];
+                float4 posA = xs[idxA];
+                float4 posB = xs[idxB];
+                float3 r = bounds.minImage(make_float3(posA) - make_float3(posB));
+                float lenSqr = lengths[i] * lengths[i];
+                float diff = lenSqr - lengthSqr(r);
+                if (fabsf(diff) > 2.0f * tolerance * lenSqr) {
+                    converged = false;
+                    float4 ref = refs[i];
+                    float3 ref3 = make_float3(ref);
+                    float invMassA = invMassOf(vs[idxA]);
+                    float invMassB = invMassOf(vs[idxB]);
+                    float g = diff / (2.0f * (invMassA + invMassB) * dot(ref3, r));
+                    float3 dA = ref3 * (g * invMassA);
+                    float3 dB = ref3 * (-g * invMassB);
+                    posA += dA;
+                    posB += dB;
+                    xs[idxA] = posA;
+                    xs[idxB] = posB;
+                    ref.w += g;
+                    refs[i] = ref;
+                }
+            }
+        }
+        if (not converged) {
+            atomicAdd(nFailed, 1);
+        }
+        //the positions moved by g/m * ref over the step, so velocities change by that over dt
+        for (int i=start; i<end; i++) {
+            int2 constraint = ids[i];
+            int idxA = idToIdxs[constraint.x];
+            int idxB = idToIdxs[constraint.y];
+            float4 ref = refs[i];
+            float3 ref3 = make_float3(ref);
+            float4 velA = vs[idxA];
+            float4 velB = vs[idxB];
+            float3 dvA = ref3 * (ref.w * invMassOf(velA) * invDt);
+            float3 dvB = ref3 * (-ref.w * invMassOf(velB) * invDt);
+            velA += dvA;
+            velB += dvB;
+            vs[idxA] = velA;
+            vs[idxB] = velB;
+            if (virialScale != 0) {
+                //constraint force on A is 2*g*ref/dt^2, acting along the bond.  Split between the two atoms
+                Virial virial(0, 0, 0, 0, 0, 0);
+                computeVirial(virial, ref3 * (ref.w * virialScale), ref3);
+                virial *= 0.5f;
+                virials[idxA] += virial;
+                virials[idxB] += virial;
+            }
+        }
+    }
+}
+
+__global__ void rattleVelocities(int nClusters, int *clusterIdxs, int2 *ids, float *lengths,
+                                 int *idToIdxs, float4 *xs, float4 *vs, BoundsGPU bounds,
+                                 float invDt, float tolerance, int maxIterations, int *nFailed) {
+    int idx = GETIDX();
+    if (idx < nClusters) {
+        int start = clusterIdxs[idx];
+        int end = clusterIdxs[idx+1];
+        bool converged = false;
+        for (int iter=0; iter<maxIterations and not converged; iter++) {
+            converged = true;
+            for (int i=start; i<end; i++) {
+                int2 constraint = ids[i];
+                int idxA = idToIdxs[constraint.x];
+                int idxB = idToIdxs[constraint.y];
+                float3 r = bounds.minImage(make_float3(xs[idxA]) - make_float3(xs[idxB]));
+                float4 velA = vs[idxA];
+                float4 velB = vs[idxB];
+                float rv = dot(r, make_float3(velA) - make_float3(velB));
+                float lenSqr = lengths[i] * lengths[i];
+                //relative change of the length over one step
+                if (fabsf(rv) > tolerance * lenSqr * invDt) {
+                    converged = false;
+                    float invMassA = invMassOf(velA);
+                    float invMassB = invMassOf(velB);
+                    float k = rv / (lengthSqr(r) * (invMassA + invMassB));
+                    float3 dvA = r * (-k * invMassA);
+                    float3 dvB = r * (k * invMassB);
+                    velA += dvA;
+                    velB += dvB;
+                    vs[idxA] = velA;
+                    vs[idxB] = velB;
+                }
+            }
+        }
+        if (not converged) {
+            atomicAdd(nFailed, 1);
+        }
+    }
+}
+
+bool FixShake::prepareForRun() {
+    int nConstraints = constraintIds.size();
+    //group constraints which share atoms into clusters, which are solved together
+    std::unordered_map<int, int> parent;
+    std::function<int (int)> root = [&] (int id) {
+        while (parent[id] != id) {
+            parent[id] = parent[parent[id]];
+            id = parent[id];
+        }
+        return id;
+    };
+    for (int2 c : constraintIds) {
+        if (parent.find(c.x) == parent.end()) {
+            parent[c.x] = c.x;
+        }
+        if (parent.find(c.y) == parent.end()) {
+            parent[c.y] = c.y;
+        }
+        parent[root(c.x)] = root(c.y);
+    }
+    std::unordered_map<int, int> clusterOfRoot;
+    std::vector<int> clusterOfConstraint(nConstraints);
+    for (int i=0; i<nConstraints; i++) {
+        int r = root(constraintIds[i].x);
+        if (clusterOfRoot.find(r) == clusterOfRoot.end()) {
+            int n = clusterOfRoot.size();
+            clusterOfRoot[r] = n;
+        }
+        clusterOfConstraint[i] = clusterOfRoot[r];
+    }
+    nClusters = clusterOfRoot.size();
+    std::vector<int> order(nConstraints);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&] (int a, int b) {
+        return clusterOfConstraint[a] < clusterOfConstraint[b];
+    });
+    std::vector<int> clusterStarts(nClusters+1, 0);
+    for (int i=0; i<nConstraints; i++) {
+        clusterStarts[clusterOfConstraint[order[i]]+1]++;
+    }
+    cumulativeSum(clusterStarts.data(), nClusters+1);
+
+    setConstraintsGPU(order);
+    clusterIdxs = GPUArrayDeviceGlobal<int>(nClusters+1);
+    clusterIdxs.set(clusterStarts.data());
+    nFailed = GPUArrayGlobal<int>(1);
+    nFailed.d_data.memset(0);
+
+    //bring the starting configuration onto the constraints without changing velocities, then remove velocities along them
+    if (nConstraints) {
+        stepInit();
+        shake(0, false);
+        rattle();
+    }
+    prepared = true;
+    return prepared;
+}
+
+void FixShake::shake(float invDt, bool computeVirials) {
+    GPUData &gpd = state->gpd;
+    int activeIdx = gpd.activeIdx();
+    float dt = state->dt;
+    //2*g*ref/dt^2 is the constraint force, in force units
+    float virialScale = computeVirials ? 2.0f / (dt * dt * state->units.ftm_to_v) : 0.0f;
+    shakePositions<<<NBLOCK(nClusters), PERBLOCK>>>(nClusters, clusterIdxs.data(), idsGPU.data(), lengthsGPU.data(), refs.data(),
+                                                    gpd.idToIdxs.d_data.data(), gpd.xs(activeIdx), gpd.vs(activeIdx),
+                                                    gpd.virials.d_data.data(), state->boundsGPU,
+                                                    invDt, virialScale, tolerance, maxIterations, nFailed.d_data.data());
+}
+
+void FixShake::rattle() {
+    GPUData &gpd = state->gpd;
+    int activeIdx = gpd.activeIdx();
+    rattleVelocities<<<NBLOCK(nClusters), PERBLOCK>>>(nClusters, clusterIdxs.data(), idsGPU.data(), lengthsGPU.data(),
+                                                      gpd.idToIdxs.d_data.data(), gpd.xs(activeIdx), gpd.vs(activeIdx),
+                                                      state->boundsGPU, 1.0f / state->dt, tolerance, maxIterations, nFailed.d_data.data());
+}
+
+bool FixShake::postNVE_X() {
+    if (nClusters) {
+        int virialMode = state->dataManager.getVirialModeForTurn(state->turn);
+        shake(1.0f / state->dt, virialMode == 1 or virialMode == 2);
+    }
+    return true;
+}
+
+bool FixShake::stepFinal() {
+    if (nClusters) {
+        rattle();
+    }
+    return true;
+}
+
+bool FixShake::postRun() {
+    nFailed.dataToHost();
+    cudaDeviceSynchronize();
+    if (nFailed.h_data[0]) {
+        mdWarning("FixShake %s: constraint clusters did not converge within %d iterations %d times during the run\n", handle.c_str(), maxIterations, nFailed.h_data[0]);
+    }
+    return true;
+}
+
+void export_FixShake()
+{
+    py::class_<FixShake, boost::shared_ptr<FixShake>, py::bases<FixConstraint> >
+        (
+         "FixShake",
+         py::init<boost::shared_ptr<State>, std::string>
+            (py::args("state", "handle"))
+        )
+        .def_readwrite("tolerance", &FixShake::tolerance)
+        .def_readwrite("maxIterations", &FixShake::maxIterations)
+        ;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#ifndef FIXSHAKE_H
+#define FIXSHAKE_H
+
+#include "FixConstraint.h"
+#include "GPUArrayGlobal.h"
+
+void export_FixShake();
+
+//! Fix constraining bond lengths with SHAKE and RATTLE
+/*!
+ * Constraints sharing atoms are grouped into clusters, and each cluster is
+ * solved iteratively by one thread, so independent clusters (such as the X-H
+ * bonds of a protein) are solved in parallel.  Positions are constrained with
+ * SHAKE after the position update (postNVE_X), using the bond vectors at the
+ * start of the step, and velocities are constrained with RATTLE at the end of
+ * the step (stepFinal).
+ */
+class FixShake : public FixConstraint {
+    private:
+        int nClusters;
+        GPUArrayDeviceGlobal<int> clusterIdxs; //!< Index of the first constraint of each cluster, nClusters+1 entries
+        GPUArrayGlobal<int> nFailed; //!< Number of times a cluster did not converge this run
+
+        void shake(float invDt, bool computeVirials);
+        void rattle();
+
+    public:
+        //! Constructor
+        /*!
+         * \param state Pointer to the simulation state
+         * \param handle "Name" of the Fix
+         */
+        FixShake(boost::shared_ptr<State> state_, std::string handle_);
+
+        bool prepareForRun();
+        bool postNVE_X();
+        bool stepFinal();
+        bool postRun();
+
+        double tolerance; //!< Relative tolerance on constrained lengths and on their rate of change per step
+        int maxIterations; //!< Most iterations spent on a cluster per step
+};
+
+#endif
@@ -7,6 +7,7 @@
 #include "State.h"
 #include "cutils_func.h"
 #include "EvaluatorWrapper.h"
+#include "PairEvaluatorFused.h"
 
 const std::string TICGType = "TICG";
 
@@ -18,6 +19,7 @@ FixTICG::FixTICG(boost::shared_ptr<State> state_, std::string handle_, std::stri
     initializeParameters(rCutHandle, rCuts);
     paramOrder = {rCutHandle, CHandle};
     readFromRestart();
+    canRunOnHost = true;
     setEvalWrapper();
 }
 
@@ -29,15 +31,36 @@ void FixTICG::compute(int virialMode) {
     GPUData &gpd = state->gpd;
     GridGPU &grid = state->gridGPU;
     int activeIdx = gpd.activeIdx();
-    uint16_t *neighborCounts = grid.perAtomArray.d_data.data();
+    uint16_t *neighborCounts = grid.neighborCounts(getNeighborRCut());
     float *neighborCoefs = state->specialNeighborCoefs;
-    evalWrap->compute(nAtoms,nPerRingPoly, gpd.xs(activeIdx), gpd.fs(activeIdx),
+    evalWrap->compute(nAtoms,nPerRingPoly, gpd.xs(activeIdx), gpd.fs(activeIdx), gpd.fsFixed.data(),
                       neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(),
-                      state->devManager.prop.warpSize, paramsCoalesced.data(), numTypes, state->boundsGPU,
-                      neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.virials.d_data.data(), gpd.qs(activeIdx), chargeRCut, virialMode, nThreadPerBlock(), nThreadPerAtom());
+                      state->devManager.prop.warpSize, evalParams(), numTypes, state->boundsGPU,
+                      neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.virials.d_data.data(), gpd.qs(activeIdx), chargeRCut, virialMode, nThreadPerBlock(), nThreadPerAtom(), grid.compressedNeighborlist());
 
 
 }
+void FixTICG::computeHost(int virialMode) {
+    int nAtoms = state->atoms.size();
+    int numTypes = state->atomParams.numTypes;
+    GPUData &gpd = state->gpd;
+    GridGPU &grid = state->gridGPU;
+    float *neighborCoefs = state->specialNeighborCoefs;
+    evalWrap->computeHost(nAtoms, grid, gpd.xs.h_data.data(), gpd.fs.h_data.data(),
+                          evalParamsHost(), numTypes, state->boundsGPU,
+                          neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.virials.h_data.data(), gpd.qs.h_data.data(), chargeRCut, virialMode);
+}
+
+void FixTICG::singlePointEngHost(float *perParticleEng) {
+    int nAtoms = state->atoms.size();
+    int numTypes = state->atomParams.numTypes;
+    GPUData &gpd = state->gpd;
+    GridGPU &grid = state->gridGPU;
+    float *neighborCoefs = state->specialNeighborCoefs;
+    evalWrap->energyHost(nAtoms, grid, gpd.xs.h_data.data(), perParticleEng,
+                         evalParamsHost(), numTypes, state->boundsGPU,
+                         neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs.h_data.data(), chargeRCut);
+}
 
 void FixTICG::singlePointEng(float *perParticleEng) {
     int nAtoms = state->atoms.size();
@@ -46,9 +69,9 @@ void FixTICG::singlePointEng(float *perParticleEng) {
     GPUData &gpd = state->gpd;
     GridGPU &grid = state->gridGPU;
     int activeIdx = gpd.activeIdx();
-    uint16_t *neighborCounts = grid.perAtomArray.d_data.data();
+    uint16_t *neighborCounts = grid.neighborCounts(getNeighborRCut());
     float *neighborCoefs = state->specialNeighborCoefs;
-    evalWrap->energy(nAtoms,nPerRingPoly, gpd.xs(activeIdx), perParticleEng, neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(), state->devManager.prop.warpSize, paramsCoalesced.data(), numTypes, state->boundsGPU, neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs(activeIdx), chargeRCut, nThreadPerBlock(), nThreadPerAtom());
+    evalWrap->energy(nAtoms,nPerRingPoly, gpd.xs(activeIdx), perParticleEng, neighborCounts, grid.neighborlist.data(), grid.perBlockArray.d_data.data(), state->devManager.prop.warpSize, evalParams(), numTypes, state->boundsGPU, neighborCoefs[0], neighborCoefs[1], neighborCoefs[2], gpd.qs(activeIdx), chargeRCut, nThreadPerBlock(), nThreadPerAtom(), grid.compressedNeighborlist());
 
 
 
@@ -75,8 +98,15 @@ bool FixTICG::prepareForRun() {
     return prepared;
 }
 
+bool FixTICG::addToFused(EvaluatorFused &fused) {
+    return fused.add(PAIR_EVAL_TICG);
+}
+
 void FixTICG::setEvalWrapper() {
-    if (evalWrapperMode == "orig") {
+    if (setFusedEvalWrapper()) {
+        return;
+    }
+    if (evalWrapperMode == "offload") {
         EvaluatorTICG eval;
         evalWrap = pickEvaluator<EvaluatorTICG, 2, true>(eval, chargeCalcFix);
      } else if (evalWrapperMode == "self") {
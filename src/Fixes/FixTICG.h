@@ -23,9 +23,11 @@ class FixTICG : public FixPair {
 
         //! Compute forces
         void compute(int);
+        void computeHost(int);
 
         //! Compute single point energy
         void singlePointEng(float *);
+        void singlePointEngHost(float *);
 
         //! Prepare Fix
         /*!
@@ -68,6 +70,7 @@ class FixTICG : public FixPair {
         std::vector<float> rCuts; //!< vector storing cutoff distance values
 
         void setEvalWrapper();
+        bool addToFused(EvaluatorFused &fused);
 };
 
 #endif
@@ -26,9 +26,11 @@ class FixWCA : public FixPair {
 
         //! Compute forces
         void compute(int);
+        void computeHost(int);
 
         //! Compute single point energy
         void singlePointEng(float *);
+        void singlePointEngHost(float *);
 
         //! Prepare Fix
         /*!
@@ -80,6 +82,7 @@ class FixWCA : public FixPair {
         std::vector<float> rCuts; //!< vector storing cutoff distance values
 
         void setEvalWrapper();
+        bool addToFused(EvaluatorFused &fused);
         void setEvalWrapperOrig();
 };
 
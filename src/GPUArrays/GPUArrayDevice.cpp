@@ -1,5 +1,8 @@
 #include "GPUArrayDevice.h"
 
+bool GPUArrayDevice::hostOnly = false;
+std::function<void ()> GPUArrayDevice::selectDevice;
+
 bool GPUArrayDevice::resize(size_t newSize, bool force /*= false*/)
 {
     if (force || newSize > cap) {
@@ -3,6 +3,7 @@
 #define GPUARRAYDEVICE_H
 
 #include <cstddef>
+#include <functional>
 #include <cuda_runtime.h>
 
 //! Base class for GPUArrayDevices
@@ -97,6 +98,25 @@ public:
      */
     virtual void memset(int val) = 0;
 
+    //! No device memory is used
+    /*!
+     * Set by State::setBackend for the host backend.  Arrays allocated while
+     * it is set hold no device memory, and copies to or from them do
+     * nothing, so a host run needs neither a GPU nor the CUDA driver.
+     *
+     * The flag is shared by the whole process.  A new State resets it to the
+     * GPU default, setBackend refuses to run once the state has atoms or
+     * fixes, and each run sets it from its own state's backend.
+     */
+    static bool hostOnly;
+
+    //! Called before device memory is first allocated
+    /*!
+     * The DeviceManager selects its device here, so that nothing touches the
+     * GPU until a device array is actually needed.
+     */
+    static std::function<void ()> selectDevice;
+
 private:
     //! Allocate memory for the array
     virtual void allocate() = 0;
@@ -41,8 +41,10 @@ public:
         : GPUArrayDevice(other.n)
     {
         allocate();
-        CUCHECK(cudaMemcpy(ptr, other.ptr, n*sizeof(T),
+        if (ptr and other.ptr) {
+            CUCHECK(cudaMemcpy(ptr, other.ptr, n*sizeof(T),
                                                 cudaMemcpyDeviceToDevice));
+        }
     }
 
     //! Move constructor
@@ -71,8 +73,10 @@ public:
             //!       reallocation here
             resize(other.n, true); // Force resizing
         }
-        CUCHECK(cudaMemcpy(ptr, other.ptr, n*sizeof(T),
+        if (ptr and other.ptr) {
+            CUCHECK(cudaMemcpy(ptr, other.ptr, n*sizeof(T),
                                                 cudaMemcpyDeviceToDevice));
+        }
         return *this;
     }
 
@@ -134,7 +138,7 @@ public:
     void get(void *copyTo, size_t offset, size_t nElements,
                                         cudaStream_t stream = nullptr) const
     {
-        if (copyTo == nullptr) { return; }
+        if (copyTo == nullptr or ptr == nullptr) { return; }
         T *pointer = (T*)ptr;
         if (stream) {
             CUCHECK(cudaMemcpyAsync(copyTo, pointer+offset, nElements*sizeof(T),
@@ -155,10 +159,12 @@ public:
      * the the GPUArrayDeviceGlobal.
      */
     void set(void const *copyFrom) {
+        if (ptr == nullptr) { return; }
         CUCHECK(cudaMemcpy(ptr, copyFrom, size()*sizeof(T),
                                                 cudaMemcpyHostToDevice));
     }
     void set (void const *copyFrom, size_t offset, size_t nElements) {
+        if (ptr == nullptr) { return; }
         T *pointer = (T*)ptr;
         CUCHECK(cudaMemcpy(pointer+offset, copyFrom, nElements*sizeof(T),
                                                 cudaMemcpyHostToDevice));
@@ -175,6 +181,7 @@ public:
      * stream object. Otherwise, the data is copied synchronously.
      */
     void copyToDeviceArray(void *dest, cudaStream_t stream = nullptr) const {
+        if (ptr == nullptr) { return; }
         if (stream) {
             CUCHECK(cudaMemcpyAsync(dest, ptr, n*sizeof(T),
                                             cudaMemcpyDeviceToDevice, stream));
@@ -196,6 +203,7 @@ public:
      * and this value is used.
      */
     void memset(int val) {
+        if (ptr == nullptr) { return; }
         CUCHECK(cudaMemset(ptr, val, n*sizeof(T)));
     }
 
@@ -209,16 +217,33 @@ public:
         mdAssert(sizeof(T) == 4  || sizeof(T) == 8 ||
                  sizeof(T) == 12 || sizeof(T) == 16,
                  "Type parameter incompatible size");
+        if (ptr == nullptr) { return; }
         MEMSETFUNC(ptr, &val, n, sizeof(T));
     }
 
 private:
     //! Allocate memory
-    void allocate() { CUCHECK(cudaMalloc(&ptr, n * sizeof(T))); cap = size(); }
+    /*!
+     * Nothing is allocated for empty arrays or with the host backend, and ptr
+     * stays null.
+     */
+    void allocate() {
+        cap = size();
+        if (n == 0 or hostOnly) {
+            ptr = nullptr;
+            return;
+        }
+        if (selectDevice) {
+            selectDevice();
+        }
+        CUCHECK(cudaMalloc(&ptr, n * sizeof(T)));
+    }
 
     //! Deallocate memory
     void deallocate() {
-        CUCHECK(cudaFree(ptr));
+        if (ptr) {
+            CUCHECK(cudaFree(ptr));
+        }
         n = 0;
         cap = 0;
         ptr = nullptr;
@@ -131,6 +131,7 @@ public:
 
     //! Copy data from CPU memory to active GPU memory
     void dataToDevice() {
+        if (GPUArrayDevice::hostOnly) { return; }
         CUCHECK(cudaMemcpy(d_data[activeIdx].data(), h_data.data(), size()*sizeof(T), cudaMemcpyHostToDevice ));
 
     }
@@ -145,6 +146,7 @@ public:
      * \param idx Index specifying which GPU memory to access
      */
     void dataToHost(int idx) {
+        if (GPUArrayDevice::hostOnly) { return; }
         CUCHECK(cudaMemcpy(h_data.data(), d_data[idx].data(), size()*sizeof(T), cudaMemcpyDeviceToHost));
     }
 
@@ -153,6 +155,7 @@ public:
      * \param dest Pointer to GPU memory; destination for copy.
      */
     void copyToDeviceArray(void *dest) {
+        if (GPUArrayDevice::hostOnly) { return; }
         CUCHECK(cudaMemcpy(dest, d_data[activeIdx].data(), size()*sizeof(T), cudaMemcpyDeviceToDevice));
     }
 
@@ -164,6 +167,7 @@ public:
      */
     bool copyBetweenArrays(int dst, int src) {
         if (dst != src) {
+            if (GPUArrayDevice::hostOnly) { return true; }
             CUCHECK(cudaMemcpy(d_data[dst].data(), d_data[src].data(), size()*sizeof(T), cudaMemcpyDeviceToDevice));
             return true;
         }
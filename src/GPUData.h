@@ -23,6 +23,10 @@ public:
     GPUArrayPair<float> qs;
     GPUArrayGlobal<int> idToIdxs;
     GPUArrayGlobal<Virial> virials;
+    /* x, y, z fixed point force sums per atom when State::fixedPointForces is set, empty otherwise.
+     * Fixes add to these instead of fs, and IntegratorUtil::addFixedPointForces moves them into fs
+     * once all fixes have run */
+    GPUArrayDeviceGlobal<unsigned long long> fsFixed;
 
     GPUArrayGlobal<float4> xsBuffer;
     GPUArrayGlobal<float4> vsBuffer;
@@ -9,6 +9,13 @@
 #include "cutils_func.h"
 #include "cutils_math.h"
 
+#include <algorithm>
+#include <thrust/device_ptr.h>
+#include <thrust/scan.h>
+#include <thrust/copy.h>
+#include <thrust/sort.h>
+#include <thrust/iterator/counting_iterator.h>
+
 using std::endl;
 using std::cout;
 namespace py = boost::python;
@@ -29,13 +36,15 @@ void GridGPU::initArrays() {
     xsLastBuild = GPUArrayDeviceGlobal<float4>(state->atoms.size());
 
     // in prepare for run, you make GPU grid _after_ copying xs to device
-    buildFlag = GPUArrayGlobal<int>(1);
+    buildFlag = GPUArrayGlobal<int>(2);
     buildFlag.d_data.memset(0);
     copyPositionsAsync();
     
     buildFlag.d_data.memset(0);
     // TODO delete cudaDS() call below
-    cudaDeviceSynchronize();
+    if (state->backend != BACKEND::HOST) {
+        cudaDeviceSynchronize();
+    }
 }
 
 void GridGPU::initArraysTune() {
@@ -46,12 +55,89 @@ void GridGPU::initArraysTune() {
 
 }
 
+void GridGPU::setPadding(double padding_) {
+    float rCut = neighCutoffMax - padding;
+    padding = padding_;
+    neighCutoffMax = rCut + padding;
+    minGridDim = make_float3(neighCutoffMax, neighCutoffMax, neighCutoffMax);
+    updateTypeNeighCuts();
+    setBounds(state->boundsGPU);
+}
+
+//most cells multi-cutoff binning searches in each direction.  Bounds the cell count when cutoffs are very different
+const int multiCutoffMaxReach = 4;
+
+//grids with more cells than this per atom only store their occupied cells, see hashOccupiedCells
+const double sparseCellsPerAtom = 8;
+
+//room single-pass neighbor builds leave above the most neighbors of any ring polymer in the last build
+const float singlePassSlack = 1.2;
+//single-pass builds are skipped when their list would be this many times larger than a counted one
+const double singlePassMaxMemRatio = 2;
+
+void GridGPU::setTypeRCuts(std::vector<float> rCutSqrs, int numTypes) {
+    typeRCuts = std::vector<float>();
+    numTypesMulti = numTypes;
+    for (float rCutSqr : rCutSqrs) {
+        typeRCuts.push_back(sqrt(rCutSqr));
+    }
+    updateTypeNeighCuts();
+    setBounds(state->boundsGPU);
+}
+
+void GridGPU::updateTypeNeighCuts() {
+    if (typeRCuts.empty()) {
+        return;
+    }
+    std::vector<float> cutSqrs(typeRCuts.size());
+    std::vector<float> cutMaxs(numTypesMulti, 0);
+    for (int i=0; i<numTypesMulti; i++) {
+        for (int j=0; j<numTypesMulti; j++) {
+            float cut = typeRCuts[i*numTypesMulti + j] + padding;
+            cutSqrs[i*numTypesMulti + j] = cut * cut;
+            cutMaxs[i] = fmax(cutMaxs[i], cut);
+        }
+    }
+    multiCutoffCellSize = *std::min_element(cutMaxs.begin(), cutMaxs.end());
+    typeNeighCutSqrs = GPUArrayDeviceGlobal<float>(cutSqrs.size());
+    typeNeighCutSqrs.set(cutSqrs.data());
+    typeNeighCutMaxs = GPUArrayDeviceGlobal<float>(cutMaxs.size());
+    typeNeighCutMaxs.set(cutMaxs.data());
+}
+
+void GridGPU::setRCut(double rCut) {
+    neighCutoffMax = rCut + padding;
+    minGridDim = make_float3(neighCutoffMax, neighCutoffMax, neighCutoffMax);
+    setBounds(state->boundsGPU);
+}
+
 void GridGPU::setBounds(BoundsGPU &newBounds) {
     Vector trace = state->boundsGPU.rectComponents;  
     Vector attemptDDim = Vector(minGridDim);
     VectorInt nGrid = trace / attemptDDim;  // so rounding to bigger grid
 
     Vector actualDDim = trace / nGrid;
+    multiCutoffActive = false;
+    if (typeRCuts.size() and nPerRingPoly == 1 and state->backend != BACKEND::HOST) {
+        //smaller cells, searched out to each type's longest cutoff.  The stencil must not wrap onto itself
+        float cellSize = fmax(multiCutoffCellSize, neighCutoffMax / multiCutoffMaxReach);
+        VectorInt nGridMulti = trace / Vector(cellSize, cellSize, cellSize);
+        Vector dDimMulti = trace / nGridMulti;
+        float3 periodic = state->boundsGPU.periodic;
+        float periodicDims[3] = {periodic.x, periodic.y, periodic.z};
+        bool fits = true;
+        for (int i=0; i<(state->is2d ? 2 : 3); i++) {
+            int reach = ceil(neighCutoffMax / dDimMulti[i]);
+            if (periodicDims[i] and nGridMulti[i] < 2*reach + 1) {
+                fits = false;
+            }
+        }
+        if (fits) {
+            nGrid = nGridMulti;
+            actualDDim = dDimMulti;
+            multiCutoffActive = true;
+        }
+    }
 
     // making grid that is exactly size of box.  This way can compute offsets
     // easily from Grid that doesn't have to deal with higher-level stuff like
@@ -64,13 +150,194 @@ void GridGPU::setBounds(BoundsGPU &newBounds) {
         ds.z = 1;
         assert(os.z == -.5);
     }
-    if (nsNew != ns) {
+    //mostly empty grids only store their occupied cells, rebuilt every build
+    double numCells = (double) nsNew.x * nsNew.y * nsNew.z;
+    int nRingPoly = gpd->xs.size() / nPerRingPoly;
+    bool sparse = state->backend != BACKEND::HOST and nRingPoly > 0
+                  and numCells > sparseCellsPerAtom * nRingPoly;
+    if (nsNew != ns or sparse != sparseCells) {
         ns = nsNew;
-        perCellArray = GPUArrayGlobal<uint32_t>(prod(ns) + 1);
+        sparseCells = sparse;
+        if (sparseCells) {
+            cellOrder = GPUArrayGlobal<int>();
+        } else {
+            perCellArray = GPUArrayGlobal<uint32_t>(prod(ns) + 1);
+            updateCellOrder();
+        }
     }
     boundsLastBuild = newBounds;
 }
 
+//interleaves the low bits of x, y, z, with x most significant
+__host__ __device__ uint64_t interleaveBits(uint32_t x, uint32_t y, uint32_t z, int bits) {
+    uint64_t key = 0;
+    for (int b=bits-1; b>=0; b--) {
+        key = (key << 3) | (((x >> b) & 1) << 2) | (((y >> b) & 1) << 1) | ((z >> b) & 1);
+    }
+    return key;
+}
+
+//position along a 3d Hilbert curve (Skilling, AIP Conf. Proc. 707, 381 (2004))
+__host__ __device__ uint64_t hilbertKey(int3 sqrIdx, int bits) {
+    uint32_t X[3] = {(uint32_t) sqrIdx.x, (uint32_t) sqrIdx.y, (uint32_t) sqrIdx.z};
+    uint32_t M = 1u << (bits-1);
+    uint32_t t;
+    //inverse undo
+    for (uint32_t Q=M; Q>1; Q>>=1) {
+        uint32_t P = Q - 1;
+        for (int i=0; i<3; i++) {
+            if (X[i] & Q) {
+                X[0] ^= P;
+            } else {
+                t = (X[0] ^ X[i]) & P;
+                X[0] ^= t;
+                X[i] ^= t;
+            }
+        }
+    }
+    //gray encode
+    X[1] ^= X[0];
+    X[2] ^= X[1];
+    t = 0;
+    for (uint32_t Q=M; Q>1; Q>>=1) {
+        if (X[2] & Q) {
+            t ^= Q - 1;
+        }
+    }
+    for (int i=0; i<3; i++) {
+        X[i] ^= t;
+    }
+    return interleaveBits(X[0], X[1], X[2], bits);
+}
+
+//position of a cell along the curve given by State::gridOrder, with bits bits per dimension
+__host__ __device__ uint64_t cellCurveKey(int3 sqrIdx, int3 ns, int bits, int gridOrder) {
+    if (gridOrder == GRIDORDER::HILBERT) {
+        return hilbertKey(sqrIdx, bits);
+    } else if (gridOrder == GRIDORDER::MORTON) {
+        return interleaveBits(sqrIdx.x, sqrIdx.y, sqrIdx.z, bits);
+    }
+    return cellKey(sqrIdx, ns);
+}
+
+int curveBits(int3 ns) {
+    int bits = 1;
+    while ((1 << bits) < std::max(ns.x, std::max(ns.y, ns.z))) {
+        bits++;
+    }
+    return bits;
+}
+
+__global__ void insertCellKeys(float4 *xs, int nRingPoly, float3 os, float3 ds, int3 ns,
+                               unsigned long long *hashKeys, uint32_t hashMask) {
+    int idx = GETIDX();
+    if (idx < nRingPoly) {
+        int3 sqrIdx = make_int3((make_float3(xs[idx]) - os) / ds);
+        unsigned long long key = cellKey(sqrIdx, ns);
+        uint32_t h = cellHash(key) & hashMask;
+        while (true) {
+            unsigned long long old = atomicCAS(hashKeys + h, CELL_HASH_EMPTY, key);
+            if (old == CELL_HASH_EMPTY or old == key) {
+                break;
+            }
+            h = (h + 1) & hashMask;
+        }
+    }
+}
+
+struct CellSlotOccupied {
+    const unsigned long long *hashKeys;
+    __host__ __device__ bool operator()(uint32_t h) const {
+        return hashKeys[h] != CELL_HASH_EMPTY;
+    }
+};
+
+__global__ void occupiedCellCurveKeys(int numOccupied, const uint32_t *occupiedSlots, const unsigned long long *hashKeys,
+                                      int3 ns, int bits, int gridOrder, unsigned long long *curveKeys) {
+    int idx = GETIDX();
+    if (idx < numOccupied) {
+        unsigned long long key = hashKeys[occupiedSlots[idx]];
+        int3 sqrIdx = make_int3(key / ((unsigned long long) ns.y * ns.z), (key / ns.z) % ns.y, key % ns.z);
+        curveKeys[idx] = cellCurveKey(sqrIdx, ns, bits, gridOrder);
+    }
+}
+
+__global__ void numberOccupiedCells(int numOccupied, const uint32_t *occupiedSlots, int *hashSlots) {
+    int idx = GETIDX();
+    if (idx < numOccupied) {
+        hashSlots[occupiedSlots[idx]] = idx;
+    }
+}
+
+void GridGPU::hashOccupiedCells(float4 *centroids, int nRingPoly) {
+    //at most half full, so probes stay short
+    uint32_t hashSize = 1;
+    while (hashSize < 2*nRingPoly) {
+        hashSize <<= 1;
+    }
+    if (cellHashKeys.size() != hashSize) {
+        cellHashKeys = GPUArrayDeviceGlobal<unsigned long long>(hashSize);
+        cellHashSlots = GPUArrayDeviceGlobal<int>(hashSize);
+        occupiedSlots = GPUArrayDeviceGlobal<uint32_t>(hashSize);
+        occupiedCurveKeys = GPUArrayDeviceGlobal<unsigned long long>(hashSize);
+    }
+    cellHashKeys.memset(0xff);
+    insertCellKeys<<<NBLOCK(nRingPoly), PERBLOCK>>>(centroids, nRingPoly, os, ds, ns,
+                                                    cellHashKeys.data(), hashSize-1);
+
+    //number the occupied cells along the grid ordering, so atoms sorted by cell keep their spatial locality.  Only
+    //the count comes back to the host, to size perCellArray
+    thrust::counting_iterator<uint32_t> allSlots(0);
+    thrust::device_ptr<uint32_t> slots(occupiedSlots.data());
+    numOccupiedCells = thrust::copy_if(allSlots, allSlots + hashSize, slots,
+                                       CellSlotOccupied{cellHashKeys.data()}) - slots;
+    occupiedCellCurveKeys<<<NBLOCK(numOccupiedCells), PERBLOCK>>>(numOccupiedCells, occupiedSlots.data(),
+                                                                  cellHashKeys.data(), ns, curveBits(ns),
+                                                                  state->gridOrder, occupiedCurveKeys.data());
+    thrust::device_ptr<unsigned long long> curveKeys(occupiedCurveKeys.data());
+    thrust::sort_by_key(curveKeys, curveKeys + numOccupiedCells, slots);
+    numberOccupiedCells<<<NBLOCK(numOccupiedCells), PERBLOCK>>>(numOccupiedCells, occupiedSlots.data(),
+                                                                cellHashSlots.data());
+}
+
+CellMap GridGPU::cellMap() {
+    CellMap map;
+    map.order = cellOrder.size() ? cellOrder.d_data.data() : nullptr;
+    map.hashKeys = sparseCells ? cellHashKeys.data() : nullptr;
+    map.hashSlots = sparseCells ? cellHashSlots.data() : nullptr;
+    map.hashMask = cellHashKeys.size() - 1;
+    map.emptySlot = numOccupiedCells;
+    return map;
+}
+
+void GridGPU::updateCellOrder() {
+    if (state->gridOrder == GRIDORDER::ROWMAJOR) {
+        cellOrder = GPUArrayGlobal<int>();
+        return;
+    }
+    int numGridCells = prod(ns);
+    int bits = curveBits(ns);
+    std::vector<std::pair<uint64_t, int> > keys(numGridCells);
+    for (int x=0; x<ns.x; x++) {
+        for (int y=0; y<ns.y; y++) {
+            for (int z=0; z<ns.z; z++) {
+                int3 sqrIdx = make_int3(x, y, z);
+                uint64_t key = cellCurveKey(sqrIdx, ns, bits, state->gridOrder);
+                int lin = LINEARIDX(sqrIdx, ns);
+                keys[lin] = std::make_pair(key, lin);
+            }
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    cellOrder = GPUArrayGlobal<int>(numGridCells);
+    for (int i=0; i<numGridCells; i++) {
+        cellOrder.h_data[keys[i].second] = i;
+    }
+    if (state->backend != BACKEND::HOST) {
+        cellOrder.dataToDevice();
+    }
+}
+
 void GridGPU::initStream() {
     //std::cout << "initializing stream" << std::endl;
     //streamCreated = true;
@@ -80,6 +347,17 @@ void GridGPU::initStream() {
 
 GridGPU::GridGPU() {
     streamCreated = false;
+    clusterPairsHostValid = false;
+    halfListHost = false;
+    innerPadding = 0;
+    numChecksSinceLastPrune = 0;
+    numTypesMulti = 0;
+    multiCutoffActive = false;
+    sparseCells = false;
+    numOccupiedCells = 0;
+    singlePassCapacity = 0;
+    maxNeighborCount = GPUArrayDeviceGlobal<int>(2);
+    neighborlistCompressedValid = false;
     //initStream();
 }
 
@@ -116,6 +394,16 @@ GridGPU::GridGPU(State *state_, float dx_, float dy_, float dz_, float neighCuto
     padding = padding_;
     streamCreated = false;
     onlyPositionsFlag = false;
+    clusterPairsHostValid = false;
+    halfListHost = false;
+    innerPadding = 0;
+    numChecksSinceLastPrune = 0;
+    numTypesMulti = 0;
+    sparseCells = false;
+    numOccupiedCells = 0;
+    singlePassCapacity = 0;
+    maxNeighborCount = GPUArrayDeviceGlobal<int>(2);
+    neighborlistCompressedValid = false;
     ns = make_int3(0, 0, 0);
     minGridDim = make_float3(dx_, dy_, dz_);
     boundsLastBuild = BoundsGPU(make_float3(0, 0, 0), make_float3(0, 0, 0), make_float3(0, 0, 0));
@@ -200,13 +488,13 @@ __global__ void computeCentroids(float4 *centroids, float4 *xs, int nAtoms, int
 }
 __global__ void countNumInGridCells(float4 *xs, int nAtoms,
                                     uint32_t *counts, uint16_t *atomIdxs,
-                                    float3 os, float3 ds, int3 ns) {
+                                    float3 os, float3 ds, int3 ns, CellMap cellOrder) {
 
     int idx = GETIDX();
     if (idx < nAtoms) {
         //printf("idx %d\n", idx);
         int3 sqrIdx = make_int3((make_float3(xs[idx]) - os) / ds);
-        int sqrLinIdx = LINEARIDX(sqrIdx, ns);
+        int sqrLinIdx = cellOrder(sqrIdx, ns);
         //printf("lin is %d\n", sqrLinIdx);
         uint16_t myPlaceInGrid = atomicAdd(counts + sqrLinIdx, 1); //atomicAdd returns old value
         //printf("grid is %d\n", myPlaceInGrid);
@@ -217,6 +505,41 @@ __global__ void countNumInGridCells(float4 *xs, int nAtoms,
 
 }
 
+//for deterministic runs.  The place in a grid cell handed out by countNumInGridCells depends on the order
+//threads reach the atomic, so scatter each ring polymer to its slot, then re-rank within each cell by id
+__global__ void scatterToGridSlots(float4 *centroids, int nRingPoly, uint32_t *gridCellArrayIdxs, uint16_t *idxInGridCell,
+                                   int *rpInSlot, float3 os, float3 ds, int3 ns, CellMap cellOrder) {
+    int idx = GETIDX();
+    if (idx < nRingPoly) {
+        int3 sqrIdx = make_int3((make_float3(centroids[idx]) - os) / ds);
+        int sqrLinIdx = cellOrder(sqrIdx, ns);
+        rpInSlot[gridCellArrayIdxs[sqrLinIdx] + idxInGridCell[idx]] = idx;
+    }
+}
+
+__global__ void rankInGridCellsById(int numGridCells, uint32_t *gridCellArrayIdxs, uint16_t *idxInGridCell,
+                                    int *rpInSlot, uint *ids, int nPerRingPoly) {
+    int idx = GETIDX();
+    if (idx < numGridCells) {
+        int start = gridCellArrayIdxs[idx];
+        int end = gridCellArrayIdxs[idx+1];
+        //cells hold few atoms, so insertion sort is fine
+        for (int i=start+1; i<end; i++) {
+            int rp = rpInSlot[i];
+            uint id = ids[rp*nPerRingPoly];
+            int j = i-1;
+            while (j >= start and ids[rpInSlot[j]*nPerRingPoly] > id) {
+                rpInSlot[j+1] = rpInSlot[j];
+                j--;
+            }
+            rpInSlot[j+1] = rp;
+        }
+        for (int i=start; i<end; i++) {
+            idxInGridCell[rpInSlot[i]] = i - start;
+        }
+    }
+}
+
 
 /*
 __global__ void printNeighbors(int *neighborlistBounds, cudaTextureObject_t neighbors,
@@ -283,7 +606,7 @@ __global__ void sortPerAtomArrays(
                     int *idToIdxs,
                     bool requiresCharges,
                     uint32_t *gridCellArrayIdxs, uint16_t *idxInGridCell, int nRingPoly,
-                    float3 os, float3 ds, int3 ns,
+                    float3 os, float3 ds, int3 ns, CellMap cellOrder,
                     int nPerRingPoly) {
 
     int idx = GETIDX();
@@ -292,7 +615,7 @@ __global__ void sortPerAtomArrays(
         float3 pos       = make_float3(posWhole);
         //uint   id        = idsFrom[idx * nPerRingPoly];
         int3   sqrIdx    = make_int3((pos - os) / ds);
-        int    sqrLinIdx = LINEARIDX(sqrIdx, ns);
+        int    sqrLinIdx = cellOrder(sqrIdx, ns);
         int    sortedIdx = gridCellArrayIdxs[sqrLinIdx] + idxInGridCell[idx];
         //printf("I MOVE FROM %d TO %d, id is %d , MY POS IS %f %f %f\n", idx, sortedIdx, id, pos.x, pos.y, pos.z);
 
@@ -322,7 +645,7 @@ __global__ void sortPerAtomArrays_xsOnly(
                     uint *idsFrom, uint *idsTo,
                     int *idToIdxs,
                     uint32_t *gridCellArrayIdxs, uint16_t *idxInGridCell, int nRingPoly,
-                    float3 os, float3 ds, int3 ns, int nPerRingPoly) {
+                    float3 os, float3 ds, int3 ns, CellMap cellOrder, int nPerRingPoly) {
 
     int idx = GETIDX();
     if (idx < nRingPoly) {
@@ -330,7 +653,7 @@ __global__ void sortPerAtomArrays_xsOnly(
         float3 pos = make_float3(posWhole);
         //uint id = idsFrom[idx];
         int3 sqrIdx = make_int3((pos - os) / ds);
-        int sqrLinIdx = LINEARIDX(sqrIdx, ns);
+        int sqrLinIdx = cellOrder(sqrIdx, ns);
         int sortedIdx = gridCellArrayIdxs[sqrLinIdx] + idxInGridCell[idx];
 
         //okay, now have all data needed to do copies
@@ -349,25 +672,55 @@ __global__ void sortPerAtomArrays_xsOnly(
 /*! modifies myCount to be the number of neighbors in this cell */
 __device__ void checkCell(float3 pos, float4 *xs,
                           uint32_t *gridCellArrayIdxs, int squareIdx,
-                          float3 loop, float neighCutSqr, int &myCount, int nThreadPerRP, int myIdxInAtomTeam) {
+                          float3 loop, float neighCutSqr, const float *typeCutSqrRow,
+                          int &myCount, int nThreadPerRP, int myIdxInAtomTeam) {
 
     uint32_t idxMin = gridCellArrayIdxs[squareIdx];
     uint32_t idxMax = gridCellArrayIdxs[squareIdx+1];
     for (int i=idxMin+myIdxInAtomTeam; i<idxMax; i+=nThreadPerRP) {
-        float3 otherPos = make_float3(xs[i]);
-        float3 distVec  = otherPos + loop - pos;
-        if (dot(distVec, distVec) < neighCutSqr) {
+        float4 otherPosWhole = xs[i];
+        float3 distVec  = make_float3(otherPosWhole) + loop - pos;
+        float cutSqr = typeCutSqrRow ? typeCutSqrRow[__float_as_int(otherPosWhole.w)] : neighCutSqr;
+        if (dot(distVec, distVec) < cutSqr) {
             myCount++;
         }
     }
 }
 
+//Cells searched by an atom.  With per type pair cutoffs (typeNeighCutSqrs not null), the cells out to the longest
+//cutoff of the atom's type, and the row of squared cutoffs for its type.  Otherwise the 27 cells around it
+__device__ void typeStencil(float4 posWhole, float3 ds, const float *typeNeighCutSqrs, const float *typeNeighCutMaxs,
+                            int numTypes, int3 &reach, float &searchCutSqr, const float *&typeCutSqrRow) {
+    reach = make_int3(1, 1, 1);
+    searchCutSqr = 0;
+    typeCutSqrRow = nullptr;
+    if (typeNeighCutSqrs) {
+        int type = __float_as_int(posWhole.w);
+        float searchCut = typeNeighCutMaxs[type];
+        searchCutSqr = searchCut * searchCut;
+        reach = make_int3(ceilf(searchCut / ds.x), ceilf(searchCut / ds.y), ceilf(searchCut / ds.z));
+        typeCutSqrRow = typeNeighCutSqrs + type*numTypes;
+    }
+}
+
+//squared distance from pos to the nearest point of the cell d cells away from sqrIdx, the cell containing pos
+__device__ float cellDistSqr(float3 pos, int3 sqrIdx, int3 d, float3 os, float3 ds) {
+    float3 inCell = pos - (os + make_float3(sqrIdx) * ds);
+    float3 gap;
+    gap.x = d.x > 0 ? d.x*ds.x - inCell.x : (d.x < 0 ? inCell.x - (d.x+1)*ds.x : 0);
+    gap.y = d.y > 0 ? d.y*ds.y - inCell.y : (d.y < 0 ? inCell.y - (d.y+1)*ds.y : 0);
+    gap.z = d.z > 0 ? d.z*ds.z - inCell.z : (d.z < 0 ? inCell.z - (d.z+1)*ds.z : 0);
+    return dot(gap, gap);
+}
+
 template
 <int MULTITHREADPERATOM>
 __global__ void countNumNeighbors(float4 *xs, int nRingPoly,
                                   uint16_t *neighborCounts, uint32_t *gridCellArrayIdxs,
-                                  float3 os, float3 ds, int3 ns,
-                                  float3 periodic, float3 trace, float neighCutSqr, int nThreadPerRP) {
+                                  float3 os, float3 ds, int3 ns, CellMap cellOrder,
+                                  float3 periodic, float3 trace, float neighCutSqr,
+                                  const float *typeNeighCutSqrs, const float *typeNeighCutMaxs, int numTypes,
+                                  int nThreadPerRP) {
 
     extern __shared__ uint16_t counts_shr[];
     int idx = GETIDX();
@@ -392,31 +745,38 @@ __global__ void countNumNeighbors(float4 *xs, int nRingPoly,
         } else {
             myIdxInAtomTeam = 0;
         }
+        int3 reach;
+        float searchCutSqr;
+        const float *typeCutSqrRow;
+        typeStencil(posWhole, ds, typeNeighCutSqrs, typeNeighCutMaxs, numTypes, reach, searchCutSqr, typeCutSqrRow);
 
         int xIdx, yIdx, zIdx;
         int xIdxLoop, yIdxLoop, zIdxLoop;
         float3 offset = make_float3(0, 0, 0);
-        for (xIdx=sqrIdx.x-1; xIdx<=sqrIdx.x+1; xIdx++) {
+        for (xIdx=sqrIdx.x-reach.x; xIdx<=sqrIdx.x+reach.x; xIdx++) {
             offset.x = -floorf((float) xIdx / ns.x);
             xIdxLoop = xIdx + ns.x * offset.x;
             if (periodic.x || (!periodic.x && xIdxLoop == xIdx)) {
 
-                for (yIdx=sqrIdx.y-1; yIdx<=sqrIdx.y+1; yIdx++) {
+                for (yIdx=sqrIdx.y-reach.y; yIdx<=sqrIdx.y+reach.y; yIdx++) {
                     offset.y = -floorf((float) yIdx / ns.y);
                     yIdxLoop = yIdx + ns.y * offset.y;
                     if (periodic.y || (!periodic.y && yIdxLoop == yIdx)) {
 
-                        for (zIdx=sqrIdx.z-1; zIdx<=sqrIdx.z+1; zIdx++) {
+                        for (zIdx=sqrIdx.z-reach.z; zIdx<=sqrIdx.z+reach.z; zIdx++) {
                             offset.z = -floorf((float) zIdx / ns.z);
                             zIdxLoop = zIdx + ns.z * offset.z;
+                            if (typeCutSqrRow and cellDistSqr(pos, sqrIdx, make_int3(xIdx-sqrIdx.x, yIdx-sqrIdx.y, zIdx-sqrIdx.z), os, ds) > searchCutSqr) {
+                                continue;
+                            }
                             if (periodic.z || (!periodic.z && zIdxLoop == zIdx)) {
                                 int3 sqrIdxOther    = make_int3(xIdxLoop, yIdxLoop, zIdxLoop);
-                                int  sqrIdxOtherLin = LINEARIDX(sqrIdxOther, ns);
+                                int  sqrIdxOtherLin = cellOrder(sqrIdxOther, ns);
                                 float3 loop = (-offset) * trace;
                                 // updates myCount for this cell
                                 checkCell(pos, xs, 
                                           gridCellArrayIdxs, sqrIdxOtherLin,
-                                          loop, neighCutSqr, myCount, nThreadPerRP, myIdxInAtomTeam);
+                                          loop, neighCutSqr, typeCutSqrRow, myCount, nThreadPerRP, myIdxInAtomTeam);
                                 //note sign switch on offset!
 
                             } // endif periodic.z
@@ -467,8 +827,9 @@ template
 <int MULTITHREADPERATOM, int CHECKIDS, bool EXCLUSIONS>
 __device__ int assignFromCell(float3 pos, int idx, uint myId, float4 *xs, uint *ids,
                               uint32_t *gridCellArrayIdxs, int squareIdx,
-                              float3 offset, float3 trace, float neighCutSqr,
-                              int currentNeighborIdx, uint32_t *teamNlist_base_shr, int teamOffset, uint *neighborlist,
+                              float3 offset, float3 trace, float neighCutSqr, const float *typeCutSqrRow,
+                              int currentNeighborIdx, int &myCount, int capacity,
+                              uint32_t *teamNlist_base_shr, int teamOffset, uint *neighborlist,
                               uint *exclusionIds_shr, int exclIdxLo_shr, int exclIdxHi_shr,
                               int nPerRingPoly, int nThreadPerRP,
                               int warpSize, int myIdxInTeam, bool validThread) {
@@ -495,27 +856,26 @@ __device__ int assignFromCell(float3 pos, int idx, uint myId, float4 *xs, uint *
         bool validAtom = i<idxMax;
         uint nlistItem = nlistDefault;
         if (validAtom) {
-            float3 otherPos = make_float3(xs[i]);
-            float3 distVec = otherPos + (offset * trace) - pos;
+            float4 otherPosWhole = xs[i];
+            float3 distVec = make_float3(otherPosWhole) + (offset * trace) - pos;
             uint otherId = ids[i*nPerRingPoly];
             bool idsFine = CHECKIDS ? myId != otherId : true;
-            if (idsFine && dot(distVec, distVec) < neighCutSqr) {
+            float cutSqr = typeCutSqrRow ? typeCutSqrRow[__float_as_int(otherPosWhole.w)] : neighCutSqr;
+            if (idsFine && dot(distVec, distVec) < cutSqr) {
                 if (EXCLUSIONS) {
                     uint exclusionTag = addExclusion(otherId, exclusionIds_shr, exclIdxLo_shr, exclIdxHi_shr);
 
-                    if (MULTITHREADPERATOM) {
-                        nlistItem = (i | exclusionTag);
-                    } else {
-                        neighborlist[currentNeighborIdx] = (i | exclusionTag);
-                        currentNeighborIdx += warpSize;
-                    }
+                    nlistItem = (i | exclusionTag);
                 } else {
-                    if (MULTITHREADPERATOM) {
-                        nlistItem = i;
-                    } else {
-                        neighborlist[currentNeighborIdx] = i;
-                        currentNeighborIdx += warpSize;
+                    nlistItem = i;
+                }
+                if (!MULTITHREADPERATOM) {
+                    //neighbors past capacity are only counted, and the list is rebuilt with room for them
+                    if (myCount < capacity) {
+                        neighborlist[currentNeighborIdx] = nlistItem;
                     }
+                    currentNeighborIdx += warpSize;
+                    myCount++;
                 }
             }
         }
@@ -532,7 +892,10 @@ __device__ int assignFromCell(float3 pos, int idx, uint myId, float4 *xs, uint *
             if (validAtom and myIdxInTeam==0) {
                 for (int tIdx=0; tIdx<nThreadPerRP; tIdx++) {
                     if (teamNlist_base_shr[teamOffset+tIdx]!=nlistDefault) {
-                        neighborlist[currentNeighborIdx] = teamNlist_base_shr[teamOffset+tIdx];
+                        if (myCount < capacity) {
+                            neighborlist[currentNeighborIdx] = teamNlist_base_shr[teamOffset+tIdx];
+                        }
+                        myCount++;
                         currentNeighborIdx++;
                         if ((currentNeighborIdx % nThreadPerRP)==0) {
                             currentNeighborIdx += (warpSize - nThreadPerRP);
@@ -551,10 +914,12 @@ __device__ int assignFromCell(float3 pos, int idx, uint myId, float4 *xs, uint *
 template <int MULTITHREADPERATOM, bool EXCLUSIONS>
 __global__ void assignNeighbors(float4 *xs, int nRingPoly, int nPerRingPoly, uint *ids,
                                 uint32_t *gridCellArrayIdxs, uint32_t *cumulSumMaxPerBlock,
-                                float3 os, float3 ds, int3 ns,
+                                float3 os, float3 ds, int3 ns, CellMap cellOrder,
                                 float3 periodic, float3 trace, float neighCutSqr,
+                                const float *typeNeighCutSqrs, const float *typeNeighCutMaxs, int numTypes,
                                 uint *neighborlist, int warpSize,
-                                int *exclusionIndexes, uint *exclusionIds, int maxExclusionsPerAtom, int nThreadPerRP) {
+                                int *exclusionIndexes, uint *exclusionIds, int maxExclusionsPerAtom, int nThreadPerRP,
+                                uint16_t *neighborCounts, int capacity, int *maxNeighborCount) {
 
     // extern __shared__ int exclusions_shr[];
     extern __shared__ uint32_t exclusionIds_shr[];
@@ -621,6 +986,11 @@ __global__ void assignNeighbors(float4 *xs, int nRingPoly, int nPerRingPoly, uin
     int xIdx, yIdx, zIdx;
     int xIdxLoop, yIdxLoop, zIdxLoop;
     int currentNeighborIdx;
+    int myCount = 0;
+    //the 27 cells for invalid threads, which search no cells but must match their team's loop
+    int3 reach = make_int3(1, 1, 1);
+    float searchCutSqr = 0;
+    const float *typeCutSqrRow = nullptr;
 
 
     if (validThread) {
@@ -630,30 +1000,36 @@ __global__ void assignNeighbors(float4 *xs, int nRingPoly, int nPerRingPoly, uin
         //printf("atom idx %d tid %d base idx %d\n", idx/nThreadPerRP, threadIdx.x, currentNeighborIdx); 
         pos = make_float3(posWhole);
         sqrIdx = make_int3((pos - os) / ds);
+        typeStencil(posWhole, ds, typeNeighCutSqrs, typeNeighCutMaxs, numTypes, reach, searchCutSqr, typeCutSqrRow);
     }
-    currentNeighborIdx = assignFromCell<MULTITHREADPERATOM, 1,EXCLUSIONS>(pos, idx, myId, xs, ids, gridCellArrayIdxs, LINEARIDX(sqrIdx, ns), offset, trace, neighCutSqr, currentNeighborIdx, teamNlist_base_shr, teamOffset, neighborlist, exclusionIds_shr, exclIdxLo_shr, exclIdxHi_shr, nPerRingPoly, nThreadPerRP, warpSize, myIdxInTeam, validThread);
-    for (xIdx=sqrIdx.x-1; xIdx<=sqrIdx.x+1; xIdx++) {
+    //invalid threads still take part in the shared memory compaction, but have no cell to look up
+    int sqrLinIdx = validThread ? cellOrder(sqrIdx, ns) : 0;
+    currentNeighborIdx = assignFromCell<MULTITHREADPERATOM, 1,EXCLUSIONS>(pos, idx, myId, xs, ids, gridCellArrayIdxs, sqrLinIdx, offset, trace, neighCutSqr, typeCutSqrRow, currentNeighborIdx, myCount, capacity, teamNlist_base_shr, teamOffset, neighborlist, exclusionIds_shr, exclIdxLo_shr, exclIdxHi_shr, nPerRingPoly, nThreadPerRP, warpSize, myIdxInTeam, validThread);
+    for (xIdx=sqrIdx.x-reach.x; xIdx<=sqrIdx.x+reach.x; xIdx++) {
         offset.x = -floorf((float) xIdx / ns.x);
         xIdxLoop = xIdx + ns.x * offset.x;
         if (periodic.x || (!periodic.x && xIdxLoop == xIdx)) {
 
-            for (yIdx=sqrIdx.y-1; yIdx<=sqrIdx.y+1; yIdx++) {
+            for (yIdx=sqrIdx.y-reach.y; yIdx<=sqrIdx.y+reach.y; yIdx++) {
                 offset.y = -floorf((float) yIdx / ns.y);
                 yIdxLoop = yIdx + ns.y * offset.y;
                 if (periodic.y || (!periodic.y && yIdxLoop == yIdx)) {
 
-                    for (zIdx=sqrIdx.z-1; zIdx<=sqrIdx.z+1; zIdx++) {
+                    for (zIdx=sqrIdx.z-reach.z; zIdx<=sqrIdx.z+reach.z; zIdx++) {
                         offset.z = -floorf((float) zIdx / ns.z);
                         zIdxLoop = zIdx + ns.z * offset.z;
+                        if (typeCutSqrRow and cellDistSqr(pos, sqrIdx, make_int3(xIdx-sqrIdx.x, yIdx-sqrIdx.y, zIdx-sqrIdx.z), os, ds) > searchCutSqr) {
+                            continue;
+                        }
                         if (periodic.z || (!periodic.z && zIdxLoop == zIdx)) {
                             if (! (xIdx == sqrIdx.x and yIdx == sqrIdx.y and zIdx == sqrIdx.z) ) {
 
                                 int3 sqrIdxOther = make_int3(xIdxLoop, yIdxLoop, zIdxLoop);
-                                int sqrIdxOtherLin = LINEARIDX(sqrIdxOther, ns);
+                                int sqrIdxOtherLin = validThread ? cellOrder(sqrIdxOther, ns) : 0;
                                 currentNeighborIdx = assignFromCell<MULTITHREADPERATOM, 0,EXCLUSIONS>(
                                         pos, idx, myId, xs, ids, gridCellArrayIdxs,
-                                        sqrIdxOtherLin, -offset, trace, neighCutSqr,
-                                        currentNeighborIdx,
+                                        sqrIdxOtherLin, -offset, trace, neighCutSqr, typeCutSqrRow,
+                                        currentNeighborIdx, myCount, capacity,
                                         teamNlist_base_shr,
                                         teamOffset, neighborlist,
                                         exclusionIds_shr, exclIdxLo_shr, exclIdxHi_shr,
@@ -670,6 +1046,15 @@ __global__ void assignNeighbors(float4 *xs, int nRingPoly, int nPerRingPoly, uin
         } // endif periodic.x
     } // endfor xIdx
 
+    //with multiple threads per ring polymer, the first of the team did the writing and has the count
+    if (validThread and myIdxInTeam == 0) {
+        if (neighborCounts) {
+            neighborCounts[idx/nThreadPerRP] = min(myCount, capacity);
+        }
+        if (myCount > *maxNeighborCount) {
+            atomicMax(maxNeighborCount, myCount);
+        }
+    }
 }
 /**/
 
@@ -692,34 +1077,282 @@ void setPerBlockCounts(std::vector<uint16_t> &neighborCounts, std::vector<uint32
 }
 
 
+//Sets buildFlag[0] if any atom moved too far since xsB, the positions of the last build.  If xsLastPrune is given,
+//also sets buildFlag[1] if any atom moved too far for the pruned inner list, so both are read with one copy.
+__device__ float maxMoveSqrAfter(int numChecks, float paddingSqr) {
+    float maxMoveRatio = std::fminf(
+                    0.95,
+                    (numChecks+1) / (float)(numChecks+2));
+    return paddingSqr * maxMoveRatio * maxMoveRatio;
+}
+
 __global__ void setBuildFlag(float4 *xsA, float4 *xsB, int nAtoms, BoundsGPU boundsGPU,
-                             float paddingSqr, int *buildFlag, int numChecksSinceBuild, int warpSize) {
+                             float paddingSqr, int *buildFlag, int numChecksSinceBuild, int warpSize,
+                             float4 *xsLastPrune, float prunePaddingSqr, int numChecksSincePrune) {
 
     int idx = GETIDX();
     extern __shared__ short flags_shr[];
+    short *pruneFlags_shr = flags_shr + blockDim.x;
     if (idx < nAtoms) {
-        float3 distVector = boundsGPU.minImage(make_float3(xsA[idx] - xsB[idx]));
+        float4 pos = xsA[idx];
+        float3 distVector = boundsGPU.minImage(make_float3(pos - xsB[idx]));
         float lenSqr = lengthSqr(distVector);
-        float maxMoveRatio = std::fminf(
-                        0.95,
-                        (numChecksSinceBuild+1) / (float)(numChecksSinceBuild+2));
-        float maxMoveSqr = paddingSqr * maxMoveRatio * maxMoveRatio;
         // printf("moved %f\n", sqrtf(lenSqr));
-        // printf("max move is %f\n", maxMoveSqr);
-        flags_shr[threadIdx.x] = (short) (lenSqr > maxMoveSqr);
+        flags_shr[threadIdx.x] = (short) (lenSqr > maxMoveSqrAfter(numChecksSinceBuild, paddingSqr));
+        if (xsLastPrune) {
+            float3 pruneDistVector = boundsGPU.minImage(make_float3(pos - xsLastPrune[idx]));
+            pruneFlags_shr[threadIdx.x] = (short) (lengthSqr(pruneDistVector) > maxMoveSqrAfter(numChecksSincePrune, prunePaddingSqr));
+        } else {
+            pruneFlags_shr[threadIdx.x] = 0;
+        }
     } else {
         flags_shr[threadIdx.x] = 0;
+        pruneFlags_shr[threadIdx.x] = 0;
     }
     __syncthreads();
     //just took from parallel reduction in cutils_func
     reduceByN<short>(flags_shr, blockDim.x, warpSize);
+    if (xsLastPrune) {
+        reduceByN<short>(pruneFlags_shr, blockDim.x, warpSize);
+    }
     if (threadIdx.x == 0 and flags_shr[0] != 0) {
         buildFlag[0] = 1;
     }
+    if (threadIdx.x == 0 and xsLastPrune and pruneFlags_shr[0] != 0) {
+        buildFlag[1] = 1;
+    }
 
 }
 
 
+//index of a ring polymer's nth neighbor in the list
+__device__ int neighborRowIdx(int baseIdx, int nthNeigh, int nThreadPerRP, int warpSize) {
+    return baseIdx + nthNeigh%nThreadPerRP + warpSize * (nthNeigh/nThreadPerRP);
+}
+
+//copies the entries of the outer list within innerCut into the inner list.  The inner list uses the
+//same per-block offsets as the outer one, which is fine since it never has more neighbors per atom.
+__global__ void pruneNeighbors(float4 *xs, int nRingPoly, BoundsGPU bounds, float innerCutSqr,
+                               uint16_t *outerCounts, uint *outerNlist,
+                               uint16_t *innerCounts, uint *innerNlist,
+                               uint32_t *cumulSumMaxPerBlock, int warpSize, int nThreadPerBlock, int nThreadPerRP) {
+    int idx = GETIDX();
+    if (idx < nRingPoly) {
+        //the list is laid out for pair kernels of nThreadPerBlock threads, while this kernel runs one thread per ring polymer
+        int baseIdx = baseNeighlistIdxFromRPIndex(cumulSumMaxPerBlock, warpSize, idx, nThreadPerRP, nThreadPerBlock);
+
+        float3 pos = make_float3(xs[idx]);
+        int numOuter = outerCounts[idx];
+        int numInner = 0;
+        for (int nthNeigh=0; nthNeigh<numOuter; nthNeigh++) {
+            uint otherIdxRaw = outerNlist[neighborRowIdx(baseIdx, nthNeigh, nThreadPerRP, warpSize)];
+            uint otherIdx = otherIdxRaw & EXCL_MASK;
+            float3 dr = bounds.minImage(pos - make_float3(xs[otherIdx]));
+            if (lengthSqr(dr) < innerCutSqr) {
+                innerNlist[neighborRowIdx(baseIdx, numInner, nThreadPerRP, warpSize)] = otherIdxRaw;
+                numInner++;
+            }
+        }
+        innerCounts[idx] = numInner;
+    }
+}
+
+//orders each atom's row so that the entries within each sub-list cutoff come first, shortest cutoff first.  Entries
+//are only swapped within a row, so the layout is unchanged and the full list is still the first counts entries
+__global__ void partitionNeighbors(float4 *xs, int nRingPoly, BoundsGPU bounds, float *subListCutSqrs, int nSubLists,
+                                   uint16_t *counts, uint *nlist, uint16_t *subListCounts,
+                                   uint32_t *cumulSumMaxPerBlock, int warpSize, int nThreadPerBlock, int nThreadPerRP) {
+    int idx = GETIDX();
+    if (idx < nRingPoly) {
+        int baseIdx = baseNeighlistIdxFromRPIndex(cumulSumMaxPerBlock, warpSize, idx, nThreadPerRP, nThreadPerBlock);
+
+        float3 pos = make_float3(xs[idx]);
+        int numNeigh = counts[idx];
+        int numSorted = 0;
+        for (int i=0; i<nSubLists; i++) {
+            float cutSqr = subListCutSqrs[i];
+            for (int nthNeigh=numSorted; nthNeigh<numNeigh; nthNeigh++) {
+                int nlistIdx = neighborRowIdx(baseIdx, nthNeigh, nThreadPerRP, warpSize);
+                uint otherIdxRaw = nlist[nlistIdx];
+                float3 dr = bounds.minImage(pos - make_float3(xs[otherIdxRaw & EXCL_MASK]));
+                if (lengthSqr(dr) < cutSqr) {
+                    int sortedIdx = neighborRowIdx(baseIdx, numSorted, nThreadPerRP, warpSize);
+                    nlist[nlistIdx] = nlist[sortedIdx];
+                    nlist[sortedIdx] = otherIdxRaw;
+                    numSorted++;
+                }
+            }
+            subListCounts[i*nRingPoly + idx] = numSorted;
+        }
+    }
+}
+
+//orders each sub-list of a ring polymer's neighbors by index, so the differences stored by compressNeighborlist are small.
+//Rows come out of assignNeighbors mostly in order, so insertion sort does little work
+__global__ void sortNeighborSegments(int nRingPoly, uint16_t *counts, uint16_t *subListCounts, int nSubLists, uint *nlist,
+                                     uint32_t *cumulSumMaxPerBlock, int warpSize, int nThreadPerBlock, int nThreadPerRP) {
+    int idx = GETIDX();
+    if (idx < nRingPoly) {
+        int baseIdx = baseNeighlistIdxFromRPIndex(cumulSumMaxPerBlock, warpSize, idx, nThreadPerRP, nThreadPerBlock);
+
+        int segStart = 0;
+        for (int s=0; s<=nSubLists; s++) {
+            int segEnd = s < nSubLists ? subListCounts[s*nRingPoly + idx] : counts[idx];
+            for (int i=segStart+1; i<segEnd; i++) {
+                uint raw = nlist[neighborRowIdx(baseIdx, i, nThreadPerRP, warpSize)];
+                uint key = raw & EXCL_MASK;
+                int j = i-1;
+                while (j >= segStart) {
+                    uint other = nlist[neighborRowIdx(baseIdx, j, nThreadPerRP, warpSize)];
+                    uint otherKey = other & EXCL_MASK;
+                    if (otherKey <= key) {
+                        break;
+                    }
+                    nlist[neighborRowIdx(baseIdx, j+1, nThreadPerRP, warpSize)] = other;
+                    j--;
+                }
+                nlist[neighborRowIdx(baseIdx, j+1, nThreadPerRP, warpSize)] = raw;
+            }
+            segStart = segEnd;
+        }
+    }
+}
+
+//Compressed list kernels run one thread per reading thread of the pair kernels, so each block covers one block of the layout
+template <bool WRITE>
+__global__ void encodeNeighbors(int nRingPoly, uint16_t *counts, uint *nlist, uint32_t *cumulSumMaxPerBlock,
+                                uint32_t *wordsPerWarp, uint16_t *words, uint32_t *cumulSumWordsPerBlock,
+                                int warpSize, int nThreadPerRP) {
+    __shared__ uint32_t maxWords_shr;
+    if (not WRITE) {
+        if (threadIdx.x == 0) {
+            maxWords_shr = 0;
+        }
+        __syncthreads();
+    }
+    int idx = GETIDX();
+    int ringPolyIdx = idx / nThreadPerRP;
+    if (ringPolyIdx < nRingPoly) {
+        int myIdxInTeam = threadIdx.x % nThreadPerRP;
+        int baseIdx = baseNeighlistIdxFromRPIndex(cumulSumMaxPerBlock, warpSize, ringPolyIdx, nThreadPerRP) + myIdxInTeam;
+        int wordIdx = 0;
+        if (WRITE) {
+            wordIdx = baseNeighlistIdxFromRPIndex(cumulSumWordsPerBlock, warpSize, ringPolyIdx, nThreadPerRP) + myIdxInTeam;
+        }
+        uint32_t numWords = 0;
+        uint prev = 0;
+        int numNeigh = counts[ringPolyIdx];
+        for (int nthNeigh=myIdxInTeam, k=0; nthNeigh<numNeigh; nthNeigh+=nThreadPerRP, k++) {
+            uint raw = nlist[baseIdx + warpSize*k];
+            if (WRITE) {
+                wordIdx = writeCompressedNeighbor(words, wordIdx, warpSize, raw, prev);
+            } else {
+                numWords += compressedNeighborSize(raw, prev);
+            }
+            prev = raw & EXCL_MASK;
+        }
+        if (not WRITE) {
+            atomicMax(&maxWords_shr, numWords);
+        }
+    }
+    if (not WRITE) {
+        __syncthreads();
+        if (threadIdx.x == 0) {
+            wordsPerWarp[blockIdx.x] = maxWords_shr * warpSize;
+        }
+    }
+}
+
+//prunes the compressed outer list into the compressed inner one, one thread per stream of words.  Each stream keeps
+//its entries in order, so with no entry taking more than two words it never gets longer and the inner list fits the
+//outer list's layout.  Streams with fewer entries within innerCut than the longest of their ring polymer are filled
+//up with their last dropped entries, which the pair kernels skip by distance.  The sub-lists are the prefixes holding
+//the entries of the outer sub-lists, which were partitioned with the full padding and so stay valid until the next build
+__global__ void pruneNeighborsCompressed(float4 *xs, int nRingPoly, BoundsGPU bounds, float innerCutSqr,
+                                         uint16_t *outerCounts, uint16_t *outerSubListCounts, uint16_t *outerWords,
+                                         uint16_t *innerCounts, uint16_t *innerSubListCounts, uint16_t *innerWords,
+                                         int nSubLists, uint32_t *cumulSumWordsPerBlock, int warpSize, int nThreadPerRP) {
+    //per ring polymer of the block, the count of each sub-list then of the full list
+    extern __shared__ int counts_shr[];
+    int *myCounts_shr = counts_shr + (threadIdx.x / nThreadPerRP) * (nSubLists+1);
+    int myIdxInTeam = threadIdx.x % nThreadPerRP;
+    if (myIdxInTeam == 0) {
+        for (int s=0; s<=nSubLists; s++) {
+            myCounts_shr[s] = 0;
+        }
+    }
+    __syncthreads();
+    int idx = GETIDX();
+    int ringPolyIdx = idx / nThreadPerRP;
+    bool active = ringPolyIdx < nRingPoly;
+    int wordIdx = 0;
+    int numMine = 0;
+    int numKept = 0;
+    float3 pos;
+    NeighborlistCompressed outer(outerWords, cumulSumWordsPerBlock);
+    if (active) {
+        wordIdx = baseNeighlistIdxFromRPIndex(cumulSumWordsPerBlock, warpSize, ringPolyIdx, nThreadPerRP) + myIdxInTeam;
+        pos = make_float3(xs[ringPolyIdx]);
+        int numOuter = outerCounts[ringPolyIdx];
+        numMine = numOuter > myIdxInTeam ? (numOuter - myIdxInTeam + nThreadPerRP - 1) / nThreadPerRP : 0;
+        NeighborReader neighbors(nullptr, outer, 0, wordIdx, warpSize);
+        for (int k=0; k<numMine; k++) {
+            uint otherIdx = neighbors.next() & EXCL_MASK;
+            float3 dr = bounds.minImage(pos - make_float3(xs[otherIdx]));
+            numKept += lengthSqr(dr) < innerCutSqr;
+        }
+        //fewest neighbors for which this stream holds numKept
+        if (numKept) {
+            atomicMax(myCounts_shr + nSubLists, nThreadPerRP*(numKept-1) + myIdxInTeam + 1);
+        }
+    }
+    __syncthreads();
+    if (active) {
+        int numInner = myCounts_shr[nSubLists];
+        int numInnerMine = numInner > myIdxInTeam ? (numInner - myIdxInTeam + nThreadPerRP - 1) / nThreadPerRP : 0;
+        int firstFill = (numMine - numKept) - (numInnerMine - numKept);
+        int numDropped = 0;
+        int numWritten = 0;
+        int subList = 0;
+        uint prev = 0;
+        int innerWordIdx = wordIdx;
+        NeighborReader neighbors(nullptr, outer, 0, wordIdx, warpSize);
+        for (int k=0; k<numMine; k++) {
+            int nthNeigh = myIdxInTeam + k*nThreadPerRP;
+            for (; subList<nSubLists and nthNeigh >= outerSubListCounts[subList*nRingPoly + ringPolyIdx]; subList++) {
+                if (numWritten) {
+                    atomicMax(myCounts_shr + subList, nThreadPerRP*(numWritten-1) + myIdxInTeam + 1);
+                }
+            }
+            uint raw = neighbors.next();
+            uint otherIdx = raw & EXCL_MASK;
+            float3 dr = bounds.minImage(pos - make_float3(xs[otherIdx]));
+            bool keep = lengthSqr(dr) < innerCutSqr;
+            if (not keep) {
+                keep = numDropped >= firstFill;
+                numDropped++;
+            }
+            if (keep) {
+                innerWordIdx = writeCompressedNeighbor(innerWords, innerWordIdx, warpSize, raw, prev);
+                prev = otherIdx;
+                numWritten++;
+            }
+        }
+        for (; subList<nSubLists; subList++) {
+            if (numWritten) {
+                atomicMax(myCounts_shr + subList, nThreadPerRP*(numWritten-1) + myIdxInTeam + 1);
+            }
+        }
+    }
+    __syncthreads();
+    if (active and myIdxInTeam == 0) {
+        innerCounts[ringPolyIdx] = myCounts_shr[nSubLists];
+        for (int s=0; s<nSubLists; s++) {
+            innerSubListCounts[s*nRingPoly + ringPolyIdx] = myCounts_shr[s];
+        }
+    }
+}
+
 __global__ void computeMaxMemSizePerWarp(int nAtoms, uint16_t *neighborCounts,
                                            uint16_t *maxMemSizePerWarp, int warpSize, int nThreadPerAtom) {
 
@@ -762,7 +1395,19 @@ __global__ void setCumulativeSumPerBlock(int numBlocks, uint32_t *perBlockArray,
 }
 
 
+//single-pass builds lay every warp out for the same number of neighbors per ring polymer
+__global__ void setUniformPerBlock(int numBlocks, uint32_t *perBlockArray, uint32_t memSizePerWarp) {
+    int idx = GETIDX();
+    if (idx < numBlocks+1) {
+        perBlockArray[idx] = idx * memSizePerWarp;
+    }
+}
+
 void GridGPU::periodicBoundaryConditions(float neighCut, bool forceBuild) {
+    if (state->backend == BACKEND::HOST) {
+        periodicBoundaryConditionsHost(neighCut, forceBuild);
+        return;
+    }
     DeviceManager &devManager = state->devManager;
     int warpSize = devManager.prop.warpSize;
 
@@ -781,6 +1426,7 @@ void GridGPU::periodicBoundaryConditions(float neighCut, bool forceBuild) {
         setBounds(state->boundsGPU);
     }
     BoundsGPU bounds = state->boundsGPU;
+    CellMap cellOrder_d = cellMap();
 
     // DO ASYNC COPY TO xsLastBuild
     // FINISH FUTURE WHICH SETS REBUILD FLAG BY NOW PLEASE
@@ -788,9 +1434,13 @@ void GridGPU::periodicBoundaryConditions(float neighCut, bool forceBuild) {
     // multigpu: needs to rebuild if any proc needs to rebuild
 
     // NOTE:  nothing to do here, if onlyPositionsFlag is True
-    setBuildFlag<<<NBLOCK(nAtoms), PERBLOCK, PERBLOCK * sizeof(short)>>>(
+    //the inner list is checked in the same pass.  A pair can close by twice the largest single move, so its
+    //check is against half of innerPadding
+    bool checkPrune = innerPadding > 0 and xsLastPrune.size() == nAtoms;
+    setBuildFlag<<<NBLOCK(nAtoms), PERBLOCK, 2 * PERBLOCK * sizeof(short)>>>(
                 gpd->xs(activeIdx), xsLastBuild.data(), nAtoms, bounds,
-		padding * padding, buildFlag.d_data.data(), numChecksSinceLastBuild, warpSize);
+		padding * padding, buildFlag.d_data.data(), numChecksSinceLastBuild, warpSize,
+                checkPrune ? xsLastPrune.data() : nullptr, 0.25f * innerPadding * innerPadding, numChecksSinceLastPrune);
     buildFlag.dataToHost();
     cudaDeviceSynchronize();
 
@@ -814,14 +1464,6 @@ void GridGPU::periodicBoundaryConditions(float neighCut, bool forceBuild) {
         }
         periodicWrap<<<NBLOCK(nAtoms), PERBLOCK>>>(gpd->xs(activeIdx), nAtoms, boundsUnskewed);
         
-        // increase number of grid cells if necessary
-        int numGridCells = prod(ns);
-        if (numGridCells + 1 != perCellArray.size()) {
-            perCellArray = GPUArrayGlobal<uint32_t>(numGridCells + 1);
-        }
-
-        perCellArray.d_data.memset(0);
-        perAtomArray.d_data.memset(0);//PER RP CENTROID
         float4 *centroids;
         if (nPerRingPoly > 1) {
             computeCentroids<<<NBLOCK(nRingPoly), PERBLOCK>>>(rpCentroids.data(), gpd->xs(activeIdx), nAtoms, nPerRingPoly, boundsUnskewed);
@@ -831,19 +1473,43 @@ void GridGPU::periodicBoundaryConditions(float neighCut, bool forceBuild) {
             centroids = gpd->xs(activeIdx);
         }
 
+        // increase number of grid cells if necessary
+        int numGridCells;
+        if (sparseCells) {
+            hashOccupiedCells(centroids, nRingPoly);
+            cellOrder_d = cellMap();
+            numGridCells = numOccupiedCells + 1; //the last is the empty cell that unoccupied cells map to
+        } else {
+            numGridCells = prod(ns);
+        }
+        if (numGridCells + 1 != perCellArray.size()) {
+            perCellArray = GPUArrayGlobal<uint32_t>(numGridCells + 1);
+        }
+
+        perCellArray.d_data.memset(0);
+        perAtomArray.d_data.memset(0);//PER RP CENTROID
+
         countNumInGridCells<<<NBLOCK(nRingPoly), PERBLOCK>>>(
                     centroids, nRingPoly,
                     perCellArray.d_data.data(), perAtomArray.d_data.data(),
-                    os, ds, ns
+                    os, ds, ns, cellOrder_d
         );//PER RP CENTROID
         
-        perCellArray.dataToHost();
-        cudaDeviceSynchronize();
-
-        uint32_t *gridCellCounts_h = perCellArray.h_data.data();
         //repurposing this as starting indexes for each grid square
-        cumulativeSum(gridCellCounts_h, perCellArray.size());
-        perCellArray.dataToDevice();
+        thrust::device_ptr<uint32_t> gridCellCounts(perCellArray.d_data.data());
+        thrust::exclusive_scan(gridCellCounts, gridCellCounts + perCellArray.size(), gridCellCounts);
+        if (state->deterministic) {
+            if (rpInSlot.size() != (size_t) nRingPoly) {
+                rpInSlot = GPUArrayDeviceGlobal<int>(nRingPoly);
+            }
+            scatterToGridSlots<<<NBLOCK(nRingPoly), PERBLOCK>>>(
+                    centroids, nRingPoly,
+                    perCellArray.d_data.data(), perAtomArray.d_data.data(),
+                    rpInSlot.data(), os, ds, ns, cellOrder_d);
+            rankInGridCellsById<<<NBLOCK(numGridCells), PERBLOCK>>>(
+                    numGridCells, perCellArray.d_data.data(), perAtomArray.d_data.data(),
+                    rpInSlot.data(), gpd->ids(activeIdx), nPerRingPoly);
+        }
         int gridIdx;
 
         //sort atoms by position, matching grid ordering
@@ -860,7 +1526,7 @@ void GridGPU::periodicBoundaryConditions(float neighCut, bool forceBuild) {
                     gpd->idToIdxs.d_data.data(),
                     state->requiresCharges,
                     perCellArray.d_data.data(), perAtomArray.d_data.data(),
-                    nRingPoly, os, ds, ns, nPerRingPoly);
+                    nRingPoly, os, ds, ns, cellOrder_d, nPerRingPoly);
         } else {
             // just the positions and ids.  All we need.
 
@@ -870,7 +1536,7 @@ void GridGPU::periodicBoundaryConditions(float neighCut, bool forceBuild) {
                     gpd->ids(activeIdx), gpd->ids(!activeIdx),
                     gpd->idToIdxs.d_data.data(),
                     perCellArray.d_data.data(), perAtomArray.d_data.data(),
-                    nRingPoly, os, ds, ns, nPerRingPoly
+                    nRingPoly, os, ds, ns, cellOrder_d, nPerRingPoly
             );
         }
         if (onlyPositionsFlag) {
@@ -906,96 +1572,143 @@ void GridGPU::periodicBoundaryConditions(float neighCut, bool forceBuild) {
          */
 
         perAtomArray.d_data.memset(0);
+        maxNeighborCount.memset(0);
+        float *typeNeighCutSqrs_d = multiCutoffActive ? typeNeighCutSqrs.data() : nullptr;
         /* multigpu:
          *     call this for ghosts too; everything after this has to be done on
          *     ghosts too
          */
-        if (nThreadPerRP==1) {
-            countNumNeighbors<0><<<NBLOCKTEAM(nRingPoly, nThreadPerBlock(), nThreadPerRP), nThreadPerBlock()>>>(
-                            centroids, nRingPoly, 
-                            perAtomArray.d_data.data(), perCellArray.d_data.data(),
-                            os, ds, ns, bounds.periodic, trace, neighCut*neighCut, nThreadPerRP); //PER RP CENTROID
-        } else {
-            countNumNeighbors<1><<<NBLOCKTEAM(nRingPoly, nThreadPerBlock(), nThreadPerRP), nThreadPerBlock(), nThreadPerBlock()*sizeof(uint16_t)>>>(
-                            centroids, nRingPoly, 
-                            perAtomArray.d_data.data(), perCellArray.d_data.data(),
-                            os, ds, ns, bounds.periodic, trace, neighCut*neighCut, nThreadPerRP); //PER RP CENTROID
-        }
-
- 
-        computeMaxMemSizePerWarp<<<NBLOCKVAR(nRingPoly, nThreadPerBlock()), nThreadPerBlock(), nThreadPerBlock()*sizeof(uint16_t)>>>(
-                    nRingPoly, perAtomArray.d_data.data(),
-                    perBlockArray_maxNeighborsInBlock.data(), warpSize, nThreadPerRP); // MAKE NUM NP VARIABLE
+        //writes the list laid out by perBlockArray.  Neighbors past capacity are dropped, but counted in maxNeighborCount,
+        //and the stored counts are clamped to capacity so readers stay in each ring polymer's slots
+        auto launchAssignNeighbors = [&] (uint16_t *neighborCounts, int capacity) {
+            size_t shMem = (nThreadPerBlock()/nThreadPerRP)*maxExclusionsPerAtom*sizeof(uint32_t);
+            if (nThreadPerRP==1) {
+                if (exclusions) {
+                    assignNeighbors<0,true><<<NBLOCKTEAM(nRingPoly, nThreadPerBlock(), nThreadPerRP), nThreadPerBlock(), shMem>>>(
+                                    centroids, nRingPoly, nPerRingPoly, state->gpd.ids(gridIdx),
+                                    perCellArray.d_data.data(), perBlockArray.d_data.data(), os, ds, ns, cellOrder_d,
+                                    bounds.periodic, trace, neighCut*neighCut,
+                                    typeNeighCutSqrs_d, typeNeighCutMaxs.data(), numTypesMulti, neighborlist.data(), warpSize,
+                                    exclusionIndexes.data(), exclusionIds.data(), maxExclusionsPerAtom, nThreadPerRP,
+                                    neighborCounts, capacity, maxNeighborCount.data()
+                                    ); //PER RP CENTROID
+                } else {
+                    assignNeighbors<0,false><<<NBLOCKTEAM(nRingPoly, nThreadPerBlock(), nThreadPerRP), nThreadPerBlock(), shMem>>>(
+                                    centroids, nRingPoly, nPerRingPoly, state->gpd.ids(gridIdx),
+                                    perCellArray.d_data.data(), perBlockArray.d_data.data(), os, ds, ns, cellOrder_d,
+                                    bounds.periodic, trace, neighCut*neighCut,
+                                    typeNeighCutSqrs_d, typeNeighCutMaxs.data(), numTypesMulti, neighborlist.data(), warpSize,
+                                    exclusionIndexes.data(), exclusionIds.data(), maxExclusionsPerAtom, nThreadPerRP,
+                                    neighborCounts, capacity, maxNeighborCount.data()
+                                    ); //PER RP CENTROID
+                }
+            } else {
+                if (exclusions) {
+                    assignNeighbors<1,true><<<NBLOCKTEAM(nRingPoly, nThreadPerBlock(), nThreadPerRP), nThreadPerBlock(), shMem + nThreadPerBlock()*sizeof(uint32_t)>>>(
+                                    centroids, nRingPoly, nPerRingPoly, state->gpd.ids(gridIdx),
+                                    perCellArray.d_data.data(), perBlockArray.d_data.data(), os, ds, ns, cellOrder_d,
+                                    bounds.periodic, trace, neighCut*neighCut,
+                                    typeNeighCutSqrs_d, typeNeighCutMaxs.data(), numTypesMulti, neighborlist.data(), warpSize,
+                                    exclusionIndexes.data(), exclusionIds.data(), maxExclusionsPerAtom, nThreadPerRP,
+                                    neighborCounts, capacity, maxNeighborCount.data()
+                                    ); //PER RP CENTROID
+                } else {
+                    assignNeighbors<1,false><<<NBLOCKTEAM(nRingPoly, nThreadPerBlock(), nThreadPerRP), nThreadPerBlock(), shMem + nThreadPerBlock()*sizeof(uint32_t)>>>(
+                                    centroids, nRingPoly, nPerRingPoly, state->gpd.ids(gridIdx),
+                                    perCellArray.d_data.data(), perBlockArray.d_data.data(), os, ds, ns, cellOrder_d,
+                                    bounds.periodic, trace, neighCut*neighCut,
+                                    typeNeighCutSqrs_d, typeNeighCutMaxs.data(), numTypesMulti, neighborlist.data(), warpSize,
+                                    exclusionIndexes.data(), exclusionIds.data(), maxExclusionsPerAtom, nThreadPerRP,
+                                    neighborCounts, capacity, maxNeighborCount.data()
+                                    ); //PER RP CENTROID
+                }
+            }
+        };
 
-        /*
-        //delete
-        perBlockArray_maxNeighborsInBlock.dataToHost();
-        cudaDeviceSynchronize();
-        cout << "new" << endl;
-        for (auto x : perBlockArray_maxNeighborsInBlock.h_data) {
-            cout << x << endl;
-        }
-        //end delete
-        */
         int numBlocks = perBlockArray_maxNeighborsInBlock.size();
-        setCumulativeSumPerBlock<<<NBLOCKVAR(numBlocks+1, nThreadPerBlock()), nThreadPerBlock()>>>(
-                    numBlocks, perBlockArray.d_data.data(),
-                    perBlockArray_maxNeighborsInBlock.data());
-        uint32_t cumulMemSizePerWarp;
-        perBlockArray.d_data.get(&cumulMemSizePerWarp, numBlocks, 1);
-        cudaDeviceSynchronize();
-        //perAtomArray.dataToHost();
-        //cudaDeviceSynchronize();
-        //setPerBlockCounts(perAtomArray.h_data, perBlockArray.h_data);  // okay, now this is the start index (+1 is end index) of each atom's neighbors
-        //perBlockArray.dataToDevice();
-
-        //int totalNumNeighbors = perBlockArray.h_data.back() * PERBLOCK;
-        int totalNumNeighbors = cumulMemSizePerWarp * (nThreadPerBlock() / warpSize);  // total number of possible neighbors
-        if (totalNumNeighbors==0) {
-            totalNumNeighbors=1; // gets mad if you send a list of size zero
-        }
-       // cout << cumulMemSizePerWarp << endl;
-        //cout << totalNumNeighbors << endl;
-        //std::cout << "TOTAL NUM IS " << totalNumNeighbors << std::endl;
-        //printf("TOTAL NUM NEIGH %d\n", totalNumNeighbors);
-        if (totalNumNeighbors > neighborlist.size()) {
-            neighborlist = GPUArrayDeviceGlobal<uint>(totalNumNeighbors*1.5);
-        } else if (totalNumNeighbors < neighborlist.size() * 0.5) {
-            neighborlist = GPUArrayDeviceGlobal<uint>(totalNumNeighbors*1.5);
-        }
-
-        if (nThreadPerRP==1) {
-            if (exclusions) {
-                assignNeighbors<0,true><<<NBLOCKTEAM(nRingPoly, nThreadPerBlock(), nThreadPerRP), nThreadPerBlock(), (nThreadPerBlock()/nThreadPerRP)*maxExclusionsPerAtom*sizeof(uint32_t)>>>(
-                                centroids, nRingPoly, nPerRingPoly, state->gpd.ids(gridIdx),
-                                perCellArray.d_data.data(), perBlockArray.d_data.data(), os, ds, ns,
-                                bounds.periodic, trace, neighCut*neighCut, neighborlist.data(), warpSize,
-                                exclusionIndexes.data(), exclusionIds.data(), maxExclusionsPerAtom, nThreadPerRP
-                                ); //PER RP CENTROID
+        int warpsPerBlock = nThreadPerBlock() / warpSize;
+        bool compress = state->compressNeighborlist;
+        //largest neighbor count, then the words per warp of the compressed list
+        int buildCounts[2];
+        int &maxCount = buildCounts[0];
+        auto readBuildCounts = [&] () {
+            if (compress) {
+                sizeCompressedNeighborlist();
+            }
+            maxNeighborCount.get(buildCounts);
+            cudaDeviceSynchronize();
+        };
+        bool built = false;
+        if (singlePassCapacity > 0) {
+            //room for singlePassCapacity neighbors per ring polymer, sized from earlier builds, so the stencils are
+            //only searched once.  If any ring polymer has more, the list is counted and built again below
+            uint32_t memSizePerWarp = ceilf((float) singlePassCapacity / nThreadPerRP) * warpSize;
+            setUniformPerBlock<<<NBLOCKVAR(numBlocks+1, nThreadPerBlock()), nThreadPerBlock()>>>(
+                        numBlocks, perBlockArray.d_data.data(), memSizePerWarp);
+            size_t totalNumNeighbors = (size_t) numBlocks * warpsPerBlock * memSizePerWarp;
+            if (totalNumNeighbors > neighborlist.size() or totalNumNeighbors < neighborlist.size() * 0.5) {
+                neighborlist = GPUArrayDeviceGlobal<uint>(std::max<size_t>(totalNumNeighbors, 1));
+            }
+            launchAssignNeighbors(perAtomArray.d_data.data(), singlePassCapacity);
+            //the one read before the list is used.  A ring polymer past capacity had its count clamped and its
+            //extra neighbors dropped, so the list is counted and built again right away
+            readBuildCounts();
+            if (maxCount > singlePassCapacity) {
+                singlePassCapacity = 0;
+                perAtomArray.d_data.memset(0);
+                maxNeighborCount.memset(0);
             } else {
-                assignNeighbors<0,false><<<NBLOCKTEAM(nRingPoly, nThreadPerBlock(), nThreadPerRP), nThreadPerBlock(), (nThreadPerBlock()/nThreadPerRP)*maxExclusionsPerAtom*sizeof(uint32_t)>>>(
-                                centroids, nRingPoly, nPerRingPoly, state->gpd.ids(gridIdx),
-                                perCellArray.d_data.data(), perBlockArray.d_data.data(), os, ds, ns,
-                                bounds.periodic, trace, neighCut*neighCut, neighborlist.data(), warpSize,
-                                exclusionIndexes.data(), exclusionIds.data(), maxExclusionsPerAtom, nThreadPerRP
-                                ); //PER RP CENTROID
+                if (maxCount * singlePassSlack < singlePassCapacity * 0.5) {
+                    singlePassCapacity = ceilf(maxCount * singlePassSlack) + 1;
+                }
+                built = true;
             }
-        } else {
-            if (exclusions) {
-                assignNeighbors<1,true><<<NBLOCKTEAM(nRingPoly, nThreadPerBlock(), nThreadPerRP), nThreadPerBlock(), (nThreadPerBlock()/nThreadPerRP)*maxExclusionsPerAtom*sizeof(uint32_t) + nThreadPerBlock()*sizeof(uint32_t)>>>(
-                                centroids, nRingPoly, nPerRingPoly, state->gpd.ids(gridIdx),
-                                perCellArray.d_data.data(), perBlockArray.d_data.data(), os, ds, ns,
-                                bounds.periodic, trace, neighCut*neighCut, neighborlist.data(), warpSize,
-                                exclusionIndexes.data(), exclusionIds.data(), maxExclusionsPerAtom, nThreadPerRP
-                                ); //PER RP CENTROID
+        }
+
+        if (not built) {
+            if (nThreadPerRP==1) {
+                countNumNeighbors<0><<<NBLOCKTEAM(nRingPoly, nThreadPerBlock(), nThreadPerRP), nThreadPerBlock()>>>(
+                                centroids, nRingPoly, 
+                                perAtomArray.d_data.data(), perCellArray.d_data.data(),
+                                os, ds, ns, cellOrder_d, bounds.periodic, trace, neighCut*neighCut,
+                                typeNeighCutSqrs_d, typeNeighCutMaxs.data(), numTypesMulti, nThreadPerRP); //PER RP CENTROID
             } else {
-                assignNeighbors<1,false><<<NBLOCKTEAM(nRingPoly, nThreadPerBlock(), nThreadPerRP), nThreadPerBlock(), (nThreadPerBlock()/nThreadPerRP)*maxExclusionsPerAtom*sizeof(uint32_t) + nThreadPerBlock()*sizeof(uint32_t)>>>(
-                                centroids, nRingPoly, nPerRingPoly, state->gpd.ids(gridIdx),
-                                perCellArray.d_data.data(), perBlockArray.d_data.data(), os, ds, ns,
-                                bounds.periodic, trace, neighCut*neighCut, neighborlist.data(), warpSize,
-                                exclusionIndexes.data(), exclusionIds.data(), maxExclusionsPerAtom, nThreadPerRP
-                                ); //PER RP CENTROID
+                countNumNeighbors<1><<<NBLOCKTEAM(nRingPoly, nThreadPerBlock(), nThreadPerRP), nThreadPerBlock(), nThreadPerBlock()*sizeof(uint16_t)>>>(
+                                centroids, nRingPoly, 
+                                perAtomArray.d_data.data(), perCellArray.d_data.data(),
+                                os, ds, ns, cellOrder_d, bounds.periodic, trace, neighCut*neighCut,
+                                typeNeighCutSqrs_d, typeNeighCutMaxs.data(), numTypesMulti, nThreadPerRP); //PER RP CENTROID
+            }
+
+            computeMaxMemSizePerWarp<<<NBLOCKVAR(nRingPoly, nThreadPerBlock()), nThreadPerBlock(), nThreadPerBlock()*sizeof(uint16_t)>>>(
+                        nRingPoly, perAtomArray.d_data.data(),
+                        perBlockArray_maxNeighborsInBlock.data(), warpSize, nThreadPerRP); // MAKE NUM NP VARIABLE
+
+            setCumulativeSumPerBlock<<<NBLOCKVAR(numBlocks+1, nThreadPerBlock()), nThreadPerBlock()>>>(
+                        numBlocks, perBlockArray.d_data.data(),
+                        perBlockArray_maxNeighborsInBlock.data());
+            uint32_t cumulMemSizePerWarp;
+            perBlockArray.d_data.get(&cumulMemSizePerWarp, numBlocks, 1);
+            cudaDeviceSynchronize();
+
+            int totalNumNeighbors = cumulMemSizePerWarp * warpsPerBlock;  // total number of possible neighbors
+            if (totalNumNeighbors==0) {
+                totalNumNeighbors=1; // gets mad if you send a list of size zero
+            }
+            if (totalNumNeighbors > neighborlist.size()) {
+                neighborlist = GPUArrayDeviceGlobal<uint>(totalNumNeighbors*1.5);
+            } else if (totalNumNeighbors < neighborlist.size() * 0.5) {
+                neighborlist = GPUArrayDeviceGlobal<uint>(totalNumNeighbors*1.5);
             }
+
+            launchAssignNeighbors(nullptr, INT_MAX);
+
+            //build in one pass from now on, unless laying every warp out for the densest ring polymer takes too much
+            //more memory than fitting each block to its own, as in mixtures of very different sizes
+            readBuildCounts();
+            int capacity = ceilf(maxCount * singlePassSlack) + 1;
+            double uniformNumNeighbors = (double) numBlocks * warpsPerBlock * ceilf((float) capacity / nThreadPerRP) * warpSize;
+            singlePassCapacity = uniformNumNeighbors <= singlePassMaxMemRatio * totalNumNeighbors ? capacity : 0;
         }
 
         /*
@@ -1021,24 +1734,454 @@ void GridGPU::periodicBoundaryConditions(float neighCut, bool forceBuild) {
 
         numChecksSinceLastBuild = 0;
         copyPositionsAsync(); 
+        if (state->reorderForcersEvery > 0 and state->nlistBuildCount % state->reorderForcersEvery == 0) {
+            state->reorderForcers();
+        }
+        if (compress) {
+            compressNeighborlist(buildCounts[1]);
+            if (innerPadding > 0) {
+                pruneNeighborlist(neighCut - padding + innerPadding);
+            }
+        } else if (innerPadding > 0) {
+            if (neighborlistOuter.size() != neighborlist.size()) {
+                neighborlistOuter = GPUArrayDeviceGlobal<uint>(neighborlist.size());
+            }
+            if (perAtomArrayOuter.size() != perAtomArray.size()) {
+                perAtomArrayOuter = GPUArrayDeviceGlobal<uint16_t>(perAtomArray.size());
+            }
+            neighborlist.copyToDeviceArray((void *) neighborlistOuter.data());
+            perAtomArray.d_data.copyToDeviceArray((void *) perAtomArrayOuter.data());
+            pruneNeighborlist(neighCut - padding + innerPadding);
+        } else {
+            neighborlistChanged();
+        }
     } else {
         numChecksSinceLastBuild++;
+        if (checkPrune and buildFlag.h_data[1]) {
+            pruneNeighborlist(neighCut - padding + innerPadding);
+        } else if (checkPrune) {
+            numChecksSinceLastPrune++;
+        }
     }
 
     buildFlag.d_data.memset(0);
 }
 
+void GridGPU::pruneNeighborlist(float innerCut) {
+    int nAtoms = gpd->xs.size();
+    int nRingPoly = nAtoms / nPerRingPoly;
+    int activeIdx = gpd->activeIdx();
+    int warpSize = state->devManager.prop.warpSize;
+    BoundsGPU bounds = state->boundsGPU;
+    state->nlistPruneCount++;
+
+    float4 *centroids;
+    if (nPerRingPoly > 1) {
+        computeCentroids<<<NBLOCK(nRingPoly), PERBLOCK>>>(
+            rpCentroids.data(), gpd->xs(activeIdx), nAtoms, nPerRingPoly, bounds);
+        centroids = rpCentroids.data();
+    } else {
+        centroids = gpd->xs(activeIdx);
+    }
+    int nSubLists = subListRCuts.size();
+    if (neighborlistCompressedValid) {
+        int nRPPerBlock = nThreadPerBlock() / nThreadPerAtom();
+        pruneNeighborsCompressed<<<NBLOCKTEAM(nRingPoly, nThreadPerBlock(), nThreadPerAtom()), nThreadPerBlock(), nRPPerBlock*(nSubLists+1)*sizeof(int)>>>(
+                    centroids, nRingPoly, bounds, innerCut*innerCut,
+                    perAtomArrayOuter.data(), nSubLists ? perAtomArraySubListsOuter.data() : nullptr, neighborlistCompressedOuter.data(),
+                    perAtomArray.d_data.data(), nSubLists ? perAtomArraySubLists.data() : nullptr, neighborlistCompressed.data(),
+                    nSubLists, perBlockArrayCompressed.data(), warpSize, nThreadPerAtom());
+    } else {
+        pruneNeighbors<<<NBLOCK(nRingPoly), PERBLOCK>>>(
+                    centroids, nRingPoly, bounds, innerCut*innerCut,
+                    perAtomArrayOuter.data(), neighborlistOuter.data(),
+                    perAtomArray.d_data.data(), neighborlist.data(),
+                    perBlockArray.d_data.data(), warpSize, nThreadPerBlock(), nThreadPerAtom());
+    }
+
+    if (xsLastPrune.size() != nAtoms) {
+        xsLastPrune = GPUArrayDeviceGlobal<float4>(nAtoms);
+    }
+    gpd->xs.d_data[activeIdx].copyToDeviceArray((void *) xsLastPrune.data());
+    numChecksSinceLastPrune = 0;
+    if (not neighborlistCompressedValid) {
+        neighborlistChanged();
+    }
+}
+
+void GridGPU::setSubListRCuts(std::vector<float> rCuts) {
+    float rCutMax = neighCutoffMax - padding;
+    std::sort(rCuts.begin(), rCuts.end());
+    subListRCuts = std::vector<float>();
+    for (float rCut : rCuts) {
+        //cutoffs within rounding of the largest gain nothing from a sub-list
+        if (rCut < rCutMax - 1e-4f and (subListRCuts.empty() or rCut > subListRCuts.back() + 1e-4f)) {
+            subListRCuts.push_back(rCut);
+        }
+    }
+}
+
+uint16_t *GridGPU::neighborCounts(float rCut) {
+    for (int i=0; i<subListRCuts.size(); i++) {
+        if (rCut <= subListRCuts[i] + 1e-4f) {
+            return perAtomArraySubLists.data() + i * (gpd->xs.size() / nPerRingPoly);
+        }
+    }
+    return perAtomArray.d_data.data();
+}
+
+void GridGPU::partitionNeighborlist(float subListPadding) {
+    int nAtoms = gpd->xs.size();
+    int nRingPoly = nAtoms / nPerRingPoly;
+    int activeIdx = gpd->activeIdx();
+    int warpSize = state->devManager.prop.warpSize;
+    BoundsGPU bounds = state->boundsGPU;
+    int nSubLists = subListRCuts.size();
+
+    std::vector<float> cutSqrs(nSubLists);
+    for (int i=0; i<nSubLists; i++) {
+        float cut = subListRCuts[i] + subListPadding;
+        cutSqrs[i] = cut * cut;
+    }
+    if (subListCutSqrs.size() != nSubLists) {
+        subListCutSqrs = GPUArrayDeviceGlobal<float>(nSubLists);
+    }
+    subListCutSqrs.set(cutSqrs.data());
+    if (perAtomArraySubLists.size() != nSubLists * nRingPoly) {
+        perAtomArraySubLists = GPUArrayDeviceGlobal<uint16_t>(nSubLists * nRingPoly);
+    }
+
+    float4 *centroids;
+    if (nPerRingPoly > 1) {
+        computeCentroids<<<NBLOCK(nRingPoly), PERBLOCK>>>(
+            rpCentroids.data(), gpd->xs(activeIdx), nAtoms, nPerRingPoly, bounds);
+        centroids = rpCentroids.data();
+    } else {
+        centroids = gpd->xs(activeIdx);
+    }
+    partitionNeighbors<<<NBLOCK(nRingPoly), PERBLOCK>>>(
+                centroids, nRingPoly, bounds, subListCutSqrs.data(), nSubLists,
+                perAtomArray.d_data.data(), neighborlist.data(), perAtomArraySubLists.data(),
+                perBlockArray.d_data.data(), warpSize, nThreadPerBlock(), nThreadPerAtom());
+}
+
+void GridGPU::sizeCompressedNeighborlist() {
+    int nRingPoly = gpd->xs.size() / nPerRingPoly;
+    int warpSize = state->devManager.prop.warpSize;
+    int numBlocks = perBlockArray_maxNeighborsInBlock.size();
+    int nSubLists = subListRCuts.size();
+    mdAssert(nRingPoly - 1 <= NLIST_INDEX_MAX, "Too many atoms to compress the neighbor list");
+
+    //the sub-lists of a list that gets pruned keep the full padding, since the prune keeps them as they are
+    if (nSubLists) {
+        partitionNeighborlist(padding);
+    }
+    sortNeighborSegments<<<NBLOCK(nRingPoly), PERBLOCK>>>(
+                nRingPoly, perAtomArray.d_data.data(), nSubLists ? perAtomArraySubLists.data() : nullptr, nSubLists,
+                neighborlist.data(), perBlockArray.d_data.data(), warpSize, nThreadPerBlock(), nThreadPerAtom());
+
+    //size each warp for the longest stream of words in its block, as for the uncompressed list
+    if (perBlockArrayCompressed.size() != numBlocks + 1) {
+        perBlockArrayCompressed = GPUArrayDeviceGlobal<uint32_t>(numBlocks + 1);
+    }
+    encodeNeighbors<false><<<NBLOCKTEAM(nRingPoly, nThreadPerBlock(), nThreadPerAtom()), nThreadPerBlock()>>>(
+                nRingPoly, perAtomArray.d_data.data(), neighborlist.data(), perBlockArray.d_data.data(),
+                perBlockArrayCompressed.data(), nullptr, nullptr, warpSize, nThreadPerAtom());
+    thrust::device_ptr<uint32_t> wordsPerWarp(perBlockArrayCompressed.data());
+    thrust::exclusive_scan(wordsPerWarp, wordsPerWarp + numBlocks + 1, wordsPerWarp);
+    //the total comes back with the build's largest neighbor count, so compressing adds no wait for the host
+    cudaMemcpyAsync(maxNeighborCount.data() + 1, perBlockArrayCompressed.data() + numBlocks, sizeof(uint32_t),
+                    cudaMemcpyDeviceToDevice);
+}
+
+void GridGPU::compressNeighborlist(uint32_t cumulWordsPerWarp) {
+    int nRingPoly = gpd->xs.size() / nPerRingPoly;
+    int warpSize = state->devManager.prop.warpSize;
+    int nSubLists = subListRCuts.size();
+    bool prunes = innerPadding > 0;
+
+    //with an inner list, this is the outer list, and the inner one is pruned into the same layout
+    GPUArrayDeviceGlobal<uint16_t> &words = prunes ? neighborlistCompressedOuter : neighborlistCompressed;
+    size_t numWords = (size_t) cumulWordsPerWarp * (nThreadPerBlock() / warpSize);
+    numWords = std::max<size_t>(numWords, 1);
+    if (numWords > words.size() or numWords < words.size() * 0.5) {
+        words = GPUArrayDeviceGlobal<uint16_t>(numWords * 1.1);
+    }
+    encodeNeighbors<true><<<NBLOCKTEAM(nRingPoly, nThreadPerBlock(), nThreadPerAtom()), nThreadPerBlock()>>>(
+                nRingPoly, perAtomArray.d_data.data(), neighborlist.data(), perBlockArray.d_data.data(),
+                nullptr, words.data(), perBlockArrayCompressed.data(), warpSize, nThreadPerAtom());
+    if (prunes) {
+        if (perAtomArrayOuter.size() != perAtomArray.size()) {
+            perAtomArrayOuter = GPUArrayDeviceGlobal<uint16_t>(perAtomArray.size());
+        }
+        perAtomArray.d_data.copyToDeviceArray((void *) perAtomArrayOuter.data());
+        if (perAtomArraySubListsOuter.size() != perAtomArraySubLists.size()) {
+            perAtomArraySubListsOuter = GPUArrayDeviceGlobal<uint16_t>(perAtomArraySubLists.size());
+        }
+        if (nSubLists) {
+            perAtomArraySubLists.copyToDeviceArray((void *) perAtomArraySubListsOuter.data());
+        }
+        if (neighborlistCompressed.size() != words.size()) {
+            neighborlistCompressed = GPUArrayDeviceGlobal<uint16_t>(words.size());
+        }
+    }
+    //only the compressed list is kept between builds
+    neighborlist = GPUArrayDeviceGlobal<uint>();
+    neighborlistOuter = GPUArrayDeviceGlobal<uint>();
+    neighborlistCompressedValid = true;
+}
+
+NeighborlistCompressed GridGPU::compressedNeighborlist() {
+    if (not neighborlistCompressedValid) {
+        return NeighborlistCompressed();
+    }
+    return NeighborlistCompressed(neighborlistCompressed.data(), perBlockArrayCompressed.data());
+}
+
+void GridGPU::neighborlistChanged() {
+    if (subListRCuts.size()) {
+        partitionNeighborlist(innerPadding > 0 ? innerPadding : padding);
+    }
+    neighborlistCompressedValid = false;
+    if (neighborlistCompressed.size()) {
+        //turned off between runs
+        neighborlistCompressed = GPUArrayDeviceGlobal<uint16_t>();
+        neighborlistCompressedOuter = GPUArrayDeviceGlobal<uint16_t>();
+        perBlockArrayCompressed = GPUArrayDeviceGlobal<uint32_t>();
+        perAtomArraySubListsOuter = GPUArrayDeviceGlobal<uint16_t>();
+    }
+}
+
 // future note: this has not been generalized to arbitrary gpu data
 // -- some state-> pointers need to be made local to the gpu data that is
 //    not necessarily global;
 //   but, this is only called above, and its currently commented out. so, ok.
-bool GridGPU::verifyNeighborlists(float neighCut) {
+/* host backend */
+
+template <typename T>
+void permuteHost(std::vector<T> &data, std::vector<int> &sortedIdxs) {
+    std::vector<T> sorted(data.size());
+    for (int i=0, ii=sortedIdxs.size(); i<ii; i++) {
+        sorted[sortedIdxs[i]] = data[i];
+    }
+    data.swap(sorted);
+}
+
+//calls f(otherIdx) for every atom within the cutoff of atom idx
+template <class F>
+void forEachNeighborHost(int idx, float4 *xs, uint32_t *gridCellArrayIdxs,
+                         float3 os, float3 ds, int3 ns, const int *cellOrder,
+                         float3 periodic, float3 trace, float neighCutSqr, F f) {
+    float3 pos = make_float3(xs[idx]);
+    int3 sqrIdx = make_int3((pos - os) / ds);
+    forEachStencilCellHost(sqrIdx, ns, cellOrder, periodic, trace, [&] (int sqrIdxOtherLin, bool ownCell, float3 loop) {
+        uint32_t idxMin = gridCellArrayIdxs[sqrIdxOtherLin];
+        uint32_t idxMax = gridCellArrayIdxs[sqrIdxOtherLin+1];
+        for (uint32_t i=idxMin; i<idxMax; i++) {
+            if (ownCell and i == idx) {
+                continue;
+            }
+            float3 distVec = make_float3(xs[i]) + loop - pos;
+            if (dot(distVec, distVec) < neighCutSqr) {
+                f(i);
+            }
+        }
+    });
+}
+
+uint GridGPU::exclusionTagHost(uint myId, uint otherId) {
+    if (myId + 1 >= exclusionIndexesHost.size()) {
+        return 0;
+    }
+    uint exclMask = EXCL_MASK;
+    for (int j=exclusionIndexesHost[myId]; j<exclusionIndexesHost[myId+1]; j++) {
+        if ((exclusionIdsHost[j] & exclMask) == otherId) {
+            return exclusionIdsHost[j] & (~exclMask);
+        }
+    }
+    return 0;
+}
+
+void GridGPU::buildClusterPairsHost(float neighCutSqr, float3 periodic, float3 trace) {
+    const int *cellOrder_h = cellOrder.size() ? cellOrder.h_data.data() : nullptr;
+    std::vector<uint> &ids = gpd->ids.h_data;
+    std::function<uint (int, int)> exclusionTag;
+    if (exclusions and exclusionIdsHost.size()) {
+        exclusionTag = [&] (int a, int b) { return exclusionTagHost(ids[a], ids[b]); };
+    }
+    buildClusterPairListHost(gpd->xs.h_data.data(), perCellArray.h_data.data(), ns, os, ds, cellOrder_h, periodic, trace,
+                             neighCutSqr, exclusionTag, clusterIdxsHost, cellClusterIdxsHost, clusterPairIdxsHost,
+                             clusterPairsHost);
+}
+
+void GridGPU::periodicBoundaryConditionsHost(float neighCut, bool forceBuild) {
+    mdAssert(nPerRingPoly == 1, "The host backend does not support ring polymers");
+    if (neighCut == -1) {
+        neighCut = neighCutoffMax;
+    }
+    int nAtoms = gpd->xs.size();
+    if (boundsLastBuild != state->boundsGPU) {
+        setBounds(state->boundsGPU);
+    }
+    BoundsGPU bounds = state->boundsGPU;
+    std::vector<float4> &xs = gpd->xs.h_data;
+
+    bool build = forceBuild or xsLastBuildHost.size() != nAtoms;
+    if (not build) {
+        float maxMoveRatio = std::fmin(0.95, (numChecksSinceLastBuild+1) / (float) (numChecksSinceLastBuild+2));
+        float maxMoveSqr = padding * padding * maxMoveRatio * maxMoveRatio;
+        int numMoved = 0;
+#pragma omp parallel for schedule(static) reduction(+:numMoved)
+        for (int i=0; i<nAtoms; i++) {
+            float3 distVector = bounds.minImage(make_float3(xs[i] - xsLastBuildHost[i]));
+            numMoved += lengthSqr(distVector) > maxMoveSqr;
+        }
+        build = numMoved > 0;
+    }
+    if (not build) {
+        numChecksSinceLastBuild++;
+        return;
+    }
+
+    state->nlistBuildCount++;
+    float3 ds_orig = ds;
+    float3 os_orig = os;
+    // see periodicBoundaryConditions
+    ds += make_float3(EPSILON, EPSILON, EPSILON);
+    os -= make_float3(EPSILON, EPSILON, EPSILON);
+
+    BoundsGPU boundsUnskewed = bounds.unskewed();
+#pragma omp parallel for schedule(static)
+    for (int i=0; i<nAtoms; i++) {
+        xs[i] = boundsUnskewed.wrapCoords(xs[i]);
+    }
+
+    int numGridCells = prod(ns);
+    if (numGridCells + 1 != perCellArray.size()) {
+        perCellArray = GPUArrayGlobal<uint32_t>(numGridCells + 1);
+    }
+    std::vector<uint32_t> &gridCellArrayIdxs = perCellArray.h_data;
+    std::fill(gridCellArrayIdxs.begin(), gridCellArrayIdxs.end(), 0);
+    std::vector<int> cellOfAtom(nAtoms);
+    const int *cellOrder_h = cellOrder.size() ? cellOrder.h_data.data() : nullptr;
+    for (int i=0; i<nAtoms; i++) {
+        int3 sqrIdx = make_int3((make_float3(xs[i]) - os) / ds);
+        cellOfAtom[i] = CELLIDX(sqrIdx, ns, cellOrder_h);
+        gridCellArrayIdxs[cellOfAtom[i]]++;
+    }
+    cumulativeSum(gridCellArrayIdxs.data(), gridCellArrayIdxs.size());
+
+    //sort atoms by position, matching grid ordering
+    std::vector<uint32_t> cellFill(gridCellArrayIdxs);
+    std::vector<int> sortedIdxs(nAtoms);
+    for (int i=0; i<nAtoms; i++) {
+        sortedIdxs[i] = cellFill[cellOfAtom[i]]++;
+    }
+    std::vector<uint> &ids = gpd->ids.h_data;
+    std::vector<int> &idToIdxs = gpd->idToIdxs.h_data;
+    for (int i=0; i<nAtoms; i++) {
+        idToIdxs[ids[i]] = sortedIdxs[i];
+    }
+    permuteHost(xs, sortedIdxs);
+    permuteHost(ids, sortedIdxs);
+    if (!(onlyPositionsFlag)) {
+        permuteHost(gpd->vs.h_data, sortedIdxs);
+        permuteHost(gpd->fs.h_data, sortedIdxs);
+        if (state->requiresCharges) {
+            permuteHost(gpd->qs.h_data, sortedIdxs);
+        }
+    }
+
+    float3 trace = boundsUnskewed.trace();
+    float3 periodic = bounds.periodic;
+    float neighCutSqr = neighCut * neighCut;
+
+    //the cluster-pair list replaces the atom list, so only one of them is built
+    clusterPairsHostValid = state->hostClusterPairs;
+    if (clusterPairsHostValid) {
+        halfListHost = false;
+        neighborlistHost.clear();
+        neighborIdxsHost.clear();
+        buildClusterPairsHost(neighCutSqr, periodic, trace);
+    } else {
+        buildNeighborlistHost(neighCutSqr, periodic, trace);
+    }
+
+    ds = ds_orig;
+    os = os_orig;
+    numChecksSinceLastBuild = 0;
+    xsLastBuildHost = xs;
+    if (state->reorderForcersEvery > 0 and state->nlistBuildCount % state->reorderForcersEvery == 0) {
+        state->reorderForcers();
+    }
+}
+
+void GridGPU::buildNeighborlistHost(float neighCutSqr, float3 periodic, float3 trace) {
+    int nAtoms = gpd->xs.size();
+    std::vector<uint> &ids = gpd->ids.h_data;
+    float4 *xs_h = gpd->xs.h_data.data();
+    uint32_t *cells_h = perCellArray.h_data.data();
+    const int *cellOrder_h = cellOrder.size() ? cellOrder.h_data.data() : nullptr;
+
+    halfListHost = state->hostHalfList;
+    bool half = halfListHost;
+    std::vector<uint16_t> &neighborCounts = perAtomArray.h_data;
+#pragma omp parallel for schedule(static)
+    for (int i=0; i<nAtoms; i++) {
+        int count = 0;
+        forEachNeighborHost(i, xs_h, cells_h, os, ds, ns, cellOrder_h, periodic, trace, neighCutSqr,
+                            [&] (uint otherIdx) {
+                                if (not half or otherIdx > (uint) i) {
+                                    count++;
+                                }
+                            });
+        neighborCounts[i] = count;
+    }
+
+    neighborIdxsHost.resize(nAtoms+1);
+    std::copy(neighborCounts.begin(), neighborCounts.begin()+nAtoms, neighborIdxsHost.begin());
+    neighborIdxsHost[nAtoms] = 0;
+    cumulativeSum(neighborIdxsHost.data(), nAtoms+1);
+    neighborlistHost.resize(neighborIdxsHost.back());
+
+    bool useExclusions = exclusions and exclusionIdsHost.size();
+#pragma omp parallel for schedule(static)
+    for (int i=0; i<nAtoms; i++) {
+        uint *nlist = neighborlistHost.data() + neighborIdxsHost[i];
+        uint myId = ids[i];
+        forEachNeighborHost(i, xs_h, cells_h, os, ds, ns, cellOrder_h, periodic, trace, neighCutSqr,
+                            [&] (uint otherIdx) {
+                                if (half and otherIdx <= (uint) i) {
+                                    return;
+                                }
+                                uint exclusionTag = useExclusions ? exclusionTagHost(myId, ids[otherIdx]) : 0;
+                                *nlist = otherIdx | exclusionTag;
+                                nlist++;
+                            });
+        //rows in index order, so the half and full lists sum each atom's pair terms in the same order
+        uint *row = neighborlistHost.data() + neighborIdxsHost[i];
+        std::sort(row, nlist, [] (uint a, uint b) {
+            uint aIdx = a & EXCL_MASK;
+            uint bIdx = b & EXCL_MASK;
+            return aIdx < bIdx;
+        });
+    }
+}
+
+bool GridGPU::verifyNeighborlists(float neighCut, uint16_t *counts) {
     std::cout << "going to verify" << std::endl;
     uint *nlist = (uint *) malloc(neighborlist.size()*sizeof(uint));
     neighborlist.get(nlist);
     float cutSqr = neighCut * neighCut;
     perAtomArray.dataToHost();
     uint16_t *neighCounts = perAtomArray.h_data.data();
+    //a sub-list is the start of each row, so only its count is read
+    std::vector<uint16_t> countsHost;
+    if (counts) {
+        countsHost.resize(gpd->xs.size() / nPerRingPoly);
+        cudaMemcpy(countsHost.data(), counts, countsHost.size()*sizeof(uint16_t), cudaMemcpyDeviceToHost);
+        neighCounts = countsHost.data();
+    }
     gpd->xs.dataToHost();
     gpd->ids.dataToHost();
     perBlockArray.dataToHost();
@@ -1083,26 +2226,35 @@ bool GridGPU::verifyNeighborlists(float neighCut) {
     // std::cout << "cpu dist is " << sqrt(lengthSqr(state->boundsGPU.minImage(xs[0]-xs[1])))  << std::endl;
 
     int warpSize = state->devManager.prop.warpSize;
+    int nThreadPerRP = nThreadPerAtom();
+    //a compressed list is decoded as the kernels decode it
+    std::vector<uint16_t> words;
+    std::vector<uint32_t> cumulWords;
+    NeighborlistCompressed compressed;
+    if (neighborlistCompressedValid) {
+        words = std::vector<uint16_t>(neighborlistCompressed.size());
+        neighborlistCompressed.get(words.data());
+        cumulWords = std::vector<uint32_t>(perBlockArrayCompressed.size());
+        perBlockArrayCompressed.get(cumulWords.data());
+        cudaDeviceSynchronize();
+        compressed = NeighborlistCompressed(words.data(), cumulWords.data());
+    }
+    bool correct = true;
     for (int i=0; i<xs.size(); i++) {
-        int blockIdx = i / PERBLOCK;
-        int warpIdx = (i - blockIdx * PERBLOCK) / warpSize;
-        int idxInWarp = i - blockIdx * PERBLOCK - warpIdx * warpSize;
-        int cumSumUpToMyBlock = perBlockArray.h_data[blockIdx];
-        int perAtomMyWarp = perBlockArray.h_data[blockIdx+1] - cumSumUpToMyBlock;
-        int baseIdx = PERBLOCK * perBlockArray.h_data[blockIdx] + perAtomMyWarp * warpSize * warpIdx + idxInWarp;
-
-        //std::cout << "i is " << i << " blockIdx is " << blockIdx << " warp idx is " << warpIdx << " and idx in that warp is " << idxInWarp << " resulting base idx is " << baseIdx << std::endl;
+        int baseIdx = baseNeighlistIdxFromRPIndex(perBlockArray.h_data.data(), warpSize, i, nThreadPerRP, nThreadPerBlock());
+        int baseIdxCompressed = 0;
+        if (compressed.words) {
+            baseIdxCompressed = baseNeighlistIdxFromRPIndex(compressed.cumulSumMaxPerBlock, warpSize, i, nThreadPerRP, nThreadPerBlock());
+        }
+
         //std::cout << "id is " << ids[i] << std::endl;
         std::vector<int> neighIds;
-        // std::cout << "begin end " << neighIdxs[i] << " " << neighIdxs[i+1] << std::endl;
-        for (int j=0; j<neighCounts[i]; j++) {
-            int nIdx = baseIdx + j*warpSize;
-            // std::cout << "looking at neighborlist index " << nIdx << std::endl;
-            // std::cout << "idx " << nlist[nIdx] << std::endl;
-            float4 atom = xs[nlist[nIdx]];
-            uint id = ids[nlist[nIdx]];
-            // std::cout << "id is " << id << std::endl;
-            neighIds.push_back(id);
+        for (int myIdxInTeam=0; myIdxInTeam<nThreadPerRP; myIdxInTeam++) {
+            NeighborReader neighbors(nlist, compressed, baseIdx + myIdxInTeam, baseIdxCompressed + myIdxInTeam, warpSize);
+            for (int j=myIdxInTeam; j<neighCounts[i]; j+=nThreadPerRP) {
+                uint otherIdx = neighbors.next() & EXCL_MASK;
+                neighIds.push_back(ids[otherIdx]);
+            }
         }
 
         sort(neighIds.begin(), neighIds.end());
@@ -1119,20 +2271,38 @@ bool GridGPU::verifyNeighborlists(float neighCut) {
                 std::cout << x << " ";
             }
             std::cout << std::endl;
+            correct = false;
             break;
         }
     }
 
     free(nlist);
     std::cout << "end verification" << std::endl;
-    return true;
+    return correct;
 }
 
 
 bool GridGPU::checkSorting(int gridIdx, int *gridIdxs,
                            GPUArrayDeviceGlobal<int> &gridIdxsDev) {
 
-    int numGridIdxs = prod(ns);
+    //cells are numbered as the build numbers them, so check with a host copy of its cell map
+    int numGridIdxs = sparseCells ? numOccupiedCells + 1 : prod(ns);
+    CellMap cellOrder_h;
+    cellOrder_h.order = cellOrder.size() ? cellOrder.h_data.data() : nullptr;
+    cellOrder_h.hashKeys = nullptr;
+    cellOrder_h.hashSlots = nullptr;
+    cellOrder_h.hashMask = cellHashKeys.size() - 1;
+    cellOrder_h.emptySlot = numOccupiedCells;
+    std::vector<unsigned long long> hashKeys_h;
+    std::vector<int> hashSlots_h;
+    if (sparseCells) {
+        hashKeys_h.resize(cellHashKeys.size());
+        hashSlots_h.resize(cellHashSlots.size());
+        cellHashKeys.get(hashKeys_h.data());
+        cellHashSlots.get(hashSlots_h.data());
+        cellOrder_h.hashKeys = hashKeys_h.data();
+        cellOrder_h.hashSlots = hashSlots_h.data();
+    }
     std::vector<int> activeIds = LISTMAPREF(Atom, int, atom, state->atoms, atom.id);
     std::vector<int> gpuIds;
 
@@ -1152,8 +2322,7 @@ bool GridGPU::checkSorting(int gridIdx, int *gridIdxs,
             gpuIds.push_back(id);
 
             int3 sqr = make_int3((pos - os) / ds);
-            int linear = LINEARIDX(sqr, ns);
-            if (linear != i) {
+            if (cellOrder_h(sqr, ns) != i) {
                 correct = false;
             }
         }
@@ -1250,6 +2419,8 @@ void GridGPU::handleExclusionsDistance() {
     exclusionIndexes.set(idxs.data());
     exclusionIds = GPUArrayDeviceGlobal<uint>(excludedById.size());
     exclusionIds.set(excludedById.data());
+    exclusionIndexesHost = idxs;
+    exclusionIdsHost = excludedById;
     /*(
     for (int idx : idxs) {
         cout << "excl bound " << idx << endl;
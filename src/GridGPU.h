@@ -14,6 +14,8 @@
 #include "Tunable.h"
 
 #include "BoundsGPU.h"
+#include "NeighborlistCompressed.h"
+#include "ClusterPairsHost.h"
 class State;
 
 #include "globalDefs.h"
@@ -26,6 +28,50 @@ class State;
  * This class defines a simulation grid on the GPU. Typically, the GridGPU will
  * be created by AtomGrid::makeGPU().
  */
+#define CELL_HASH_EMPTY 0xffffffffffffffffULL //!< Free slot in GridGPU::cellHashKeys
+
+//! Row-major index of a grid cell, 64 bit so sparse grids can be larger than 2^31 cells
+inline __host__ __device__ unsigned long long cellKey(int3 idx, int3 ns) {
+    return ((unsigned long long) idx.x * ns.y + idx.y) * ns.z + idx.z;
+}
+
+//! Hash of a cell key (the finalizer of MurmurHash3)
+inline __host__ __device__ uint32_t cellHash(unsigned long long key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return (uint32_t) key;
+}
+
+/*! \brief Maps a grid cell to its index in perCellArray
+ *
+ * Dense grids index cells in row-major order, or by rank along the
+ * space-filling curve through order.  Sparse grids hold only the occupied
+ * cells, found through an open-addressing hash of the row-major index.
+ * Unoccupied cells map to emptySlot, an extra cell with no atoms.
+ */
+struct CellMap {
+    const int *order;
+    const unsigned long long *hashKeys; //!< Null for dense grids
+    const int *hashSlots;
+    uint32_t hashMask;
+    int emptySlot;
+    __host__ __device__ int operator()(int3 idx, int3 ns) const {
+        if (hashKeys) {
+            unsigned long long key = cellKey(idx, ns);
+            uint32_t h = cellHash(key) & hashMask;
+            while (hashKeys[h] != key) {
+                if (hashKeys[h] == CELL_HASH_EMPTY) {
+                    return emptySlot;
+                }
+                h = (h + 1) & hashMask;
+            }
+            return hashSlots[h];
+        }
+        return CELLIDX(idx, ns, order);
+    }
+};
+
 //void export_GridGPU();
 class GridGPU : public Tunable {
 
@@ -46,16 +92,22 @@ private:
      */
     void initStream();
 
+    int exclusionMode; //<! When to do exclusions based on distance or existing forcers
+
+public:
     /*! \brief Verfiy consistency of neightbor list
      *
      * \param neighCut Cutoff distance for neighbor building
+     * \param counts Device neighbor counts to check, e.g. a sub-list's from
+     *        neighborCounts.  nullptr checks the whole list
      *
      * \return True if neighbor list is built correctly. Else, return False.
      *
      * This function is helpful for debugging purposes, checking that the
-     * neighbor listing works as expected.
+     * neighbor listing works as expected.  Compares against all pairs within
+     * neighCut at the current positions, so call it right after a build.
      */
-    bool verifyNeighborlists(float neighCut);
+    bool verifyNeighborlists(float neighCut, uint16_t *counts = nullptr);
 
     /*! \brief Verify that sorting atoms into grid works as expected
      *
@@ -69,18 +121,28 @@ private:
      * atoms are sorted correctly into the grid cells.
      */
     bool checkSorting(int gridIdx, int *gridIdxs, GPUArrayDeviceGlobal<int> &grid);
-    int exclusionMode; //<! When to do exclusions based on distance or existing forcers
 
-public:
     GPUArrayGlobal<uint32_t> perCellArray;      //!< Number of atoms in a given grid cell, later starting index of cell in neighborlist
     GPUArrayGlobal<uint32_t> perBlockArray;     //!< Number of neighbors in a GPU block
     GPUArrayDeviceGlobal<uint16_t> perBlockArray_maxNeighborsInBlock; //!< array for holding max # neighs of atoms in a GPU block
+    /*! \brief Neighbors per ring polymer single-pass builds leave room for
+     *
+     * When non-zero, builds skip counting and give every ring polymer this
+     * many slots, sized from the most neighbors of any ring polymer in
+     * earlier builds.  If any ring polymer has more, which is read right
+     * after the build, the list is counted and built again before it is used.
+     * Zero when that layout would take much more memory than a counted one.
+     */
+    int singlePassCapacity;
+    GPUArrayDeviceGlobal<int> maxNeighborCount; //!< Most neighbors of any ring polymer in the last build, then the words per warp of the compressed list
     GPUArrayGlobal<uint16_t> perAtomArray;      //!< For each atom, store the place in the grid
     GPUArrayDeviceGlobal<float4> xsLastBuild;   //!< Contains the atom positions at
     GPUArrayDeviceGlobal<float4> rpCentroids;
                                                 //!< the time of the last build.
     GPUArrayGlobal<int> buildFlag;  //!< If buildFlag[0] == true, neighbor list
-                                    //!< will be rebuilt
+                                    //!< will be rebuilt.  buildFlag[1] is set if the
+                                    //!< inner list needs pruning
+    GPUArrayDeviceGlobal<int> rpInSlot;          //!< Ring polymer in each sorted slot, used to order cells by id in deterministic runs
     float3 ds;      //!< Grid spacing in x-, y-, and z-dimension
     float3 os;      //!< Point of origin (lower value for all bounds)
     int3 ns;        //!< Number of grid points in each dimension
@@ -136,6 +198,47 @@ public:
     void handleExclusionsForcers();
 
     void initArraysTune();
+
+    /*! \brief Change the neighbor list padding
+     *
+     * Adjusts neighCutoffMax and the grid cell size to match.  The list is
+     * not rebuilt until the next periodicBoundaryConditions call.
+     */
+    void setPadding(double padding_);
+
+    /*! \brief Change the largest interaction cutoff
+     *
+     * As setPadding, for fixes whose cutoffs change during a run.
+     */
+    void setRCut(double rCut);
+
+    /*! \brief Number the grid cells along the curve set by State::gridOrder
+     *
+     * Called whenever the number of cells changes.  Atoms are sorted by
+     * cell in this order, so with Morton or Hilbert ordering atoms that are
+     * close in space are also close in memory.  Leaves cellOrder empty for
+     * the default row-major ordering.
+     */
+    void updateCellOrder();
+    GPUArrayGlobal<int> cellOrder; //!< Rank of each row-major cell along the space-filling curve, empty for row-major
+
+    /*! \brief Hash the occupied cells and number them along State::gridOrder
+     *
+     * Used instead of a dense perCellArray when the grid has many more cells
+     * than atoms, as in vapor-liquid slabs, droplets, or large non-periodic
+     * boxes.  perCellArray then holds only the occupied cells plus one empty
+     * cell, so memory and build time scale with the number of atoms rather
+     * than the box volume.  Called every build.
+     */
+    void hashOccupiedCells(float4 *centroids, int nRingPoly);
+    //! Cell map for the current grid, for the device kernels
+    CellMap cellMap();
+    bool sparseCells;                              //!< True if only occupied cells are stored, see hashOccupiedCells
+    int numOccupiedCells;                          //!< Number of occupied cells of a sparse grid
+    GPUArrayDeviceGlobal<unsigned long long> cellHashKeys; //!< Row-major index of the cell in each hash slot, CELL_HASH_EMPTY if free
+    GPUArrayDeviceGlobal<int> cellHashSlots;             //!< Index in perCellArray of the cell in each hash slot
+    GPUArrayDeviceGlobal<uint32_t> occupiedSlots;        //!< Hash slots of the occupied cells, in cell order once numbered
+    GPUArrayDeviceGlobal<unsigned long long> occupiedCurveKeys; //!< Position of each occupied cell along the grid ordering
     /*! \brief Remap atoms around periodic boundary conditions
      *
      * \param neighCut Cutoff distance for neighbor interactions.
@@ -148,6 +251,153 @@ public:
     void periodicBoundaryConditions(float neighCut = -1,
                                     bool forceBuild = false);
 
+    /*! \brief Prune the outer neighbor list into the inner one
+     *
+     * \param innerCut Cutoff distance of the inner list
+     *
+     * Only used if innerPadding > 0.  The list built by
+     * periodicBoundaryConditions is kept in neighborlistOuter and
+     * perAtomArrayOuter, and neighborlist and perAtomArray hold only the
+     * entries within innerCut, so the pair kernels iterate the short list.
+     * Called after every build and whenever an atom has moved more than
+     * innerPadding/2 since the last prune.  A compressed list is pruned from
+     * neighborlistCompressedOuter without decoding it, see
+     * compressNeighborlist.
+     */
+    void pruneNeighborlist(float innerCut);
+    float innerPadding; //!< Padding of the pruned inner list.  0 means the built list is used directly
+    GPUArrayDeviceGlobal<uint> neighborlistOuter;      //!< Full list built with padding, pruned into neighborlist
+    GPUArrayDeviceGlobal<uint16_t> perAtomArrayOuter;  //!< Neighbor counts of the outer list
+    GPUArrayDeviceGlobal<float4> xsLastPrune;          //!< Atom positions at the time of the last prune
+    int numChecksSinceLastPrune;
+
+    /*! \brief Set the cutoffs of the nested neighbor sub-lists
+     *
+     * \param rCuts Interaction cutoffs of the fixes using the neighbor list
+     *
+     * Each distinct cutoff shorter than the largest gets a sub-list.  Each
+     * atom's row of the neighbor list is ordered by distance class, with the
+     * neighbors within the shortest cutoff (plus padding) first, so a
+     * sub-list is the first perAtomArraySubLists entries of the row and pair
+     * kernels use it by being passed its counts instead of perAtomArray.
+     * The rows are reordered after every build or prune.
+     */
+    void setSubListRCuts(std::vector<float> rCuts);
+
+    /*! \brief Neighbor counts of the shortest list holding every pair within rCut
+     *
+     * Returns perAtomArray if no sub-list is short enough.  Only valid for
+     * the device neighbor list.
+     */
+    uint16_t *neighborCounts(float rCut);
+
+    /*! \brief Order each atom's neighbor row by sub-list and count the entries of each
+     *
+     * \param subListPadding Padding added to each sub-list cutoff.  Entries
+     *        stay valid until an atom moves half the padding of the list
+     *        they came from, so this is the padding of that list.
+     */
+    void partitionNeighborlist(float subListPadding);
+    std::vector<float> subListRCuts;                   //!< Ascending cutoffs of the sub-lists, without padding
+
+    /*! \brief Compressed neighbor list for the kernels reading the list
+     *
+     * Returns an empty NeighborlistCompressed, which makes NeighborReader
+     * read neighborlist, unless State::compressNeighborlist was set when the
+     * list was last built.
+     */
+    NeighborlistCompressed compressedNeighborlist();
+
+    /*! \brief Order and measure the freshly built list for compressing
+     *
+     * Partitions the sub-lists, orders each sub-list of every row by index,
+     * and lays out the words of each pair kernel thread's neighbors, as
+     * described in NeighborlistCompressed.  The total size is left in
+     * maxNeighborCount, to be read with the build's neighbor count.
+     */
+    void sizeCompressedNeighborlist();
+
+    /*! \brief Store the list as 16 bit index differences
+     *
+     * \param cumulWordsPerWarp Total words per warp found by sizeCompressedNeighborlist
+     *
+     * Encodes the list into neighborlistCompressed, or, with an inner list,
+     * into neighborlistCompressedOuter, which pruneNeighborlist then prunes
+     * into the same layout.  The uncompressed list is then released, so only
+     * the compressed form is kept between builds.
+     */
+    void compressNeighborlist(uint32_t cumulWordsPerWarp);
+    //! Partition the uncompressed list after it was built or pruned
+    void neighborlistChanged();
+    bool neighborlistCompressedValid;                  //!< True if the list is only stored compressed
+    GPUArrayDeviceGlobal<uint16_t> neighborlistCompressed; //!< Words of the compressed list
+    GPUArrayDeviceGlobal<uint16_t> neighborlistCompressedOuter; //!< Words of the compressed outer list, pruned into neighborlistCompressed
+    GPUArrayDeviceGlobal<uint16_t> perAtomArraySubListsOuter;   //!< Sub-list counts of neighborlistCompressedOuter
+    GPUArrayDeviceGlobal<uint32_t> perBlockArrayCompressed; //!< Cumulative words per warp of each block of the compressed list
+
+    /*! \brief Bin atoms for per type pair cutoffs
+     *
+     * \param rCutSqrs Squared interaction cutoff of each type pair,
+     *                 numTypes*numTypes.  Empty to use neighCutoffMax for
+     *                 every pair
+     * \param numTypes Number of atom types
+     *
+     * Only pairs within their own cutoff plus padding are listed.  Grid
+     * cells are sized by the shortest per-type cutoff, and each atom searches
+     * the cells within the longest cutoff of its own type, skipping cells
+     * that are entirely out of range.  In size-asymmetric mixtures small
+     * atoms then search a small neighborhood and their lists only hold the
+     * pairs they interact with.  Falls back to a single cutoff for ring
+     * polymers, the host backend, and boxes too small for the stencil.
+     */
+    void setTypeRCuts(std::vector<float> rCutSqrs, int numTypes);
+    std::vector<float> typeRCuts;              //!< Cutoff of each type pair, without padding.  Empty for a single cutoff
+    int numTypesMulti;                         //!< Number of types in typeRCuts
+    bool multiCutoffActive;                    //!< True if the current cells are sized for per type pair cutoffs
+    float multiCutoffCellSize;                 //!< Shortest per-type cutoff plus padding, the attempted cell size
+    GPUArrayDeviceGlobal<float> typeNeighCutSqrs; //!< Squared cutoff plus padding of each type pair
+    GPUArrayDeviceGlobal<float> typeNeighCutMaxs; //!< Longest cutoff plus padding of each type
+    //! Upload the per type pair cutoffs with the current padding
+    void updateTypeNeighCuts();
+    GPUArrayDeviceGlobal<float> subListCutSqrs;        //!< Squared cutoffs plus padding of the sub-lists
+    GPUArrayDeviceGlobal<uint16_t> perAtomArraySubLists; //!< Neighbor counts of each sub-list, one block of nRingPoly per sub-list
+
+    /*! \brief Host backend version of periodicBoundaryConditions
+     *
+     * Wraps, sorts, and rebuilds the neighbor list on the host copies of the
+     * atom data.  Builds the cluster-pair list if state->hostClusterPairs is
+     * set and the atom list otherwise
+     */
+    void periodicBoundaryConditionsHost(float neighCut, bool forceBuild);
+    /*! \brief Build the host atom neighbor list
+     *
+     * Each atom's row starts at neighborIdxsHost[idx] and has
+     * perAtomArray.h_data[idx] entries
+     */
+    void buildNeighborlistHost(float neighCutSqr, float3 periodic, float3 trace);
+    std::vector<uint> neighborlistHost;     //!< Host neighborlist, compressed rows
+    std::vector<uint32_t> neighborIdxsHost; //!< Start of each atom's row in neighborlistHost
+    std::vector<float4> xsLastBuildHost;    //!< Host positions at the time of the last build
+
+    /*! \brief Build the host cluster-pair list
+     *
+     * Called by periodicBoundaryConditionsHost in place of
+     * buildNeighborlistHost when state->hostClusterPairs is set.  See
+     * buildClusterPairListHost.
+     */
+    void buildClusterPairsHost(float neighCutSqr, float3 periodic, float3 trace);
+    std::vector<int> clusterIdxsHost;         //!< Atom idxs of each cluster, -1 for padding
+    std::vector<int> cellClusterIdxsHost;     //!< First cluster of each grid cell
+    std::vector<uint32_t> clusterPairIdxsHost; //!< Start of each cluster's row in clusterPairsHost
+    std::vector<ClusterPair> clusterPairsHost; //!< Host cluster-pair list
+    bool clusterPairsHostValid;                //!< True if the last build made the cluster-pair list instead of neighborlistHost
+    bool halfListHost;                         //!< True if neighborlistHost stores each pair once (otherIdx > idx)
+    std::vector<float3> forceScratchHost;      //!< Per-thread force buffers for half-list and cluster-pair evaluation
+    std::vector<Virial> virialScratchHost;     //!< Per-thread virial buffers for half-list and cluster-pair evaluation
+    std::vector<float> engScratchHost;         //!< Per-thread energy buffers for half-list and cluster-pair evaluation
+    //! Return the exclusion tag (already shifted to the top two bits) between two atoms
+    uint exclusionTagHost(uint myId, uint otherId);
+
     /*! \typedef ExclusionList
      * \brief List of atoms bonded along a chain up to a given depth
      *
@@ -190,6 +440,8 @@ public:
     //ExclusionList exclusionList;
     GPUArrayDeviceGlobal<int> exclusionIndexes; //!< List of exclusion indices
     GPUArrayDeviceGlobal<uint> exclusionIds;    //!< List of excluded atom IDs
+    std::vector<int> exclusionIndexesHost;      //!< Host copy of exclusionIndexes
+    std::vector<uint> exclusionIdsHost;         //!< Host copy of exclusionIds
     int maxExclusionsPerAtom;           //!< Maximum number of exclusions for a
                                         //!< single atom
     int numChecksSinceLastBuild;        //!< Number of calls to
@@ -0,0 +1,355 @@
+#include "Autotuner.h"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+#include "Fix.h"
+#include "Logging.h"
+#include "State.h"
+
+Autotuner::Autotuner(State *state_) : state(state_) {
+    tuning = false;
+    paramIdx = 0;
+    candidateIdx = 0;
+    turnsInTrial = 0;
+    userPadding = 0;
+    userInterval = 1;
+    restoreAfterRun = false;
+    bestTime = std::numeric_limits<double>::max();
+    bestVal = 0;
+    lastTuneTurn = 0;
+}
+
+void Autotuner::setupParams() {
+    params.clear();
+    if (state->backend != BACKEND::HOST) {
+        int warpSize = state->devManager.prop.warpSize;
+        Param perBlock;
+        perBlock.name = "nThreadPerBlock";
+        for (int n=64; n<=maxThreadPerBlock; n*=2) {
+            if (n % warpSize == 0) {
+                perBlock.candidates.push_back(n);
+            }
+        }
+        perBlock.get = [this] () { return (double) state->nThreadPerBlock; };
+        perBlock.set = [this] (double x) { setThreads((int) x, state->nThreadPerAtom); };
+        params.push_back(perBlock);
+
+        Param perAtom;
+        perAtom.name = "nThreadPerAtom";
+        for (int n : {1, 2, 4, 8, 16}) {
+            if (warpSize % n == 0) {
+                perAtom.candidates.push_back(n);
+            }
+        }
+        perAtom.get = [this] () { return (double) state->nThreadPerAtom; };
+        perAtom.set = [this] (double x) { setThreads(state->nThreadPerBlock, (int) x); };
+        params.push_back(perAtom);
+    }
+
+    //before padding, since a fix's candidates may change the neighbor list cutoff
+    for (Fix *f : state->fixes) {
+        int nCandidates = f->nTuneCandidates();
+        if (nCandidates > 1) {
+            Param fixParam;
+            fixParam.name = "fix_" + f->handle;
+            std::replace(fixParam.name.begin(), fixParam.name.end(), ' ', '_');
+            for (int i=0; i<nCandidates; i++) {
+                fixParam.candidates.push_back(i);
+            }
+            fixParam.get = [f] () { return (double) f->tuneCandidate(); };
+            fixParam.set = [f] (double x) { f->setTuneCandidate((int) x); };
+            params.push_back(fixParam);
+        }
+    }
+
+    //the padding sets how far atoms may move between rebuild checks, so periodicInterval follows it (see safeInterval)
+    if (userPadding > 0) {
+        Param padding;
+        padding.name = "padding";
+        for (double scale : {0.5, 0.75, 1.0, 1.5, 2.0}) {
+            double x = scale * userPadding;
+            //the pruned inner list needs a larger outer list
+            if (state->innerPadding == 0 or x > state->innerPadding) {
+                padding.candidates.push_back(x);
+            }
+        }
+        padding.get = [this] () { return state->padding; };
+        padding.set = [this] (double x) { setPadding(x); };
+        params.push_back(padding);
+    } else {
+        Param interval;
+        interval.name = "periodicInterval";
+        for (int n : {1, 2, 5, 10, 20, 50, 100}) {
+            if (n < userInterval) {
+                interval.candidates.push_back(n);
+            }
+        }
+        interval.candidates.push_back(userInterval);
+        interval.get = [this] () { return (double) state->periodicInterval; };
+        interval.set = [this] (double x) { state->periodicInterval = (int) x; };
+        params.push_back(interval);
+    }
+}
+
+//Atoms may move padding/2 between rebuild checks.  The user's padding and interval are taken to be safe, so a
+//padding is given the largest interval whose padding per turn is at least the user's, never above the user's interval
+int Autotuner::safeInterval(double padding, double userPadding, int userInterval) {
+    int best = 1;
+    for (int n : {1, 2, 5, 10, 20, 50, 100, userInterval}) {
+        if (n <= userInterval and n * userPadding <= padding * userInterval) {
+            best = std::max(best, n);
+        }
+    }
+    return best;
+}
+
+void Autotuner::setThreads(int nThreadPerBlock, int nThreadPerAtom) {
+    state->nThreadPerBlock = nThreadPerBlock;
+    state->nThreadPerAtom = nThreadPerAtom;
+    GridGPU &grid = state->gridGPU;
+    grid.nThreadPerBlock(nThreadPerBlock);
+    grid.nThreadPerAtom(nThreadPerAtom);
+    grid.initArraysTune();
+    //pair kernels index the neighbor list with the fixes' values, so they must match the grid's
+    for (Fix *f : state->fixes) {
+        f->nThreadPerBlock(nThreadPerBlock);
+        f->nThreadPerAtom(nThreadPerAtom);
+    }
+}
+
+void Autotuner::setPadding(double padding) {
+    state->padding = padding;
+    state->periodicInterval = safeInterval(padding, userPadding, userInterval);
+    state->gridGPU.setPadding(padding);
+}
+
+void Autotuner::prepareForRun() {
+    lastTuneTurn = state->turn;
+    tuning = false;
+    if (not state->autoTune) {
+        return;
+    }
+    //restored in postRun, so tuned values never become the user's settings
+    userPadding = state->padding;
+    userInterval = state->periodicInterval;
+    restoreAfterRun = true;
+    //taken before anything is tuned, since tuning a fix may change the cutoff
+    cacheSignature = signature();
+    if (readCache()) {
+        return;
+    }
+    if (state->deterministic) {
+        //timings differ between runs, so the tuned values (and the trajectory) would too
+        mdWarning("autoTune does not time parameters in deterministic mode.  Only cached values are used\n");
+        return;
+    }
+    beginTuning();
+}
+
+void Autotuner::beginTuning() {
+    lastTuneTurn = state->turn;
+    setupParams();
+    if (params.empty()) {
+        return;
+    }
+    tuning = true;
+    paramIdx = 0;
+    candidateIdx = 0;
+    bestTime = std::numeric_limits<double>::max();
+    bestVal = params[0].get();
+    startTrial();
+}
+
+void Autotuner::startTrial() {
+    params[paramIdx].set(params[paramIdx].candidates[candidateIdx]);
+    //every trial starts from a fresh list, and the timer starts once that build has finished
+    state->gridGPU.periodicBoundaryConditions(-1, true);
+    if (state->backend != BACKEND::HOST) {
+        cudaDeviceSynchronize();
+    }
+    turnsInTrial = 1;
+    trialStart = std::chrono::high_resolution_clock::now();
+}
+
+double Autotuner::elapsed() {
+    if (state->backend != BACKEND::HOST) {
+        cudaDeviceSynchronize();
+    }
+    std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - trialStart;
+    return duration.count();
+}
+
+void Autotuner::turnStart() {
+    if (not tuning) {
+        if (state->autoTune and not state->deterministic and state->tuneEvery > 0 and state->turn - lastTuneTurn >= state->tuneEvery) {
+            beginTuning();
+        }
+        return;
+    }
+    if (turnsInTrial < state->tuneTurns) {
+        turnsInTrial++;
+        return;
+    }
+    double time = elapsed();
+    Param &param = params[paramIdx];
+    if (time < bestTime) {
+        bestTime = time;
+        bestVal = param.candidates[candidateIdx];
+    }
+    candidateIdx++;
+    if (candidateIdx == param.candidates.size()) {
+        param.set(bestVal);
+        mdMessage("Tuned %s to %g\n", param.name.c_str(), bestVal);
+        paramIdx++;
+        if (paramIdx == params.size()) {
+            finishTuning();
+            return;
+        }
+        candidateIdx = 0;
+        bestTime = std::numeric_limits<double>::max();
+        bestVal = params[paramIdx].get();
+    }
+    startTrial();
+}
+
+void Autotuner::postRun() {
+    if (tuning) {
+        params[paramIdx].set(bestVal);
+        tuning = false;
+    }
+    if (not restoreAfterRun) {
+        return;
+    }
+    restoreAfterRun = false;
+    state->padding = userPadding;
+    state->periodicInterval = userInterval;
+    state->gridGPU.setPadding(userPadding);
+}
+
+void Autotuner::finishTuning() {
+    tuning = false;
+    //the list was built for the last candidate
+    state->gridGPU.periodicBoundaryConditions(-1, true);
+    if (state->tuneCacheFile.size()) {
+        writeCache();
+    }
+}
+
+std::string Autotuner::signature() {
+    std::vector<std::string> fixTypes;
+    for (Fix *f : state->fixes) {
+        fixTypes.push_back(f->type);
+    }
+    std::stringstream hardware;
+    if (state->backend == BACKEND::HOST) {
+        hardware << "host " << state->nHostThreads;
+    } else {
+        std::string device = state->devManager.prop.name;
+        std::replace(device.begin(), device.end(), ' ', '_');
+        hardware << "gpu " << device;
+    }
+    return signature(state->atoms.size(), state->nPerRingPoly, state->atoms.size() / state->boundsGPU.volume(),
+                     state->getMaxRCut(), hardware.str(), fixTypes);
+}
+
+std::string Autotuner::signature(size_t nAtoms, int nPerRingPoly, double density, double rCut,
+                                 std::string hardware, std::vector<std::string> fixTypes) {
+    std::sort(fixTypes.begin(), fixTypes.end());
+    std::stringstream ss;
+    ss.precision(3);
+    ss << "nAtoms " << nAtoms;
+    ss << " nPerRingPoly " << nPerRingPoly;
+    ss << " density " << density;
+    ss << " rCut " << rCut;
+    ss << " " << hardware;
+    ss << " fixes";
+    for (std::string &type : fixTypes) {
+        ss << " " << type;
+    }
+    return ss.str();
+}
+
+bool Autotuner::readCache() {
+    TunedValues values;
+    if (state->tuneCacheFile.empty() or not readCacheFile(state->tuneCacheFile, cacheSignature, userInterval, values)) {
+        return false;
+    }
+    setupParams();
+    for (auto &value : values) {
+        for (Param &param : params) {
+            if (param.name == value.first) {
+                param.set(value.second);
+            }
+        }
+    }
+    state->gridGPU.periodicBoundaryConditions(-1, true);
+    mdMessage("Using tuned parameters from %s\n", state->tuneCacheFile.c_str());
+    return true;
+}
+
+void Autotuner::writeCache() {
+    TunedValues values;
+    for (Param &param : params) {
+        values.push_back(std::make_pair(param.name, param.get()));
+    }
+    if (not writeCacheFile(state->tuneCacheFile, cacheSignature, values)) {
+        mdWarning("Could not write tuning cache %s\n", state->tuneCacheFile.c_str());
+    }
+}
+
+//each line of the cache is the signature, a tab, then name value pairs
+bool Autotuner::readCacheFile(std::string fn, std::string sig, int userInterval, TunedValues &values) {
+    std::ifstream cache(fn);
+    std::string line;
+    while (std::getline(cache, line)) {
+        size_t tab = line.find('\t');
+        if (tab == std::string::npos or line.substr(0, tab) != sig) {
+            continue;
+        }
+        values.clear();
+        std::stringstream ss(line.substr(tab+1));
+        std::string name;
+        double x;
+        while (ss >> name >> x) {
+            //a cached interval was safe for the padding tuned with it, but the user may have since asked for less
+            if (name == "periodicInterval") {
+                x = std::min(x, (double) userInterval);
+            }
+            values.push_back(std::make_pair(name, x));
+        }
+        return true;
+    }
+    return false;
+}
+
+bool Autotuner::writeCacheFile(std::string fn, std::string sig, const TunedValues &values) {
+    std::vector<std::string> lines;
+    std::ifstream cacheIn(fn);
+    std::string line;
+    while (std::getline(cacheIn, line)) {
+        if (line.substr(0, line.find('\t')) != sig) {
+            lines.push_back(line);
+        }
+    }
+    cacheIn.close();
+
+    std::stringstream ss;
+    ss << sig << "\t";
+    ss.precision(8);
+    for (const auto &value : values) {
+        ss << value.first << " " << value.second << " ";
+    }
+    lines.push_back(ss.str());
+
+    std::ofstream cacheOut(fn);
+    if (not cacheOut.is_open()) {
+        return false;
+    }
+    for (std::string &l : lines) {
+        cacheOut << l << "\n";
+    }
+    return true;
+}
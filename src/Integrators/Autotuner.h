@@ -0,0 +1,100 @@
+#pragma once
+#ifndef AUTOTUNER_H
+#define AUTOTUNER_H
+
+#include <stdint.h>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+class State;
+
+//! Times candidate runtime parameters during the first turns of a run
+/*!
+ * When State::autoTune is set, the integrator calls turnStart() at the top of
+ * each turn.  Parameters are tuned one at a time: each candidate value is run
+ * for State::tuneTurns turns and the fastest is kept before moving on to the
+ * next parameter.  The tuned parameters are nThreadPerBlock and
+ * nThreadPerAtom (GPU backend only), parameter sets offered by fixes (see
+ * Fix::nTuneCandidates), and padding together with periodicInterval.
+ * Each padding is run with the longest interval that keeps the padding per
+ * turn between rebuild checks at least the user's, and periodicInterval is
+ * never raised above the value set by the user.  The user's padding and
+ * periodicInterval are restored after the run.
+ *
+ * If State::tuneCacheFile is set, the winners are stored there keyed by a
+ * signature of the system (atom count, density, cutoff, fixes), and a later
+ * run with the same signature starts from the cached values without tuning.
+ * Tuning is repeated every State::tuneEvery turns.
+ */
+class Autotuner {
+public:
+    Autotuner(State *state_);
+
+    //! Load cached values or begin tuning.  Call once the grid has been built.
+    void prepareForRun();
+
+    //! Advance the tuner.  Call at the top of every turn, before the neighbor list check.
+    void turnStart();
+
+    //! Restore the padding and periodicInterval set by the user
+    void postRun();
+
+    bool tuning; //!< True while candidates are being timed
+
+    static const int maxThreadPerBlock = 512; //!< Largest nThreadPerBlock candidate
+
+    typedef std::vector<std::pair<std::string, double> > TunedValues; //!< Name and value of each tuned parameter
+
+    //! Longest periodicInterval, at most userInterval, at which padding moves at least as far per turn as the user's
+    static int safeInterval(double padding, double userPadding, int userInterval);
+
+    //! Key of a system in the tuning cache.  Values are rounded, so nearby systems share cached parameters
+    static std::string signature(size_t nAtoms, int nPerRingPoly, double density, double rCut,
+                                 std::string hardware, std::vector<std::string> fixTypes);
+
+    //! Read the values cached for sig, with periodicInterval clamped to userInterval.  False if there are none
+    static bool readCacheFile(std::string fn, std::string sig, int userInterval, TunedValues &values);
+
+    //! Store values for sig, replacing any cached before.  False if the file could not be written
+    static bool writeCacheFile(std::string fn, std::string sig, const TunedValues &values);
+
+private:
+    struct Param {
+        std::string name;
+        std::vector<double> candidates;
+        std::function<double ()> get;
+        std::function<void (double)> set;
+    };
+
+    State *state;
+    std::vector<Param> params;
+    int paramIdx;
+    int candidateIdx;
+    int turnsInTrial;
+    double bestTime;
+    double bestVal;
+    int64_t lastTuneTurn;
+    std::chrono::high_resolution_clock::time_point trialStart;
+
+    void setupParams();
+    void beginTuning();
+    void startTrial();
+    void finishTuning();
+    double elapsed();
+
+    void setThreads(int nThreadPerBlock, int nThreadPerAtom);
+    void setPadding(double padding);
+    double userPadding; //!< state->padding when the run started
+    int userInterval;   //!< state->periodicInterval when the run started
+    bool restoreAfterRun; //!< True if postRun should restore userPadding and userInterval
+
+    std::string signature();
+    std::string cacheSignature; //!< signature() at the start of the run
+    bool readCache();
+    void writeCache();
+};
+
+#endif
@@ -4,12 +4,17 @@
 #include "globalDefs.h"
 #include "cutils_func.h"
 #include "DataSetUser.h"
+#include "DataComputer.h"
 #include "Fix.h"
 #include "GPUArray.h"
 #include "PythonOperation.h"
 #include "WriteConfig.h"
 #include "Interpolator.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace std;
 
 
@@ -39,7 +44,11 @@ void Integrator::stepInit(bool computeVirials)
     }
     if (computeVirials) {
         //reset virials each turn
-        state->gpd.virials.d_data.memset(0);
+        if (state->backend == BACKEND::HOST) {
+            std::fill(state->gpd.virials.h_data.begin(), state->gpd.virials.h_data.end(), Virial(0, 0, 0, 0, 0, 0));
+        } else {
+            state->gpd.virials.d_data.memset(0);
+        }
     }
 }
 
@@ -66,7 +75,9 @@ void Integrator::asyncOperations() {
     // capture this instead.  Little confused
     auto writeAndPy = [this] (int64_t ts) {
         // have to set device in each thread
-        state->devManager.setDevice(state->devManager.currentDevice, false);
+        if (state->backend != BACKEND::HOST) {
+            state->devManager.setDevice(state->devManager.currentDevice, false);
+        }
         for (SHARED(WriteConfig) wc : state->writeConfigs) {
             if (not (ts % wc->writeEvery)) {
                 wc->write(ts);
@@ -122,7 +133,19 @@ __global__ void printFloats(float4 *xs, int n) {
 
 
 void Integrator::basicPreRunChecks() {
-    if (state->devManager.prop.major < 3) {
+    if (state->backend == BACKEND::HOST) {
+        for (Fix *f : state->fixes) {
+            mdAssert(f->canRunOnHost, "Fix %s of type %s cannot be run with the host backend", f->handle.c_str(), f->type.c_str());
+        }
+        mdAssert(state->nPerRingPoly == 1, "The host backend does not support ring polymers");
+        for (boost::shared_ptr<MD_ENGINE::DataSetUser> ds : state->dataManager.dataSets) {
+            mdAssert(ds->computer->canRunOnHost, "Only energy, temperature, and pressure can be recorded with the host backend");
+        }
+    } else {
+        state->devManager.init();
+        mdAssert(state->devManager.nDevices > 0, "No GPU found.  Use state.setBackend('host') to run on the CPU");
+    }
+    if (state->backend != BACKEND::HOST and state->devManager.prop.major < 3) {
         cout << "Device compute capability must be >= 3.0. Quitting" << endl;
         assert(state->devManager.prop.major >= 3);
     }
@@ -144,6 +167,15 @@ void Integrator::basicPreRunChecks() {
 
 }
 
+//defined here rather than in IntegratorUtil.cpp because it launches a kernel
+void IntegratorUtil::addFixedPointForces() {
+    GPUData &gpd = state->gpd;
+    if (gpd.fsFixed.size()) {
+        int nAtoms = state->atoms.size();
+        ::addFixedPointForces<<<NBLOCK(nAtoms), PERBLOCK>>>(nAtoms, gpd.fs(gpd.activeIdx()), nullptr, gpd.fsFixed.data(), nullptr);
+    }
+}
+
 void Integrator::prepareDataComputers() {
     for (boost::shared_ptr<MD_ENGINE::DataSetUser> ds : state->dataManager.dataSets) {
         ds->prepareForRun(); //will also prepare those data sets' computers
@@ -158,14 +190,33 @@ std::vector<bool> Integrator::basicPrepare(int numTurns) {
     int nAtoms = state->atoms.size();
     state->runningFor = numTurns;
     state->runInit = state->turn;
+    //the device array mode is process wide, so it follows whichever state is being run
+    GPUArrayDevice::hostOnly = state->backend == BACKEND::HOST;
     state->prepareForRun();
     state->atomParams.guessAtomicNumbers();
     setActiveData();
-    for (GPUArray *dat : activeData) {
-        dat->dataToDevice();
+    if (state->backend == BACKEND::HOST) {
+#ifdef _OPENMP
+        if (state->nHostThreads > 0) {
+            omp_set_num_threads(state->nHostThreads);
+        }
+#endif
+    } else {
+        for (GPUArray *dat : activeData) {
+            dat->dataToDevice();
+        }
+    }
+    if (state->fixedPointForces and state->backend != BACKEND::HOST) {
+        state->gpd.fsFixed = GPUArrayDeviceGlobal<unsigned long long>(3*nAtoms);
+        state->gpd.fsFixed.memset(0);
+    } else {
+        state->gpd.fsFixed = GPUArrayDeviceGlobal<unsigned long long>();
     }
     std::vector<bool> prepared;
     for (Fix *f : state->fixes) {
+        //pair kernels index the neighbor list with these, so they must match the grid, which takes them from the state
+        f->takeStateNThreadPerBlock(state->nThreadPerBlock);
+        f->takeStateNThreadPerAtom(state->nThreadPerAtom);
         f->updateGroupTag();
         if (!(f->requiresForces) ) {
             prepared.push_back(f->prepareForRun());
@@ -174,10 +225,13 @@ std::vector<bool> Integrator::basicPrepare(int numTurns) {
         }
         f->setVirialTurnPrepare();
     }
+    state->handlePairFusion();
     state->handleChargeOffloading();
     for (Fix *f : state->fixes) {
         f->setEvalWrapper(); //have to do this after prepare b/c pair calcs need evaluators from charge that have been updated with correct alpha or other coefficiants, and change calcs need to know that handoffs happened
     }
+    state->updateNeighborSubLists();
+    state->updateNeighborTypeRCuts();
     state->gridGPU.periodicBoundaryConditions(-1, true);
     /*
     for (boost::shared_ptr<MD_ENGINE::DataSetUser> ds : state->dataManager.dataSets) {
@@ -198,15 +252,22 @@ void Integrator::basicFinish() {
         f->postRun();
         f->hasAcceptedChargePairCalc = false;
         f->hasOffloadedChargePairCalc = false;
+        f->hasOffloadedPairCalc = false;
+        f->resetPairFusion();
+        f->respaLevel = 0;
     }
     if (state->asyncData && state->asyncData->joinable()) {
         state->asyncData->join();
     }
-    for (GPUArray *dat : activeData) {
-        dat->dataToHost();
+    if (state->backend != BACKEND::HOST) {
+        for (GPUArray *dat : activeData) {
+            dat->dataToHost();
+        }
+        cudaDeviceSynchronize();
     }
-    cudaDeviceSynchronize();
     state->downloadFromRun();
+    //atoms keep their own masses outside of runs, see State::repartitionHydrogenMass
+    state->restoreRepartitionedMass();
     state->finish();
 }
 
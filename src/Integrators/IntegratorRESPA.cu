@@ -0,0 +1,365 @@
+#include "IntegratorRESPA.h"
+
+#include <chrono>
+
+#undef _XOPEN_SOURCE
+#undef _POSIX_C_SOURCE
+#include <boost/python.hpp>
+#include <boost/shared_ptr.hpp>
+#include "Logging.h"
+#include "Autotuner.h"
+#include "State.h"
+#include "Fix.h"
+#include "FixConstraint.h"
+#include "cutils_func.h"
+#include "globalDefs.h"
+using namespace MD_ENGINE;
+
+namespace py = boost::python;
+
+__global__ void respaKick_cu(int nAtoms, float4 *vs, float4 *fsLevel, float dtf) {
+    int idx = GETIDX();
+    if (idx < nAtoms) {
+        float4 vel = vs[idx];
+        float invmass = vel.w;
+        if (invmass > INVMASSBOOL) {
+            vs[idx] = make_float4(0.0f, 0.0f, 0.0f, invmass);
+            return;
+        }
+        float3 dv = dtf * invmass * make_float3(fsLevel[idx]);
+        vel += dv;
+        vs[idx] = vel;
+    }
+}
+
+__global__ void respaDrift_cu(int nAtoms, float4 *xs, float4 *vs, float dt) {
+    int idx = GETIDX();
+    if (idx < nAtoms) {
+        float4 pos = xs[idx];
+        float3 dx = dt*make_float3(vs[idx]);
+        pos += dx;
+        xs[idx] = pos;
+    }
+}
+
+//moves the forces just computed into the level's array and clears fs for the next level
+__global__ void respaTakeForces_cu(int nAtoms, float4 *fs, float4 *fsLevel) {
+    int idx = GETIDX();
+    if (idx < nAtoms) {
+        float4 force = fs[idx];
+        fsLevel[idx] = force;
+        fs[idx] = make_float4(0.0f, 0.0f, 0.0f, force.w);
+    }
+}
+
+__global__ void respaZeroForces_cu(int nAtoms, float4 *fs) {
+    int idx = GETIDX();
+    if (idx < nAtoms) {
+        float w = fs[idx].w;
+        fs[idx] = make_float4(0.0f, 0.0f, 0.0f, w);
+    }
+}
+
+__global__ void respaAddForces_cu(int nAtoms, float4 *fs, float4 *fsLevel) {
+    int idx = GETIDX();
+    if (idx < nAtoms) {
+        float4 force = fs[idx];
+        float3 df = make_float3(fsLevel[idx]);
+        fs[idx] = make_float4(force.x + df.x, force.y + df.y, force.z + df.z, force.w);
+    }
+}
+
+/* host backend versions of the kernels above */
+
+void respaKick_host(int nAtoms, float4 *vs, float4 *fsLevel, float dtf) {
+#pragma omp parallel for schedule(static)
+    for (int idx=0; idx<nAtoms; idx++) {
+        float4 vel = vs[idx];
+        float invmass = vel.w;
+        if (invmass > INVMASSBOOL) {
+            vs[idx] = make_float4(0.0f, 0.0f, 0.0f, invmass);
+            continue;
+        }
+        float3 dv = dtf * invmass * make_float3(fsLevel[idx]);
+        vel += dv;
+        vs[idx] = vel;
+    }
+}
+
+void respaDrift_host(int nAtoms, float4 *xs, float4 *vs, float dt) {
+#pragma omp parallel for schedule(static)
+    for (int idx=0; idx<nAtoms; idx++) {
+        float4 pos = xs[idx];
+        float3 dx = dt*make_float3(vs[idx]);
+        pos += dx;
+        xs[idx] = pos;
+    }
+}
+
+void respaTakeForces_host(int nAtoms, float4 *fs, float4 *fsLevel) {
+#pragma omp parallel for schedule(static)
+    for (int idx=0; idx<nAtoms; idx++) {
+        float4 force = fs[idx];
+        fsLevel[idx] = force;
+        fs[idx] = make_float4(0.0f, 0.0f, 0.0f, force.w);
+    }
+}
+
+void respaZeroForces_host(int nAtoms, float4 *fs) {
+#pragma omp parallel for schedule(static)
+    for (int idx=0; idx<nAtoms; idx++) {
+        float w = fs[idx].w;
+        fs[idx] = make_float4(0.0f, 0.0f, 0.0f, w);
+    }
+}
+
+void respaAddForces_host(int nAtoms, float4 *fs, float4 *fsLevel) {
+#pragma omp parallel for schedule(static)
+    for (int idx=0; idx<nAtoms; idx++) {
+        float4 force = fs[idx];
+        float3 df = make_float3(fsLevel[idx]);
+        fs[idx] = make_float4(force.x + df.x, force.y + df.y, force.z + df.z, force.w);
+    }
+}
+
+IntegratorRESPA::IntegratorRESPA(State *state_, py::list loops_)
+    : Integrator(state_)
+{
+    int len = py::len(loops_);
+    for (int i=0; i<len; i++) {
+        py::extract<int> loopPy(loops_[i]);
+        mdAssert(loopPy.check(), "Non-integer number of steps given for RESPA level %d", i);
+        int loop = loopPy;
+        mdAssert(loop > 0, "RESPA level %d must take at least one step per step of the level above it", i);
+        loops.push_back(loop);
+    }
+}
+
+void IntegratorRESPA::setLevel(boost::shared_ptr<Fix> fix, int level) {
+    mdAssert(level >= 0 and level <= (int) loops.size(), "RESPA level %d of fix %s is out of range.  Levels go from 0 to %d", level, fix->handle.c_str(), (int) loops.size());
+    levelOfHandle[fix->handle] = level;
+}
+
+void IntegratorRESPA::assignLevels() {
+    int nLevels = loops.size() + 1;
+    fixesInLevel = std::vector<std::vector<Fix *> >(nLevels);
+    for (Fix *f : state->fixes) {
+        auto it = levelOfHandle.find(f->handle);
+        int level = it == levelOfHandle.end() ? nLevels-1 : it->second;
+        mdAssert(level < nLevels, "RESPA level %d of fix %s is out of range", level, f->handle.c_str());
+        f->respaLevel = level;
+        fixesInLevel[level].push_back(f);
+    }
+    dts = std::vector<double>(nLevels);
+    dts[nLevels-1] = state->dt;
+    for (int i=nLevels-2; i>=0; i--) {
+        dts[i] = dts[i+1] / loops[i];
+    }
+    int nAtoms = state->atoms.size();
+    levelForces = std::vector<GPUArrayGlobal<float4> >();
+    for (int i=0; i<nLevels; i++) {
+        levelForces.push_back(GPUArrayGlobal<float4>(nAtoms));
+    }
+}
+
+void IntegratorRESPA::run(int numTurns)
+{
+    mdAssert(state->nPerRingPoly == 1, "IntegratorRESPA does not support ring polymers");
+    //state->requiresPostNVE_V is only set in basicPrepare, so ask the fixes directly
+    for (Fix *f : state->fixes) {
+        mdAssert(not f->requiresPostNVE_V, "IntegratorRESPA does not support fixes which act between the velocity and position updates");
+        mdAssert(f->type != "Rigid" and dynamic_cast<FixConstraint *>(f) == nullptr, "IntegratorRESPA does not support constraint fixes");
+    }
+
+    basicPreRunChecks();
+    //levels are set on the fixes before preparing so pair calculations are only shared within a level
+    assignLevels();
+    std::vector<bool> prepared = basicPrepare(numTurns); //nlist built here
+    clearForces();
+    for (int i=0; i<(int) fixesInLevel.size(); i++) {
+        forceLevel(i, 1);
+    }
+    sumForces();
+
+    for (Fix *f : state->fixes) {
+        if (!(f->prepared) ) {
+            bool isPrepared = f->prepareForRun();
+            if (!isPrepared) {
+                mdError("A fix is unable to be instantiated correctly.");
+            }
+        }
+    }
+
+    // we should prepare for the datacomputers after the fixes
+    prepareDataComputers();
+
+    for (Fix *f : state->fixes) {
+        f->assignLocalTempComputer();
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    DataManager &dataManager = state->dataManager;
+    int top = fixesInLevel.size() - 1;
+    Autotuner tuner(state);
+    tuner.prepareForRun();
+    for (int i=0; i<numTurns; ++i) {
+
+        tuner.turnStart();
+        int virialMode = dataManager.getVirialModeForTurn(state->turn);
+
+        stepInit(virialMode==1 or virialMode==2);
+
+        // The first step of every level starts now, so the opening half
+        // kicks are all applied before the neighbor list check, which may
+        // reorder atoms and so invalidate the stored level forces
+        for (int level=top; level>=0; level--) {
+            kick(level, 0.5 * dts[level]);
+        }
+
+        //read each turn since the tuner may change it
+        int periodicInterval = state->periodicInterval;
+        if (state->turn % periodicInterval == 0 or state->turn == state->nextForceBuild) {
+            state->gridGPU.periodicBoundaryConditions();
+        }
+        handleBoundsChange();
+
+        //fs holds the total force of the last turn for data recording
+        clearForces();
+        advance(top, true, true, virialMode);
+        sumForces();
+
+        //quits if ctrl+c has been pressed
+        checkQuit();
+
+        stepFinal();
+
+        doDataComputation();
+        doDataAppending();
+        dataManager.clearVirialTurn(state->turn);
+        asyncOperations();
+
+        state->turn++;
+        if (state->verbose && (i+1 == numTurns || state->turn % state->shoutEvery == 0)) {
+            mdMessage("Turn %d %.2f percent done.\n", (int)state->turn, 100.0*(i+1)/numTurns);
+        }
+    }
+
+    if (state->backend != BACKEND::HOST) {
+        cudaDeviceSynchronize();
+        CUT_CHECK_ERROR("after run\n");
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = end - start;
+    mdMessage("runtime %f\n%e particle timesteps per second\n",
+              duration.count(), state->atoms.size()*numTurns / duration.count());
+
+    tuner.postRun();
+    basicFinish();
+}
+
+void IntegratorRESPA::advance(int level, bool first, bool last, int virialMode) {
+    if (not first) {
+        kick(level, 0.5 * dts[level]);
+    }
+    if (level == 0) {
+        drift();
+    } else {
+        for (int i=0; i<loops[level-1]; i++) {
+            advance(level-1, first and i==0, last and i==loops[level-1]-1, virialMode);
+        }
+    }
+    //only the last force evaluation of a level is at the end of the turn, where virials are recorded
+    forceLevel(level, last ? virialMode : 0);
+    kick(level, 0.5 * dts[level]);
+}
+
+void IntegratorRESPA::forceLevel(int level, int virialMode) {
+    int simTurn = state->turn;
+    for (Fix *f : fixesInLevel[level]) {
+        if (! (simTurn % f->applyEvery)) {
+            if (state->backend == BACKEND::HOST) {
+                f->computeHost(virialMode);
+            } else {
+                f->compute(virialMode);
+            }
+            f->setVirialTurn();
+        }
+    }
+    int nAtoms = state->atoms.size();
+    if (state->backend == BACKEND::HOST) {
+        respaTakeForces_host(nAtoms, state->gpd.fs.h_data.data(), levelForces[level].h_data.data());
+        return;
+    }
+    addFixedPointForces();
+    respaTakeForces_cu<<<NBLOCK(nAtoms), PERBLOCK>>>(
+            nAtoms,
+            state->gpd.fs.getDevData(),
+            levelForces[level].getDevData());
+}
+
+void IntegratorRESPA::kick(int level, double dt) {
+    int nAtoms = state->atoms.size();
+    float dtf = dt * state->units.ftm_to_v;
+    if (state->backend == BACKEND::HOST) {
+        respaKick_host(nAtoms, state->gpd.vs.h_data.data(), levelForces[level].h_data.data(), dtf);
+        return;
+    }
+    respaKick_cu<<<NBLOCK(nAtoms), PERBLOCK>>>(
+            nAtoms,
+            state->gpd.vs.getDevData(),
+            levelForces[level].getDevData(),
+            dtf);
+}
+
+void IntegratorRESPA::drift() {
+    int nAtoms = state->atoms.size();
+    if (state->backend == BACKEND::HOST) {
+        respaDrift_host(nAtoms, state->gpd.xs.h_data.data(), state->gpd.vs.h_data.data(), dts[0]);
+        return;
+    }
+    respaDrift_cu<<<NBLOCK(nAtoms), PERBLOCK>>>(
+            nAtoms,
+            state->gpd.xs.getDevData(),
+            state->gpd.vs.getDevData(),
+            dts[0]);
+}
+
+void IntegratorRESPA::clearForces() {
+    int nAtoms = state->atoms.size();
+    if (state->backend == BACKEND::HOST) {
+        respaZeroForces_host(nAtoms, state->gpd.fs.h_data.data());
+        return;
+    }
+    respaZeroForces_cu<<<NBLOCK(nAtoms), PERBLOCK>>>(nAtoms, state->gpd.fs.getDevData());
+}
+
+void IntegratorRESPA::sumForces() {
+    int nAtoms = state->atoms.size();
+    for (int i=0; i<(int) levelForces.size(); i++) {
+        if (state->backend == BACKEND::HOST) {
+            respaAddForces_host(nAtoms, state->gpd.fs.h_data.data(), levelForces[i].h_data.data());
+        } else {
+            respaAddForces_cu<<<NBLOCK(nAtoms), PERBLOCK>>>(
+                    nAtoms,
+                    state->gpd.fs.getDevData(),
+                    levelForces[i].getDevData());
+        }
+    }
+}
+
+void export_IntegratorRESPA()
+{
+    py::class_<IntegratorRESPA,
+               boost::shared_ptr<IntegratorRESPA>,
+               py::bases<Integrator>,
+               boost::noncopyable>
+    (
+        "IntegratorRESPA",
+        py::init<State *, py::list>(
+            py::args("state", "loops")
+        )
+    )
+    .def("setLevel", &IntegratorRESPA::setLevel, (py::arg("fix"), py::arg("level")))
+    .def("run", &IntegratorRESPA::run,(py::arg("numTurns")))
+    ;
+}
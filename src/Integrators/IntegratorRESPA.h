@@ -0,0 +1,86 @@
+#pragma once
+#ifndef INTEGRATORRESPA_H
+#define INTEGRATORRESPA_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "Integrator.h"
+#include "GPUArrayGlobal.h"
+#include "globalDefs.h"
+class Fix;
+
+//! Make the Integrator accessible to the Python interface
+void export_IntegratorRESPA();
+
+//! Multiple-timestep velocity-Verlet integrator (r-RESPA)
+/*!
+ * This class implements the reversible reference system propagator algorithm
+ * of Tuckerman et al. \cite TuckermanEtal:JCP1992 .  Each fix is assigned to a
+ * force level.  The outermost level is integrated with state->dt, and each
+ * inner level takes loops[i] steps per step of the level above it, so stiff,
+ * cheap forces (bonds, angles) can be integrated with a small timestep while
+ * expensive, slowly varying forces (long range electrostatics) are evaluated
+ * rarely.  Fixes without an assigned level are placed in the outermost level.
+ *
+ * The turn counter, data recording and applyEvery all count outer steps.
+ */
+class IntegratorRESPA : public Integrator
+{
+public:
+    //! Constructor
+    /*!
+     * \param statePtr Pointer to the simulation state
+     * \param loops Number of steps of each level per step of the level above
+     *              it, innermost first.  There are len(loops)+1 levels.
+     */
+    IntegratorRESPA(State *statePtr, boost::python::list loops);
+
+    //! Assign a fix to a force level, 0 being the innermost
+    void setLevel(boost::shared_ptr<Fix> fix, int level);
+
+    //! Run the Integrator
+    /*!
+     * \param numTurns Number of outer steps to run
+     */
+    virtual void run(int numTurns);
+
+private:
+    std::vector<int> loops; //!< Steps of level i per step of level i+1
+    std::map<std::string, int> levelOfHandle; //!< Level of each assigned fix, by fix handle
+    std::vector<std::vector<Fix *> > fixesInLevel; //!< Fixes of each level, set at the start of a run
+    std::vector<double> dts; //!< Timestep of each level
+    std::vector<GPUArrayGlobal<float4> > levelForces; //!< Last force computed for each level
+
+    //! Sort the active fixes into levels
+    void assignLevels();
+
+    //! Advance level by one of its steps
+    /*!
+     * \param level Level to advance
+     * \param first If true, the opening half-kick was already applied at the start of the turn
+     * \param last If true, this step ends at the end of the turn, so virials are computed
+     * \param virialMode Virial mode of the turn
+     */
+    void advance(int level, bool first, bool last, int virialMode);
+
+    //! Compute the forces of one level and store them in levelForces
+    void forceLevel(int level, int virialMode);
+
+    //! Update velocities with the stored forces of one level
+    void kick(int level, double dt);
+
+    //! Update positions by a timestep of the innermost level
+    void drift();
+
+    //! Zero gpd.fs, keeping the w component
+    void clearForces();
+
+    //! Add the forces of all levels to gpd.fs
+    void sumForces();
+};
+
+#endif
@@ -23,10 +23,15 @@ void IntegratorUtil::force(int virialMode) {
            //     Mod::FDotR(state);
            //     computedFDotR = true;
            // }
-            f->compute(virialMode);
+            if (state->backend == BACKEND::HOST) {
+                f->computeHost(virialMode);
+            } else {
+                f->compute(virialMode);
+            }
             f->setVirialTurn();
         }
     }
+    addFixedPointForces();
 };
 
 void IntegratorUtil::postNVE_V() {
@@ -63,10 +68,15 @@ void IntegratorUtil::singlePointEng() {
 void IntegratorUtil::forceSingle(int virialMode) {
     for (Fix *f : state->fixes) {
         if (f->forceSingle and f->willFire(state->turn)) {
-            f->compute(virialMode);
+            if (state->backend == BACKEND::HOST) {
+                f->computeHost(virialMode);
+            } else {
+                f->compute(virialMode);
+            }
             f->setVirialTurn();
         }
     }
+    addFixedPointForces();
 }
 
 
@@ -89,7 +99,7 @@ void IntegratorUtil::doDataComputation() {
             computedAny = true;
         }
     }
-    if (computedAny) {
+    if (computedAny and state->backend != BACKEND::HOST) {
         cudaDeviceSynchronize();
     }
 }
@@ -38,6 +38,8 @@ public:
      *
      */
     void forceSingle(int virialMode);
+    //! Add the fixed point force sums to fs and zero them, if State::fixedPointForces is set
+    void addFixedPointForces();
     void handleBoundsChange();
 
     void checkQuit();
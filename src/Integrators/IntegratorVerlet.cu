@@ -7,6 +7,7 @@
 #include <boost/python.hpp>
 #include <boost/shared_ptr.hpp>
 #include "Logging.h"
+#include "Autotuner.h"
 #include "State.h"
 #include "Fix.h"
 #include "cutils_func.h"
@@ -539,6 +540,73 @@ __global__ void postForce_cu(int nAtoms, float4 *vs, float4 *fs, float dtf)
     }
 }
 
+/* host backend versions of the kernels above */
+
+void nve_v_host(int nAtoms, float4 *vs, float4 *fs, float dtf) {
+#pragma omp parallel for schedule(static)
+    for (int idx=0; idx<nAtoms; idx++) {
+        float4 vel = vs[idx];
+        float invmass = vel.w;
+        float4 force = fs[idx];
+        if (invmass > INVMASSBOOL) {
+            fs[idx] = make_float4(0.0f, 0.0f, 0.0f, force.w);
+            vs[idx] = make_float4(0.0f, 0.0f, 0.0f, invmass);
+            continue;
+        }
+        float3 dv = dtf * invmass * make_float3(force);
+        vel += dv;
+        vs[idx] = vel;
+        fs[idx] = make_float4(0.0f, 0.0f, 0.0f, force.w);
+    }
+}
+
+void nve_x_host(int nAtoms, float4 *xs, float4 *vs, float dt) {
+#pragma omp parallel for schedule(static)
+    for (int idx=0; idx<nAtoms; idx++) {
+        float4 pos = xs[idx];
+        float3 dx = dt*make_float3(vs[idx]);
+        pos += dx;
+        xs[idx] = pos;
+    }
+}
+
+void preForce_host(int nAtoms, float4 *xs, float4 *vs, float4 *fs, float dt, float dtf) {
+#pragma omp parallel for schedule(static)
+    for (int idx=0; idx<nAtoms; idx++) {
+        float4 vel = vs[idx];
+        float invmass = vel.w;
+        float4 force = fs[idx];
+        float3 dv = dtf * invmass * make_float3(force);
+        if (invmass > INVMASSBOOL) {
+            dv = make_float3(0.0, 0.0, 0.0);
+        }
+        vel += dv;
+        vs[idx] = vel;
+
+        float4 pos = xs[idx];
+        float3 dx = dt*make_float3(vel);
+        pos += dx;
+        xs[idx] = pos;
+
+        fs[idx] = make_float4(0.0f, 0.0f, 0.0f, force.w);
+    }
+}
+
+void postForce_host(int nAtoms, float4 *vs, float4 *fs, float dtf) {
+#pragma omp parallel for schedule(static)
+    for (int idx=0; idx<nAtoms; idx++) {
+        float4 vel = vs[idx];
+        float invmass = vel.w;
+        if (invmass > INVMASSBOOL) {
+            vs[idx] = make_float4(0.0f, 0.0f, 0.0f, invmass);
+            continue;
+        }
+        float3 dv = dtf * invmass * make_float3(fs[idx]);
+        vel += dv;
+        vs[idx] = vel;
+    }
+}
+
 IntegratorVerlet::IntegratorVerlet(State *state_)
     : Integrator(state_)
 {
@@ -580,8 +648,6 @@ void IntegratorVerlet::run(int numTurns)
         setInterpolator();
     }
     
-    int periodicInterval = state->periodicInterval;
-
     // we should prepare for the datacomputers after the fixes
     prepareDataComputers();
 
@@ -593,8 +659,13 @@ void IntegratorVerlet::run(int numTurns)
     auto start = std::chrono::high_resolution_clock::now();
     DataManager &dataManager = state->dataManager;
     dtf = 0.5f * state->dt * state->units.ftm_to_v;
+    Autotuner tuner(state);
+    tuner.prepareForRun();
     for (int i=0; i<numTurns; ++i) {
 
+        tuner.turnStart();
+        //read each turn since the tuner may change it
+        int periodicInterval = state->periodicInterval;
         if (state->turn % periodicInterval == 0 or state->turn == state->nextForceBuild) {
             state->gridGPU.periodicBoundaryConditions();
         }
@@ -640,17 +711,24 @@ void IntegratorVerlet::run(int numTurns)
     }
 
     //! \todo These parts could be moved to basicFinish()
-    cudaDeviceSynchronize();
-    CUT_CHECK_ERROR("after run\n");
+    if (state->backend != BACKEND::HOST) {
+        cudaDeviceSynchronize();
+        CUT_CHECK_ERROR("after run\n");
+    }
     auto end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> duration = end - start;
     mdMessage("runtime %f\n%e particle timesteps per second\n",
               duration.count(), state->atoms.size()*numTurns / duration.count());
 
+    tuner.postRun();
     basicFinish();
 }
 
 void IntegratorVerlet::nve_v() {
+    if (state->backend == BACKEND::HOST) {
+        nve_v_host(state->atoms.size(), state->gpd.vs.h_data.data(), state->gpd.fs.h_data.data(), dtf);
+        return;
+    }
     uint activeIdx = state->gpd.activeIdx();
     nve_v_cu<<<NBLOCK(state->atoms.size()), PERBLOCK>>>(
             state->atoms.size(),
@@ -660,6 +738,10 @@ void IntegratorVerlet::nve_v() {
 }
 
 void IntegratorVerlet::nve_x() {
+    if (state->backend == BACKEND::HOST) {
+        nve_x_host(state->atoms.size(), state->gpd.xs.h_data.data(), state->gpd.vs.h_data.data(), state->dt);
+        return;
+    }
     uint activeIdx = state->gpd.activeIdx();
     if (state->nPerRingPoly == 1) {
     	nve_x_cu<<<NBLOCK(state->atoms.size()), PERBLOCK>>>(
@@ -685,6 +767,10 @@ void IntegratorVerlet::nve_x() {
 }
 void IntegratorVerlet::preForce()
 {
+    if (state->backend == BACKEND::HOST) {
+        preForce_host(state->atoms.size(), state->gpd.xs.h_data.data(), state->gpd.vs.h_data.data(), state->gpd.fs.h_data.data(), state->dt, dtf);
+        return;
+    }
     uint activeIdx = state->gpd.activeIdx();
     if (state->nPerRingPoly == 1) {
     	preForce_cu<<<NBLOCK(state->atoms.size()), PERBLOCK>>>(
@@ -720,6 +806,10 @@ void IntegratorVerlet::preForce()
 
 void IntegratorVerlet::postForce()
 {
+    if (state->backend == BACKEND::HOST) {
+        postForce_host(state->atoms.size(), state->gpd.vs.h_data.data(), state->gpd.fs.h_data.data(), dtf);
+        return;
+    }
     uint activeIdx = state->gpd.activeIdx();
     postForce_cu<<<NBLOCK(state->atoms.size()), PERBLOCK>>>(
             state->atoms.size(),
@@ -0,0 +1,92 @@
+#pragma once
+#ifndef NEIGHBORLIST_COMPRESSED_H
+#define NEIGHBORLIST_COMPRESSED_H
+
+#include "globalDefs.h"
+
+#define NLIST_DELTA_MAX 0x1fff    //!< Largest index difference held in a single word
+#define NLIST_LONG_FLAG 0x2000    //!< Set in a word followed by a second word, holding the full index between them
+#define NLIST_INDEX_MAX 0x1fffffff //!< Largest index a compressed list can hold
+
+//! Neighborlist stored as 16 bit index differences, see GridGPU::compressNeighborlist
+/*!
+ * Each thread reading the list (one per atom, or nThreadPerAtom per atom)
+ * has its own stream of words, laid out like the uncompressed list: the
+ * k-th word of a stream is warpSize words after the (k-1)-th, and each warp
+ * starts where cumulSumMaxPerBlock puts it.  A word holds the exclusion bits
+ * in its top two bits and the difference from the previous index of the
+ * stream in its low 13.  Differences that are negative or larger than
+ * NLIST_DELTA_MAX, and the first entry if it is too large, set
+ * NLIST_LONG_FLAG and hold the high bits of the index, with the low 16 in
+ * the next word.  No entry takes more than two words, so dropping entries
+ * from a stream never makes it longer.
+ */
+struct NeighborlistCompressed {
+    const uint16_t *words;                //!< Null if the list is not compressed
+    const uint32_t *cumulSumMaxPerBlock;  //!< Cumulative words per warp of each block, as GridGPU::perBlockArray
+    NeighborlistCompressed() : words(nullptr), cumulSumMaxPerBlock(nullptr) {}
+    NeighborlistCompressed(const uint16_t *words_, const uint32_t *cumulSumMaxPerBlock_)
+        : words(words_), cumulSumMaxPerBlock(cumulSumMaxPerBlock_) {}
+};
+
+//! Number of words entry raw takes after an entry with index prev
+inline __host__ __device__ int compressedNeighborSize(uint raw, uint prev) {
+    uint otherIdx = raw & EXCL_MASK;
+    return (otherIdx < prev or otherIdx - prev > NLIST_DELTA_MAX) ? 2 : 1;
+}
+
+//! Writes entry raw after an entry with index prev at words[idx], with stride words between words.  Returns the next idx
+inline __host__ __device__ int writeCompressedNeighbor(uint16_t *words, int idx, int stride, uint raw, uint prev) {
+    uint otherIdx = raw & EXCL_MASK;
+    uint exclBits = (raw >> 30) << 14;
+    if (otherIdx < prev or otherIdx - prev > NLIST_DELTA_MAX) {
+        words[idx] = exclBits | NLIST_LONG_FLAG | (otherIdx >> 16);
+        words[idx + stride] = otherIdx & 0xffff;
+        return idx + 2*stride;
+    }
+    words[idx] = exclBits | (otherIdx - prev);
+    return idx + stride;
+}
+
+//! Reads one thread's neighbors in order from either the compressed or the uncompressed list
+class NeighborReader {
+    const uint *neighborlist;
+    const uint16_t *words;
+    int idx;
+    int warpSize;
+    uint prev;
+public:
+    /*!
+     * \param baseIdx Index of the thread's first entry in neighborlist
+     * \param baseIdxCompressed Index of the thread's first word, if compressed.words is set
+     *
+     * A copy of a reader goes on from where the reader is.
+     */
+    __host__ __device__ NeighborReader(const uint *neighborlist_, NeighborlistCompressed compressed,
+                                       int baseIdx, int baseIdxCompressed, int warpSize_)
+        : neighborlist(neighborlist_), words(compressed.words), warpSize(warpSize_), prev(0) {
+        idx = words ? baseIdxCompressed : baseIdx;
+    }
+
+    //! Next entry, with the exclusion bits, as it is stored in the uncompressed list
+    __host__ __device__ uint next() {
+        if (!words) {
+            uint raw = neighborlist[idx];
+            idx += warpSize;
+            return raw;
+        }
+        uint word = words[idx];
+        idx += warpSize;
+        uint otherIdx;
+        if (word & NLIST_LONG_FLAG) {
+            otherIdx = ((word & NLIST_DELTA_MAX) << 16) | words[idx];
+            idx += warpSize;
+        } else {
+            otherIdx = prev + (word & NLIST_DELTA_MAX);
+        }
+        prev = otherIdx;
+        return otherIdx | ((word >> 14) << 30);
+    }
+};
+
+#endif
@@ -12,6 +12,7 @@
 #ifndef _SHAREDMEM_H_
 #define _SHAREDMEM_H_
 #include "Virial.h"
+#include "Accumulator.h"
 
 //****************************************************************************
 // Because dynamically sized shared memory arrays are declared "extern",
@@ -187,6 +188,16 @@ struct SharedMemory <Virial>
     }
 };
 
+template <>
+struct SharedMemory <VirialAccum>
+{
+    __device__ VirialAccum *getPointer()
+    {
+        extern __shared__ VirialAccum s_VirialAccum[];
+        return s_VirialAccum;
+    }
+};
+
 template <>
 struct SharedMemory <float4>
 {
@@ -15,7 +15,7 @@ template <class T>
 __host__ __device__ T squareVectorItem(T *vals, int nCol, int i, int j) {
     return vals[i*nCol + j];
 }
-inline __device__ int squareVectorIndex(int nCol, int i, int j) {
+inline __host__ __device__ int squareVectorIndex(int nCol, int i, int j) {
     return i*nCol + j;
 }
 
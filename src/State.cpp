@@ -33,6 +33,9 @@ State::State() : units(&dt) {
     is2d = false;
     rCut = RCUT_INIT;
     padding = PADDING_INIT;
+    innerPadding = 0;
+    nlistBuildCount = 0;
+    nlistPruneCount = 0;
     turn = 0;
     maxIdExisting = -1;
     maxExclusions = 0;
@@ -49,6 +52,7 @@ State::State() : units(&dt) {
     verbose = true;
     readConfig = SHARED(ReadConfig) (new ReadConfig(this));
     atomParams = AtomParams(this);
+    requiresPostNVE_V = false;
     requiresCharges = false; //will be set to true if a fix needs it (like ewald sum).  Is max of fixes requiresCharges bool
     dataManager = DataManager(this);
     integUtil = IntegratorUtil(this);
@@ -58,11 +62,33 @@ State::State() : units(&dt) {
     rng_is_seeded = false;
     nPerRingPoly  = 1;
     exclusionMode = EXCLUSIONMODE::DISTANCE;
+    backend = BACKEND::GPU;
+    GPUArrayDevice::hostOnly = false;
+    nHostThreads = 0;
+    hostClusterPairs = false;
+    hostHalfList = false;
+    gridOrder = GRIDORDER::ROWMAJOR;
+    reorderForcersEvery = 0;
+    deterministic = false;
+#ifdef MIXED_PRECISION
+    fixedPointForces = true;
+#else
+    fixedPointForces = false;
+#endif
+    fusePairFixes = false;
+    multiCutoffNeighbors = false;
+    compressNeighborlist = false;
+    hydrogenMassFactor = 1;
+    hydrogenMassCutoff = 1.5;
+    hydrogenMassFactorApplied = 1;
 
     nThreadPerAtom = 1;
     nThreadPerBlock = 256;
 
     tuneEvery = 1000000;
+    autoTune = false;
+    tuneTurns = 100;
+    tuneCacheFile = "";
     nextForceBuild = 0;
 
 }
@@ -386,6 +412,43 @@ void State::setExclusionMode(std::string mode) {
     }
 }
 
+void State::setBackend(std::string mode) {
+    //device arrays are allocated or skipped for the backend in effect when they are created, so it can't change under them
+    mdAssert(atoms.size() == 0 and fixes.size() == 0, "setBackend must be called before any atoms or fixes are added");
+    if (mode == "gpu") {
+        backend = BACKEND::GPU;
+    } else if (mode == "host") {
+        backend = BACKEND::HOST;
+    } else {
+        mdAssert(false, "Backend must be 'gpu' or 'host'");
+    }
+    GPUArrayDevice::hostOnly = backend == BACKEND::HOST;
+}
+
+void State::setGridOrder(std::string order) {
+    if (order == "rowmajor") {
+        gridOrder = GRIDORDER::ROWMAJOR;
+    } else if (order == "morton") {
+        gridOrder = GRIDORDER::MORTON;
+    } else if (order == "hilbert") {
+        gridOrder = GRIDORDER::HILBERT;
+    } else {
+        mdAssert(false, "Grid order must be 'rowmajor', 'morton', or 'hilbert'");
+    }
+}
+
+void State::reorderForcers() {
+    if (backend != BACKEND::HOST) {
+        gpd.idToIdxs.dataToHost();
+        cudaDeviceSynchronize();
+    }
+    for (Fix *f : fixes) {
+        if (f->prepared) {
+            f->reorderForcers(gpd.idToIdxs.h_data);
+        }
+    }
+}
+
 template <typename T>
 int getSharedIdx(std::vector<SHARED(T)> &list, SHARED(T) other) {
     for (unsigned int i=0; i<list.size(); i++) {
@@ -485,6 +548,8 @@ void State::initializeGrid() {
 
     // copy value of nPerRingPoly to make it local to gpd instance
     gridGPU = GridGPU(this, gridDim, gridDim, gridDim, gridDim, exclusionMode, this->padding, &gpd,nPerRingPoly);
+    mdAssert(innerPadding == 0 or innerPadding < padding, "innerPadding must be smaller than padding");
+    gridGPU.innerPadding = innerPadding;
     //testing
     //nThreadPerBlock = 64;
     //nThreadPerAtom = 4;
@@ -523,10 +588,12 @@ void State::copyAtomDataToGPU(std::vector<int> &idToIdx) {
     gpd.fs.set(fs_vec);
     gpd.qs.set(qs_vec);
 
-    gpd.xs.dataToDevice();
-    gpd.vs.dataToDevice();
-    gpd.fs.dataToDevice();
-    gpd.qs.dataToDevice();
+    if (backend == BACKEND::GPU) {
+        gpd.xs.dataToDevice();
+        gpd.vs.dataToDevice();
+        gpd.fs.dataToDevice();
+        gpd.qs.dataToDevice();
+    }
 }
 
 bool State::prepareForRun() {
@@ -543,6 +610,11 @@ bool State::prepareForRun() {
     if (!requirePostNVE_V.empty()) {
         requiresPostNVE_V = *std::max_element(requirePostNVE_V.begin(), requirePostNVE_V.end());
     }
+    //before masses are copied into vs.w, and before fixes which read masses prepare.  Integrator::basicFinish
+    //puts the original masses back after the run
+    if (hydrogenMassFactor != hydrogenMassFactorApplied) {
+        repartitionHydrogenMass();
+    }
 
     std::vector<float4> xs_vec, vs_vec, fs_vec;
     std::vector<uint> ids;
@@ -629,7 +701,7 @@ void State::handleChargeOffloading() {
     for (Fix *f : fixes) {
         if (f->canOffloadChargePairCalc) {
             for (Fix *g : fixes) {
-                if (g->canAcceptChargePairCalc and not g->hasAcceptedChargePairCalc) {
+                if (g->canAcceptChargePairCalc and not g->hasAcceptedChargePairCalc and not g->hasOffloadedPairCalc) {
                     g->acceptChargePairCalc(f); 
                     f->hasOffloadedChargePairCalc = true;
                     g->hasAcceptedChargePairCalc = true;
@@ -638,6 +710,56 @@ void State::handleChargeOffloading() {
         }
     }
 }
+void State::updateNeighborSubLists() {
+    std::vector<float> rCuts;
+    for (Fix *f : fixes) {
+        float rCut = f->getNeighborRCut();
+        if (rCut > 0) {
+            rCuts.push_back(rCut);
+        }
+    }
+    gridGPU.setSubListRCuts(rCuts);
+}
+void State::updateNeighborTypeRCuts() {
+    int numTypes = atomParams.numTypes;
+    std::vector<float> rCutSqrs;
+    if (multiCutoffNeighbors) {
+        //no pair is listed to less than state.rCut, as when all pairs share one cutoff
+        rCutSqrs = std::vector<float>(numTypes*numTypes, rCut*rCut);
+        for (Fix *f : fixes) {
+            //fixes without cutoffs don't use the neighbor list
+            if (f->getNeighborRCut() > 0) {
+                std::vector<float> fixRCutSqrs = f->getNeighborRCutSqrs();
+                for (int i=0; i<rCutSqrs.size(); i++) {
+                    rCutSqrs[i] = fmax(rCutSqrs[i], fixRCutSqrs[i]);
+                }
+            }
+        }
+    }
+    gridGPU.setTypeRCuts(rCutSqrs, numTypes);
+}
+void State::handlePairFusion() {
+    for (Fix *f : fixes) {
+        f->resetPairFusion();
+        f->hasOffloadedPairCalc = false;
+    }
+    if (not fusePairFixes) {
+        return;
+    }
+    //fixes are only fused with fixes integrated at the same RESPA level
+    std::map<int, Fix *> hosts;
+    for (Fix *f : fixes) {
+        if (not f->canFusePairCalc) {
+            continue;
+        }
+        auto it = hosts.find(f->respaLevel);
+        if (it == hosts.end()) {
+            hosts[f->respaLevel] = f;
+        } else if (f->applyEvery == it->second->applyEvery and it->second->acceptPairCalc(f)) {
+            f->hasOffloadedPairCalc = true;
+        }
+    }
+}
 void copyAsyncWithInstruc(State *state, std::function<void (int64_t )> cb, int64_t turn) {
     cudaStream_t stream;
     CUCHECK(cudaStreamCreate(&stream));
@@ -690,7 +812,31 @@ void copySyncWithInstruc(State *state, std::function<void (int64_t )> cb, int64_
     state->copyAtomDataToGPU(state->gpd.idToIdxs.h_data);
 }
 
+//host backend: the host copies are already current, so no transfers or syncing are needed
+void copyHostWithInstruc(State *state, std::function<void (int64_t )> cb, int64_t turn) {
+    std::vector<int> idToIdxsOnCopy = state->gpd.idToIdxsOnCopy;
+    std::vector<float4> &xs = state->gpd.xs.h_data;
+    std::vector<float4> &vs = state->gpd.vs.h_data;
+    std::vector<float4> &fs = state->gpd.fs.h_data;
+    std::vector<uint> &ids = state->gpd.ids.h_data;
+    std::vector<Atom> &atoms = state->atoms;
+    for (int i=0, ii=state->atoms.size(); i<ii; i++) {
+        int id = ids[i];
+        int idxWriteTo = idToIdxsOnCopy[id];
+        atoms[idxWriteTo].pos = xs[i];
+        atoms[idxWriteTo].vel = vs[i];
+        atoms[idxWriteTo].force = fs[i];
+    }
+    cb(turn);
+    state->copyAtomDataToGPU(state->gpd.idToIdxs.h_data);
+}
+
 bool State::runtimeHostOperation(std::function<void (int64_t )> cb, bool async) {
+    if (backend == BACKEND::HOST) {
+        bounds.set(boundsGPU);
+        copyHostWithInstruc(this, cb, turn);
+        return true;
+    }
     // buffers should already be allocated in prepareForRun, and num atoms
     // shouldn't have changed.
     if (async) {
@@ -744,6 +890,72 @@ void State::finish() {
     }
 }
 
+void State::repartitionHydrogenMass() {
+    restoreRepartitionedMass();
+    if (hydrogenMassFactor == 1) {
+        return;
+    }
+    mdAssert(hydrogenMassFactor > 0, "hydrogenMassFactor must be positive");
+    mdAssert(units.unitType == UNITS::REAL, "hydrogenMassFactor requires real units, since hydrogens are found by their mass in amu (hydrogenMassCutoff)");
+    std::unordered_map<int, double> masses;
+    std::vector<int> order; //ids in the order they are first changed, so masses are restored deterministically
+    auto isHydrogen = [&] (Atom &a) {
+        return a.mass > 0 and a.mass < hydrogenMassCutoff;
+    };
+    for (Fix *f : fixes) {
+        std::vector<BondVariant> *fixBonds = f->getBonds();
+        if (fixBonds == nullptr) {
+            continue;
+        }
+        for (BondVariant &bv : *fixBonds) {
+            const Bond &b = boost::apply_visitor(bondDowncast(bv), bv);
+            Atom &a = idToAtom(b.ids[0]);
+            Atom &c = idToAtom(b.ids[1]);
+            bool hydrogenA = isHydrogen(a);
+            bool hydrogenC = isHydrogen(c);
+            if (hydrogenA == hydrogenC) {
+                continue;
+            }
+            Atom &hydrogen = hydrogenA ? a : c;
+            Atom &heavy = hydrogenA ? c : a;
+            //a hydrogen bonded to more than one heavy atom (or listed by more than one fix) takes mass only once
+            if (masses.find(hydrogen.id) != masses.end()) {
+                continue;
+            }
+            for (Atom *changed : {&hydrogen, &heavy}) {
+                if (masses.find(changed->id) == masses.end()) {
+                    masses[changed->id] = changed->mass;
+                    order.push_back(changed->id);
+                }
+            }
+            double dm = (hydrogenMassFactor - 1) * hydrogen.mass;
+            mdAssert(heavy.mass - dm > 0, "Repartitioning hydrogen mass leaves atom %d with no mass", heavy.id);
+            hydrogen.mass += dm;
+            heavy.mass -= dm;
+        }
+    }
+    for (int id : order) {
+        massesBeforeRepartition.push_back(std::make_pair(id, masses[id]));
+    }
+    hydrogenMassFactorApplied = hydrogenMassFactor;
+    mdMessage("Repartitioned hydrogen mass by a factor of %f, changing the mass of %d atoms\n", hydrogenMassFactor, (int) order.size());
+}
+
+void State::restoreRepartitionedMass() {
+    for (auto &it : massesBeforeRepartition) {
+        if (it.first < (int) idToIdx.size() and idToIdx[it.first] != -1) {
+            idToAtom(it.first).mass = it.second;
+        }
+    }
+    massesBeforeRepartition.clear();
+    hydrogenMassFactorApplied = 1;
+}
+
+void State::restoreHydrogenMass() {
+    restoreRepartitionedMass();
+    hydrogenMassFactor = 1;
+}
+
 bool State::addToGroupPy(std::string handle, py::list toAdd) {//list of atom ids
     uint32_t tagBit = groupTagFromHandle(handle);  //if I remove asserts from this, could return things other than true, like if handle already exists
     int len = py::len(toAdd);
@@ -1072,16 +1284,34 @@ BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(State_seedRNG_overloads,State::seedRNG,0,
                 .def("destroy", &State::destroy)
                 .def("seedRNG", &State::seedRNG, State_seedRNG_overloads())
                 .def("preparePIMD", &State::preparePIMD)
+                .def("setBackend", &State::setBackend)
+                .def("setGridOrder", &State::setGridOrder)
+                .def_readwrite("reorderForcersEvery", &State::reorderForcersEvery)
+                .def_readwrite("deterministic", &State::deterministic)
+                .def_readwrite("fixedPointForces", &State::fixedPointForces)
+                .def_readwrite("fusePairFixes", &State::fusePairFixes)
+                .def_readwrite("multiCutoffNeighbors", &State::multiCutoffNeighbors)
+                .def_readwrite("compressNeighborlist", &State::compressNeighborlist)
+                .def_readwrite("hydrogenMassFactor", &State::hydrogenMassFactor)
+                .def_readwrite("hydrogenMassCutoff", &State::hydrogenMassCutoff)
+                .def("restoreHydrogenMass", &State::restoreHydrogenMass)
                 .def_readwrite("is2d", &State::is2d)
                 .def_readwrite("turn", &State::turn)
                 .def_readwrite("nThreadPerAtom", &State::nThreadPerAtom)
                 .def_readwrite("nThreadPerBlock", &State::nThreadPerBlock)
                 .def_readwrite("tuneEvery", &State::tuneEvery)
+                .def_readwrite("autoTune", &State::autoTune)
+                .def_readwrite("tuneTurns", &State::tuneTurns)
+                .def_readwrite("tuneCacheFile", &State::tuneCacheFile)
+                .def_readwrite("nHostThreads", &State::nHostThreads)
+                .def_readwrite("hostClusterPairs", &State::hostClusterPairs)
+                .def_readwrite("hostHalfList", &State::hostHalfList)
                 .def_readwrite("periodicInterval", &State::periodicInterval)
                 .def_readwrite("rCut", &State::rCut)
                 .def_readwrite("nPerRingPoly", &State::nPerRingPoly)
                 .def_readwrite("dt", &State::dt)
                 .def_readwrite("padding", &State::padding)
+                .def_readwrite("innerPadding", &State::innerPadding)
                 .def_readonly("groupTags", &State::groupTags)
                 .def_readonly("dataManager", &State::dataManager)
                 //shared ptrs
@@ -53,6 +53,8 @@ class Fix;
 class WriteConfig;
 
 enum EXCLUSIONMODE {FORCER, DISTANCE};
+enum BACKEND {GPU, HOST};
+enum GRIDORDER {ROWMAJOR, MORTON, HILBERT};
 //! Simulation state
 /*!
  * This class reflects the current state of the simulation. It contains and
@@ -116,6 +118,7 @@ public:
     int64_t turn; //!< Step of the simulation
     int runningFor; //!< How long the simulation is currently running
     int nlistBuildCount; //!< number of times we have build nlists
+    int nlistPruneCount; //!< number of times the inner nlist has been pruned
     int64_t runInit; //!< Timestep at which the current run started
     int64_t nextForceBuild; //!< Timestep neighborlists will definitely be build.  Fixes might need to request this
     int dangerousRebuilds; //!< Unused
@@ -133,8 +136,35 @@ public:
      */
     double rCut;
     double padding; //!< Added to rCut for cutoff distance of neighbor building
+    double innerPadding; //!< Added to rCut for the pruned inner neighbor list, 0 to disable pruning
     int exclusionMode; //!< Mode for handling bond list exclusions.  See comments for exclusions in GridGPU
     void setExclusionMode(std::string);
+    int backend; //!< Where the timestep runs: BACKEND::GPU (default) or BACKEND::HOST, which uses OpenMP threads on the host copies of the data
+    void setBackend(std::string);
+    int nHostThreads; //!< number of OpenMP threads for the host backend.  0 uses the OpenMP default
+    bool hostClusterPairs; //!< host backend evaluates pair forces and virials cluster-vs-cluster, each cluster pair stored once (see GridGPU::buildClusterPairsHost)
+    bool hostHalfList; //!< host backend stores each pair once and applies Newton's third law.  Ignored if hostClusterPairs is set
+    int gridOrder; //!< Order in which grid cells (and so atoms) are laid out in memory, one of GRIDORDER
+    void setGridOrder(std::string order); //!< 'rowmajor', 'morton', or 'hilbert'
+    int reorderForcersEvery; //!< Regroup bonded forcers by current atom index every this many neighbor list builds.  0 for never
+    //! Rebuild the fixes' bonded forcer lists with the current atom ordering
+    void reorderForcers();
+    bool deterministic; //!< Make runs bitwise reproducible: sums done with atomics use fixed point, atoms are ordered by id within grid cells, and autoTune only uses cached values
+    bool fixedPointForces; //!< Sum each atom's force over all pair, bond, angle, dihedral and improper fixes in 64 bit fixed point, rounding to float once per evaluation.  Defaults to true in MIXED_PRECISION builds
+    bool fusePairFixes; //!< Evaluate compatible pair fixes in a single pass over the neighbor list (see FixPair::acceptPairCalc)
+    bool multiCutoffNeighbors; //!< Bin atoms and list pairs by per type pair cutoffs (see GridGPU::setTypeRCuts)
+    bool compressNeighborlist; //!< Store the neighbor list delta-encoded (see GridGPU::compressNeighborlist)
+    double hydrogenMassFactor; //!< Bonded hydrogens are run with this multiple of their mass, taken from their heavy atom.  1 for off
+    double hydrogenMassCutoff; //!< Atoms lighter than this are treated as hydrogens when repartitioning mass
+    double hydrogenMassFactorApplied; //!< Factor the atoms' masses are currently repartitioned by, 1 if they are not
+    std::vector<std::pair<int, double> > massesBeforeRepartition; //!< Atom ids and masses changed by repartitionHydrogenMass
+    //! Move mass from heavy atoms onto the hydrogens bonded to them, by the fixes' bonds, keeping the mass of each molecule.
+    //! Starts from the original masses if they were already repartitioned
+    void repartitionHydrogenMass();
+    //! Put back the masses changed by repartitionHydrogenMass
+    void restoreRepartitionedMass();
+    //! Put back the original masses and turn repartitioning off
+    void restoreHydrogenMass();
 
     // Variables that enable extension to PIMD
     int nPerRingPoly;			// RP discretization/number of time slices
@@ -330,7 +360,10 @@ public:
     
     int nThreadPerAtom; //!< number of threads per atom for pair computations and nlist building
     int nThreadPerBlock; //!< number of threads per block for pair computations and nlist building
-    int tuneEvery;
+    int tuneEvery; //!< With autoTune, re-tune every this many turns
+    bool autoTune; //!< Time candidate runtime parameters at the start of each run (see Autotuner)
+    int tuneTurns; //!< Number of turns each candidate is timed for
+    std::string tuneCacheFile; //!< File storing tuned parameters between runs.  Empty for none
     
     bool verbose; //!< Verbose output
     int shoutEvery; //!< Report state of simulation every this many timesteps
@@ -522,6 +555,12 @@ public:
      */
     void seedRNG(unsigned int seed = 0);
     void handleChargeOffloading();
+    //! Hand the pair calculations of compatible pair fixes to the first pair fix, so they share one neighbor list pass
+    void handlePairFusion();
+    //! Give gridGPU a neighbor sub-list for each fix cutoff shorter than the largest.  Call after charge offloading and pair fusion
+    void updateNeighborSubLists();
+    //! Give gridGPU the per type pair cutoffs of the fixes if multiCutoffNeighbors is set
+    void updateNeighborTypeRCuts();
 
     Units units;
 
@@ -0,0 +1,31 @@
+#include "cutils_func.h"
+
+__global__ void addFixedPointForces(int nAtoms, float4 *fs, Virial *virials, unsigned long long *fsFixed, unsigned long long *virialsFixed) {
+    int idx = GETIDX();
+    if (idx < nAtoms) {
+        float4 forceCur = fs[idx];
+        forceCur.x += fromFixedPoint(fsFixed[3*idx]);
+        forceCur.y += fromFixedPoint(fsFixed[3*idx+1]);
+        forceCur.z += fromFixedPoint(fsFixed[3*idx+2]);
+        fs[idx] = forceCur;
+        for (int i=0; i<3; i++) {
+            fsFixed[3*idx+i] = 0;
+        }
+        if (virials) {
+            Virial virialCur = virials[idx];
+            for (int i=0; i<6; i++) {
+                virialCur[i] += fromFixedPoint(virialsFixed[6*idx+i]);
+                virialsFixed[6*idx+i] = 0;
+            }
+            virials[idx] = virialCur;
+        }
+    }
+}
+
+__global__ void addFixedPointEngs(int nAtoms, float *perParticleEng, unsigned long long *engsFixed) {
+    int idx = GETIDX();
+    if (idx < nAtoms) {
+        perParticleEng[idx] += fromFixedPoint(engsFixed[idx]);
+        engsFixed[idx] = 0;
+    }
+}
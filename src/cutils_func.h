@@ -5,6 +5,7 @@
 #include "globalDefs.h"
 #include "cutils_math.h"
 #include "Virial.h"
+#include "Accumulator.h"
 #include "SharedMem.h"
 #define N_DATA_PER_THREAD 4 //must be power of 2, 4 found to be fastest for a floats and float4s
 //tests show that N_DATA_PER_THREAD = 4 is fastest
@@ -18,8 +19,10 @@ inline __device__ int baseNeighlistIdx(const uint32_t *cumulSumMaxMemPerWarp, in
     return warpsPerBlock * cumulSumUpToMe + memSizePerWarpMe * myWarp + myIdxInWarp;
 }
 
-inline __device__ int baseNeighlistIdxFromRPIndex(const uint32_t *cumulSumMaxMemPerWarp, int warpSize, int myRingPolyIdx, int nThreadPerAtom) { 
-    int nAtomPerBlock = blockDim.x / nThreadPerAtom;
+//where a ring polymer's neighbors start in a list laid out for pair kernels of nThreadPerBlock threads per block,
+//for kernels launched with other blocks and for the host
+inline __host__ __device__ int baseNeighlistIdxFromRPIndex(const uint32_t *cumulSumMaxMemPerWarp, int warpSize, int myRingPolyIdx, int nThreadPerAtom, int nThreadPerBlock) { 
+    int nAtomPerBlock = nThreadPerBlock / nThreadPerAtom;
     int      blockIdx           = myRingPolyIdx / nAtomPerBlock;
     uint32_t cumulSumUpToMe     = cumulSumMaxMemPerWarp[blockIdx];
     uint32_t memSizePerWarpMe   = cumulSumMaxMemPerWarp[blockIdx+1] - cumulSumUpToMe;
@@ -27,10 +30,14 @@ inline __device__ int baseNeighlistIdxFromRPIndex(const uint32_t *cumulSumMaxMem
     int nAtomPerWarp            = warpSize / nThreadPerAtom;
     int myWarp                  = nthAtomInBlock / nAtomPerWarp;
     int myIdxInWarp             = nthAtomInBlock % nAtomPerWarp;
-    int warpsPerBlock           = blockDim.x/warpSize;
+    int warpsPerBlock           = nThreadPerBlock/warpSize;
     return warpsPerBlock * cumulSumUpToMe + memSizePerWarpMe * myWarp + myIdxInWarp * nThreadPerAtom;
 }
 
+inline __device__ int baseNeighlistIdxFromRPIndex(const uint32_t *cumulSumMaxMemPerWarp, int warpSize, int myRingPolyIdx, int nThreadPerAtom) { 
+    return baseNeighlistIdxFromRPIndex(cumulSumMaxMemPerWarp, warpSize, myRingPolyIdx, nThreadPerAtom, blockDim.x);
+}
+
 inline __device__ int baseNeighlistIdxFromRPIndex(const uint32_t *cumulSumMaxMemPerWarp, int warpSize, int myRingPolyIdx) {
     int      blockIdx           = myRingPolyIdx / blockDim.x;
     uint32_t cumulSumUpToMe     = cumulSumMaxMemPerWarp[blockIdx];
@@ -194,6 +201,45 @@ ACCUMULATION_CLASS(SumVectorToVirial, Virial, float4, v, Virial(v.x*v.x, v.y*v.y
 /* TODO: this is the line giving grief for massless particles! */
 ACCUMULATION_CLASS(SumVectorToVirialOverW, Virial, float4, v, Virial(v.x*v.x/v.w, v.y*v.y/v.w, v.z*v.z/v.w, v.x*v.y/v.w, v.x*v.z/v.w, v.y*v.z/v.w), Virial(0, 0, 0, 0, 0, 0)); 
 ACCUMULATION_CLASS(SumVirialToScalar, float, Virial, vir, (vir[0]+vir[1]+vir[2]), 0); 
+//same sums as above, but summed in the accum type (double in MIXED_PRECISION builds)
+ACCUMULATION_CLASS(SumSingleAccum, accum, float, x, x, 0);
+ACCUMULATION_CLASS(SumVirialAccum, VirialAccum, Virial, vir, VirialAccum(vir), VirialAccum(0, 0, 0, 0, 0, 0));
+ACCUMULATION_CLASS(SumVectorSqr3DOverWAccum, accum, float4, v, lengthSqrOverW(v), 0);
+ACCUMULATION_CLASS(SumVectorToVirialOverWAccum, VirialAccum, float4, v, VirialAccum(v.x*v.x/v.w, v.y*v.y/v.w, v.z*v.z/v.w, v.x*v.y/v.w, v.x*v.z/v.w, v.y*v.z/v.w), VirialAccum(0, 0, 0, 0, 0, 0)); 
+ACCUMULATION_CLASS(SumVirialToScalarAccum, accum, Virial, vir, (vir[0]+vir[1]+vir[2]), 0); 
+
+//the reduction kernels add their block's result into dest in chunks of this type
+template <class K>
+struct AccumChunk {
+    typedef float type;
+};
+template <>
+struct AccumChunk<double> {
+    typedef double type;
+};
+template <>
+struct AccumChunk<VirialAccum> {
+    typedef accum type;
+};
+
+inline __device__ void atomicAddChunk(float *dest, float val) {
+    atomicAdd(dest, val);
+}
+
+//double atomicAdd is only native on sm_60 and up, so build it from a 64 bit compare and swap
+inline __device__ void atomicAddChunk(double *dest, double val) {
+    unsigned long long int *destAsInt = (unsigned long long int *) dest;
+    unsigned long long int old = *destAsInt;
+    unsigned long long int assumed;
+    do {
+        assumed = old;
+        old = atomicCAS(destAsInt, assumed, __double_as_longlong(val + __longlong_as_double(assumed)));
+    } while (assumed != old);
+}
+
+inline __device__ void atomicAddFixedPoint(unsigned long long *dest, double val) {
+    atomicAdd(dest, (unsigned long long) toFixedPoint(val));
+}
 
 template <class K, class T, class C, int NPERTHREAD>
 __global__ void oneToOne_gpu(K *dest, T *src, int n, C instance) {
@@ -210,8 +256,10 @@ __global__ void oneToOne_gpu(K *dest, T *src, int n, C instance) {
 }
 
 
-template <class K, class T, class C, int NPERTHREAD>
+//if FIXED, the block sums are added into dest as fixed point, one long long per chunk of K.  Read the result with reductionResult
+template <class K, class T, class C, int NPERTHREAD, bool FIXED=false>
 __global__ void accumulate_gpu(K *dest, T *src, int n, int warpSize, C instance) {
+    typedef typename AccumChunk<K>::type Chunk;
     SharedMemory<K> sharedMem;
     K *tmp = sharedMem.getPointer();
     
@@ -241,18 +289,23 @@ __global__ void accumulate_gpu(K *dest, T *src, int n, int warpSize, C instance)
             __syncthreads();
         }
     }
-    if (threadIdx.x < sizeof(K) / sizeof(float)) {
+    if (threadIdx.x < sizeof(K) / sizeof(Chunk)) {
         //one day, some hero will find out why it doesn't work to do atomicAdd as a member of the accumulation class.
-        //in the mean time, just adding 32 bit chunks.  Could template this to do ints too.
-        float *destFloat = (float *) dest;
-        float *tmpFloat = (float *) tmp;
-        atomicAdd(destFloat + threadIdx.x, tmpFloat[threadIdx.x]);
+        //in the mean time, just adding 32 (or 64, for double accumulators) bit chunks.  Could template this to do ints too.
+        Chunk *tmpChunk = (Chunk *) tmp;
+        if (FIXED) {
+            atomicAddFixedPoint((unsigned long long *) dest + threadIdx.x, tmpChunk[threadIdx.x]);
+        } else {
+            Chunk *destChunk = (Chunk *) dest;
+            atomicAddChunk(destChunk + threadIdx.x, tmpChunk[threadIdx.x]);
+        }
     }
 }
 
 //dealing with the common case of summing based on group tags
-template <class K, class T, class C, int NPERTHREAD>
+template <class K, class T, class C, int NPERTHREAD, bool FIXED=false>
 __global__ void accumulate_gpu_if(K *dest, T *src, int n, int warpSize, C instance) {
+    typedef typename AccumChunk<K>::type Chunk;
     SharedMemory<K> sharedMem;
     K *tmp = sharedMem.getPointer();
 
@@ -276,7 +329,8 @@ __global__ void accumulate_gpu_if(K *dest, T *src, int n, int warpSize, C instan
     int curLookahead = NPERTHREAD;
     int numLookaheadSteps = log2f(blockDim.x-1);
     const int sumBaseIdx = threadIdx.x * NPERTHREAD;
-    atomicAdd((int *) (dest + 1), numAdded);
+    int *numAddedDest = FIXED ? (int *) ((unsigned long long *) dest + sizeof(K) / sizeof(Chunk)) : (int *) (dest + 1);
+    atomicAdd(numAddedDest, numAdded);
     __syncthreads();
     for (int i=sumBaseIdx+1; i<sumBaseIdx + NPERTHREAD; i++) {
         tmp[sumBaseIdx] += tmp[i];
@@ -290,13 +344,99 @@ __global__ void accumulate_gpu_if(K *dest, T *src, int n, int warpSize, C instan
             __syncthreads();
         }
     }
-    if (threadIdx.x < sizeof(K) / sizeof(float)) {
+    if (threadIdx.x < sizeof(K) / sizeof(Chunk)) {
         //one day, some hero will find out why it doesn't work to do atomicAdd as a member of the accumulation class.
-        //in the mean time, just adding 32 bit chunks.  Could template this to do ints too.
-        float *destFloat = (float *) dest;
-        float *tmpFloat = (float *) tmp;
-        atomicAdd(destFloat + threadIdx.x, tmpFloat[threadIdx.x]);
+        //in the mean time, just adding 32 (or 64, for double accumulators) bit chunks.  Could template this to do ints too.
+        Chunk *tmpChunk = (Chunk *) tmp;
+        if (FIXED) {
+            atomicAddFixedPoint((unsigned long long *) dest + threadIdx.x, tmpChunk[threadIdx.x]);
+        } else {
+            Chunk *destChunk = (Chunk *) dest;
+            atomicAddChunk(destChunk + threadIdx.x, tmpChunk[threadIdx.x]);
+        }
     }
 }
 
+//launch helpers for the common case of reducing an n-long array with N_DATA_PER_THREAD per thread.
+//fixedPoint is normally State::deterministic
+template <class K, class T, class C>
+void accumulate(K *dest, T *src, int n, int warpSize, C instance, bool fixedPoint) {
+    if (fixedPoint) {
+        accumulate_gpu<K, T, C, N_DATA_PER_THREAD, true> <<<NBLOCK(n / (double) N_DATA_PER_THREAD), PERBLOCK, N_DATA_PER_THREAD*PERBLOCK*sizeof(K)>>>
+            (dest, src, n, warpSize, instance);
+    } else {
+        accumulate_gpu<K, T, C, N_DATA_PER_THREAD, false> <<<NBLOCK(n / (double) N_DATA_PER_THREAD), PERBLOCK, N_DATA_PER_THREAD*PERBLOCK*sizeof(K)>>>
+            (dest, src, n, warpSize, instance);
+    }
+}
+
+template <class K, class T, class C>
+void accumulateIf(K *dest, T *src, int n, int warpSize, C instance, bool fixedPoint) {
+    if (fixedPoint) {
+        accumulate_gpu_if<K, T, C, N_DATA_PER_THREAD, true> <<<NBLOCK(n / (double) N_DATA_PER_THREAD), PERBLOCK, N_DATA_PER_THREAD*PERBLOCK*sizeof(K)>>>
+            (dest, src, n, warpSize, instance);
+    } else {
+        accumulate_gpu_if<K, T, C, N_DATA_PER_THREAD, false> <<<NBLOCK(n / (double) N_DATA_PER_THREAD), PERBLOCK, N_DATA_PER_THREAD*PERBLOCK*sizeof(K)>>>
+            (dest, src, n, warpSize, instance);
+    }
+}
+
+//reads the result of accumulate(If) from host data, converting from fixed point if need be
+template <class K>
+K reductionResult(float *src, bool fixedPoint) {
+    if (not fixedPoint) {
+        return * (K *) src;
+    }
+    typedef typename AccumChunk<K>::type Chunk;
+    K res;
+    Chunk *resChunk = (Chunk *) &res;
+    long long *srcFixed = (long long *) src;
+    for (int i=0; i<(int) (sizeof(K) / sizeof(Chunk)); i++) {
+        resChunk[i] = fromFixedPoint(srcFixed[i]);
+    }
+    return res;
+}
+
+//host backend versions of accumulate(If).  Values are summed in index order and the result is stored in the same
+//form the kernels leave it in, so it is read back with reductionResult
+template <class K>
+void storeReductionResult(K *dest, K val, bool fixedPoint) {
+    if (not fixedPoint) {
+        *dest = val;
+        return;
+    }
+    typedef typename AccumChunk<K>::type Chunk;
+    Chunk *valChunk = (Chunk *) &val;
+    long long *destFixed = (long long *) dest;
+    for (int i=0; i<(int) (sizeof(K) / sizeof(Chunk)); i++) {
+        destFixed[i] = toFixedPoint(valChunk[i]);
+    }
+}
+
+template <class K, class T, class C>
+void accumulateHost(K *dest, T *src, int n, C instance, bool fixedPoint) {
+    K sum = instance.zero();
+    for (int i=0; i<n; i++) {
+        sum += instance.process(src[i]);
+    }
+    storeReductionResult(dest, sum, fixedPoint);
+}
+
+template <class K, class T, class C>
+void accumulateIfHost(K *dest, T *src, int n, C instance, bool fixedPoint) {
+    K sum = instance.zero();
+    for (int i=0; i<n; i++) {
+        if (instance.willProcess(src, i)) {
+            sum += instance.process(src[i]);
+        }
+    }
+    storeReductionResult(dest, sum, fixedPoint);
+}
+
+//used by kernels which add per-forcer contributions to atoms with atomics.  In deterministic mode they add into
+//fixed point scratch arrays instead (3 per atom for forces, 6 for virials, 1 for energies), which are then
+//added to the atoms' values and zeroed by these kernels
+__global__ void addFixedPointForces(int nAtoms, float4 *fs, Virial *virials, unsigned long long *fsFixed, unsigned long long *virialsFixed);
+__global__ void addFixedPointEngs(int nAtoms, float *perParticleEng, unsigned long long *engsFixed);
+
 #endif
@@ -54,10 +54,13 @@ using b_shared_ptr = boost::shared_ptr<T>;
 #define XIDX(x, SIZE) (x % (PERLINE / SIZE))
 #define YIDX(y, SIZE) (y / (PERLINE / SIZE))
 #define PERBLOCK 256
+#define HOST_CLUSTER_SIZE 4 //atoms per cluster in the host cluster-pair list.  Must be <= 4 so the per-pair exclusion tags fit in 32 bits
 #define NBLOCK(x) ((int) (ceil(x / (float) PERBLOCK)))
 #define NBLOCKVAR(x, threadPerBlock) ((int) (ceil(x / (float) threadPerBlock)))
 
 #define NBLOCKTEAM(x, threadPerBlock, threadPerTeam) ((int) (ceil(x / (float) (threadPerBlock/threadPerTeam))))
 
 #define LINEARIDX(idx, ns) (ns.z*ns.y*idx.x + ns.z*idx.y + idx.z)
+//index of a grid cell in the per-cell arrays.  If cellOrder is set, cells are numbered along a space-filling curve (see GridGPU::updateCellOrder)
+#define CELLIDX(idx, ns, cellOrder) (cellOrder ? cellOrder[LINEARIDX(idx, ns)] : LINEARIDX(idx, ns))
 
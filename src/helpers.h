@@ -30,7 +30,7 @@ void cumulativeSum(T *data, K n) {
             vals[4] = xz;
             vals[5] = yz;
             */
-inline __device__ void computeVirial(Virial &v, float3 force, float3 dr) {
+inline __host__ __device__ void computeVirial(Virial &v, float3 force, float3 dr) {
     v[0] += force.x * dr.x;
     v[1] += force.y * dr.y;
     v[2] += force.z * dr.z;
@@ -41,7 +41,8 @@ inline __device__ void computeVirial(Virial &v, float3 force, float3 dr) {
 
 
 template <class SRCVar, class SRCBase, class SRCFull, class DEST, class TYPEHOLDER, int N>
-int copyMultiAtomToGPU(int nAtoms, std::vector<SRCVar> &src, std::vector<int> &idToIdx, GPUArrayDeviceGlobal<DEST> *dest, GPUArrayDeviceGlobal<int> *destIdxs, std::unordered_map<int, TYPEHOLDER> *forcerTypes, GPUArrayDeviceGlobal<TYPEHOLDER> *parameters, int maxExistingType) {
+int copyMultiAtomToGPU(int nAtoms, std::vector<SRCVar> &src, std::vector<int> &idToIdx, GPUArrayDeviceGlobal<DEST> *dest, GPUArrayDeviceGlobal<int> *destIdxs, std::unordered_map<int, TYPEHOLDER> *forcerTypes, GPUArrayDeviceGlobal<TYPEHOLDER> *parameters, int maxExistingType,
+                       std::vector<DEST> *destHost_out = nullptr, std::vector<int> *destIdxsHost_out = nullptr) {
     std::vector<int> idxs(nAtoms+1, 0); //started out being used as counts
     std::vector<int> numAddedPerAtom(nAtoms, 0);
     bool redundantCalcs = N <= 3;
@@ -90,6 +91,10 @@ int copyMultiAtomToGPU(int nAtoms, std::vector<SRCVar> &src, std::vector<int> &i
     }
     *dest = GPUArrayDeviceGlobal<DEST>(destHost.size());
     dest->set(destHost.data());
+    if (destHost_out) {
+        *destHost_out = destHost;
+        *destIdxsHost_out = redundantCalcs ? idxs : std::vector<int>();
+    }
     int maxPerBlock = 0;
     if (redundantCalcs) {
         *destIdxs = GPUArrayDeviceGlobal<int>(idxs.size());
@@ -116,4 +121,32 @@ int copyMultiAtomToGPU(int nAtoms, std::vector<SRCVar> &src, std::vector<int> &i
     return maxPerBlock;
 }
 
+//Regroups forcer entries laid out per atom, as by copyBondsToGPU and copyMultiAtomToGPU, after the atoms were
+//sorted again.  atomIdOf gives the id of the atom an entry belongs to.  Entries keep their order within each atom,
+//so the result is the same as copying the forcers again, without redoing their types and parameters.  Returns the
+//most entries of any block
+template <class T, class ATOMIDOF>
+int regroupForcersByAtom(std::vector<T> &entries, std::vector<int> &idxs, std::vector<int> &idToIdx, ATOMIDOF atomIdOf) {
+    int nAtoms = idxs.size() - 1;
+    std::vector<int> newIdxs(nAtoms+1, 0);
+    for (T &e : entries) {
+        newIdxs[idToIdx[atomIdOf(e)]]++;
+    }
+    cumulativeSum(newIdxs.data(), nAtoms+1);
+    std::vector<int> numAddedPerAtom(nAtoms, 0);
+    std::vector<T> regrouped(entries.size());
+    for (T &e : entries) {
+        int idx = idToIdx[atomIdOf(e)];
+        regrouped[newIdxs[idx] + numAddedPerAtom[idx]] = e;
+        numAddedPerAtom[idx]++;
+    }
+    entries.swap(regrouped);
+    idxs.swap(newIdxs);
+    int maxPerBlock = 0;
+    for (int i=0; i<nAtoms; i+=PERBLOCK) {
+        maxPerBlock = std::fmax(maxPerBlock, idxs[std::fmin(i+PERBLOCK+1, idxs.size()-1)] - idxs[i]);
+    }
+    return maxPerBlock;
+}
+
 #endif
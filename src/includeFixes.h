@@ -28,9 +28,13 @@
 #include "FixChargePairDSF.h"
 #include "FixChargeEwald.h"
 #include "FixWCA.h"
+#include "FixPairTabulated.h"
 #include "FixPressureBerendsen.h"
 #include "FixLinearMomentum.h"
 #include "FixRigid.h"
+#include "FixConstraint.h"
+#include "FixShake.h"
+#include "FixLINCS.h"
 #include "FixExternalHarmonic.h"
 #include "FixExternalQuartic.h"
 #include "FixRingPolyPot.h"
@@ -0,0 +1,112 @@
+#include "Autotuner.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+//The parts of the autotuner that do not time anything: the cache of tuned values, the signature keying it, and the
+//interval given to each padding candidate
+class AutotunerTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        fn = "AutotunerTest.cache";
+        std::remove(fn.c_str());
+    }
+
+    virtual void TearDown() {
+        std::remove(fn.c_str());
+    }
+
+    double valueOf(const Autotuner::TunedValues &values, std::string name) {
+        for (auto &value : values) {
+            if (value.first == name) {
+                return value.second;
+            }
+        }
+        ADD_FAILURE() << "no value for " << name;
+        return 0;
+    }
+
+    std::string fn;
+};
+
+TEST_F(AutotunerTest, SafeInterval) {
+    double userPadding = 0.5;
+    int userInterval = 10;
+    //the user's padding keeps the user's interval, and more padding never raises it
+    EXPECT_EQ(Autotuner::safeInterval(0.5, userPadding, userInterval), 10);
+    EXPECT_EQ(Autotuner::safeInterval(1.0, userPadding, userInterval), 10);
+    //less padding per turn than the user's is never allowed
+    EXPECT_EQ(Autotuner::safeInterval(0.25, userPadding, userInterval), 5);
+    EXPECT_EQ(Autotuner::safeInterval(0.1, userPadding, userInterval), 2);
+    EXPECT_EQ(Autotuner::safeInterval(0.01, userPadding, userInterval), 1);
+    //an interval that is not a candidate is still kept for the user's padding
+    EXPECT_EQ(Autotuner::safeInterval(0.5, userPadding, 7), 7);
+}
+
+TEST_F(AutotunerTest, Signature) {
+    std::string sig = Autotuner::signature(1000, 1, 0.8, 2.5, "gpu Tesla_K80", {"LJCut", "Langevin"});
+    EXPECT_EQ(sig, Autotuner::signature(1000, 1, 0.8, 2.5, "gpu Tesla_K80", {"Langevin", "LJCut"}));
+    EXPECT_EQ(sig, Autotuner::signature(1000, 1, 0.80001, 2.5, "gpu Tesla_K80", {"LJCut", "Langevin"}));
+    EXPECT_NE(sig, Autotuner::signature(1001, 1, 0.8, 2.5, "gpu Tesla_K80", {"LJCut", "Langevin"}));
+    EXPECT_NE(sig, Autotuner::signature(1000, 1, 0.85, 2.5, "gpu Tesla_K80", {"LJCut", "Langevin"}));
+    EXPECT_NE(sig, Autotuner::signature(1000, 1, 0.8, 3.0, "gpu Tesla_K80", {"LJCut", "Langevin"}));
+    EXPECT_NE(sig, Autotuner::signature(1000, 1, 0.8, 2.5, "host 8", {"LJCut", "Langevin"}));
+    EXPECT_NE(sig, Autotuner::signature(1000, 1, 0.8, 2.5, "gpu Tesla_K80", {"LJCut"}));
+    //the tab separates the signature from the values in the cache
+    EXPECT_EQ(sig.find('\t'), std::string::npos);
+}
+
+TEST_F(AutotunerTest, CacheRoundTrip) {
+    Autotuner::TunedValues values;
+    EXPECT_FALSE(Autotuner::readCacheFile(fn, "sigA", 10, values));
+
+    Autotuner::TunedValues a = {{"nThreadPerBlock", 128}, {"nThreadPerAtom", 4}, {"padding", 0.375}};
+    Autotuner::TunedValues b = {{"nThreadPerBlock", 256}, {"periodicInterval", 5}};
+    ASSERT_TRUE(Autotuner::writeCacheFile(fn, "sigA", a));
+    ASSERT_TRUE(Autotuner::writeCacheFile(fn, "sigB", b));
+
+    ASSERT_TRUE(Autotuner::readCacheFile(fn, "sigA", 10, values));
+    EXPECT_EQ(values, a);
+    ASSERT_TRUE(Autotuner::readCacheFile(fn, "sigB", 10, values));
+    EXPECT_EQ(values, b);
+    EXPECT_FALSE(Autotuner::readCacheFile(fn, "sigC", 10, values));
+
+    //tuning again replaces the line of the signature and keeps the others
+    Autotuner::TunedValues a2 = {{"nThreadPerBlock", 64}, {"padding", 0.6}};
+    ASSERT_TRUE(Autotuner::writeCacheFile(fn, "sigA", a2));
+    ASSERT_TRUE(Autotuner::readCacheFile(fn, "sigA", 10, values));
+    EXPECT_EQ(values, a2);
+    ASSERT_TRUE(Autotuner::readCacheFile(fn, "sigB", 10, values));
+    EXPECT_EQ(values, b);
+
+    std::ifstream cache(fn);
+    std::string line;
+    int nLines = 0;
+    while (std::getline(cache, line)) {
+        nLines++;
+    }
+    EXPECT_EQ(nLines, 2);
+}
+
+//a cached periodicInterval is never used above the one the user set for this run
+TEST_F(AutotunerTest, PeriodicIntervalClamp) {
+    Autotuner::TunedValues cached = {{"padding", 0.5}, {"periodicInterval", 50}};
+    ASSERT_TRUE(Autotuner::writeCacheFile(fn, "sig", cached));
+    Autotuner::TunedValues values;
+    ASSERT_TRUE(Autotuner::readCacheFile(fn, "sig", 10, values));
+    EXPECT_EQ(valueOf(values, "periodicInterval"), 10);
+    EXPECT_EQ(valueOf(values, "padding"), 0.5);
+    ASSERT_TRUE(Autotuner::readCacheFile(fn, "sig", 100, values));
+    EXPECT_EQ(valueOf(values, "periodicInterval"), 50);
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc,argv);
+    int ret = RUN_ALL_TESTS();
+    return ret;
+}
@@ -0,0 +1,109 @@
+#include "State.h"
+#include "FixLJCut.h"
+#include "FixBondHarmonic.h"
+#include "FixLangevin.h"
+#include "IntegratorVerlet.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+//LJ chains of four atoms joined by harmonic bonds, thermostatted with Langevin.  With State::deterministic set,
+//the trajectory should not depend on the launch configuration
+class DeterministicRunTest : public ::testing::Test {
+protected:
+    boost::shared_ptr<State> makeState(int nThreadPerBlock) {
+        boost::shared_ptr<State> state(new State());
+        int nSide = 8;
+        double spacing = 1.2;
+        state->bounds = Bounds(state, Vector(0, 0, 0), Vector(nSide*spacing, nSide*spacing, nSide*spacing));
+        state->rCut = 2.5;
+        state->padding = 0.5;
+        state->periodicInterval = 7;
+        state->dt = 0.005;
+        state->shoutEvery = 100000;
+        state->deterministic = true;
+        state->nThreadPerBlock = nThreadPerBlock;
+        state->nThreadPerAtom = 1;
+        state->atomParams.addSpecies("spc1", 1);
+        for (int i=0; i<nSide; i++) {
+            for (int j=0; j<nSide; j++) {
+                for (int k=0; k<nSide; k++) {
+                    state->addAtom("spc1", Vector((i+0.5)*spacing, (j+0.5)*spacing, (k+0.5)*spacing), 0);
+                }
+            }
+        }
+
+        lj = boost::shared_ptr<FixLJCut>(new FixLJCut(state, "lj"));
+        lj->setParameter("sig", "spc1", "spc1", 1);
+        lj->setParameter("eps", "spc1", "spc1", 1);
+        state->activateFix(lj);
+
+        bonds = boost::shared_ptr<FixBondHarmonic>(new FixBondHarmonic(state, "bonds"));
+        for (int i=0; i+1<(int) state->atoms.size(); i++) {
+            if (i % 4 != 3) {
+                bonds->createBond(&state->atoms[i], &state->atoms[i+1], 100, spacing, -1);
+            }
+        }
+        state->activateFix(bonds);
+
+        langevin = boost::shared_ptr<FixLangevin>(new FixLangevin(state, "langevin", "all", 1.2));
+        langevin->setParams(1234, 1);
+        state->activateFix(langevin);
+        return state;
+    }
+
+    //positions and velocities after nTurns, by atom id
+    std::vector<Vector> run(int nThreadPerBlock, int nTurns) {
+        boost::shared_ptr<State> state = makeState(nThreadPerBlock);
+        IntegratorVerlet integrator(state.get());
+        integrator.run(nTurns);
+        std::vector<Vector> result;
+        for (int id=0; id<(int) state->atoms.size(); id++) {
+            Atom &a = state->idToAtom(id);
+            result.push_back(a.pos);
+            result.push_back(a.vel);
+        }
+        return result;
+    }
+
+    boost::shared_ptr<FixLJCut> lj;
+    boost::shared_ptr<FixBondHarmonic> bonds;
+    boost::shared_ptr<FixLangevin> langevin;
+};
+
+TEST_F(DeterministicRunTest, SameResultForEachBlockSize) {
+    int nTurns = 200;
+    std::vector<Vector> reference = run(128, nTurns);
+    for (int nThreadPerBlock : {64, 256}) {
+        std::vector<Vector> other = run(nThreadPerBlock, nTurns);
+        ASSERT_EQ(reference.size(), other.size());
+        for (int i=0; i<(int) reference.size(); i++) {
+            for (int k=0; k<3; k++) {
+                EXPECT_EQ(reference[i][k], other[i][k]) << "nThreadPerBlock " << nThreadPerBlock << ", atom " << i/2
+                                                        << (i % 2 ? " velocity" : " position") << ", component " << k;
+            }
+        }
+    }
+}
+
+TEST_F(DeterministicRunTest, RepeatedRunIsIdentical) {
+    int nTurns = 100;
+    std::vector<Vector> first = run(128, nTurns);
+    std::vector<Vector> second = run(128, nTurns);
+    ASSERT_EQ(first.size(), second.size());
+    for (int i=0; i<(int) first.size(); i++) {
+        for (int k=0; k<3; k++) {
+            EXPECT_EQ(first[i][k], second[i][k]) << "atom " << i/2 << (i % 2 ? " velocity" : " position");
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    //State and the fixes keep python lists
+    Py_Initialize();
+    ::testing::InitGoogleTest(&argc,argv);
+    int ret = RUN_ALL_TESTS();
+    return ret;
+}
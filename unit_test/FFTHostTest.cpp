@@ -0,0 +1,153 @@
+#include "FFTHost.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <complex>
+#include <random>
+#include <vector>
+
+//Grids are filled with random values and checked against a direct DFT, using the built-in transforms.  Sizes
+//cover each radix (2, 3, 4, 5, 7), primes above 7 (Bluestein), and even and odd nz
+class FFTHostTest : public ::testing::Test {
+protected:
+    void init(int nx_, int ny_, int nz_) {
+        nx = nx_;
+        ny = ny_;
+        nz = nz_;
+        nzComplex = nz/2 + 1;
+        fft = FFTHost(nx, ny, nz, false);
+
+        std::mt19937 generator(123);
+        std::uniform_real_distribution<double> dist(-1.0, 1.0);
+        values = std::vector<float>(nx*ny*nz);
+        for (float &v : values) {
+            v = dist(generator);
+        }
+        grid = std::vector<float>(fft.size(), 0);
+        for (int x=0; x<nx; x++) {
+            for (int y=0; y<ny; y++) {
+                for (int z=0; z<nz; z++) {
+                    grid[realIdx(x, y, z)] = values[(x*ny + y)*nz + z];
+                }
+            }
+        }
+    }
+
+    void checkForward() {
+        fft.forward(grid.data());
+        for (int kx=0; kx<nx; kx++) {
+            for (int ky=0; ky<ny; ky++) {
+                for (int kz=0; kz<nzComplex; kz++) {
+                    std::complex<double> expected = directDFT(kx, ky, kz);
+                    int kIdx = (kx*ny + ky)*nzComplex + kz;
+                    EXPECT_NEAR(expected.real(), grid[2*kIdx], 1e-4) << kx << " " << ky << " " << kz;
+                    EXPECT_NEAR(expected.imag(), grid[2*kIdx+1], 1e-4) << kx << " " << ky << " " << kz;
+                }
+            }
+        }
+    }
+
+    void checkRoundTrip() {
+        fft.forward(grid.data());
+        fft.inverse(grid.data());
+        int n = nx*ny*nz;
+        for (int x=0; x<nx; x++) {
+            for (int y=0; y<ny; y++) {
+                for (int z=0; z<nz; z++) {
+                    EXPECT_NEAR(values[(x*ny + y)*nz + z], grid[realIdx(x, y, z)] / n, 1e-5) << x << " " << y << " " << z;
+                }
+            }
+        }
+    }
+
+    int realIdx(int x, int y, int z) {
+        return (x*ny + y)*2*nzComplex + z;
+    }
+
+    std::complex<double> directDFT(int kx, int ky, int kz) {
+        std::complex<double> sum = 0;
+        for (int x=0; x<nx; x++) {
+            for (int y=0; y<ny; y++) {
+                for (int z=0; z<nz; z++) {
+                    double phase = -2*M_PI*((double) kx*x/nx + (double) ky*y/ny + (double) kz*z/nz);
+                    sum += (double) values[(x*ny + y)*nz + z] * std::polar(1.0, phase);
+                }
+            }
+        }
+        return sum;
+    }
+
+    int nx, ny, nz, nzComplex;
+    FFTHost fft;
+    std::vector<float> values;
+    std::vector<float> grid;
+};
+
+TEST_F(FFTHostTest, ForwardMatchesDirectDFT) {
+    init(6, 5, 14);
+    checkForward();
+}
+
+TEST_F(FFTHostTest, InverseIsUnnormalized) {
+    init(6, 5, 14);
+    checkRoundTrip();
+}
+
+TEST_F(FFTHostTest, PowerOfTwo) {
+    init(8, 16, 32);
+    checkForward();
+    init(8, 16, 32);
+    checkRoundTrip();
+}
+
+TEST_F(FFTHostTest, LargePrimeAndOddZ) {
+    init(11, 4, 9);
+    checkForward();
+    init(11, 4, 9);
+    checkRoundTrip();
+}
+
+//nz = 26 is transformed as packed rows of length 13
+TEST_F(FFTHostTest, LargePrimeInPackedZ) {
+    init(3, 13, 26);
+    checkForward();
+    init(3, 13, 26);
+    checkRoundTrip();
+}
+
+#ifdef HAVE_FFTW
+TEST(FFTHostFFTWTest, MatchesBuiltIn) {
+    int nx = 6, ny = 10, nz = 14;
+    FFTHost builtIn(nx, ny, nz, false);
+    FFTHost fftw(nx, ny, nz);
+    EXPECT_TRUE(fftw.usingFFTW());
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    std::vector<float> a(builtIn.size());
+    for (float &v : a) {
+        v = dist(generator);
+    }
+    std::vector<float> b = a;
+    builtIn.forward(a.data());
+    fftw.forward(b.data());
+    for (size_t i=0; i<a.size(); i++) {
+        EXPECT_NEAR(a[i], b[i], 1e-4);
+    }
+    builtIn.inverse(a.data());
+    fftw.inverse(b.data());
+    for (int row=0; row<nx*ny; row++) {
+        for (int z=0; z<nz; z++) {
+            int i = row*2*(nz/2+1) + z;
+            EXPECT_NEAR(a[i], b[i], 1e-3);
+        }
+    }
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc,argv);
+    int ret = RUN_ALL_TESTS();
+    return ret;
+}
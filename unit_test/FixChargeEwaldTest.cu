@@ -0,0 +1,299 @@
+#include "EwaldHelpers.h"
+#include "State.h"
+#include "FixChargeEwald.h"
+#include "IntegratorVerlet.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+//Cardinal B-spline M_n(x) from its explicit sum, for checking the recursion in assignmentWeights
+double bSpline(int n, double x) {
+    double sum = 0;
+    double binomial = 1;
+    double factorial = 1;
+    for (int i=2; i<n; i++) {
+        factorial *= i;
+    }
+    for (int j=0; j<=n; j++) {
+        if (x >= j) {
+            sum += (j % 2 ? -1 : 1) * binomial * std::pow(x - j, n - 1);
+        }
+        binomial = binomial * (n - j) / (j + 1);
+    }
+    return sum / factorial;
+}
+
+template <int ORDER>
+void checkAssignmentWeights() {
+    for (float frac=0; frac<1; frac+=0.0625f) {
+        float w[ORDER], dw[ORDER];
+        assignmentWeights<ORDER>(frac, w, dw);
+        float wSum = 0;
+        float dwSum = 0;
+        for (int k=0; k<ORDER; k++) {
+            EXPECT_NEAR(bSpline(ORDER, frac + k), w[k], 1e-5) << "order " << ORDER << ", frac " << frac << ", k " << k;
+            if (ORDER > 1) {
+                double dM = bSpline(ORDER-1, frac + k) - bSpline(ORDER-1, frac + k - 1);
+                EXPECT_NEAR(dM, dw[k], 1e-5) << "order " << ORDER << ", frac " << frac << ", k " << k;
+            }
+            wSum += w[k];
+            dwSum += dw[k];
+        }
+        EXPECT_NEAR(1, wSum, 1e-5);
+        EXPECT_NEAR(0, dwSum, 1e-5);
+    }
+}
+
+TEST(FixChargeEwaldTest, AssignmentWeights) {
+    checkAssignmentWeights<1>();
+    checkAssignmentWeights<2>();
+    checkAssignmentWeights<3>();
+    checkAssignmentWeights<4>();
+    checkAssignmentWeights<5>();
+    checkAssignmentWeights<6>();
+    checkAssignmentWeights<7>();
+}
+
+//each size is the smallest at least n with no prime factors above 7
+TEST(FixChargeEwaldTest, NextFFTSize) {
+    auto isSmooth = [] (int m) {
+        for (int p : {2, 3, 5, 7}) {
+            while (m % p == 0) {
+                m /= p;
+            }
+        }
+        return m == 1;
+    };
+    for (int n=1; n<=1000; n++) {
+        int m = nextFFTSize(n);
+        EXPECT_TRUE(isSmooth(m)) << "n " << n << ", size " << m;
+        for (int k=n; k<m; k++) {
+            EXPECT_FALSE(isSmooth(k)) << "n " << n << ", size " << m << " skips " << k;
+        }
+    }
+    EXPECT_EQ(nextFFTSize(0), 1);
+    EXPECT_EQ(nextFFTSize(11), 12);
+    EXPECT_EQ(nextFFTSize(97), 98);
+    EXPECT_EQ(nextFFTSize(121), 125);
+}
+
+TEST(FixChargeEwaldTest, TuneCandidates) {
+    typedef std::pair<float, int> Candidate;
+    //the user's first, then 0.85, 1 and 1.2 times the cutoff at the user's order and at 3, 5 and 7, once each
+    std::vector<Candidate> candidates = ewaldTuneCandidates(10, 4, 100, 1);
+    ASSERT_EQ((int) candidates.size(), 1 + 2 + 3*3);
+    EXPECT_EQ(candidates[0], Candidate(10, 4));
+    for (int i=0; i<(int) candidates.size(); i++) {
+        for (int j=0; j<i; j++) {
+            EXPECT_NE(candidates[i], candidates[j]);
+        }
+    }
+    EXPECT_NE(std::find(candidates.begin(), candidates.end(), Candidate(8.5f, 7)), candidates.end());
+    EXPECT_NE(std::find(candidates.begin(), candidates.end(), Candidate(12, 3)), candidates.end());
+
+    //the user's order is among the others, so it is not repeated
+    EXPECT_EQ((int) ewaldTuneCandidates(10, 3, 100, 1).size(), 1 + 2 + 3 + 3);
+
+    //cutoffs must stay below half the box, and analytical differentiation needs order 2 or more
+    candidates = ewaldTuneCandidates(10, 1, 11, 2);
+    EXPECT_EQ(candidates[0], Candidate(10, 1));
+    ASSERT_EQ((int) candidates.size(), 1 + 3*2);
+    for (int i=1; i<(int) candidates.size(); i++) {
+        EXPECT_LT(candidates[i].first, 11);
+        EXPECT_GE(candidates[i].second, 2);
+    }
+}
+
+//The first order update from the expansion (updateGreenFunction) should match a full recompute (calc_Green_function)
+//for the new box to second order in the change
+class FixChargeEwaldGreenTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        sz = make_int3(8, 10, 12);
+        trace = make_float3(20.0, 24.0, 27.0);
+        alpha = 0.3;
+        sumLimits = 2;
+        order = 5;
+        dLogL = make_float3(1e-3, -2e-3, 1.5e-3);
+        traceNew = trace * make_float3(std::exp(dLogL.x), std::exp(dLogL.y), std::exp(dLogL.z));
+    }
+
+    void checkUpdate(bool ad) {
+        int nK = sz.x*sz.y*(sz.z/2+1);
+        std::vector<float> Gs(nK), GsNew(nK), GsUpdated(nK);
+        float GMax = 0;
+        for (int kIdx=0; kIdx<nK; kIdx++) {
+            int3 id = make_int3(kIdx/(sz.y*(sz.z/2+1)), (kIdx/(sz.z/2+1))%sz.y, kIdx%(sz.z/2+1));
+            float3 dG, dGNew;
+            Gs[kIdx] = greenFunction(id, sz, trace, alpha, sumLimits, order, ad, dG);
+            GsNew[kIdx] = greenFunction(id, sz, traceNew, alpha, sumLimits, order, ad, dGNew);
+            GsUpdated[kIdx] = updatedGreenFunction(make_float4(Gs[kIdx], dG.x, dG.y, dG.z), dLogL);
+            GMax = std::fmax(GMax, std::fabs(Gs[kIdx]));
+        }
+        //second order error, plus single precision noise where G is small
+        float dLogLSqr = lengthSqr(dLogL);
+        double errorUpdated = 0;
+        double errorUnchanged = 0;
+        for (int kIdx=0; kIdx<nK; kIdx++) {
+            EXPECT_NEAR(GsNew[kIdx], GsUpdated[kIdx], 100*dLogLSqr*std::fabs(Gs[kIdx]) + 1e-6f*GMax) << "k point " << kIdx;
+            errorUpdated += std::fabs(GsNew[kIdx] - GsUpdated[kIdx]);
+            errorUnchanged += std::fabs(GsNew[kIdx] - Gs[kIdx]);
+        }
+        EXPECT_LT(errorUpdated, 0.01*errorUnchanged);
+    }
+
+    int3 sz;
+    float3 trace, traceNew;
+    float alpha;
+    int sumLimits;
+    int order;
+    float3 dLogL;
+};
+
+TEST_F(FixChargeEwaldGreenTest, IncrementalUpdateIK) {
+    checkUpdate(false);
+}
+
+TEST_F(FixChargeEwaldGreenTest, IncrementalUpdateAD) {
+    checkUpdate(true);
+}
+
+TEST_F(FixChargeEwaldGreenTest, NoChangeIsExact) {
+    float3 dG;
+    int3 id = make_int3(1, 2, 3);
+    float G = greenFunction(id, sz, trace, alpha, sumLimits, order, false, dG);
+    EXPECT_FLOAT_EQ(G, updatedGreenFunction(make_float4(G, dG.x, dG.y, dG.z), make_float3(0, 0, 0)));
+}
+
+//Opposite charges on alternating sites of a strongly jittered lattice, so the system is neutral but disordered, as
+//the error estimates assume.  Forces are computed once, by a run of no turns
+class FixChargeEwaldForceTest : public ::testing::Test {
+protected:
+    void makeState(std::string backend, std::string differentiation) {
+        state = boost::shared_ptr<State>(new State());
+        //the backend is process wide for array allocation, so every state sets its own
+        state->setBackend(backend);
+        int nSide = 8;
+        double spacing = 1.2;
+        state->bounds = Bounds(state, Vector(0, 0, 0), Vector(nSide*spacing, nSide*spacing, nSide*spacing));
+        state->rCut = 3.0;
+        state->padding = 0.5;
+        state->shoutEvery = 100000;
+        state->atomParams.addSpecies("spc1", 1);
+        std::mt19937 generator(97531);
+        std::uniform_real_distribution<double> jitter(-0.4, 0.4);
+        for (int i=0; i<nSide; i++) {
+            for (int j=0; j<nSide; j++) {
+                for (int k=0; k<nSide; k++) {
+                    Vector pos((i+0.5)*spacing, (j+0.5)*spacing, (k+0.5)*spacing);
+                    double q = (i + j + k) % 2 ? -1 : 1;
+                    state->addAtom("spc1", pos + Vector(jitter(generator), jitter(generator), jitter(generator)), q);
+                }
+            }
+        }
+        ewald = boost::shared_ptr<FixChargeEwald>(new FixChargeEwald(state, "ewald", "all"));
+        ewald->setDifferentiation(differentiation);
+    }
+
+    //forces by atom id
+    std::vector<Vector> computeForces() {
+        state->activateFix(ewald);
+        IntegratorVerlet integrator(state.get());
+        integrator.run(0);
+        std::vector<Vector> fs;
+        for (int id=0; id<(int) state->atoms.size(); id++) {
+            fs.push_back(state->idToAtom(id).force);
+        }
+        return fs;
+    }
+
+    //total energy at the positions of the last computeForces, as DataComputerEnergy computes it
+    double energy() {
+        int nAtoms = state->atoms.size();
+        std::vector<float> engs(nAtoms, 0);
+        ewald->setEvalWrapperMode("self");
+        ewald->setEvalWrapper();
+        if (state->backend == BACKEND::HOST) {
+            ewald->singlePointEngHost(engs.data());
+        } else {
+            GPUArrayGlobal<float> engsGPU(nAtoms);
+            engsGPU.d_data.memset(0);
+            ewald->singlePointEng(engsGPU.getDevData());
+            engsGPU.dataToHost();
+            cudaDeviceSynchronize();
+            engs = engsGPU.h_data;
+        }
+        ewald->setEvalWrapperMode("offload");
+        ewald->setEvalWrapper();
+        double eng = 0;
+        for (float e : engs) {
+            eng += e;
+        }
+        return eng;
+    }
+
+    boost::shared_ptr<State> state;
+    boost::shared_ptr<FixChargeEwald> ewald;
+};
+
+//Each differentiation sizes its mesh and alpha so its RMS force error is below the requested error, so the RMS
+//difference between the two is below twice that
+TEST_F(FixChargeEwaldForceTest, ADMatchesIK) {
+    double error = 1e-3;
+    makeState("gpu", "ik");
+    ewald->setError(error, state->rCut, 3);
+    std::vector<Vector> fsIK = computeForces();
+    makeState("gpu", "ad");
+    ewald->setError(error, state->rCut, 3);
+    std::vector<Vector> fsAD = computeForces();
+    ASSERT_EQ(fsIK.size(), fsAD.size());
+    double sumSqr = 0;
+    double sumSqrDiff = 0;
+    for (int i=0; i<(int) fsIK.size(); i++) {
+        sumSqr += fsIK[i].lenSqr();
+        sumSqrDiff += (fsAD[i] - fsIK[i]).lenSqr();
+    }
+    double rmsForce = std::sqrt(sumSqr / fsIK.size());
+    double rmsDiff = std::sqrt(sumSqrDiff / fsIK.size());
+    EXPECT_GT(rmsForce, 10*error);
+    EXPECT_LT(rmsDiff, 2*error) << "RMS force " << rmsForce;
+}
+
+//With the same mesh, the host backend computes the same sums as the device kernels, in another order
+TEST_F(FixChargeEwaldForceTest, HostMatchesGPU) {
+    for (std::string differentiation : {"ik", "ad"}) {
+        makeState("gpu", differentiation);
+        ewald->setParameters(32, state->rCut, 5);
+        std::vector<Vector> fsGPU = computeForces();
+        double engGPU = energy();
+        makeState("host", differentiation);
+        ewald->setParameters(32, state->rCut, 5);
+        std::vector<Vector> fsHost = computeForces();
+        double engHost = energy();
+
+        ASSERT_EQ(fsGPU.size(), fsHost.size());
+        double sumSqr = 0;
+        for (Vector &f : fsGPU) {
+            sumSqr += f.lenSqr();
+        }
+        double rmsForce = std::sqrt(sumSqr / fsGPU.size());
+        for (int i=0; i<(int) fsGPU.size(); i++) {
+            EXPECT_LT((fsHost[i] - fsGPU[i]).len(), 1e-4*rmsForce) << differentiation << ", atom " << i;
+        }
+        EXPECT_NEAR(engHost, engGPU, 1e-4*std::fabs(engGPU)) << differentiation;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    //State and the fixes keep python lists
+    Py_Initialize();
+    ::testing::InitGoogleTest(&argc,argv);
+    int ret = RUN_ALL_TESTS();
+    return ret;
+}
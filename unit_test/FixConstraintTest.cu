@@ -0,0 +1,141 @@
+#include "State.h"
+#include "FixLJCut.h"
+#include "FixShake.h"
+#include "FixLINCS.h"
+#include "IntegratorVerlet.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+//Bent three-atom molecules on a lattice with LJ between molecules.  Each molecule has a heavy atom bonded to two
+//light ones, and the light atoms are held at a fixed distance too, so the three constraints of a molecule are coupled
+class FixConstraintTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        state = boost::shared_ptr<State>(new State());
+        int nSide = 5;
+        double spacing = 3.0;
+        side = nSide*spacing;
+        state->bounds = Bounds(state, Vector(0, 0, 0), Vector(side, side, side));
+        state->rCut = 2.5;
+        state->padding = 0.5;
+        state->periodicInterval = 5;
+        state->dt = 0.002;
+        state->shoutEvery = 100000;
+        state->atomParams.addSpecies("heavy", 16);
+        state->atomParams.addSpecies("light", 1);
+        bondLength = 1.0;
+        double theta = 109.47 * M_PI / 180;
+        for (int i=0; i<nSide; i++) {
+            for (int j=0; j<nSide; j++) {
+                for (int k=0; k<nSide; k++) {
+                    Vector center((i+0.5)*spacing, (j+0.5)*spacing, (k+0.5)*spacing);
+                    state->addAtom("heavy", center, 0);
+                    state->addAtom("light", center + Vector(bondLength, 0, 0), 0);
+                    state->addAtom("light", center + Vector(bondLength*std::cos(theta), bondLength*std::sin(theta), 0), 0);
+                }
+            }
+        }
+        std::mt19937 generator(2468);
+        std::normal_distribution<double> dist(0, 1);
+        for (Atom &a : state->atoms) {
+            double scale = 1 / std::sqrt(a.mass);
+            a.vel = Vector(dist(generator), dist(generator), dist(generator)) * scale;
+        }
+
+        lj = boost::shared_ptr<FixLJCut>(new FixLJCut(state, "lj"));
+        for (std::string a : {"heavy", "light"}) {
+            for (std::string b : {"heavy", "light"}) {
+                lj->setParameter("sig", a, b, 1);
+                lj->setParameter("eps", a, b, a == "heavy" and b == "heavy" ? 1 : 0.2);
+            }
+        }
+        state->activateFix(lj);
+        lightLength = 2 * bondLength * std::sin(theta / 2);
+    }
+
+    void addConstraints(FixConstraint *fix) {
+        for (int m=0; m<(int) state->atoms.size(); m+=3) {
+            fix->createConstraint(m, m+1, bondLength);
+            fix->createConstraint(m, m+2, bondLength);
+            fix->createConstraint(m+1, m+2, lightLength);
+        }
+        constrained.clear();
+        for (int m=0; m<(int) state->atoms.size(); m+=3) {
+            constrained.push_back({m, m+1, bondLength});
+            constrained.push_back({m, m+2, bondLength});
+            constrained.push_back({m+1, m+2, lightLength});
+        }
+    }
+
+    Vector minImage(Vector dr) {
+        for (int k=0; k<3; k++) {
+            dr[k] -= side * std::round(dr[k] / side);
+        }
+        return dr;
+    }
+
+    //checks the largest relative error in a constrained length, and the largest speed along a constraint
+    //relative to the speed of the faster of its atoms
+    void checkConstraints(double lengthTol, double speedTol) {
+        double maxLengthErr = 0;
+        double maxSpeedErr = 0;
+        for (Constrained &c : constrained) {
+            Atom &a = state->idToAtom(c.idA);
+            Atom &b = state->idToAtom(c.idB);
+            Vector dr = minImage(a.pos - b.pos);
+            double len = dr.len();
+            maxLengthErr = std::fmax(maxLengthErr, std::fabs(len - c.length) / c.length);
+            double speedAlong = (a.vel - b.vel).dot(dr) / len;
+            double speed = std::fmax(a.vel.len(), b.vel.len());
+            maxSpeedErr = std::fmax(maxSpeedErr, std::fabs(speedAlong) / speed);
+        }
+        EXPECT_LT(maxLengthErr, lengthTol);
+        EXPECT_LT(maxSpeedErr, speedTol);
+    }
+
+    struct Constrained {
+        int idA, idB;
+        double length;
+    };
+
+    double side, bondLength, lightLength;
+    std::vector<Constrained> constrained;
+    boost::shared_ptr<State> state;
+    boost::shared_ptr<FixLJCut> lj;
+};
+
+//SHAKE holds lengths to its tolerance (1e-5 relative).  RATTLE's tolerance is on the change in length per step,
+//so the speed left along a bond is up to 1e-5*length/dt, about 0.5% of a light atom's thermal speed.  Unconstrained,
+//it would be of the order of the thermal speed
+TEST_F(FixConstraintTest, ShakeRattle) {
+    boost::shared_ptr<FixShake> shake(new FixShake(state, "shake"));
+    addConstraints(shake.get());
+    state->activateFix(shake);
+    IntegratorVerlet integrator(state.get());
+    integrator.run(500);
+    checkConstraints(5e-5, 1e-2);
+}
+
+//P-LINCS truncates the matrix expansion, so lengths are only as good as its order and iterations allow.  Coupled
+//triangles converge slowly, so a higher order than the default is used, as recommended for angle constraints
+TEST_F(FixConstraintTest, LINCS) {
+    boost::shared_ptr<FixLINCS> lincs(new FixLINCS(state, "lincs", 8, 2));
+    addConstraints(lincs.get());
+    state->activateFix(lincs);
+    IntegratorVerlet integrator(state.get());
+    integrator.run(500);
+    checkConstraints(1e-3, 1e-2);
+}
+
+int main(int argc, char *argv[])
+{
+    //State and the fixes keep python lists
+    Py_Initialize();
+    ::testing::InitGoogleTest(&argc,argv);
+    int ret = RUN_ALL_TESTS();
+    return ret;
+}
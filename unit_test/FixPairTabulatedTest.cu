@@ -0,0 +1,132 @@
+#include "GPUArrayDeviceGlobal.h"
+#include "PairEvaluatorLJ.h"
+#include "PairEvaluatorTabulated.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+__global__ void tabulatedForces(int n, float *rs, EvaluatorTabulated eval, float *params, float *forces)
+{
+    int idx = GETIDX();
+    if (idx < n) {
+        float p[4] = {params[0], params[1], params[2], params[3]};
+        float3 dr = make_float3(rs[idx], 0, 0);
+        forces[idx] = eval.force(dr, p, rs[idx]*rs[idx], 1).x;
+    }
+}
+
+//Tables built the way FixPairTabulated::prepareForRun builds them, from the analytic (shifted) LJ energy and force
+class FixPairTabulatedTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        eps = 1.3;
+        sig = 0.9;
+        rMin = 0.7;
+        rCut = 2.5;
+        nPoints = 1000;
+        int nIntervals = nPoints - 1;
+        double dr = (rCut - rMin) / nIntervals;
+        std::vector<double> engs(nPoints);
+        std::vector<double> forces(nPoints);
+        for (int k=0; k<nPoints; k++) {
+            double r = rMin + k*dr;
+            engs[k] = ljEnergy(r) - ljEnergy(rCut);
+            forces[k] = ljForce(r);
+        }
+        for (int k=0; k<nIntervals; k++) {
+            table.push_back(tabulatedInterval(engs[k], engs[k+1], forces[k], forces[k+1], dr));
+        }
+        tabParams[0] = rCut*rCut;
+        tabParams[1] = rMin;
+        tabParams[2] = nIntervals / (rCut - rMin);
+        tabParams[3] = 0;
+
+        float sig6 = std::pow(sig, 6);
+        ljParams[0] = rCut*rCut;
+        ljParams[1] = 24*eps;
+        ljParams[2] = sig6;
+
+        for (double r=0.8; r<2.45; r+=0.0137) {
+            rs.push_back(r);
+        }
+    }
+
+    double ljEnergy(double r) {
+        double sr6 = std::pow(sig/r, 6);
+        return 4*eps*(sr6*sr6 - sr6);
+    }
+
+    double ljForce(double r) {
+        double sr6 = std::pow(sig/r, 6);
+        return 24*eps*(2*sr6*sr6 - sr6) / r;
+    }
+
+    double eps, sig, rMin, rCut;
+    int nPoints;
+    std::vector<float4> table;
+    float tabParams[4];
+    float ljParams[3];
+    std::vector<float> rs;
+};
+
+TEST_F(FixPairTabulatedTest, HostMatchesLJ) {
+    EvaluatorTabulated tabulated(nullptr, table.data(), nPoints-1);
+    EvaluatorLJ lj;
+    for (float r : rs) {
+        float3 dr = make_float3(r*0.48f, -r*0.6f, r*0.64f);
+        float lenSqr = lengthSqr(dr);
+        float3 fTab = tabulated.force(dr, tabParams, lenSqr, 1);
+        float3 fLJ = lj.force(dr, ljParams, lenSqr, 1);
+        float tol = 1e-3f * (length(fLJ) + 1);
+        EXPECT_NEAR(fLJ.x, fTab.x, tol) << "r = " << r;
+        EXPECT_NEAR(fLJ.y, fTab.y, tol) << "r = " << r;
+        EXPECT_NEAR(fLJ.z, fTab.z, tol) << "r = " << r;
+
+        float eTab = tabulated.energy(tabParams, lenSqr, 1);
+        float eLJ = lj.energy(ljParams, lenSqr, 1);
+        EXPECT_NEAR(eLJ, eTab, 1e-3f * (std::fabs(eLJ) + 1)) << "r = " << r;
+    }
+}
+
+TEST_F(FixPairTabulatedTest, ExcludedAndMissingPairs) {
+    EvaluatorTabulated tabulated(nullptr, table.data(), nPoints-1);
+    float3 dr = make_float3(1.1, 0, 0);
+    float3 f = tabulated.force(dr, tabParams, 1.21, 0);
+    EXPECT_FLOAT_EQ(0, f.x);
+    EXPECT_FLOAT_EQ(0, tabulated.energy(tabParams, 1.21, 0));
+
+    float noTable[4] = {tabParams[0], tabParams[1], tabParams[2], -1};
+    f = tabulated.force(dr, noTable, 1.21, 1);
+    EXPECT_FLOAT_EQ(0, f.x);
+    EXPECT_FLOAT_EQ(0, tabulated.energy(noTable, 1.21, 1));
+}
+
+TEST_F(FixPairTabulatedTest, DeviceMatchesLJ) {
+    int n = rs.size();
+    GPUArrayDeviceGlobal<float> rs_d(n);
+    GPUArrayDeviceGlobal<float4> table_d(table.size());
+    GPUArrayDeviceGlobal<float> params_d(4);
+    GPUArrayDeviceGlobal<float> forces_d(n);
+    rs_d.set(rs.data());
+    table_d.set(table.data());
+    params_d.set(tabParams);
+
+    EvaluatorTabulated tabulated(table_d.data(), nullptr, nPoints-1);
+    tabulatedForces<<<NBLOCK(n), PERBLOCK>>>(n, rs_d.data(), tabulated, params_d.data(), forces_d.data());
+
+    std::vector<float> forces(n);
+    forces_d.get(forces.data());
+    for (int i=0; i<n; i++) {
+        float fLJ = ljForce(rs[i]);
+        EXPECT_NEAR(fLJ, forces[i], 1e-3f * (std::fabs(fLJ) + 1)) << "r = " << rs[i];
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc,argv);
+    int ret = RUN_ALL_TESTS();
+    return ret;
+}
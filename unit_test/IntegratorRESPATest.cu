@@ -0,0 +1,164 @@
+#include "State.h"
+#include "FixLJCut.h"
+#include "FixBondHarmonic.h"
+#include "IntegratorVerlet.h"
+#include "IntegratorRESPA.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+//LJ dimers held together by stiff harmonic bonds.  Bonds go in the inner RESPA level and LJ in the outer one.
+//Bonded atoms are 1-2 neighbors, so they have no LJ interaction
+class IntegratorRESPATest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        nSide = 6;
+        spacing = 2.0;
+        bondLength = 1.0;
+        bondK = 400;
+        rCut = 2.5;
+    }
+
+    void makeState(double dt) {
+        state = boost::shared_ptr<State>(new State());
+        side = nSide*spacing;
+        state->bounds = Bounds(state, Vector(0, 0, 0), Vector(side, side, side));
+        state->rCut = rCut;
+        state->padding = 0.5;
+        state->periodicInterval = 5;
+        state->dt = dt;
+        state->shoutEvery = 100000;
+        state->atomParams.addSpecies("spc1", 1);
+        for (int i=0; i<nSide; i++) {
+            for (int j=0; j<nSide; j++) {
+                for (int k=0; k<nSide; k++) {
+                    Vector center((i+0.5)*spacing, (j+0.5)*spacing, (k+0.5)*spacing);
+                    state->addAtom("spc1", center - Vector(bondLength/2, 0, 0), 0);
+                    state->addAtom("spc1", center + Vector(bondLength/2, 0, 0), 0);
+                }
+            }
+        }
+        //random velocities with no net momentum, the same for every state
+        std::mt19937 generator(4321);
+        std::normal_distribution<double> dist(0, 1);
+        Vector sum(0, 0, 0);
+        for (Atom &a : state->atoms) {
+            a.vel = Vector(dist(generator), dist(generator), dist(generator));
+            sum += a.vel;
+        }
+        for (Atom &a : state->atoms) {
+            a.vel -= sum / (double) state->atoms.size();
+        }
+
+        lj = boost::shared_ptr<FixLJCut>(new FixLJCut(state, "lj"));
+        lj->setParameter("sig", "spc1", "spc1", 1);
+        lj->setParameter("eps", "spc1", "spc1", 1);
+        state->activateFix(lj);
+
+        bonds = boost::shared_ptr<FixBondHarmonic>(new FixBondHarmonic(state, "bonds"));
+        for (int i=0; i<(int) state->atoms.size(); i+=2) {
+            bonds->createBond(&state->atoms[i], &state->atoms[i+1], bondK, bondLength, -1);
+        }
+        state->activateFix(bonds);
+    }
+
+    boost::shared_ptr<IntegratorRESPA> makeRESPA(int innerLoops) {
+        boost::python::list loops;
+        loops.append(innerLoops);
+        boost::shared_ptr<IntegratorRESPA> integrator(new IntegratorRESPA(state.get(), loops));
+        integrator->setLevel(bonds, 0);
+        integrator->setLevel(lj, 1);
+        return integrator;
+    }
+
+    Vector minImage(Vector dr) {
+        for (int k=0; k<3; k++) {
+            dr[k] -= side * std::round(dr[k] / side);
+        }
+        return dr;
+    }
+
+    //total energy from the atoms on the host, with the LJ energy shifted to zero at rCut as in EvaluatorLJ
+    double totalEnergy() {
+        int nAtoms = state->atoms.size();
+        double rc6 = std::pow(rCut, -6);
+        double shift = 4*rc6*(rc6 - 1);
+        double eng = 0;
+        for (int i=0; i<nAtoms; i++) {
+            Atom &a = state->idToAtom(i);
+            eng += 0.5 * a.mass * a.vel.lenSqr();
+            for (int j=i+1; j<nAtoms; j++) {
+                Atom &b = state->idToAtom(j);
+                double r = minImage(a.pos - b.pos).len();
+                if (j == i+1 and i % 2 == 0) {
+                    eng += 0.5 * bondK * (r - bondLength) * (r - bondLength);
+                } else if (r < rCut) {
+                    double r6 = std::pow(r, -6);
+                    eng += 4*r6*(r6 - 1) - shift;
+                }
+            }
+        }
+        return eng;
+    }
+
+    std::vector<Vector> positions() {
+        std::vector<Vector> xs;
+        for (int id=0; id<(int) state->atoms.size(); id++) {
+            xs.push_back(state->idToAtom(id).pos);
+        }
+        return xs;
+    }
+
+    int nSide;
+    double spacing, side, bondLength, bondK, rCut;
+    boost::shared_ptr<State> state;
+    boost::shared_ptr<FixLJCut> lj;
+    boost::shared_ptr<FixBondHarmonic> bonds;
+};
+
+//With one inner step per outer step, RESPA applies the same forces at the same times as velocity Verlet.
+//The two half kicks are summed in a different order, so the trajectories agree to rounding
+TEST_F(IntegratorRESPATest, OneLoopMatchesVerlet) {
+    int nTurns = 50;
+    makeState(0.002);
+    IntegratorVerlet verlet(state.get());
+    verlet.run(nTurns);
+    std::vector<Vector> xsVerlet = positions();
+
+    makeState(0.002);
+    makeRESPA(1)->run(nTurns);
+    std::vector<Vector> xsRESPA = positions();
+
+    ASSERT_EQ(xsVerlet.size(), xsRESPA.size());
+    for (int i=0; i<(int) xsVerlet.size(); i++) {
+        Vector dr = minImage(xsVerlet[i] - xsRESPA[i]);
+        EXPECT_LT(dr.len(), 1e-4) << "atom " << i;
+    }
+}
+
+//The bonds vibrate with a period of about 0.22, which the inner timestep of 0.0025 resolves well.  The
+//outer timestep of 0.01 is only used for the much slower LJ forces
+TEST_F(IntegratorRESPATest, TwoLevelConservesEnergy) {
+    makeState(0.01);
+    boost::shared_ptr<IntegratorRESPA> integrator = makeRESPA(4);
+    double eng0 = totalEnergy();
+    double maxDrift = 0;
+    for (int segment=0; segment<10; segment++) {
+        integrator->run(100);
+        maxDrift = std::fmax(maxDrift, std::fabs(totalEnergy() - eng0));
+    }
+    int nAtoms = state->atoms.size();
+    EXPECT_LT(maxDrift / nAtoms, 5e-3) << "initial energy " << eng0;
+}
+
+int main(int argc, char *argv[])
+{
+    //State and the fixes keep python lists
+    Py_Initialize();
+    ::testing::InitGoogleTest(&argc,argv);
+    int ret = RUN_ALL_TESTS();
+    return ret;
+}
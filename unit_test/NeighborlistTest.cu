@@ -0,0 +1,164 @@
+#include "State.h"
+#include "FixLJCut.h"
+#include "FixWCA.h"
+#include "IntegratorVerlet.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+//An LJ liquid started from a jittered lattice.  Each test turns on one way of building or storing the neighbor
+//list, runs so the atoms leave the lattice, rebuilds, and checks the list against every pair within its cutoff
+class NeighborlistTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        state = boost::shared_ptr<State>(new State());
+        int nSide = 10;
+        double spacing = 1.2;
+        side = nSide*spacing;
+        state->bounds = Bounds(state, Vector(0, 0, 0), Vector(side, side, side));
+        state->rCut = 2.5;
+        state->padding = 0.5;
+        state->periodicInterval = 7;
+        state->dt = 0.005;
+        state->shoutEvery = 100000;
+        state->atomParams.addSpecies("spc1", 1);
+        std::mt19937 generator(1357);
+        std::uniform_real_distribution<double> jitter(-0.1, 0.1);
+        std::normal_distribution<double> dist(0, 1);
+        for (int i=0; i<nSide; i++) {
+            for (int j=0; j<nSide; j++) {
+                for (int k=0; k<nSide; k++) {
+                    Vector pos((i+0.5)*spacing, (j+0.5)*spacing, (k+0.5)*spacing);
+                    state->addAtom("spc1", pos + Vector(jitter(generator), jitter(generator), jitter(generator)), 0);
+                }
+            }
+        }
+        for (Atom &a : state->atoms) {
+            a.vel = Vector(dist(generator), dist(generator), dist(generator));
+        }
+
+        lj = boost::shared_ptr<FixLJCut>(new FixLJCut(state, "lj"));
+        lj->setParameter("sig", "spc1", "spc1", 1);
+        lj->setParameter("eps", "spc1", "spc1", 1);
+        state->activateFix(lj);
+    }
+
+    //runs, then builds the list again at the final positions, where it should hold exactly the pairs in range
+    void runAndRebuild(int nTurns) {
+        IntegratorVerlet integrator(state.get());
+        integrator.run(nTurns);
+        state->gridGPU.periodicBoundaryConditions(-1, true);
+    }
+
+    double side;
+    boost::shared_ptr<State> state;
+    boost::shared_ptr<FixLJCut> lj;
+};
+
+//the list the pair kernels read is pruned to rCut + innerPadding from the one built with the full padding
+TEST_F(NeighborlistTest, InnerPruned) {
+    state->innerPadding = 0.2;
+    runAndRebuild(100);
+    EXPECT_TRUE(state->gridGPU.verifyNeighborlists(state->rCut + state->innerPadding));
+}
+
+//a fix with a shorter cutoff reads the start of each row, which must hold exactly its pairs within its cutoff
+//plus padding, while the whole row still matches the longest cutoff
+TEST_F(NeighborlistTest, SubLists) {
+    boost::shared_ptr<FixWCA> wca(new FixWCA(state, "wca"));
+    wca->setParameter("sig", "spc1", "spc1", 1);
+    wca->setParameter("eps", "spc1", "spc1", 1);
+    state->activateFix(wca);
+    runAndRebuild(100);
+    GridGPU &grid = state->gridGPU;
+    ASSERT_EQ((int) grid.subListRCuts.size(), 1);
+    float subListRCut = grid.subListRCuts[0];
+    EXPECT_LT(subListRCut, state->rCut);
+    EXPECT_TRUE(grid.verifyNeighborlists(subListRCut + state->padding, grid.neighborCounts(subListRCut)));
+    EXPECT_TRUE(grid.verifyNeighborlists(state->rCut + state->padding));
+}
+
+//in a box mostly empty, only the occupied cells are stored and found through a hash table
+TEST_F(NeighborlistTest, SparseCells) {
+    side = 72;
+    state->bounds = Bounds(state, Vector(0, 0, 0), Vector(side, side, side));
+    runAndRebuild(100);
+    GridGPU &grid = state->gridGPU;
+    EXPECT_TRUE(grid.sparseCells);
+    EXPECT_TRUE(grid.verifyNeighborlists(state->rCut + state->padding));
+}
+
+//builds after the first leave room for a fixed number of neighbors and skip counting.  With too little room, the
+//rows that did not fit are dropped and the list must be counted and built again before it is used
+TEST_F(NeighborlistTest, SinglePassOverflow) {
+    runAndRebuild(100);
+    GridGPU &grid = state->gridGPU;
+    ASSERT_GT(grid.singlePassCapacity, 0);
+    EXPECT_TRUE(grid.verifyNeighborlists(state->rCut + state->padding));
+
+    grid.singlePassCapacity = 2;
+    grid.periodicBoundaryConditions(-1, true);
+    EXPECT_NE(grid.singlePassCapacity, 2);
+    EXPECT_TRUE(grid.verifyNeighborlists(state->rCut + state->padding));
+}
+
+//the compressed list is decoded as the pair kernels decode it
+TEST_F(NeighborlistTest, Compressed) {
+    state->compressNeighborlist = true;
+    runAndRebuild(100);
+    GridGPU &grid = state->gridGPU;
+    EXPECT_TRUE(grid.neighborlistCompressedValid);
+    EXPECT_TRUE(grid.verifyNeighborlists(state->rCut + state->padding));
+}
+
+//compressed lists are pruned into the inner list without decoding, keeping each sub-list at the start of its row
+TEST_F(NeighborlistTest, CompressedInnerSubLists) {
+    state->compressNeighborlist = true;
+    state->innerPadding = 0.2;
+    boost::shared_ptr<FixWCA> wca(new FixWCA(state, "wca"));
+    wca->setParameter("sig", "spc1", "spc1", 1);
+    wca->setParameter("eps", "spc1", "spc1", 1);
+    state->activateFix(wca);
+    runAndRebuild(100);
+    GridGPU &grid = state->gridGPU;
+    EXPECT_TRUE(grid.neighborlistCompressedValid);
+    ASSERT_EQ((int) grid.subListRCuts.size(), 1);
+    float subListRCut = grid.subListRCuts[0];
+    EXPECT_TRUE(grid.verifyNeighborlists(subListRCut + state->innerPadding, grid.neighborCounts(subListRCut)));
+    EXPECT_TRUE(grid.verifyNeighborlists(state->rCut + state->innerPadding));
+}
+
+//cells numbered along a space-filling curve must each get a distinct number, and atoms must be sorted by it.  The box
+//is not a cube and not every cell count is a power of two, so the curve also covers cells outside the grid
+TEST_F(NeighborlistTest, CurveCellOrder) {
+    state->bounds = Bounds(state, Vector(0, 0, 0), Vector(side, side + 2.4, side + 4.8));
+    for (std::string order : {"morton", "hilbert"}) {
+        state->setGridOrder(order);
+        runAndRebuild(20);
+        GridGPU &grid = state->gridGPU;
+        int numGridCells = grid.ns.x * grid.ns.y * grid.ns.z;
+        ASSERT_EQ((int) grid.cellOrder.size(), numGridCells) << order;
+        std::vector<int> ranks = grid.cellOrder.h_data;
+        std::sort(ranks.begin(), ranks.end());
+        for (int i=0; i<numGridCells; i++) {
+            ASSERT_EQ(ranks[i], i) << order;
+        }
+        grid.perCellArray.dataToHost();
+        cudaDeviceSynchronize();
+        GPUArrayDeviceGlobal<int> unused;
+        EXPECT_TRUE(grid.checkSorting(state->gpd.activeIdx(), (int *) grid.perCellArray.h_data.data(), unused)) << order;
+        EXPECT_TRUE(grid.verifyNeighborlists(state->rCut + state->padding)) << order;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    //State and the fixes keep python lists
+    Py_Initialize();
+    ::testing::InitGoogleTest(&argc,argv);
+    int ret = RUN_ALL_TESTS();
+    return ret;
+}
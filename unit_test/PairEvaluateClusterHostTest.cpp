@@ -0,0 +1,252 @@
+#include "ClusterPairsHost.h"
+#include "PairEvaluateClusterHost.h"
+#include "PairEvaluatorLJ.h"
+#include "ChargeEvaluatorNone.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+//Periodic LJ systems with some 1-2 and 1-3 pairs.  Atoms are sorted by grid cell, as
+//GridGPU::periodicBoundaryConditionsHost leaves them, and the cluster-pair list is built with
+//buildClusterPairListHost.  Forces, virials and energies are checked against a brute force atom list
+//which includes every periodic image within the cutoff, so boxes smaller than twice the cutoff, where
+//clusters pair with their own images, are covered as well
+class PairEvaluateClusterHostTest : public ::testing::Test {
+protected:
+    void init(int nAtoms_, float side_, int seed) {
+        nAtoms = nAtoms_;
+        side = side_;
+        numTypes = 2;
+        rCut = 2.5;
+        neighCut = 2.8;
+        float rCuts[2] = {rCut, 2.2f};
+        float eps[2][2] = {{1.0, 0.8}, {0.8, 0.6}};
+        float sig[2][2] = {{1.0, 1.1}, {1.1, 1.2}};
+        params.resize(3*numTypes*numTypes);
+        for (int a=0; a<numTypes; a++) {
+            for (int b=0; b<numTypes; b++) {
+                int sqrIdx = squareVectorIndex(numTypes, a, b);
+                float r = a == 1 and b == 1 ? rCuts[1] : rCuts[0];
+                params[sqrIdx] = r*r;
+                params[numTypes*numTypes + sqrIdx] = 24*eps[a][b];
+                params[2*numTypes*numTypes + sqrIdx] = std::pow(sig[a][b], 6);
+            }
+        }
+
+        //cells at least neighCut wide, atoms sorted by cell.  ids record the original order for the exclusions
+        int nCell = std::max(1, (int) (side / neighCut));
+        ns = make_int3(nCell, nCell, nCell);
+        ds = make_float3(side / nCell, side / nCell, side / nCell);
+        os = make_float3(0, 0, 0);
+        std::mt19937 generator(seed);
+        std::uniform_real_distribution<float> dist(0, side);
+        std::vector<float4> unsorted(nAtoms);
+        std::vector<int> cellOfAtom(nAtoms);
+        gridCellArrayIdxs.assign(nCell*nCell*nCell + 1, 0);
+        for (int i=0; i<nAtoms; i++) {
+            unsorted[i] = make_float4(dist(generator), dist(generator), dist(generator), 0);
+            int type = i % numTypes;
+            unsorted[i].w = *(float *) &type;
+            int3 sqrIdx = make_int3((make_float3(unsorted[i]) - os) / ds);
+            cellOfAtom[i] = LINEARIDX(sqrIdx, ns);
+            gridCellArrayIdxs[cellOfAtom[i]]++;
+        }
+        cumulativeSum(gridCellArrayIdxs.data(), gridCellArrayIdxs.size());
+        std::vector<uint32_t> cellFill(gridCellArrayIdxs);
+        xs.resize(nAtoms);
+        ids.resize(nAtoms);
+        for (int i=0; i<nAtoms; i++) {
+            int idx = cellFill[cellOfAtom[i]]++;
+            xs[idx] = unsorted[i];
+            ids[idx] = i;
+        }
+
+        float3 trace = make_float3(side, side, side);
+        float3 periodic = make_float3(1, 1, 1);
+        std::function<uint (int, int)> exclusionTag = [&] (int a, int b) { return tag(a, b) << 30; };
+        buildClusterPairListHost(xs.data(), gridCellArrayIdxs.data(), ns, os, ds, nullptr, periodic, trace,
+                                 neighCut*neighCut, exclusionTag, clusterIdxs, cellClusterIdxs, clusterPairIdxs,
+                                 clusterPairs);
+        nClusters = clusterIdxs.size() / HOST_CLUSTER_SIZE;
+    }
+
+    //1-2 for consecutive ids, 1-3 for ids two apart
+    uint tag(int a, int b) {
+        int diff = std::abs((int) ids[a] - (int) ids[b]);
+        return diff == 1 ? 1 : (diff == 2 ? 2 : 0);
+    }
+
+    void computeCluster(std::vector<float4> &fs, std::vector<Virial> &virials, std::vector<float> &engs) {
+        fs.assign(nAtoms, make_float4(0, 0, 0, 0));
+        virials.assign(nAtoms, Virial(0, 0, 0, 0, 0, 0));
+        engs.assign(nAtoms, 0);
+        compute_force_cluster_host<EvaluatorLJ, true, 3, true, ChargeEvaluatorNone, false>(
+                nAtoms, nClusters, clusterIdxs.data(), clusterPairIdxs.data(), clusterPairs.data(), xs.data(),
+                fs.data(), params.data(), numTypes, 0, 0.5, 1, virials.data(), nullptr, 0, forceScratch,
+                virialScratch, EvaluatorLJ(), ChargeEvaluatorNone());
+        compute_energy_cluster_host<EvaluatorLJ, true, 3, ChargeEvaluatorNone, false>(
+                nAtoms, nClusters, clusterIdxs.data(), clusterPairIdxs.data(), clusterPairs.data(), xs.data(),
+                engs.data(), params.data(), numTypes, 0, 0.5, 1, nullptr, 0, engScratch, EvaluatorLJ(),
+                ChargeEvaluatorNone());
+    }
+
+    //every image of every other atom, and the atom's own images, within the cutoff, in double
+    void computeBruteForce(std::vector<double3> &fs, std::vector<std::vector<double> > &virials, std::vector<double> &engs) {
+        float multipliers[4] = {1, 0, 0.5, 1};
+        fs.assign(nAtoms, make_double3(0, 0, 0));
+        virials.assign(nAtoms, std::vector<double>(6, 0));
+        engs.assign(nAtoms, 0);
+        int sqrSize = numTypes*numTypes;
+        for (int i=0; i<nAtoms; i++) {
+            int typeI = *(int *) &xs[i].w;
+            for (int j=0; j<nAtoms; j++) {
+                int typeJ = *(int *) &xs[j].w;
+                int sqrIdx = squareVectorIndex(numTypes, typeI, typeJ);
+                float p[3] = {params[sqrIdx], params[sqrSize + sqrIdx], params[2*sqrSize + sqrIdx]};
+                float multiplier = multipliers[tag(i, j)];
+                for (int sx=-1; sx<=1; sx++) {
+                    for (int sy=-1; sy<=1; sy++) {
+                        for (int sz=-1; sz<=1; sz++) {
+                            if (i == j and sx == 0 and sy == 0 and sz == 0) {
+                                continue;
+                            }
+                            float3 shift = make_float3(sx, sy, sz) * side;
+                            float3 dr = make_float3(xs[i]) - (make_float3(xs[j]) + shift);
+                            float lenSqr = lengthSqr(dr);
+                            if (lenSqr >= p[0]) {
+                                continue;
+                            }
+                            float3 force = EvaluatorLJ().force(dr, p, lenSqr, multiplier);
+                            fs[i].x += force.x;
+                            fs[i].y += force.y;
+                            fs[i].z += force.z;
+                            double w[6] = {force.x*dr.x, force.y*dr.y, force.z*dr.z, force.x*dr.y, force.x*dr.z, force.y*dr.z};
+                            for (int k=0; k<6; k++) {
+                                virials[i][k] += 0.5*w[k];
+                            }
+                            engs[i] += EvaluatorLJ().energy(p, lenSqr, multiplier);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void checkAgainstBruteForce() {
+        std::vector<float4> fs;
+        std::vector<Virial> virials;
+        std::vector<float> engs;
+        computeCluster(fs, virials, engs);
+        std::vector<double3> fsRef;
+        std::vector<std::vector<double> > virialsRef;
+        std::vector<double> engsRef;
+        computeBruteForce(fsRef, virialsRef, engsRef);
+        for (int i=0; i<nAtoms; i++) {
+            double tol = 1e-4 * (std::sqrt(fsRef[i].x*fsRef[i].x + fsRef[i].y*fsRef[i].y + fsRef[i].z*fsRef[i].z) + 1);
+            EXPECT_NEAR(fsRef[i].x, fs[i].x, tol) << "atom " << i;
+            EXPECT_NEAR(fsRef[i].y, fs[i].y, tol) << "atom " << i;
+            EXPECT_NEAR(fsRef[i].z, fs[i].z, tol) << "atom " << i;
+            for (int k=0; k<6; k++) {
+                EXPECT_NEAR(virialsRef[i][k], virials[i][k], 1e-4 * (std::fabs(virialsRef[i][k]) + 1))
+                    << "atom " << i << ", component " << k;
+            }
+            EXPECT_NEAR(engsRef[i], engs[i], 1e-4 * (std::fabs(engsRef[i]) + 1)) << "atom " << i;
+        }
+    }
+
+    void setThreads(int n) {
+#ifdef _OPENMP
+        omp_set_num_threads(n);
+#endif
+    }
+
+    int nAtoms;
+    float side;
+    int numTypes;
+    float rCut, neighCut;
+    int3 ns;
+    float3 ds, os;
+    std::vector<float4> xs;
+    std::vector<uint> ids;
+    std::vector<uint32_t> gridCellArrayIdxs;
+    std::vector<float> params;
+    int nClusters;
+    std::vector<int> clusterIdxs, cellClusterIdxs;
+    std::vector<uint32_t> clusterPairIdxs;
+    std::vector<ClusterPair> clusterPairs;
+    std::vector<float3> forceScratch;
+    std::vector<Virial> virialScratch;
+    std::vector<float> engScratch;
+};
+
+TEST_F(PairEvaluateClusterHostTest, MatchesAtomList) {
+    init(600, 12, 1234);
+    setThreads(1);
+    checkAgainstBruteForce();
+    setThreads(4);
+    checkAgainstBruteForce();
+}
+
+//one cell per side, so every cluster meets the other clusters and its own images across all 26 neighboring
+//cells.  Only the positively shifted self images are stored, and the force on each atom still includes both
+TEST_F(PairEvaluateClusterHostTest, SmallBoxSelfImages) {
+    init(40, 4, 99);
+    ASSERT_EQ(1, ns.x);
+    int nSelf = 0;
+    for (int c=0; c<nClusters; c++) {
+        for (uint32_t p=clusterPairIdxs[c]; p<clusterPairIdxs[c+1]; p++) {
+            float3 shift = clusterPairs[p].shift;
+            if (clusterPairs[p].otherCluster == c and lengthSqr(shift) > 0) {
+                EXPECT_TRUE(shift.x > 0 or (shift.x == 0 and (shift.y > 0 or (shift.y == 0 and shift.z > 0))))
+                    << "cluster " << c;
+                nSelf++;
+            }
+        }
+    }
+    EXPECT_GT(nSelf, 0);
+    EXPECT_LE(nSelf, 13*nClusters);
+    setThreads(1);
+    checkAgainstBruteForce();
+    setThreads(3);
+    checkAgainstBruteForce();
+}
+
+//Reports the throughput of the cluster-pair force loop on a liquid-density LJ system.
+//Not a pass/fail check
+TEST_F(PairEvaluateClusterHostTest, PairsPerSecondPerCore) {
+    init(32000, 33.6, 5);
+    int nThreads = 1;
+#ifdef _OPENMP
+    nThreads = omp_get_max_threads();
+#endif
+    int64_t nPairs = 0;
+    for (int c=0; c<nClusters; c++) {
+        for (uint32_t p=clusterPairIdxs[c]; p<clusterPairIdxs[c+1]; p++) {
+            nPairs += __builtin_popcount(clusterPairs[p].mask);
+        }
+    }
+    std::vector<float4> fs(nAtoms, make_float4(0, 0, 0, 0));
+    std::vector<Virial> virials(nAtoms, Virial(0, 0, 0, 0, 0, 0));
+    int nReps = 5;
+    auto start = std::chrono::steady_clock::now();
+    for (int rep=0; rep<nReps; rep++) {
+        compute_force_cluster_host<EvaluatorLJ, true, 3, false, ChargeEvaluatorNone, false>(
+                nAtoms, nClusters, clusterIdxs.data(), clusterPairIdxs.data(), clusterPairs.data(), xs.data(),
+                fs.data(), params.data(), numTypes, 0, 0.5, 1, virials.data(), nullptr, 0, forceScratch,
+                virialScratch, EvaluatorLJ(), ChargeEvaluatorNone());
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "cluster pairs: " << nPairs << " atom pairs in the list, " << nThreads << " threads, "
+              << nPairs * nReps / seconds / nThreads << " pairs/s/core" << std::endl;
+    EXPECT_GT(nPairs, 0);
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc,argv);
+    int ret = RUN_ALL_TESTS();
+    return ret;
+}
@@ -0,0 +1,171 @@
+#include "PairEvaluateIsoHost.h"
+#include "PairEvaluatorLJ.h"
+#include "ChargeEvaluatorNone.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+//A small periodic LJ system with some 1-2 and 1-3 pairs.  The full list is built brute force in index order, the
+//way GridGPU::buildNeighborlistHost sorts its rows, and the half list keeps the entries with otherIdx > idx
+class PairEvaluateIsoHostTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        nAtoms = 600;
+        numTypes = 2;
+        float side = 12;
+        bounds = BoundsGPU(make_float3(0, 0, 0), make_float3(side, side, side), make_float3(1, 1, 1));
+        std::mt19937 generator(1234);
+        std::uniform_real_distribution<float> dist(0, side);
+        for (int i=0; i<nAtoms; i++) {
+            float4 pos = make_float4(dist(generator), dist(generator), dist(generator), 0);
+            int type = i % numTypes;
+            pos.w = *(float *) &type;
+            xs.push_back(pos);
+        }
+        //rCutSqr, 24*eps, sig6 for each type pair, symmetric
+        float rCut = 2.5;
+        float eps[2][2] = {{1.0, 0.8}, {0.8, 0.6}};
+        float sig[2][2] = {{1.0, 1.1}, {1.1, 1.2}};
+        params.resize(3*numTypes*numTypes);
+        for (int a=0; a<numTypes; a++) {
+            for (int b=0; b<numTypes; b++) {
+                int sqrIdx = squareVectorIndex(numTypes, a, b);
+                params[sqrIdx] = rCut*rCut;
+                params[numTypes*numTypes + sqrIdx] = 24*eps[a][b];
+                params[2*numTypes*numTypes + sqrIdx] = std::pow(sig[a][b], 6);
+            }
+        }
+        float neighCutSqr = 2.8*2.8;
+        buildList(neighCutSqr, false, fullCounts, fullList, fullIdxs);
+        buildList(neighCutSqr, true, halfCounts, halfList, halfIdxs);
+    }
+
+    void buildList(float neighCutSqr, bool half, std::vector<uint16_t> &counts, std::vector<uint> &nlist, std::vector<uint32_t> &idxs) {
+        counts.assign(nAtoms, 0);
+        idxs.assign(nAtoms+1, 0);
+        nlist.clear();
+        for (int i=0; i<nAtoms; i++) {
+            idxs[i] = nlist.size();
+            for (int j=half ? i+1 : 0; j<nAtoms; j++) {
+                if (j == i) {
+                    continue;
+                }
+                float3 dr = bounds.minImage(make_float3(xs[i]) - make_float3(xs[j]));
+                if (lengthSqr(dr) < neighCutSqr) {
+                    int diff = std::abs(i - j);
+                    uint neighDist = diff == 1 ? 1 : (diff == 2 ? 2 : 0);
+                    nlist.push_back(j | (neighDist << 30));
+                    counts[i]++;
+                }
+            }
+        }
+        idxs[nAtoms] = nlist.size();
+    }
+
+    void computeFull(std::vector<float4> &fs, std::vector<Virial> &virials, std::vector<float> &engs) {
+        compute_force_iso_host<EvaluatorLJ, true, 3, true, ChargeEvaluatorNone, false>(
+                nAtoms, xs.data(), fs.data(), fullCounts.data(), fullList.data(), fullIdxs.data(), params.data(),
+                numTypes, bounds, 0, 0.5, 1, virials.data(), nullptr, 0, EvaluatorLJ(), ChargeEvaluatorNone());
+        compute_energy_iso_host<EvaluatorLJ, true, 3, ChargeEvaluatorNone, false>(
+                nAtoms, xs.data(), engs.data(), fullCounts.data(), fullList.data(), fullIdxs.data(), params.data(),
+                numTypes, bounds, 0, 0.5, 1, nullptr, 0, EvaluatorLJ(), ChargeEvaluatorNone());
+    }
+
+    void computeHalf(std::vector<float4> &fs, std::vector<Virial> &virials, std::vector<float> &engs) {
+        compute_force_iso_half_host<EvaluatorLJ, true, 3, true, ChargeEvaluatorNone, false>(
+                nAtoms, xs.data(), fs.data(), halfCounts.data(), halfList.data(), halfIdxs.data(), params.data(),
+                numTypes, bounds, 0, 0.5, 1, virials.data(), nullptr, 0, forceScratch, virialScratch,
+                EvaluatorLJ(), ChargeEvaluatorNone());
+        compute_energy_iso_half_host<EvaluatorLJ, true, 3, ChargeEvaluatorNone, false>(
+                nAtoms, xs.data(), engs.data(), halfCounts.data(), halfList.data(), halfIdxs.data(), params.data(),
+                numTypes, bounds, 0, 0.5, 1, nullptr, 0, engScratch, EvaluatorLJ(), ChargeEvaluatorNone());
+    }
+
+    //forces start nonzero to check that both paths add to them
+    void initialValues(std::vector<float4> &fs, std::vector<Virial> &virials, std::vector<float> &engs) {
+        fs.assign(nAtoms, make_float4(0, 0, 0, 0));
+        for (int i=0; i<nAtoms; i++) {
+            fs[i] = make_float4(0.25f*i, -0.5f, 1, 0);
+        }
+        virials.assign(nAtoms, Virial(0, 0, 0, 0, 0, 0));
+        engs.assign(nAtoms, 0);
+    }
+
+    void setThreads(int n) {
+#ifdef _OPENMP
+        omp_set_num_threads(n);
+#endif
+    }
+
+    int nAtoms;
+    int numTypes;
+    BoundsGPU bounds;
+    std::vector<float4> xs;
+    std::vector<float> params;
+    std::vector<uint16_t> fullCounts, halfCounts;
+    std::vector<uint> fullList, halfList;
+    std::vector<uint32_t> fullIdxs, halfIdxs;
+    std::vector<float3> forceScratch;
+    std::vector<Virial> virialScratch;
+    std::vector<float> engScratch;
+};
+
+TEST_F(PairEvaluateIsoHostTest, HalfListMatchesFullListBitwiseOnOneThread) {
+    setThreads(1);
+    std::vector<float4> fsFull, fsHalf;
+    std::vector<Virial> virialsFull, virialsHalf;
+    std::vector<float> engsFull, engsHalf;
+    initialValues(fsFull, virialsFull, engsFull);
+    initialValues(fsHalf, virialsHalf, engsHalf);
+    computeFull(fsFull, virialsFull, engsFull);
+    computeHalf(fsHalf, virialsHalf, engsHalf);
+    for (int i=0; i<nAtoms; i++) {
+        EXPECT_EQ(fsFull[i].x, fsHalf[i].x) << "atom " << i;
+        EXPECT_EQ(fsFull[i].y, fsHalf[i].y) << "atom " << i;
+        EXPECT_EQ(fsFull[i].z, fsHalf[i].z) << "atom " << i;
+        for (int k=0; k<6; k++) {
+            EXPECT_EQ(virialsFull[i][k], virialsHalf[i][k]) << "atom " << i << ", component " << k;
+        }
+        EXPECT_EQ(engsFull[i], engsHalf[i]) << "atom " << i;
+    }
+}
+
+//With several threads the slices group the terms differently from the full list, but the
+//result is fixed for a given thread count and agrees with the full list to rounding
+TEST_F(PairEvaluateIsoHostTest, HalfListIsReproducibleOnFourThreads) {
+    setThreads(4);
+    std::vector<float4> fsFull, fsHalf, fsHalfAgain;
+    std::vector<Virial> virialsFull, virialsHalf, virialsHalfAgain;
+    std::vector<float> engsFull, engsHalf, engsHalfAgain;
+    initialValues(fsFull, virialsFull, engsFull);
+    initialValues(fsHalf, virialsHalf, engsHalf);
+    initialValues(fsHalfAgain, virialsHalfAgain, engsHalfAgain);
+    computeFull(fsFull, virialsFull, engsFull);
+    computeHalf(fsHalf, virialsHalf, engsHalf);
+    computeHalf(fsHalfAgain, virialsHalfAgain, engsHalfAgain);
+    for (int i=0; i<nAtoms; i++) {
+        EXPECT_EQ(fsHalf[i].x, fsHalfAgain[i].x) << "atom " << i;
+        EXPECT_EQ(fsHalf[i].y, fsHalfAgain[i].y) << "atom " << i;
+        EXPECT_EQ(fsHalf[i].z, fsHalfAgain[i].z) << "atom " << i;
+        for (int k=0; k<6; k++) {
+            EXPECT_EQ(virialsHalf[i][k], virialsHalfAgain[i][k]) << "atom " << i << ", component " << k;
+        }
+        EXPECT_EQ(engsHalf[i], engsHalfAgain[i]) << "atom " << i;
+
+        float3 fFull = make_float3(fsFull[i]);
+        float tol = 1e-4f * (length(fFull) + 1);
+        EXPECT_NEAR(fsFull[i].x, fsHalf[i].x, tol) << "atom " << i;
+        EXPECT_NEAR(fsFull[i].y, fsHalf[i].y, tol) << "atom " << i;
+        EXPECT_NEAR(fsFull[i].z, fsHalf[i].z, tol) << "atom " << i;
+        EXPECT_NEAR(engsFull[i], engsHalf[i], 1e-4f * (std::fabs(engsFull[i]) + 1)) << "atom " << i;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc,argv);
+    int ret = RUN_ALL_TESTS();
+    return ret;
+}